@@ -0,0 +1,131 @@
+/***********************************************************************\
+*
+* Contents: binary IO helpers: little endian and variable length
+*           encoded values
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cassert>
+
+#include "binaryIO.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+void writeVarUInt(std::ostream &outputStream, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    outputStream.put(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  outputStream.put(static_cast<char>(value));
+}
+
+void writeVarInt(std::ostream &outputStream, int64_t value)
+{
+  writeVarUInt(outputStream, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void writeUInt(std::ostream &outputStream, uint64_t value, uint n)
+{
+  assert(n <= 8);
+
+  for (uint i = 0; i < n; i++)
+  {
+    outputStream.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+uint8_t readByte(std::istream &inputStream)
+{
+  int ch = inputStream.get();
+  if (ch == EOF)
+  {
+    throw std::ios_base::failure("unexpected end of data");
+  }
+
+  return static_cast<uint8_t>(ch);
+}
+
+uint64_t readVarUInt(std::istream &inputStream)
+{
+  uint64_t value = 0;
+  for (uint shift = 0; shift < 64; shift += 7)
+  {
+    uint8_t byte = readByte(inputStream);
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      return value;
+    }
+  }
+
+  throw std::ios_base::failure("invalid variable length value");
+}
+
+int64_t readVarInt(std::istream &inputStream)
+{
+  uint64_t value = readVarUInt(inputStream);
+
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+uint64_t readUInt(std::istream &inputStream, uint n)
+{
+  assert(n <= 8);
+
+  uint64_t value = 0;
+  for (uint i = 0; i < n; i++)
+  {
+    value |= static_cast<uint64_t>(readByte(inputStream)) << (8 * i);
+  }
+
+  return value;
+}
+
+void putVarUInt(std::vector<uint8_t> &data, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    data.push_back(static_cast<uint8_t>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  data.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t getVarUInt(const std::vector<uint8_t> &data, size_t &i)
+{
+  uint64_t value = 0;
+  uint     shift = 0;
+  uint8_t  byte;
+  do
+  {
+    assert(i < data.size());
+    byte = data[i++];
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    shift += 7;
+  }
+  while ((byte & 0x80) != 0);
+
+  return value;
+}
+
+/* end of file */
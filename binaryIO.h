@@ -0,0 +1,92 @@
+/***********************************************************************\
+*
+* Contents: binary IO helpers: little endian and variable length
+*           encoded values
+* Systems: all
+*
+\***********************************************************************/
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+
+#include <sys/types.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** write variable length encoded unsigned value: 7 bits per byte, low
+ *  bits first, bit 7 set if more bytes follow
+ * @param outputStream output stream
+ * @param value value
+ */
+void writeVarUInt(std::ostream &outputStream, uint64_t value);
+
+/** write variable length encoded signed value (zig-zag)
+ * @param outputStream output stream
+ * @param value value
+ */
+void writeVarInt(std::ostream &outputStream, int64_t value);
+
+/** write value little endian
+ * @param outputStream output stream
+ * @param value value
+ * @param n number of bytes
+ */
+void writeUInt(std::ostream &outputStream, uint64_t value, uint n);
+
+/** read byte
+ * @param inputStream input stream
+ * @return byte
+ */
+uint8_t readByte(std::istream &inputStream);
+
+/** read variable length encoded unsigned value
+ * @param inputStream input stream
+ * @return value
+ */
+uint64_t readVarUInt(std::istream &inputStream);
+
+/** read variable length encoded signed value (zig-zag)
+ * @param inputStream input stream
+ * @return value
+ */
+int64_t readVarInt(std::istream &inputStream);
+
+/** read value little endian
+ * @param inputStream input stream
+ * @param n number of bytes
+ * @return value
+ */
+uint64_t readUInt(std::istream &inputStream, uint n);
+
+/** append variable length encoded unsigned value to buffer
+ * @param data data
+ * @param value value
+ */
+void putVarUInt(std::vector<uint8_t> &data, uint64_t value);
+
+/** get variable length encoded unsigned value from buffer
+ * @param data data
+ * @param i index in data, advanced
+ * @return value
+ */
+uint64_t getVarUInt(const std::vector<uint8_t> &data, size_t &i);
+
+#endif // BINARY_IO_H
+
+/* end of file */
@@ -0,0 +1,634 @@
+/***********************************************************************\
+*
+* Contents: coastlines: vectorized island outlines
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <tuple>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cassert>
+
+#include "parallel.h"
+#include "binaryIO.h"
+
+#include "coastlines.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// cell rows per parallel band
+LOCAL const uint BAND_SIZE          = 64;
+// polygons per parallel block of simplify()
+LOCAL const uint POLYGON_BLOCK_SIZE = 64;
+
+// binary file format
+LOCAL const char     BINARY_MAGIC[4] = {'D','W','C','L'};
+LOCAL const uint32_t BINARY_VERSION  = 1;
+
+// no edge
+LOCAL const uint32_t NONE = UINT32_MAX;
+
+// cell edges: top, right, bottom, left
+enum Edges
+{
+  EDGE_TOP,
+  EDGE_RIGHT,
+  EDGE_BOTTOM,
+  EDGE_LEFT,
+  EDGE_NONE
+};
+
+// marching squares segments by cell case (land corners: top left 8, top
+// right 4, bottom right 2, bottom left 1); oriented with land on the
+// left; in the saddle cases 5 and 10 the land corners are connected
+LOCAL const Edges SEGMENTS[16][2][2] =
+{
+  {{EDGE_NONE,   EDGE_NONE  }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_BOTTOM, EDGE_LEFT  }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_RIGHT,  EDGE_BOTTOM}, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_RIGHT,  EDGE_LEFT  }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_TOP,    EDGE_RIGHT }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_TOP,    EDGE_LEFT  }, {EDGE_BOTTOM, EDGE_RIGHT }},
+  {{EDGE_TOP,    EDGE_BOTTOM}, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_TOP,    EDGE_LEFT  }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_LEFT,   EDGE_TOP   }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_BOTTOM, EDGE_TOP   }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_RIGHT,  EDGE_TOP   }, {EDGE_LEFT,   EDGE_BOTTOM}},
+  {{EDGE_RIGHT,  EDGE_TOP   }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_LEFT,   EDGE_RIGHT }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_BOTTOM, EDGE_RIGHT }, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_LEFT,   EDGE_BOTTOM}, {EDGE_NONE,   EDGE_NONE  }},
+  {{EDGE_NONE,   EDGE_NONE  }, {EDGE_NONE,   EDGE_NONE  }},
+};
+
+/***************************** Datatypes *******************************/
+
+/** chain of points inside a band: closed ring or open chain from the
+ *  top to the bottom border of the band
+ */
+struct Chain
+{
+  uint32_t                       label;
+  std::vector<Coastlines::Point> points;
+  bool                           closed;
+};
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** get key of point
+ * @param point point
+ * @return key
+ */
+LOCAL inline uint64_t getKey(const Coastlines::Point &point)
+{
+  return (static_cast<uint64_t>(static_cast<uint32_t>(point.y)) << 32) | static_cast<uint32_t>(point.x);
+}
+
+/** get twice the signed area of ring
+ * @param ring ring
+ * @return twice the signed area; negative for outer rings
+ */
+LOCAL int64_t getArea2(const Coastlines::Ring &ring)
+{
+  int64_t area2 = 0;
+  for (size_t i = 0; i < ring.size(); i++)
+  {
+    const Coastlines::Point &p0 = ring[i];
+    const Coastlines::Point &p1 = ring[(i + 1) % ring.size()];
+    area2 += static_cast<int64_t>(p0.x) * p1.y - static_cast<int64_t>(p1.x) * p0.y;
+  }
+
+  return area2;
+}
+
+/** extract chains of a band of cell rows
+ * @param map map
+ * @param width,height map size
+ * @param cy0,cy1 cell rows [cy0,cy1); cell x/y has the tile centers x/y
+ *                and x+1/y+1 as corners, x,y in [-1,width-1] resp.
+ *                [-1,height-1]
+ * @param chains extracted chains
+ */
+LOCAL void extractBand(const Map &map, uint width, uint height, int cy0, int cy1, std::vector<Chain> &chains)
+{
+  const LandMask &landMask = map.getLandMask();
+  const uint     rows      = cy1 - cy0;
+
+  // edges: horizontal (top) edges of the rows [cy0,cy1], then vertical
+  // (left) edges of the rows [cy0,cy1)
+  const uint32_t horizontalCount = (rows + 1) * (width + 1);
+  const uint32_t edgeCount       = horizontalCount + rows * (width + 2);
+  auto getHorizontalEdge = [&](int cx, int cy) -> uint32_t { return (cy - cy0) * (width + 1) + (cx + 1); };
+  auto getVerticalEdge   = [&](int cx, int cy) -> uint32_t { return horizontalCount + (cy - cy0) * (width + 2) + (cx + 1); };
+  auto getPoint = [&](uint32_t edge) -> Coastlines::Point
+  {
+    if (edge < horizontalCount)
+    {
+      int cx = static_cast<int>(edge % (width + 1)) - 1;
+      int cy = static_cast<int>(edge / (width + 1)) + cy0;
+      return Coastlines::Point(2 * cx + 2, 2 * cy + 1);
+    }
+    else
+    {
+      int cx = static_cast<int>((edge - horizontalCount) % (width + 2)) - 1;
+      int cy = static_cast<int>((edge - horizontalCount) / (width + 2)) + cy0;
+      return Coastlines::Point(2 * cx + 1, 2 * cy + 2);
+    }
+  };
+
+  std::vector<uint32_t> nextEdges(edgeCount, NONE);
+  std::vector<uint32_t> labels(edgeCount, 0);
+  std::vector<bool>     hasPrevious(edgeCount, false);
+
+  // marching squares; tiles outside of the map are water
+  std::vector<uint8_t> landRows[2] = {std::vector<uint8_t>(width + 2, 0), std::vector<uint8_t>(width + 2, 0)};
+  auto getLandRow = [&](int y, std::vector<uint8_t> &landRow)
+  {
+    if ((y >= 0) && (y < static_cast<int>(height)))
+    {
+      for (uint x = 0; x < width; x++)
+      {
+        landRow[x + 1] = landMask.get(x, y) ? 1 : 0;
+      }
+    }
+    else
+    {
+      std::fill(landRow.begin(), landRow.end(), 0);
+    }
+  };
+  getLandRow(cy0, landRows[1]);
+  for (int cy = cy0; cy < cy1; cy++)
+  {
+    landRows[0].swap(landRows[1]);
+    getLandRow(cy + 1, landRows[1]);
+
+    const uint8_t *top    = landRows[0].data();
+    const uint8_t *bottom = landRows[1].data();
+    for (int cx = -1; cx < static_cast<int>(width); cx++)
+    {
+      uint cellCase =   (top   [cx + 1] << 3)
+                      | (top   [cx + 2] << 2)
+                      | (bottom[cx + 2] << 1)
+                      | (bottom[cx + 1] << 0);
+      if ((cellCase == 0) || (cellCase == 15))
+      {
+        continue;
+      }
+
+      // all land corners of a cell are connected: label of any of them
+      uint32_t label;
+      if      (top   [cx + 1]) label = map.getIslandLabel(cx,     cy    );
+      else if (top   [cx + 2]) label = map.getIslandLabel(cx + 1, cy    );
+      else if (bottom[cx + 2]) label = map.getIslandLabel(cx + 1, cy + 1);
+      else                     label = map.getIslandLabel(cx,     cy + 1);
+
+      const uint32_t edges[4] =
+      {
+        getHorizontalEdge(cx,     cy    ),
+        getVerticalEdge  (cx + 1, cy    ),
+        getHorizontalEdge(cx,     cy + 1),
+        getVerticalEdge  (cx,     cy    )
+      };
+      for (uint i = 0; (i < 2) && (SEGMENTS[cellCase][i][0] != EDGE_NONE); i++)
+      {
+        uint32_t from = edges[SEGMENTS[cellCase][i][0]];
+        uint32_t to   = edges[SEGMENTS[cellCase][i][1]];
+
+        assert(nextEdges[from] == NONE);
+        nextEdges[from] = to;
+        labels[from]    = label;
+        hasPrevious[to] = true;
+      }
+    }
+  }
+
+  // open chains: start at an edge without previous edge (top border of
+  // band), end at an edge without next edge (bottom border of band)
+  auto follow = [&](uint32_t edge, bool closed)
+  {
+    Chain chain;
+    chain.label  = labels[edge];
+    chain.closed = closed;
+    do
+    {
+      chain.points.push_back(getPoint(edge));
+      uint32_t next = nextEdges[edge];
+      nextEdges[edge] = NONE;
+      edge = next;
+    }
+    while ((edge != NONE) && (nextEdges[edge] != NONE));
+    if (!closed)
+    {
+      assert(edge != NONE);
+      chain.points.push_back(getPoint(edge));
+    }
+    chains.push_back(chain);
+  };
+  for (uint32_t edge = 0; edge < edgeCount; edge++)
+  {
+    if ((nextEdges[edge] != NONE) && !hasPrevious[edge])
+    {
+      follow(edge, false);
+    }
+  }
+
+  // closed rings: remaining edges
+  for (uint32_t edge = 0; edge < edgeCount; edge++)
+  {
+    if (nextEdges[edge] != NONE)
+    {
+      follow(edge, true);
+    }
+  }
+}
+
+/** simplify ring with Douglas-Peucker
+ * @param ring ring
+ * @param tolerance max. distance of removed points [half tiles]
+ */
+LOCAL void simplifyRing(Coastlines::Ring &ring, double tolerance)
+{
+  const size_t n = ring.size();
+  if (n < 4)
+  {
+    return;
+  }
+
+  auto getDistance = [&ring](size_t i, size_t a, size_t b) -> double
+  {
+    const double px = ring[i].x,     py = ring[i].y;
+    const double ax = ring[a].x,     ay = ring[a].y;
+    const double dx = ring[b].x - ax, dy = ring[b].y - ay;
+    const double length2 = dx * dx + dy * dy;
+    double       t       = (length2 > 0.0) ? ((px - ax) * dx + (py - ay) * dy) / length2 : 0.0;
+    t = std::max(0.0, std::min(1.0, t));
+
+    return hypot(px - (ax + t * dx), py - (ay + t * dy));
+  };
+
+  // split closed ring at the first point and the point farthest from it
+  size_t split        = 1;
+  double maxDistance2 = 0.0;
+  for (size_t i = 1; i < n; i++)
+  {
+    double dx = ring[i].x - ring[0].x, dy = ring[i].y - ring[0].y;
+    if ((dx * dx + dy * dy) > maxDistance2)
+    {
+      maxDistance2 = dx * dx + dy * dy;
+      split        = i;
+    }
+  }
+
+  // keep points farther than tolerance from the simplified outline;
+  // index n is the first point again
+  std::vector<bool>                     keep(n + 1, false);
+  std::vector<std::pair<size_t, size_t>> stack;
+  keep[0]     = true;
+  keep[split] = true;
+  keep[n]     = true;
+  stack.push_back(std::make_pair(0, split));
+  stack.push_back(std::make_pair(split, n));
+  while (!stack.empty())
+  {
+    size_t a = stack.back().first;
+    size_t b = stack.back().second;
+    stack.pop_back();
+
+    size_t farthest    = a;
+    double maxDistance = tolerance;
+    for (size_t i = a + 1; i < b; i++)
+    {
+      double distance = getDistance(i, a, b % n);
+      if (distance > maxDistance)
+      {
+        maxDistance = distance;
+        farthest    = i;
+      }
+    }
+    if (farthest != a)
+    {
+      keep[farthest] = true;
+      stack.push_back(std::make_pair(a, farthest));
+      stack.push_back(std::make_pair(farthest, b));
+    }
+  }
+
+  size_t keepCount = std::count(keep.begin(), keep.begin() + n, true);
+  if (keepCount < 3)
+  {
+    return;
+  }
+
+  Coastlines::Ring simplifiedRing;
+  simplifiedRing.reserve(keepCount);
+  for (size_t i = 0; i < n; i++)
+  {
+    if (keep[i])
+    {
+      simplifiedRing.push_back(ring[i]);
+    }
+  }
+  ring.swap(simplifiedRing);
+}
+
+/** write coordinate in tiles
+ * @param outputStream output stream
+ * @param value coordinate [half tiles]
+ */
+LOCAL void writeCoordinate(std::ostream &outputStream, int32_t value)
+{
+  outputStream << (value / 2);
+  if ((value % 2) != 0)
+  {
+    outputStream << ".5";
+  }
+}
+
+void Coastlines::clear()
+{
+  width  = 0;
+  height = 0;
+  polygons.clear();
+}
+
+void Coastlines::extract(const Map &map)
+{
+  clear();
+
+  width  = map.getWidth();
+  height = map.getHeight();
+  if ((width == 0) || (height == 0))
+  {
+    return;
+  }
+  assert(!map.getIslandLabels().empty());
+
+  // chains of bands of cell rows; cell row r has the tile rows r-1 and r
+  // as corners
+  const uint                      bandCount = (height + 1 + BAND_SIZE - 1) / BAND_SIZE;
+  std::vector<std::vector<Chain>> bandChains(bandCount);
+  parallelFor(0, height + 1, BAND_SIZE, [&](uint r0, uint r1)
+  {
+    extractBand(map, width, height, static_cast<int>(r0) - 1, static_cast<int>(r1) - 1, bandChains[r0 / BAND_SIZE]);
+  });
+
+  // stitch open chains at the band borders
+  std::vector<const Chain*>              openChains;
+  std::unordered_map<uint64_t, uint32_t> openChainsByStart;
+  for (const std::vector<Chain> &chains : bandChains)
+  {
+    for (const Chain &chain : chains)
+    {
+      if (!chain.closed)
+      {
+        openChainsByStart[getKey(chain.points.front())] = static_cast<uint32_t>(openChains.size());
+        openChains.push_back(&chain);
+      }
+    }
+  }
+
+  // rings: label, true for outer ring, points
+  typedef std::tuple<uint32_t, bool, Ring> LabeledRing;
+  std::vector<LabeledRing> rings;
+  for (const std::vector<Chain> &chains : bandChains)
+  {
+    for (const Chain &chain : chains)
+    {
+      if (chain.closed)
+      {
+        rings.push_back(LabeledRing(chain.label, getArea2(chain.points) < 0, chain.points));
+      }
+    }
+  }
+  std::vector<bool> used(openChains.size(), false);
+  for (size_t i = 0; i < openChains.size(); i++)
+  {
+    if (used[i])
+    {
+      continue;
+    }
+
+    Ring   ring;
+    size_t j = i;
+    do
+    {
+      used[j] = true;
+      const std::vector<Point> &points = openChains[j]->points;
+      ring.insert(ring.end(), points.begin(), points.end() - 1);
+
+      auto next = openChainsByStart.find(getKey(points.back()));
+      assert(next != openChainsByStart.end());
+      j = next->second;
+    }
+    while (j != i);
+    rings.push_back(LabeledRing(openChains[i]->label, getArea2(ring) < 0, ring));
+  }
+
+  // group rings by island: outer ring first
+  std::stable_sort(rings.begin(),
+                   rings.end(),
+                   [](const LabeledRing &ring1, const LabeledRing &ring2)
+                   {
+                     if (std::get<0>(ring1) != std::get<0>(ring2)) return std::get<0>(ring1) < std::get<0>(ring2);
+                     return std::get<1>(ring1) && !std::get<1>(ring2);
+                   }
+                  );
+  for (LabeledRing &ring : rings)
+  {
+    if (polygons.empty() || (polygons.back().label != std::get<0>(ring)))
+    {
+      polygons.push_back(Polygon());
+      polygons.back().label = std::get<0>(ring);
+    }
+    polygons.back().rings.push_back(Ring());
+    polygons.back().rings.back().swap(std::get<2>(ring));
+  }
+}
+
+void Coastlines::simplify(double tolerance)
+{
+  parallelFor(0, polygons.size(), POLYGON_BLOCK_SIZE, [&](uint i0, uint i1)
+  {
+    for (uint i = i0; i < i1; i++)
+    {
+      for (Ring &ring : polygons[i].rings)
+      {
+        simplifyRing(ring, 2.0 * tolerance);
+      }
+    }
+  });
+}
+
+size_t Coastlines::getPointCount() const
+{
+  size_t pointCount = 0;
+  for (const Polygon &polygon : polygons)
+  {
+    for (const Ring &ring : polygon.rings)
+    {
+      pointCount += ring.size();
+    }
+  }
+
+  return pointCount;
+}
+
+void Coastlines::loadBinary(const std::string &filePath)
+{
+  std::ifstream inputStream(filePath, std::ios::binary);
+  if (!inputStream.is_open())
+  {
+    std::stringstream buffer;
+    buffer << "cannot open coastlines file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  char magic[4];
+  if (   !inputStream.read(magic, sizeof(magic))
+      || !std::equal(magic, magic + sizeof(magic), BINARY_MAGIC)
+      || (readUInt(inputStream, 4) != BINARY_VERSION)
+     )
+  {
+    std::stringstream buffer;
+    buffer << "invalid coastlines file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  clear();
+  width  = static_cast<uint>(readUInt(inputStream, 4));
+  height = static_cast<uint>(readUInt(inputStream, 4));
+
+  Point  last;
+  size_t polygonCount = readVarUInt(inputStream);
+  for (size_t i = 0; i < polygonCount; i++)
+  {
+    Polygon polygon;
+    polygon.label = static_cast<uint32_t>(readVarUInt(inputStream));
+    polygon.rings.resize(readVarUInt(inputStream));
+    for (Ring &ring : polygon.rings)
+    {
+      ring.resize(readVarUInt(inputStream));
+      for (Point &point : ring)
+      {
+        point.x = last.x + static_cast<int32_t>(readVarInt(inputStream));
+        point.y = last.y + static_cast<int32_t>(readVarInt(inputStream));
+        last = point;
+      }
+    }
+    polygons.push_back(polygon);
+  }
+}
+
+void Coastlines::saveBinary(const std::string &filePath) const
+{
+  std::ofstream outputStream(filePath, std::ios::binary);
+  if (!outputStream.is_open())
+  {
+    std::stringstream buffer;
+    buffer << "cannot create coastlines file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  // header
+  outputStream.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  writeUInt(outputStream, BINARY_VERSION, 4);
+  writeUInt(outputStream, width, 4);
+  writeUInt(outputStream, height, 4);
+
+  // polygons; points as deltas to the previous point
+  Point last;
+  writeVarUInt(outputStream, polygons.size());
+  for (const Polygon &polygon : polygons)
+  {
+    writeVarUInt(outputStream, polygon.label);
+    writeVarUInt(outputStream, polygon.rings.size());
+    for (const Ring &ring : polygon.rings)
+    {
+      writeVarUInt(outputStream, ring.size());
+      for (const Point &point : ring)
+      {
+        writeVarInt(outputStream, static_cast<int64_t>(point.x) - last.x);
+        writeVarInt(outputStream, static_cast<int64_t>(point.y) - last.y);
+        last = point;
+      }
+    }
+  }
+
+  outputStream.close();
+  if (outputStream.fail())
+  {
+    std::stringstream buffer;
+    buffer << "cannot write coastlines file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+}
+
+void Coastlines::saveGeoJSON(const std::string &filePath) const
+{
+  std::ofstream outputStream(filePath);
+  if (!outputStream.is_open())
+  {
+    std::stringstream buffer;
+    buffer << "cannot create coastlines file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  outputStream << "{" << std::endl;
+  outputStream << "  \"type\": \"FeatureCollection\"," << std::endl;
+  outputStream << "  \"properties\": { \"width\": " << width << ", \"height\": " << height << " }," << std::endl;
+  outputStream << "  \"features\": [" << std::endl;
+  for (size_t i = 0; i < polygons.size(); i++)
+  {
+    const Polygon &polygon = polygons[i];
+
+    outputStream << "    { \"type\": \"Feature\", \"properties\": { \"label\": " << polygon.label << " }, \"geometry\": { \"type\": \"Polygon\", \"coordinates\": [" << std::endl;
+    for (size_t j = 0; j < polygon.rings.size(); j++)
+    {
+      const Ring &ring = polygon.rings[j];
+
+      // rings are closed by repeating the first point
+      outputStream << "      [";
+      for (size_t k = 0; k <= ring.size(); k++)
+      {
+        const Point &point = ring[k % ring.size()];
+        outputStream << ((k > 0) ? ", [" : "[");
+        writeCoordinate(outputStream, point.x);
+        outputStream << ", ";
+        writeCoordinate(outputStream, point.y);
+        outputStream << "]";
+      }
+      outputStream << "]" << (((j + 1) < polygon.rings.size()) ? "," : "") << std::endl;
+    }
+    outputStream << "    ] } }" << (((i + 1) < polygons.size()) ? "," : "") << std::endl;
+  }
+  outputStream << "  ]" << std::endl;
+  outputStream << "}" << std::endl;
+
+  outputStream.close();
+  if (outputStream.fail())
+  {
+    std::stringstream buffer;
+    buffer << "cannot write coastlines file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+}
+
+/* end of file */
@@ -0,0 +1,144 @@
+/***********************************************************************\
+*
+* Contents: coastlines: vectorized island outlines
+* Systems: all
+*
+\***********************************************************************/
+#ifndef COASTLINES_H
+#define COASTLINES_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "islands.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** coastlines: closed polygons along the land/water boundary, extracted
+ *  with marching squares on the tile centers. Land tiles touching
+ *  diagonally are connected, like the islands of Map::findIslands().
+ *  Outside of the map is water, so coastlines do not wrap around.
+ *  Coordinates are in half tiles: tile x/y covers [2x,2x+2) x [2y,2y+2).
+ */
+class Coastlines
+{
+  public:
+    /** point in half tiles
+     */
+    class Point
+    {
+      public:
+        int32_t x, y;
+
+        Point()
+          : x(0)
+          , y(0)
+        {
+        }
+
+        Point(int32_t x, int32_t y)
+          : x(x)
+          , y(y)
+        {
+        }
+
+        bool operator==(const Point &point) const
+        {
+          return (x == point.x) && (y == point.y);
+        }
+    };
+
+    /** ring: closed outline, last point connects to first point; land is
+     *  on the left (y axis pointing down: outer rings counter-clockwise,
+     *  holes clockwise)
+     */
+    typedef std::vector<Point> Ring;
+
+    /** polygon: outlines of an island
+     */
+    class Polygon
+    {
+      public:
+        uint32_t          label;  // island label
+        std::vector<Ring> rings;  // outer ring first, then holes (lakes)
+
+        Polygon()
+          : label(0)
+        {
+        }
+    };
+
+    Coastlines()
+      : width(0)
+      , height(0)
+    {
+    }
+
+    /** clear coastlines
+     */
+    void clear();
+
+    /** extract coastlines of map; rows are processed in parallel bands
+     *  which are stitched afterwards
+     * @param map map; islands must be found with Map::findIslands()
+     */
+    void extract(const Map &map);
+
+    /** simplify rings with Douglas-Peucker; rings which would degenerate
+     *  are kept unchanged
+     * @param tolerance max. distance of removed points [tiles]
+     */
+    void simplify(double tolerance);
+
+    /** get polygons
+     * @return polygons, sorted by island label
+     */
+    const std::vector<Polygon> &getPolygons() const
+    {
+      return polygons;
+    }
+
+    /** get total number of points
+     * @return number of points of all rings
+     */
+    size_t getPointCount() const;
+
+    /** load coastlines from compact binary file
+     * @param filePath file path
+     */
+    void loadBinary(const std::string &filePath);
+
+    /** save coastlines to compact binary file: header, then variable
+     *  length encoded labels, counts and point deltas
+     * @param filePath file path
+     */
+    void saveBinary(const std::string &filePath) const;
+
+    /** save coastlines as GeoJSON feature collection: one polygon feature
+     *  per island, coordinates in tiles
+     * @param filePath file path
+     */
+    void saveGeoJSON(const std::string &filePath) const;
+
+  private:
+    uint                 width, height;
+    std::vector<Polygon> polygons;
+};
+
+#endif // COASTLINES_H
+
+/* end of file */
@@ -0,0 +1,264 @@
+/***********************************************************************\
+*
+* Contents: exact euclidean distance transform of land masks
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+#include "parallel.h"
+
+#include "distanceField.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// rows per parallel block of the row pass
+LOCAL const uint ROW_BLOCK_SIZE    = 64;
+// columns per parallel block of the column pass; columns are copied in
+// blocks, so reading and writing uses full cache lines
+LOCAL const uint COLUMN_BLOCK_SIZE = 16;
+
+// no tile of the searched type
+LOCAL const int64_t INFINITE_SQUARED = -1;
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** integer division rounding down
+ * @param a dividend
+ * @param b divisor, > 0
+ * @return floor(a/b)
+ * Note: exact for |a| < 2^40 and b < 2^20 (the rounding error of the
+ *       double division is smaller than the distance 1/b to the next
+ *       integer); much faster than an integer division
+ */
+LOCAL inline int64_t floorDiv(int64_t a, int64_t b)
+{
+  assert(b > 0);
+
+  return static_cast<int64_t>(floor(static_cast<double>(a) / static_cast<double>(b)));
+}
+
+/** periodic 1D squared distance transform: lower envelope of the
+ *  parabolas (x-i)^2+f(i). The samples are extended by n/2 on both sides,
+ *  because the nearest copy of a sample is never further away.
+ * @param f squared distances or INFINITE_SQUARED
+ * @param n number of samples
+ * @param d transformed squared distances or INFINITE_SQUARED
+ * @param g,s,t,k scratch buffers: extended samples and envelope, at least
+ *                2*n elements
+ */
+LOCAL void transform1D(const int64_t *f, uint n, int64_t *d, int64_t *g, int64_t *s, int64_t *t, int64_t *k)
+{
+  const int64_t h = n / 2;
+  const int64_t m = n + 2 * h;
+
+  // extend samples periodically
+  for (int64_t u = 0; u < h; u++)
+  {
+    g[u]         = f[n - h + u];
+    g[h + n + u] = f[u];
+  }
+  for (int64_t u = 0; u < n; u++)
+  {
+    g[h + u] = f[u];
+  }
+
+  // parabolas of the envelope: position s, start position t and
+  // g(s)+s^2 in k; parabola at v is above the one at u at x iff
+  // (g(v)+v^2)-(g(u)+u^2) > 2x(v-u)
+  int64_t q = -1;
+  for (int64_t u = 0; u < m; u++)
+  {
+    if (g[u] == INFINITE_SQUARED)
+    {
+      continue;
+    }
+
+    const int64_t hu = g[u] + u * u;
+    while ((q >= 0) && ((k[q] - hu) > 2 * t[q] * (s[q] - u)))
+    {
+      q--;
+    }
+    if (q < 0)
+    {
+      q    = 0;
+      s[0] = u;
+      t[0] = 0;
+      k[0] = hu;
+    }
+    else
+    {
+      int64_t w = 1 + floorDiv(hu - k[q], 2 * (u - s[q]));
+      if (w < m)
+      {
+        q++;
+        s[q] = u;
+        t[q] = w;
+        k[q] = hu;
+      }
+    }
+  }
+
+  if (q < 0)
+  {
+    for (uint i = 0; i < n; i++)
+    {
+      d[i] = INFINITE_SQUARED;
+    }
+    return;
+  }
+
+  // evaluate envelope at the not extended positions
+  for (int64_t u = m - 1; u >= h; u--)
+  {
+    if (u < h + n)
+    {
+      d[u - h] = (u - s[q]) * (u - s[q]) + g[s[q]];
+    }
+    if (u == t[q])
+    {
+      q--;
+    }
+  }
+}
+
+void DistanceField::compute(const LandMask &landMask, std::vector<float> &distances)
+{
+  const uint  width    = landMask.getWidth();
+  const uint  height   = landMask.getHeight();
+  const float INFINITE = std::numeric_limits<float>::infinity();
+
+  distances.resize(static_cast<size_t>(width) * height);
+  if ((width == 0) || (height == 0))
+  {
+    return;
+  }
+
+  // row pass: distance to the nearest tile of the other type in the same
+  // row; two laps to wrap around
+  parallelFor(0, height, ROW_BLOCK_SIZE, [&](uint y0, uint y1)
+  {
+    const int64_t NONE = std::numeric_limits<int64_t>::min() / 4;
+
+    std::vector<uint8_t> rowLand(width);
+    for (uint y = y0; y < y1; y++)
+    {
+      float *row = &distances[static_cast<size_t>(y) * width];
+
+      for (uint x = 0; x < width; x++)
+      {
+        rowLand[x] = landMask.get(x, y) ? 1 : 0;
+      }
+
+      int64_t last[2] = {NONE, NONE};
+      for (uint x = 0; x < width; x++)
+      {
+        last[rowLand[x]] = x;
+      }
+      for (uint x = 0; x < width; x++)
+      {
+        last[rowLand[x]] = static_cast<int64_t>(x) + width;
+        int64_t other = last[1 - rowLand[x]];
+        row[x] = (other != NONE) ? static_cast<float>(static_cast<int64_t>(x) + width - other) : INFINITE;
+      }
+
+      last[0] = NONE;
+      last[1] = NONE;
+      for (uint x = width; x > 0; x--)
+      {
+        last[rowLand[x - 1]] = static_cast<int64_t>(x - 1) + width;
+      }
+      for (uint x = width; x > 0; x--)
+      {
+        last[rowLand[x - 1]] = x - 1;
+        int64_t other = last[1 - rowLand[x - 1]];
+        if (other != NONE)
+        {
+          row[x - 1] = std::min(row[x - 1], static_cast<float>(other - (x - 1)));
+        }
+      }
+    }
+  });
+
+  // column pass: combine row distances to the exact distance
+  parallelFor(0, width, COLUMN_BLOCK_SIZE, [&](uint x0, uint x1)
+  {
+    const uint n = x1 - x0;
+
+    std::vector<float>   block(static_cast<size_t>(n) * height);
+    std::vector<uint8_t> blockLand(static_cast<size_t>(n) * height);
+    std::vector<int64_t> toWater(height), toLand(height);
+    std::vector<int64_t> waterDistances(height), landDistances(height);
+    std::vector<int64_t> g(2 * static_cast<size_t>(height)), s(2 * static_cast<size_t>(height)), t(2 * static_cast<size_t>(height)), k(2 * static_cast<size_t>(height));
+
+    for (uint y = 0; y < height; y++)
+    {
+      const float *row = &distances[static_cast<size_t>(y) * width];
+      for (uint c = 0; c < n; c++)
+      {
+        block    [static_cast<size_t>(c) * height + y] = row[x0 + c];
+        blockLand[static_cast<size_t>(c) * height + y] = landMask.get(x0 + c, y) ? 1 : 0;
+      }
+    }
+
+    for (uint c = 0; c < n; c++)
+    {
+      float         *column     = &block    [static_cast<size_t>(c) * height];
+      const uint8_t *columnLand = &blockLand[static_cast<size_t>(c) * height];
+
+      // row distance is to the other type; to the same type it is 0
+      for (uint y = 0; y < height; y++)
+      {
+        int64_t squared = !std::isinf(column[y])
+                            ? static_cast<int64_t>(column[y]) * static_cast<int64_t>(column[y])
+                            : INFINITE_SQUARED;
+        toWater[y] = columnLand[y] ? squared : 0;
+        toLand [y] = columnLand[y] ? 0 : squared;
+      }
+
+      transform1D(toWater.data(), height, waterDistances.data(), g.data(), s.data(), t.data(), k.data());
+      transform1D(toLand.data(),  height, landDistances.data(),  g.data(), s.data(), t.data(), k.data());
+
+      for (uint y = 0; y < height; y++)
+      {
+        if (columnLand[y])
+        {
+          column[y] = (waterDistances[y] != INFINITE_SQUARED) ?  static_cast<float>(sqrt(static_cast<double>(waterDistances[y]))) :  INFINITE;
+        }
+        else
+        {
+          column[y] = (landDistances[y]  != INFINITE_SQUARED) ? -static_cast<float>(sqrt(static_cast<double>(landDistances[y])))  : -INFINITE;
+        }
+      }
+    }
+
+    for (uint y = 0; y < height; y++)
+    {
+      float *row = &distances[static_cast<size_t>(y) * width];
+      for (uint c = 0; c < n; c++)
+      {
+        row[x0 + c] = block[static_cast<size_t>(c) * height + y];
+      }
+    }
+  });
+}
+
+/* end of file */
@@ -0,0 +1,50 @@
+/***********************************************************************\
+*
+* Contents: exact euclidean distance transform of land masks
+* Systems: all
+*
+\***********************************************************************/
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+/****************************** Includes *******************************/
+#include <vector>
+
+#include "landMask.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** signed distance to the coast: exact euclidean distance transform
+ *  (Meijster/Felzenszwalb) with a row pass and a column pass, both
+ *  multi-threaded. Distances wrap around at the map borders like the
+ *  donut.
+ */
+class DistanceField
+{
+  public:
+    /** compute signed distance to the coast for every tile
+     * @param landMask land mask
+     * @param distances distances (width*height values, row by row):
+     *                  land tiles: distance to the nearest water tile
+     *                  (>=1), water tiles: negative distance to the
+     *                  nearest land tile (<=-1); +/-infinity if there is
+     *                  no water resp. land tile at all
+     */
+    static void compute(const LandMask &landMask, std::vector<float> &distances);
+};
+
+#endif // DISTANCE_FIELD_H
+
+/* end of file */
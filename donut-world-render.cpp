@@ -0,0 +1,647 @@
+/***********************************************************************\
+*
+* Contents: Donut World headless renderer: frames and thumbnails
+* Systems: Linux
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cassert>
+#include <getopt.h>
+
+#include <epoxy/egl.h>
+#include <epoxy/gl.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "color.h"
+#include "mapGenerator.h"
+#include "islands.h"
+#include "renderer.h"
+#include "frameCapture.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+LOCAL const uint DEFAULT_WIDTH          = 256;
+LOCAL const uint DEFAULT_HEIGHT         = 256;
+LOCAL const uint DEFAULT_MAP_SIZE       = 512;
+LOCAL const uint MIN_MAP_SIZE           = 128;
+LOCAL const uint MAX_MAP_SIZE           = 65536;
+LOCAL const uint MAP_SIZE_STEP          = Map::CHUNK_SIZE;
+LOCAL const uint DEFAULT_FRAME_COUNT    = 1;
+LOCAL const uint DEFAULT_FPS            = 30;
+LOCAL const char *DEFAULT_OUTPUT        = "donut-world-%04u.ppm";
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** get valid map size, see donut-world
+ * @param size requested map size
+ * @param maxSize max. map size
+ * @return size rounded to MAP_SIZE_STEP and clamped to MIN_MAP_SIZE..maxSize
+ */
+LOCAL uint getValidMapSize(uint size, uint maxSize)
+{
+  maxSize = std::max(MIN_MAP_SIZE, (maxSize / MAP_SIZE_STEP) * MAP_SIZE_STEP);
+  size    = ((size + MAP_SIZE_STEP / 2) / MAP_SIZE_STEP) * MAP_SIZE_STEP;
+
+  return std::min(std::max(size, MIN_MAP_SIZE), maxSize);
+}
+
+/** get number of frame number conversions in output file name pattern
+ * @param pattern file name pattern, printf format
+ * @return number of integer conversions with optional flags and width
+ *         (e. g. %u, %04u), -1 if the pattern has any other % directive
+ */
+LOCAL int getFrameNumberConversionCount(const std::string &pattern)
+{
+  int    count = 0;
+  size_t i     = 0;
+  while (i < pattern.size())
+  {
+    if (pattern[i] != '%')
+    {
+      i++;
+      continue;
+    }
+    i++;
+    if ((i < pattern.size()) && (pattern[i] == '%'))
+    {
+      i++;
+      continue;
+    }
+
+    while ((i < pattern.size()) && (pattern[i] != '\0') && (strchr("-+ #0", pattern[i]) != nullptr))
+    {
+      i++;
+    }
+    while ((i < pattern.size()) && isdigit(static_cast<unsigned char>(pattern[i])))
+    {
+      i++;
+    }
+    if ((i < pattern.size()) && (pattern[i] != '\0') && (strchr("diouxX", pattern[i]) != nullptr))
+    {
+      count++;
+      i++;
+    }
+    else
+    {
+      return -1;
+    }
+  }
+
+  return count;
+}
+
+/** print usage
+ * @param programName program name
+ */
+LOCAL void printUsage(const char *programName)
+{
+  std::cout << "Usage: " << programName << " [<options>]" << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  -W, --width <n>           frame width (default: " << DEFAULT_WIDTH << ")" << std::endl
+            << "  -H, --height <n>          frame height (default: " << DEFAULT_HEIGHT << ")" << std::endl
+            << "  -n, --frames <n>          number of frames (default: " << DEFAULT_FRAME_COUNT << ")" << std::endl
+            << "  -f, --fps <n>             frames per second of the animation (default: " << DEFAULT_FPS << ")" << std::endl
+            << "  -m, --map-size <n>        map width+height (default: " << DEFAULT_MAP_SIZE << ", " << MIN_MAP_SIZE << ".." << MAX_MAP_SIZE << "," << std::endl
+            << "                            multiple of " << MAP_SIZE_STEP << ")" << std::endl
+            << "  -b, --backend <name>      generator backend: shapes, noise (default: shapes)" << std::endl
+            << "  -s, --seed <n>            random seed (default: 1)" << std::endl
+            << "  -p, --pipeline <file>     generator pipeline file (shapes backend)" << std::endl
+            << "  -S, --stage-statistics    print cost of the generator stages" << std::endl
+            << "  -r, --relief <h>          terrain relief height, 0 for a smooth surface" << std::endl
+            << "                            (default: " << Renderer::DEFAULT_RELIEF_HEIGHT << ")" << std::endl
+            << "  -i, --islands             show islands" << std::endl
+            << "  -g, --grid <c>x<r>        grid of c x r worlds with seeds seed.. in one" << std::endl
+            << "                            instanced draw call" << std::endl
+            << "  -o, --output <pattern>    output file name pattern with one frame number" << std::endl
+            << "                            conversion (e. g. %04u), PPM; optional for one frame;" << std::endl
+            << "                            - for raw RGB frames on stdout (default: " << DEFAULT_OUTPUT << ")" << std::endl
+            << "  -h, --help                print this help" << std::endl
+            << std::endl
+            << "Example:" << std::endl
+            << "  " << programName << " -W 640 -H 480 -n 300 -o - | ffmpeg -f rawvideo -pix_fmt rgb24 -s 640x480 -r 30 -i - donut-world.mp4" << std::endl;
+}
+
+/** init EGL: headless OpenGL ES 3 context, surfaceless if supported,
+ *  otherwise with a pbuffer surface
+ * @param display EGL display
+ * @return true iff context is current
+ */
+LOCAL bool initEGL(EGLDisplay &display)
+{
+  if (epoxy_has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless"))
+  {
+    display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  else
+  {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if ((display == EGL_NO_DISPLAY) || !eglInitialize(display, nullptr, nullptr))
+  {
+    return false;
+  }
+  eglBindAPI(EGL_OPENGL_ES_API);
+
+  const EGLint CONFIG_ATTRIBUTES[] =
+  {
+    EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+    EGL_NONE
+  };
+  EGLConfig config = nullptr;
+  EGLint    configCount;
+  if (!eglChooseConfig(display, CONFIG_ATTRIBUTES, &config, 1, &configCount) || (configCount == 0))
+  {
+    config = nullptr;
+  }
+
+  const EGLint CONTEXT_ATTRIBUTES[] =
+  {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_NONE
+  };
+  EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, CONTEXT_ATTRIBUTES);
+  if (context == EGL_NO_CONTEXT)
+  {
+    return false;
+  }
+
+  // all rendering goes to a framebuffer object: no surface needed
+  EGLSurface surface = EGL_NO_SURFACE;
+  if (!epoxy_has_egl_extension(display, "EGL_KHR_surfaceless_context"))
+  {
+    const EGLint SURFACE_ATTRIBUTES[] =
+    {
+      EGL_WIDTH,  1,
+      EGL_HEIGHT, 1,
+      EGL_NONE
+    };
+    surface = eglCreatePbufferSurface(display, config, SURFACE_ATTRIBUTES);
+    if (surface == EGL_NO_SURFACE)
+    {
+      return false;
+    }
+  }
+
+  return eglMakeCurrent(display, surface, surface, context);
+}
+
+/** generate map colors and elevations
+ * @param mapSize map width+height
+ * @param backend generator backend
+ * @param seed random seed
+ * @param pipeline generator pipeline
+ * @param statistics cost of the generator stages, summed up over all
+ *                   generated maps, or nullptr
+ * @param colors colors, row by row
+ * @param elevations elevations, row by row, mapSize x mapSize, or
+ *                   nullptr
+ * @param labels island labels, row by row, mapSize x mapSize, or
+ *               nullptr
+ */
+LOCAL void generateColors(uint                                       mapSize,
+                          MapGenerator::Backends                     backend,
+                          uint32_t                                   seed,
+                          const MapGenerator::Pipeline               &pipeline,
+                          std::vector<MapGenerator::StageStatistics> *statistics,
+                          std::vector<Color>                         &colors,
+                          std::vector<uint8_t>                       *elevations = nullptr,
+                          std::vector<uint32_t>                      *labels = nullptr
+                         )
+{
+  Map                                        map(mapSize, mapSize);
+  std::vector<MapGenerator::StageStatistics> mapStatistics;
+  MapGenerator::generate(map, backend, seed, pipeline, &mapStatistics);
+  if (statistics != nullptr)
+  {
+    // same stages for all maps
+    if (statistics->empty())
+    {
+      *statistics = mapStatistics;
+    }
+    else
+    {
+      assert(statistics->size() == mapStatistics.size());
+      for (size_t i = 0; i < mapStatistics.size(); i++)
+      {
+        (*statistics)[i].time        += mapStatistics[i].time;
+        (*statistics)[i].tileReads   += mapStatistics[i].tileReads;
+        (*statistics)[i].tileWrites  += mapStatistics[i].tileWrites;
+        (*statistics)[i].randomDraws += mapStatistics[i].randomDraws;
+      }
+    }
+  }
+
+  colors.resize(static_cast<size_t>(mapSize) * mapSize);
+  std::mt19937                           random(seed);
+  std::uniform_real_distribution<double> waterDistribution(0.0, 1.0);
+  for (uint y = 0; y < mapSize; y++)
+  {
+    for (uint x = 0; x < mapSize; x++)
+    {
+      if (map.isLand(x, y))
+      {
+        colors[static_cast<size_t>(y) * mapSize + x] = Color::LAND1;
+      }
+      else
+      {
+        colors[static_cast<size_t>(y) * mapSize + x] = Color::interpolate(Color::WATER1, Color::WATER2, waterDistribution(random));
+      }
+    }
+  }
+
+  if (elevations != nullptr)
+  {
+    Renderer::computeElevations(map, mapSize, mapSize, *elevations);
+  }
+  if (labels != nullptr)
+  {
+    map.findIslands();
+    *labels = map.getIslandLabels();
+  }
+}
+
+/** print cost of the generator stages
+ * @param statistics cost of the generator stages
+ */
+LOCAL void printStatistics(const std::vector<MapGenerator::StageStatistics> &statistics)
+{
+  MapGenerator::StageStatistics total = {"total", 0.0, 0, 0, 0};
+
+  fprintf(stderr, "%-16s %10s %14s %14s %12s\n", "Stage", "Time [ms]", "Tile reads", "Tile writes", "Random");
+  for (const MapGenerator::StageStatistics &stageStatistics : statistics)
+  {
+    fprintf(stderr, "%-16s %10.1f %14lu %14lu %12lu\n",
+            stageStatistics.name.c_str(),
+            stageStatistics.time,
+            static_cast<ulong>(stageStatistics.tileReads),
+            static_cast<ulong>(stageStatistics.tileWrites),
+            static_cast<ulong>(stageStatistics.randomDraws)
+           );
+    total.time        += stageStatistics.time;
+    total.tileReads   += stageStatistics.tileReads;
+    total.tileWrites  += stageStatistics.tileWrites;
+    total.randomDraws += stageStatistics.randomDraws;
+  }
+  fprintf(stderr, "%-16s %10.1f %14lu %14lu %12lu\n",
+          total.name.c_str(),
+          total.time,
+          static_cast<ulong>(total.tileReads),
+          static_cast<ulong>(total.tileWrites),
+          static_cast<ulong>(total.randomDraws)
+         );
+}
+
+/** write frame as PPM file or raw RGB
+ * @param file file
+ * @param pixels RGBA pixels, bottom row first
+ * @param width,height frame size
+ * @param ppmFlag true to write PPM header
+ * @param rgb buffer for RGB pixels
+ * @return true iff written
+ */
+LOCAL bool writeFrame(FILE                 *file,
+                      const uint8_t        *pixels,
+                      uint                 width,
+                      uint                 height,
+                      bool                 ppmFlag,
+                      std::vector<uint8_t> &rgb
+                     )
+{
+  // RGBA bottom-up -> RGB top-down
+  rgb.resize(static_cast<size_t>(width) * height * 3);
+  for (uint y = 0; y < height; y++)
+  {
+    const uint8_t *p = pixels + static_cast<size_t>(height - 1 - y) * width * 4;
+    uint8_t       *q = rgb.data() + static_cast<size_t>(y) * width * 3;
+    for (uint x = 0; x < width; x++)
+    {
+      q[0] = p[0];
+      q[1] = p[1];
+      q[2] = p[2];
+      p += 4;
+      q += 3;
+    }
+  }
+
+  if (ppmFlag)
+  {
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+  }
+  return fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+}
+
+int main(int argc, char **argv)
+{
+  uint                    width          = DEFAULT_WIDTH;
+  uint                    height         = DEFAULT_HEIGHT;
+  uint                    frameCount     = DEFAULT_FRAME_COUNT;
+  uint                    fps            = DEFAULT_FPS;
+  uint                    mapSize        = DEFAULT_MAP_SIZE;
+  MapGenerator::Backends  backend        = MapGenerator::Backends::SHAPES;
+  uint32_t                seed           = 1;
+  MapGenerator::Pipeline  pipeline       = MapGenerator::Pipeline::getDefault(MapGenerator::DEFAULT_MIN_CONTINENTS, MapGenerator::DEFAULT_MAX_CONTINENTS);
+  bool                    statisticsFlag = false;
+  float                   relief         = Renderer::DEFAULT_RELIEF_HEIGHT;
+  bool                    islandsFlag    = false;
+  uint                    columns        = 0;
+  uint                    rows           = 0;
+  std::string             output         = DEFAULT_OUTPUT;
+
+  // parse options
+  const struct option OPTIONS[] =
+  {
+    {"width",            required_argument, nullptr, 'W'},
+    {"height",           required_argument, nullptr, 'H'},
+    {"frames",           required_argument, nullptr, 'n'},
+    {"fps",              required_argument, nullptr, 'f'},
+    {"map-size",         required_argument, nullptr, 'm'},
+    {"backend",          required_argument, nullptr, 'b'},
+    {"seed",             required_argument, nullptr, 's'},
+    {"pipeline",         required_argument, nullptr, 'p'},
+    {"stage-statistics", no_argument,       nullptr, 'S'},
+    {"relief",           required_argument, nullptr, 'r'},
+    {"islands",          no_argument,       nullptr, 'i'},
+    {"grid",             required_argument, nullptr, 'g'},
+    {"output",           required_argument, nullptr, 'o'},
+    {"help",             no_argument,       nullptr, 'h'},
+    {nullptr,            0,                 nullptr, 0  }
+  };
+  int ch;
+  while ((ch = getopt_long(argc, argv, "W:H:n:f:m:b:s:p:Sr:ig:o:h", OPTIONS, nullptr)) != -1)
+  {
+    switch (ch)
+    {
+      case 'W':
+        width = std::max(1UL, strtoul(optarg, nullptr, 10));
+        break;
+      case 'H':
+        height = std::max(1UL, strtoul(optarg, nullptr, 10));
+        break;
+      case 'n':
+        frameCount = strtoul(optarg, nullptr, 10);
+        break;
+      case 'f':
+        fps = std::max(1UL, strtoul(optarg, nullptr, 10));
+        break;
+      case 'm':
+        mapSize = getValidMapSize(static_cast<uint>(std::min(strtoul(optarg, nullptr, 10), static_cast<ulong>(MAX_MAP_SIZE))), MAX_MAP_SIZE);
+        break;
+      case 'b':
+        if      (strcmp(optarg, "shapes") == 0)
+        {
+          backend = MapGenerator::Backends::SHAPES;
+        }
+        else if (strcmp(optarg, "noise") == 0)
+        {
+          backend = MapGenerator::Backends::NOISE;
+        }
+        else
+        {
+          std::cerr << "ERROR: unknown backend '" << optarg << "'" << std::endl;
+          return EXIT_FAILURE;
+        }
+        break;
+      case 's':
+        seed = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+        break;
+      case 'p':
+        try
+        {
+          pipeline.load(optarg);
+        }
+        catch (const std::exception &exception)
+        {
+          std::cerr << "ERROR: " << exception.what() << std::endl;
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'S':
+        statisticsFlag = true;
+        break;
+      case 'r':
+        relief = std::max(0.0f, strtof(optarg, nullptr));
+        break;
+      case 'i':
+        islandsFlag = true;
+        break;
+      case 'g':
+        if (   (sscanf(optarg, "%ux%u", &columns, &rows) != 2)
+            || (columns == 0)
+            || (rows == 0)
+           )
+        {
+          std::cerr << "ERROR: invalid grid '" << optarg << "'" << std::endl;
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'h':
+        printUsage(argv[0]);
+        return EXIT_SUCCESS;
+      default:
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (output != "-")
+  {
+    // the pattern is a printf format: allow the frame number only
+    const int conversionCount = getFrameNumberConversionCount(output);
+    if ((conversionCount < 0) || (conversionCount > 1) || ((conversionCount == 0) && (frameCount > 1)))
+    {
+      std::cerr << "ERROR: invalid output pattern '" << output << "', expected one frame number conversion like %04u" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // init OpenGL
+  EGLDisplay display;
+  if (!initEGL(display))
+  {
+    std::cerr << "ERROR: cannot create EGL context (error 0x" << std::hex << eglGetError() << ")" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const uint maxTextureSize = Renderer::getMaxTextureSize(Renderer::TextureTypes::MIP);
+  if (mapSize > maxTextureSize)
+  {
+    const uint maxMapSize = getValidMapSize(maxTextureSize, maxTextureSize);
+    std::cerr << "Warning: map size " << mapSize << " exceeds max. texture size, using " << maxMapSize << std::endl;
+    mapSize = maxMapSize;
+  }
+
+  auto startTime = std::chrono::steady_clock::now();
+
+  // generate maps and map textures, init renderer
+  const bool                                 gridFlag = (columns > 0);
+  Renderer                                   renderer(Renderer::TextureTypes::MIP);
+  InstancedRenderer                          instancedRenderer;
+  glm::mat4                                  projectionView;
+  std::vector<Color>                         colors;
+  std::vector<uint8_t>                       elevations;
+  std::vector<uint32_t>                      labels;
+  std::vector<MapGenerator::StageStatistics> statistics;
+  if (gridFlag)
+  {
+    const uint worldCount = columns * rows;
+    GLint      maxLayers;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (worldCount > static_cast<uint>(maxLayers))
+    {
+      std::cerr << "ERROR: " << worldCount << " worlds exceed max. texture layers " << maxLayers << std::endl;
+      eglTerminate(display);
+      return EXIT_FAILURE;
+    }
+
+    instancedRenderer.init(mapSize, mapSize, worldCount);
+    std::vector<InstancedRenderer::Instance> instances(worldCount);
+    for (uint i = 0; i < worldCount; i++)
+    {
+      generateColors(mapSize, backend, seed + i, pipeline, &statistics, colors);
+      instancedRenderer.setTexture(i, colors.data());
+
+      // cell i, row by row from the top; world radius 0.9 -> 0.45
+      const glm::vec3 center((float)(i % columns) + 0.5f, (float)(rows - i / columns) - 0.5f, 0.0f);
+      instances[i].transform = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(0.5f, 0.5f, 0.5f));
+      instances[i].layer     = i;
+    }
+    instancedRenderer.setInstances(instances);
+
+    // orthographic view of the grid, square cells
+    const float cellSize   = std::min((float)width / (float)columns, (float)height / (float)rows);
+    const float viewWidth  = (float)width  / cellSize;
+    const float viewHeight = (float)height / cellSize;
+    projectionView = glm::ortho(((float)columns - viewWidth ) / 2.0f, ((float)columns + viewWidth ) / 2.0f,
+                                ((float)rows    - viewHeight) / 2.0f, ((float)rows    + viewHeight) / 2.0f,
+                                -10.0f, 10.0f
+                               );
+  }
+  else
+  {
+    generateColors(mapSize, backend, seed, pipeline, &statistics, colors, &elevations, islandsFlag ? &labels : nullptr);
+    renderer.init(mapSize, mapSize, true);
+    renderer.setTexture(colors.data());
+    renderer.setElevations(elevations.data(), mapSize, mapSize);
+    renderer.setReliefHeight(relief);
+    if (islandsFlag)
+    {
+      renderer.setLabels(labels.data(), mapSize, mapSize);
+    }
+  }
+
+  auto renderStartTime = std::chrono::steady_clock::now();
+
+  // render frames
+  FrameCapture frameCapture;
+  frameCapture.init(width, height);
+
+  const bool           rawFlag   = (output == "-");
+  bool                 errorFlag = false;
+  std::vector<uint8_t> rgb;
+  auto frameHandler = [&](uint64_t frameNumber, const uint8_t *pixels)
+  {
+    if (errorFlag)
+    {
+      return;
+    }
+
+    if (rawFlag)
+    {
+      errorFlag = !writeFrame(stdout, pixels, width, height, false, rgb);
+    }
+    else
+    {
+      char fileName[1024];
+      if (snprintf(fileName, sizeof(fileName), output.c_str(), static_cast<uint>(frameNumber)) >= static_cast<int>(sizeof(fileName)))
+      {
+        std::cerr << "ERROR: file name too long '" << output << "'" << std::endl;
+        errorFlag = true;
+        return;
+      }
+      FILE *file = fopen(fileName, "wb");
+      if (file != nullptr)
+      {
+        errorFlag = !writeFrame(file, pixels, width, height, true, rgb);
+        errorFlag = (fclose(file) != 0) || errorFlag;
+      }
+      else
+      {
+        errorFlag = true;
+      }
+      if (errorFlag)
+      {
+        std::cerr << "ERROR: cannot write '" << fileName << "': " << strerror(errno) << std::endl;
+      }
+    }
+  };
+
+  const ulong frameInterval = 1000 / fps;
+  for (uint i = 0; (i < frameCount) && !errorFlag; i++)
+  {
+    frameCapture.begin();
+    if (gridFlag)
+    {
+      instancedRenderer.draw(projectionView, i * frameInterval, (i > 0) ? frameInterval : 0);
+    }
+    else
+    {
+      renderer.draw(width, height, i * frameInterval, (i > 0) ? frameInterval : 0);
+    }
+    frameCapture.end(frameHandler);
+  }
+  frameCapture.flush(frameHandler);
+  if (rawFlag)
+  {
+    fflush(stdout);
+  }
+
+  frameCapture.done();
+  if (gridFlag)
+  {
+    instancedRenderer.done();
+  }
+  else
+  {
+    renderer.done();
+  }
+  eglTerminate(display);
+
+  auto endTime = std::chrono::steady_clock::now();
+  std::cerr << "Maps " << std::chrono::duration_cast<std::chrono::milliseconds>(renderStartTime - startTime).count() << " ms, "
+            << frameCount << " frames " << std::chrono::duration_cast<std::chrono::milliseconds>(endTime - renderStartTime).count() << " ms"
+            << std::endl;
+  if (statisticsFlag)
+  {
+    printStatistics(statistics);
+  }
+
+  return errorFlag ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* end of file */
@@ -0,0 +1,151 @@
+/***********************************************************************\
+*
+* Contents: Donut World map server
+* Systems: Unix
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <string>
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <csignal>
+#include <getopt.h>
+
+#include "parallel.h"
+#include "mapServer.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+LOCAL const char *DEFAULT_SOCKET_PATH = "/tmp/donut-world.socket";
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+LOCAL MapServer *server = nullptr;
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** signal handler: stop server
+ * @param signalNumber signal number
+ */
+LOCAL void signalHandler(int signalNumber)
+{
+  (void)signalNumber;
+
+  if (server != nullptr)
+  {
+    server->stop();
+  }
+}
+
+/** print usage
+ * @param programName program name
+ */
+LOCAL void printUsage(const char *programName)
+{
+  std::cout << "Usage: " << programName << " [<options>]" << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  -s, --socket <path>       socket path (default: " << DEFAULT_SOCKET_PATH << ")" << std::endl
+            << "  -c, --cache-dir <path>    disk cache directory (default: none)" << std::endl
+            << "  -m, --cache-size <MB>     memory cache size (default: " << MapServer::DEFAULT_CACHE_SIZE / (1024 * 1024) << ")" << std::endl
+            << "  -w, --workers <n>         number of worker threads (default: " << getThreadCount() << ")" << std::endl
+            << "  -q, --queue <n>           max. number of queued requests (default: " << MapServer::DEFAULT_QUEUE_SIZE << ")" << std::endl
+            << "  -t, --max-tiles <n>       max. number of tiles of a map (default: " << MapServer::DEFAULT_MAX_REQUEST_TILES << ")" << std::endl
+            << "  -T, --max-inflight <n>    max. number of tiles of all maps computed" << std::endl
+            << "                            concurrently (default: " << MapServer::DEFAULT_MAX_INFLIGHT_TILES << ")" << std::endl
+            << "  -h, --help                print this help" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  std::string socketPath       = DEFAULT_SOCKET_PATH;
+  std::string cacheDirectory;
+  size_t      cacheSize        = MapServer::DEFAULT_CACHE_SIZE;
+  uint        workerCount      = getThreadCount();
+  uint        queueSize        = MapServer::DEFAULT_QUEUE_SIZE;
+  size_t      maxRequestTiles  = MapServer::DEFAULT_MAX_REQUEST_TILES;
+  size_t      maxInflightTiles = MapServer::DEFAULT_MAX_INFLIGHT_TILES;
+
+  // parse options
+  const struct option OPTIONS[] =
+  {
+    {"socket",       required_argument, nullptr, 's'},
+    {"cache-dir",    required_argument, nullptr, 'c'},
+    {"cache-size",   required_argument, nullptr, 'm'},
+    {"workers",      required_argument, nullptr, 'w'},
+    {"queue",        required_argument, nullptr, 'q'},
+    {"max-tiles",    required_argument, nullptr, 't'},
+    {"max-inflight", required_argument, nullptr, 'T'},
+    {"help",         no_argument,       nullptr, 'h'},
+    {nullptr,        0,                 nullptr, 0  }
+  };
+  int ch;
+  while ((ch = getopt_long(argc, argv, "s:c:m:w:q:t:T:h", OPTIONS, nullptr)) != -1)
+  {
+    switch (ch)
+    {
+      case 's':
+        socketPath = optarg;
+        break;
+      case 'c':
+        cacheDirectory = optarg;
+        break;
+      case 'm':
+        cacheSize = static_cast<size_t>(strtoul(optarg, nullptr, 10)) * 1024 * 1024;
+        break;
+      case 'w':
+        workerCount = std::max(1UL, strtoul(optarg, nullptr, 10));
+        break;
+      case 'q':
+        queueSize = std::max(1UL, strtoul(optarg, nullptr, 10));
+        break;
+      case 't':
+        maxRequestTiles = std::max(1UL, strtoul(optarg, nullptr, 10));
+        break;
+      case 'T':
+        maxInflightTiles = std::max(1UL, strtoul(optarg, nullptr, 10));
+        break;
+      case 'h':
+        printUsage(argv[0]);
+        return EXIT_SUCCESS;
+      default:
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  // run server until SIGINT/SIGTERM
+  try
+  {
+    MapServer mapServer(socketPath, cacheDirectory, workerCount, queueSize, cacheSize, maxRequestTiles, maxInflightTiles);
+
+    server = &mapServer;
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+
+    mapServer.run();
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    server = nullptr;
+  }
+  catch (const std::exception &exception)
+  {
+    std::cerr << "ERROR: " << exception.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* end of file */
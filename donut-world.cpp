@@ -9,122 +9,128 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <stdlib.h>
+#include <getopt.h>
 
 #include <vector>
-#include <array>
+#include <algorithm>
 #include <random>
 #include <functional>
 #include <thread>
 
 #include <gtk/gtk.h>
 #include <epoxy/gl.h>
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-
-#include <glm/gtc/quaternion.hpp>
 
 #include "color.h"
 #include "mapGenerator.h"
 #include "islands.h"
+#include "renderer.h"
+#include "frameScheduler.h"
 
 /****************** Conditional compilation switches *******************/
+// allocate map texture mip chain with immutable storage (glTexStorage2D)
+#define IMMUTABLE_TEXTURE_STORAGE 1
 
 /***************************** Constants *******************************/
 #define LOCAL static
 
 #define TEXTURE_TYPE_FIXED     1
 #define TEXTURE_TYPE_GENERATED 2
+#define TEXTURE_TYPE_VIRTUAL   3
+#define TEXTURE_TYPE_INDEXED   4
 //#define TEXTURE_TYPE TEXTURE_TYPE_FIXED
 #define TEXTURE_TYPE TEXTURE_TYPE_GENERATED
-
-#if (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED)
-  // map texture
-  const uint TEXTURE_WIDTH  = 512;
-  const uint TEXTURE_HEIGHT = 512;
+//#define TEXTURE_TYPE TEXTURE_TYPE_VIRTUAL
+//#define TEXTURE_TYPE TEXTURE_TYPE_INDEXED
+
+#if   (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED) || (TEXTURE_TYPE == TEXTURE_TYPE_INDEXED)
+  // default map size; map texture size is the map size
+  LOCAL const uint DEFAULT_MAP_SIZE = 512;
+#elif (TEXTURE_TYPE == TEXTURE_TYPE_VIRTUAL)
+  // default map size; texture pages are streamed from the map colors
+  LOCAL const uint DEFAULT_MAP_SIZE = 16384;
 #else
   #include "worldmap6.h"
 #endif
 
+#if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+  // map size range; multiple of the map chunk size
+  LOCAL const uint MIN_MAP_SIZE  = 128;
+  LOCAL const uint MAX_MAP_SIZE  = 65536;
+  LOCAL const uint MAP_SIZE_STEP = Map::CHUNK_SIZE;
+#endif
+
 // OpenGL view size
 LOCAL const uint VIEW_WIDTH  = 800;
 LOCAL const uint VIEW_HEIGHT = 600;
 
-// donut faces+size
-LOCAL const uint STEPS1 = 18 * 2;
-LOCAL const uint STEPS2 = 24 * 2;
-LOCAL const float R1 = 0.3;
-LOCAL const float R2 = 0.6;
-
-LOCAL const char *VERTEX_SHADER =
-  "#version 300 es\n"
-  "uniform mat4 projectionViewModel;\n"
-  "in vec3      vPosition;\n"
-  "in vec3      vColor;\n"
-  "in vec2      vUV;\n"
-  "out vec3     color;\n"
-  "out vec2     uv;\n"
-  "\n"
-  "void main()\n"
-  "{\n"
-  "  gl_Position = projectionViewModel * vec4(vPosition, 1.0);\n"
-  "  color = vColor;\n"
-  "  uv = vUV;\n"
-  "}\n";
-
-LOCAL const char *FRAGMENT_SHADER =
-  "#version 300 es\n"
-  "precision mediump float;\n"
-  "uniform sampler2D textureSampler;\n"
-  "uniform vec2      textureTranslate;\n"
-  "in vec3           color;\n"
-  "in vec2           uv;\n"
-  "out vec4          fragment;\n"
-  "void main()\n"
-  "{\n"
-  "  vec2 w = vec2(uv.x+textureTranslate.x,uv.y+textureTranslate.y);\n"
-  "  fragment = texture2D(textureSampler, w);\n"
-  "}\n";
+#if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+  // max. elevation texture size: limited for huge maps, the relief mesh
+  // is much coarser anyway
+  LOCAL const uint MAX_ELEVATION_SIZE = 1024;
+#endif
+
+// interval of frame statistics update [us]
+LOCAL const int64_t FRAME_STATISTICS_INTERVAL = 1000000;
+
+// status bar contexts
+LOCAL const guint STATUS_CONTEXT_PROGRESS = 0;
+LOCAL const guint STATUS_CONTEXT_ISLAND   = 1;
 
 /***************************** Datatypes *******************************/
-typedef struct
-{
-  glm::vec3 position;
-  glm::vec3 color;
-  glm::vec2 uv;
-} Vertex;
 
 /***************************** Variables *******************************/
-#if (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED)
-  #if 0
-    LOCAL std::array<Color, TEXTURE_WIDTH *TEXTURE_HEIGHT> textureData;
-  #else
-    LOCAL std::array<std::array<Color, TEXTURE_WIDTH>, TEXTURE_HEIGHT> textureData;
-  #endif
+#if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+  LOCAL uint                 mapSize = DEFAULT_MAP_SIZE;  // size of next map
+#endif
+#if (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED) || (TEXTURE_TYPE == TEXTURE_TYPE_INDEXED)
+  // colors, row by row; allocation is reused for maps of the same size
+  LOCAL std::vector<Color>   textureData;
+#endif
+#if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+  LOCAL std::vector<uint8_t> elevationData;
+  LOCAL uint                 elevationWidth, elevationHeight;
 #endif
 
 LOCAL GtkWidget           *area;
-LOCAL GDateTime           *startDateTime = g_date_time_new_now_local();
-LOCAL GDateTime           *lastDateTime;
-
-LOCAL std::vector<Vertex> vertices;
 
-LOCAL GLuint              vertexBuffer;
-LOCAL GLuint              fragmentShader, vertexShader;
-LOCAL GLuint              program;
-LOCAL GLuint              vertexArray;
-
-LOCAL GLint               projectionViewModelLocation;
-LOCAL GLint               textureTranslateLocation;
-LOCAL glm::vec2           textureTranslate = { 0.0, 0.0 };
+LOCAL FrameScheduler      frameScheduler;
+LOCAL guint               tickCallbackId = 0;
+LOCAL int64_t             lastFrameTime = 0;         // [us]
+LOCAL int64_t             animationTime = 0;         // [us], advances while rotating
+LOCAL ulong               lastAnimationTime = 0;     // [ms]
+LOCAL int64_t             lastFrameStatisticsTime = 0;
+#if (TEXTURE_TYPE == TEXTURE_TYPE_VIRTUAL)
+  LOCAL uint              feedbackFrameCount = 0;
+#endif
 
-LOCAL glm::mat4           model;
+#if   (TEXTURE_TYPE == TEXTURE_TYPE_VIRTUAL)
+  LOCAL Renderer          renderer(Renderer::TextureTypes::VIRTUAL);
+#elif (TEXTURE_TYPE == TEXTURE_TYPE_INDEXED)
+  LOCAL Renderer          renderer(Renderer::TextureTypes::INDEXED);
+#else
+  LOCAL Renderer          renderer(Renderer::TextureTypes::MIP);
+#endif
 
-LOCAL Map                 map(TEXTURE_WIDTH, TEXTURE_HEIGHT);
+#if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+  LOCAL Map               map;                       // sized by generateNewRandomMap()
+#else
+  LOCAL Map               map(TEXTURE_WIDTH, TEXTURE_HEIGHT);
+#endif
 LOCAL bool                newMapFlag = FALSE;
+LOCAL bool                islandsFlag = FALSE;       // island labels of map available
+LOCAL bool                newLabelsFlag = FALSE;
+
+LOCAL bool                pointerFlag = FALSE;       // pointer in view
+LOCAL double              pointerX, pointerY;
+LOCAL bool                selectFlag = FALSE;        // select island at pointer
 
 LOCAL GtkWidget           *buttonNewMap;
+LOCAL GtkWidget           *spinButtonMapSize;
 LOCAL GtkWidget           *buttonFindIslands;
 LOCAL GtkWidget           *islandsText;
+LOCAL GtkWidget           *checkButtonRotate;
+LOCAL GtkWidget           *frameStatisticsText;
 LOCAL GtkWidget           *statusBar;
 
 /****************************** Macros *********************************/
@@ -133,216 +139,72 @@ LOCAL GtkWidget           *statusBar;
 
 /***************************** Functions *******************************/
 
-/** add triangle to vertices
- * @param vertices vertices
- * @param p0,p1,p2 triangle points
- * @param uv0,uv1,uv2 triangle UV map points
- */
-LOCAL void addTriangle(std::vector<Vertex> &vertices,
-                       const glm::vec3     &p0,
-                       const glm::vec3     &p1,
-                       const glm::vec3     &p2,
-                       const glm::vec2     &uv0,
-                       const glm::vec2     &uv1,
-                       const glm::vec2     &uv2
-                      )
-{
-  glm::vec3 c0 = { 1.0f, 0.0f, 0.0f };
-  glm::vec3 c1 = { 0.0f, 1.0f, 0.0f };
-  glm::vec3 c2 = { 0.0f, 0.0f, 1.0f };
-
-  // add triangle
-  vertices.push_back(Vertex{p0, c0, uv0});
-  vertices.push_back(Vertex{p1, c1, uv1});
-  vertices.push_back(Vertex{p2, c2, uv2});
-}
-
-/** add quad to vertices
- * @param vertices vertices
- * @param p0,p1,p2,p3 quad points
- * @param uv0,uv1,uv2,uv3 quad UV map points
+#if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+/** get valid map size
+ * @param size requested map size
+ * @param maxSize max. map size
+ * @return size rounded to MAP_SIZE_STEP and clamped to MIN_MAP_SIZE..maxSize
  */
-LOCAL void addQuad(std::vector<Vertex> &vertices,
-                   const glm::vec3     &p0,
-                   const glm::vec3     &p1,
-                   const glm::vec3     &p2,
-                   const glm::vec3     &p3,
-                   const glm::vec2     &uv0,
-                   const glm::vec2     &uv1,
-                   const glm::vec2     &uv2,
-                   const glm::vec2     &uv3
-                  )
+LOCAL uint getValidMapSize(uint size, uint maxSize)
 {
-  addTriangle(vertices, p0, p1, p2, uv0, uv1, uv2);
-  addTriangle(vertices, p2, p3, p0, uv2, uv3, uv0);
-}
+  maxSize = std::max(MIN_MAP_SIZE, (maxSize / MAP_SIZE_STEP) * MAP_SIZE_STEP);
+  size    = ((size + MAP_SIZE_STEP / 2) / MAP_SIZE_STEP) * MAP_SIZE_STEP;
 
-#if 0
-LOCAL void createCube(std::vector<Vertex> &vertices)
-{
-  glm::vec2 uv{0.0f, 0.0f};
-
-  addQuad(vertices,
-          glm::vec3(-1, -1, -1),
-          glm::vec3(1, -1, -1),
-          glm::vec3(1, 1, -1),
-          glm::vec3(-1, 1, -1),
-          uv, uv, uv, uv
-         );
-
-  addQuad(vertices,
-          glm::vec3(-1, -1, 1),
-          glm::vec3(1, -1, 1),
-          glm::vec3(1, 1, 1),
-          glm::vec3(-1, 1, 1),
-          uv, uv, uv, uv
-         );
+  return std::min(std::max(size, MIN_MAP_SIZE), maxSize);
 }
-#endif
 
-/** create donut world segment
- * @param segment segment
- * @param maxSegmentCount max. segment count
- * @param radius radius
- * @param translateY translation along y-axis
+/** get elevation texture size: largest divisor of the map size up to
+ *  MAX_ELEVATION_SIZE, see Renderer::computeElevations()
+ * @param mapSize map width or height
+ * @return elevation texture width or height
  */
-LOCAL void createDonutWorldSegment(glm::vec3 segment[], uint maxSegmentCount, float radius, float translateY)
+LOCAL uint getElevationSize(uint mapSize)
 {
-  // get circle segment
-  segment[0] = glm::vec3(0.0f, radius, 0.0f);
-
-  for (uint i = 1; i < maxSegmentCount; i++)
+  uint blockSize = (mapSize + MAX_ELEVATION_SIZE - 1) / MAX_ELEVATION_SIZE;
+  while ((mapSize % blockSize) != 0)
   {
-    float th = (2 * M_PI * (float)i) / (float)maxSegmentCount;
-
-    glm::vec3 eulers(th, 0.0, 0.0);
-    glm::quat q = glm::quat(eulers);
-
-    segment[i] = segment[0] * q;
+    blockSize++;
   }
 
-  segment[maxSegmentCount - 1] = segment[0];
-
-  // translate along y-axis
-  for (uint i = 0; i < maxSegmentCount; i++)
-  {
-    segment[i] += glm::vec3(0.0f, translateY, 0.0f);
-  }
+  return mapSize / blockSize;
 }
+#endif
 
-/** create donut world
- * @param vertices vertices
+/** generate new random map with the current map size
  */
-LOCAL void createDonutWorld(std::vector<Vertex> &vertices)
+LOCAL void generateNewRandomMap()
 {
-  glm::vec3 segment [STEPS1];
-  glm::vec3 segment0[STEPS1];
-  glm::vec3 segment1[STEPS1];
-
-  createDonutWorldSegment(segment, STEPS1, R1, R2);
-
-  glm::vec2 uv[4] {glm::vec2(0.0f, 0.0f),
-                   glm::vec2(0.0f, 0.0f),
-                   glm::vec2(0.0f, 0.0f),
-                   glm::vec2(0.0f, 0.0f)
-                  };
-  memcpy(segment0, segment, sizeof(segment0));
-
-  for (uint i = 1; i < STEPS2; i++)
-  {
-    float th = (2 * M_PI * (float)i) / (float)STEPS2;
-
-    // get rotation quaternation
-    glm::vec3 eulers(0.0, 0.0, th);
-    glm::quat q = glm::quat(eulers);
-
-    // rotate donut world segment
-    for (uint j = 0; j < STEPS1; j++)
-    {
-      segment1[j] = segment[j] * q;
-    }
-
-    // create donut world stripe
-    uv[1][0] = (float)i / (float)STEPS2; // UV p1.x
-    uv[2][0] = (float)i / (float)STEPS2; // UV p2.x
-    uv[0][1] = 0.0f; // UV p0.y
-    uv[1][1] = 0.0f; // UV p0.y
-
-    for (uint j = 0; j < STEPS1 - 1; j++)
+  #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+    // allocations are kept if the size did not change
+    if ((map.getWidth() != mapSize) || (map.getHeight() != mapSize))
     {
-      uv[3][1] = (float)(j + 1) / (float)(STEPS1 - 1); // UV p3.y
-      uv[2][1] = (float)(j + 1) / (float)(STEPS1 - 1); // UV p2.y
-
-      addQuad(vertices,
-              segment0[j + 0], segment1[j + 0],
-              segment1[j + 1], segment0[j + 1],
-              uv[0], uv[1], uv[2], uv[3]
-             );
-
-      // shift UV coodinates on y axis
-      uv[0][1] = uv[3][1]; // UV p3.y -> p0.y
-      uv[1][1] = uv[2][1]; // UV p2.y -> p1.y
+      map.reset(mapSize, mapSize);
     }
-
-    memcpy(segment0, segment1, sizeof(segment0));
-
-    // shift UV coodinates on x axis
-    uv[0][0] = uv[1][0]; // UV p1.x -> p0.x
-    uv[3][0] = uv[2][0]; // UV p2.x -> p3.x
-  }
-
-  // create final donut world stripe (connect with first segment coordinates)
-  uv[1][0] = 1.0f; // UV p1.x
-  uv[2][0] = 1.0f; // UV p2.x
-  uv[0][1] = 0.0f; // UV p0.y
-  uv[1][1] = 0.0f; // UV p0.y
-
-  for (uint j = 0; j < STEPS1 - 1; j++)
-  {
-    uv[3][1] = (float)(j + 1) / (float)(STEPS1 - 1); // UV p3.y
-    uv[2][1] = (float)(j + 1) / (float)(STEPS1 - 1); // UV p2.y
-
-    addQuad(vertices,
-            segment0[j + 0], segment [j + 0],
-            segment [j + 1], segment0[j + 1],
-            uv[0], uv[1], uv[2], uv[3]
-           );
-
-    // shift UV coodinates on y axis
-    uv[0][1] = uv[3][1]; // UV p3.y -> p0.y
-    uv[1][1] = uv[2][1]; // UV p2.y -> p1.y
-  }
-
-  //fprintf(stderr,"%s, %d: verticesCount=%lu\n",__FILE__,__LINE__,vertices.size());
-}
-
-// ---------------------------------------------------------------------
-
-/** generate new random map
- */
-LOCAL void generateNewRandomMap()
-{
-  #if (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED)
-    MapGenerator::generate(map, 600, 800);
-    for (uint y = 0; y < TEXTURE_HEIGHT; y++)
+  #endif
+  #if (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED) || (TEXTURE_TYPE == TEXTURE_TYPE_INDEXED)
+    MapGenerator::generate(map, MapGenerator::DEFAULT_MIN_CONTINENTS, MapGenerator::DEFAULT_MAX_CONTINENTS);
+    textureData.resize(static_cast<size_t>(map.getWidth()) * map.getHeight());
+    for (uint y = 0; y < map.getHeight(); y++)
     {
-      for (uint x = 0; x < TEXTURE_WIDTH; x++)
+      for (uint x = 0; x < map.getWidth(); x++)
       {
-        Tile tile = map.getTile(x,y);
-
-        switch (tile.getType())
+        if (map.isLand(x,y))
         {
-          case Tile::Types::WATER:
-            textureData[y][x] = Color::interpolate(Color::WATER1, Color::WATER2, (double)rand() / RAND_MAX);
-            break;
-          case Tile::Types::LAND:
-            textureData[y][x] = Color::LAND1;
-            break;
-          default:
-            break;
+          textureData[static_cast<size_t>(y) * map.getWidth() + x] = Color::LAND1;
+        }
+        else
+        {
+          textureData[static_cast<size_t>(y) * map.getWidth() + x] = Color::interpolate(Color::WATER1, Color::WATER2, (double)rand() / RAND_MAX);
         }
       }
     }
+  #elif (TEXTURE_TYPE == TEXTURE_TYPE_VIRTUAL)
+    MapGenerator::generate(map, MapGenerator::DEFAULT_MIN_CONTINENTS, MapGenerator::DEFAULT_MAX_CONTINENTS);
+  #endif
+  #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+    elevationWidth  = getElevationSize(map.getWidth());
+    elevationHeight = getElevationSize(map.getHeight());
+    Renderer::computeElevations(map, elevationWidth, elevationHeight, elevationData);
   #endif
 }
 
@@ -351,9 +213,6 @@ LOCAL void generateNewRandomMap()
  */
 LOCAL void onRealize(GtkWidget *widget)
 {
-  GLint status;
-  char  s[100];
-
   gtk_gl_area_make_current(GTK_GL_AREA(widget));
 
   if (gtk_gl_area_get_error(GTK_GL_AREA(widget)) != NULL)
@@ -361,105 +220,27 @@ LOCAL void onRealize(GtkWidget *widget)
     return;
   }
 
-  GdkGLContext *context = gtk_gl_area_get_context(GTK_GL_AREA(widget));
-  (void)context;
-
-  #if 1
-    createDonutWorld(vertices);
-  #else
-    createCube(vertices);
-  #endif
-
-  // init texture
-  for (uint y = 0; y < TEXTURE_HEIGHT; y++)
-  {
-    for (uint x = 0; x < TEXTURE_WIDTH; x++)
+  #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+    // map sizes supported by the GL implementation
+    const uint maxMapSize = getValidMapSize(MAX_MAP_SIZE, Renderer::getMaxTextureSize(renderer.getTextureType()));
+    gtk_spin_button_set_range(GTK_SPIN_BUTTON(spinButtonMapSize), MIN_MAP_SIZE, maxMapSize);
+    if (mapSize > maxMapSize)
     {
-      textureData[y][x] = Color::WATER1;
+      fprintf(stderr, "Warning: map size %u exceeds max. texture size, using %u\n", mapSize, maxMapSize);
+      mapSize = maxMapSize;
     }
-  }
-
-  GLuint texture;
-  glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  #if (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED)
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, TEXTURE_WIDTH, TEXTURE_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, textureData.data());
+    renderer.init(mapSize, mapSize, IMMUTABLE_TEXTURE_STORAGE);
   #else
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, TEXTURE_WIDTH, TEXTURE_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, TEXTURE_DATA);
+    renderer.init(TEXTURE_WIDTH, TEXTURE_HEIGHT, IMMUTABLE_TEXTURE_STORAGE);
   #endif
 
-  // init vertex buffer
-  glGenBuffers(1, &vertexBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-  // init shaders
-  vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &VERTEX_SHADER, NULL);
-  glCompileShader(vertexShader);
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-  glGetShaderInfoLog(vertexShader, sizeof(s), NULL, s);
-  //fprintf(stderr,"%s, %d: %s %d\n",__FILE__,__LINE__,s,n);
-  assert(status == GL_TRUE);
-
-  fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &FRAGMENT_SHADER, NULL);
-  glCompileShader(fragmentShader);
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-  glGetShaderInfoLog(fragmentShader, sizeof(s), NULL, s);
-  //fprintf(stderr,"%s, %d: %s %d\n",__FILE__,__LINE__,s,n);
-  assert(status == GL_TRUE);
-
-  // init OpenGL program
-  program = glCreateProgram();
-  glAttachShader(program, vertexShader);
-  glAttachShader(program, fragmentShader);
-  glLinkProgram(program);
-  glGetProgramiv(program, GL_LINK_STATUS, &status);
-  glGetProgramInfoLog(program, sizeof(s), NULL, s);
-  //fprintf(stderr,"%s, %d: %s %d\n",__FILE__,__LINE__,s,n);
-  assert(status == GL_TRUE);
-
-  // get shader variable locations
-  projectionViewModelLocation  = glGetUniformLocation(program, "projectionViewModel");
-  textureTranslateLocation     = glGetUniformLocation(program, "textureTranslate");
-  GLint vPositionLocation      = glGetAttribLocation(program, "vPosition");
-  GLint vColorLocation         = glGetAttribLocation(program, "vColor");
-  GLint vUVLocation            = glGetAttribLocation(program, "vUV");
-//  GLint colorLocation          = glGetAttribLocation(program, "color");
-  GLint textureSamplerLocation = glGetUniformLocation(program, "textureSampler");
-#if 0
-  fprintf(stderr, "%s, %d: projectionViewModelLocation=%d\n", __FILE__, __LINE__, projectionViewModelLocation);
-  fprintf(stderr, "%s, %d: textureTranslateLocation=%d\n", __FILE__, __LINE__, textureTranslateLocation);
-  fprintf(stderr, "%s, %d: %d\n", __FILE__, __LINE__, vPositionLocation);
-  fprintf(stderr, "%s, %d: %d\n", __FILE__, __LINE__, vColorLocation);
-  fprintf(stderr, "%s, %d: vUVLocation=%d\n", __FILE__, __LINE__, vUVLocation);
-  fprintf(stderr, "%s, %d: colorLocation=%d\n", __FILE__, __LINE__, colorLocation);
-  fprintf(stderr, "%s, %d: textureSamplerLocation=%d\n", __FILE__, __LINE__, textureSamplerLocation);
-#endif
-
-  // bind vertex array
-  glGenVertexArrays(1, &vertexArray);
-  glBindVertexArray(vertexArray);
-  glEnableVertexAttribArray(vPositionLocation);
-  glVertexAttribPointer(vPositionLocation, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
-  glEnableVertexAttribArray(vColorLocation);
-  glVertexAttribPointer(vColorLocation, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
-  glEnableVertexAttribArray(vUVLocation);
-  glVertexAttribPointer(vUVLocation, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
-
-  // bind texture
-  glActiveTexture(GL_TEXTURE0);
-  //  glBindTexture(GL_TEXTURE_2D, texture);
-  glUniform1i(textureSamplerLocation, 0);
-
-  glDetachShader(program, fragmentShader);
-  glDetachShader(program, vertexShader);
-
-  // init model projection
-  model = glm::rotate(glm::mat4(1.0), (float)(2 * M_PI / 8), glm::vec3(-1, 0, 0));
+  // init texture
+  #if   (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED) || (TEXTURE_TYPE == TEXTURE_TYPE_INDEXED)
+    const std::vector<Color> water(static_cast<size_t>(renderer.getTextureWidth()) * renderer.getTextureHeight(), Color::WATER1);
+    renderer.setTexture(water.data());
+  #elif (TEXTURE_TYPE == TEXTURE_TYPE_FIXED)
+    renderer.setTexture(reinterpret_cast<const Color*>(TEXTURE_DATA));
+  #endif
 }
 
 /** callback on unrealize widgets
@@ -474,11 +255,7 @@ LOCAL void onUnrealize(GtkWidget *widget)
     return;
   }
 
-  glDeleteProgram(program);
-  glDeleteShader(fragmentShader);
-  glDeleteShader(vertexShader);
-  //  glDeleteVertexArray(1, &vertexArray);
-  glDeleteBuffers(1, &vertexBuffer);
+  renderer.done();
 }
 
 /** redraw scene
@@ -487,49 +264,98 @@ LOCAL void onUnrealize(GtkWidget *widget)
  */
 LOCAL void drawScene(ulong time, ulong deltaTime)
 {
-  glUseProgram(program);
-  glEnable(GL_TEXTURE_2D);
-  glEnable(GL_CULL_FACE);
-  glFrontFace(GL_CCW);
-  glCullFace(GL_BACK);
-  glEnable(GL_DEPTH_TEST);
-
-  model = glm::rotate(model, (float)deltaTime / 1000.0f, glm::vec3(0, 0, 1));
-  glm::vec3 position            = glm::vec3(0, 0, 2);
-  glm::vec3 front               = glm::vec3(0, 0, -1);
-  glm::vec3 up                  = glm::vec3(0, 1, 0);
-  glm::mat4 view                = glm::lookAt(position, position + front, up);
-  glm::mat4 projection          = glm::perspective(45.0, double(VIEW_WIDTH) / double(VIEW_HEIGHT), 0.1, 100.0);
-  glm::mat4 projectionViewModel = projection * view * model;
-  glUniformMatrix4fv(projectionViewModelLocation, 1, GL_FALSE, (const GLfloat *)&projectionViewModel);
-
   if (newMapFlag)
   {
-    glTexSubImage2D(GL_TEXTURE_2D,
-                    0,  // level
-                    0,  // x-offset
-                    0,  // y-offset
-                    TEXTURE_WIDTH,
-                    TEXTURE_HEIGHT,
-                    GL_RGB,
-                    GL_UNSIGNED_BYTE,
-                    textureData.data()
-                   );
+    #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+      renderer.setTextureSize(map.getWidth(), map.getHeight());
+    #endif
+    #if   (TEXTURE_TYPE == TEXTURE_TYPE_VIRTUAL)
+      renderer.setMap(map.getSnapshot());
+    #elif (TEXTURE_TYPE == TEXTURE_TYPE_GENERATED) || (TEXTURE_TYPE == TEXTURE_TYPE_INDEXED)
+      renderer.setTexture(textureData.data());
+    #endif
+    #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+      renderer.setElevations(elevationData.data(), elevationWidth, elevationHeight);
+    #endif
+    renderer.clearLabels();
+    gtk_statusbar_pop(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_ISLAND);
+    newMapFlag = FALSE;
+  }
+  if (newLabelsFlag)
+  {
+    renderer.setLabels(map.getIslandLabels().data(), map.getWidth(), map.getHeight());
+    newLabelsFlag = FALSE;
+  }
+
+  // hover/select island at pointer; picks with the view of the last frame
+  if (islandsFlag && pointerFlag)
+  {
+    const int scaleFactor = gtk_widget_get_scale_factor(area);
+    uint32_t  label       = 0;
+    uint      x, y;
+    if (renderer.pick(static_cast<uint>(std::max(pointerX * scaleFactor, 0.0)),
+                      static_cast<uint>(std::max(pointerY * scaleFactor, 0.0)),
+                      x,
+                      y
+                     )
+       )
+    {
+      label = map.getIslandLabel(x, y);
+    }
+    renderer.setHoverLabel(label);
+
+    if (selectFlag)
+    {
+      renderer.setSelectedLabel(label);
+
+      gtk_statusbar_pop(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_ISLAND);
+      const Island *island = map.getIsland(label);
+      if (island != nullptr)
+      {
+        char buffer[128];
+        snprintf(buffer, sizeof(buffer), "Island %u: %zu tiles", label, island->getTileCount());
+        gtk_statusbar_push(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_ISLAND, buffer);
+      }
+    }
   }
+  selectFlag = FALSE;
+
+  renderer.draw(VIEW_WIDTH, VIEW_HEIGHT, time, deltaTime);
+}
+
+/** callback on frame clock tick: queue render when a frame is due
+ * @param widget widget
+ * @param frameClock frame clock
+ * @param userData user data
+ * @return G_SOURCE_CONTINUE or G_SOURCE_REMOVE when idle
+ */
+LOCAL gboolean onTick(GtkWidget *widget, GdkFrameClock *frameClock, gpointer userData)
+{
+  (void)userData;
 
-  textureTranslate[1] = (float)((time / 30) % TEXTURE_HEIGHT) / (float)TEXTURE_HEIGHT;
-  glUniform2fv(textureTranslateLocation, 1, (const GLfloat *)&textureTranslate);
+  if (frameScheduler.tick(gdk_frame_clock_get_frame_time(frameClock)))
+  {
+    gtk_gl_area_queue_render(GTK_GL_AREA(widget));
+  }
 
-  glBindVertexArray(vertexArray);
+  if (frameScheduler.isIdle())
+  {
+    // stop ticks until the next request
+    tickCallbackId = 0;
+    return G_SOURCE_REMOVE;
+  }
 
-  // draw
-  glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+  return G_SOURCE_CONTINUE;
+}
 
-  // We finished using the buffers and program
-  //  glBindVertexArray(0);
-  //  glDisableVertexAttribArray(0);
-  //  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glUseProgram(0);
+/** start frame clock ticks if frames are requested or animating
+ */
+LOCAL void scheduleFrames()
+{
+  if ((tickCallbackId == 0) && !frameScheduler.isIdle())
+  {
+    tickCallbackId = gtk_widget_add_tick_callback(area, onTick, nullptr, nullptr);
+  }
 }
 
 /** callback on OpenGL render
@@ -545,22 +371,54 @@ LOCAL gboolean onRender(GtkGLArea    *area,
     return FALSE;
   }
 
-  // get frame delta time
-  GDateTime *dateTime = g_date_time_new_now_local();
-  ulong time = g_date_time_difference(dateTime, startDateTime) / 1000;
-  ulong deltaTime = g_date_time_difference(dateTime, lastDateTime) / 1000;
-  lastDateTime = dateTime;
+  // get frame time; the animation only advances while rotating
+  const int64_t frameTime = gdk_frame_clock_get_frame_time(gtk_widget_get_frame_clock(GTK_WIDGET(area)));
+  if (frameScheduler.isAnimating() && (lastFrameTime > 0))
+  {
+    animationTime += frameTime - lastFrameTime;
+  }
+  lastFrameTime = frameTime;
+  ulong time      = static_cast<ulong>(animationTime / 1000);
+  ulong deltaTime = time - lastAnimationTime;
+  lastAnimationTime = time;
 
-  // clear viewport
-  glClearColor(0.0, 0.0, 0.0, 1.0);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  const int64_t renderStartTime = g_get_monotonic_time();
 
   // draw scene
   drawScene(time, deltaTime);
 
-  // flush the contents of the pipeline
-  glFlush();
-  gtk_gl_area_queue_render(area);
+  #if (TEXTURE_TYPE == TEXTURE_TYPE_VIRTUAL)
+    // feedback is read back one frame later: continue rendering until
+    // the pages visible in the last frame are requested and uploaded
+    if (renderer.isStreaming())
+    {
+      feedbackFrameCount = 2;
+    }
+    if (feedbackFrameCount > 0)
+    {
+      feedbackFrameCount--;
+      frameScheduler.requestFrame();
+      scheduleFrames();
+    }
+  #endif
+
+  // statistics: CPU time of the frame; the GL area flushes the pipeline
+  frameScheduler.frameDone(frameTime, g_get_monotonic_time() - renderStartTime);
+  if ((frameTime - lastFrameStatisticsTime) >= FRAME_STATISTICS_INTERVAL)
+  {
+    const FrameScheduler::Statistics statistics = frameScheduler.getStatistics();
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer),
+             "%.1f fps, %.1f/%.1f/%.1f ms",
+             statistics.framesPerSecond,
+             statistics.averageFrameTime,
+             statistics.p95FrameTime,
+             statistics.maxFrameTime
+            );
+    gtk_label_set_text(GTK_LABEL(frameStatisticsText), buffer);
+    lastFrameStatisticsTime = frameTime;
+  }
 
   return TRUE;
 }
@@ -579,7 +437,14 @@ LOCAL void onNewMap(GtkWidget *widget, GdkEventButton *eventButton, gpointer use
   (void)userData;
 
   gtk_widget_set_sensitive(GTK_WIDGET(buttonNewMap), FALSE);
-  gtk_statusbar_push(GTK_STATUSBAR(statusBar), 0, "Generate new map...");
+  gtk_widget_set_sensitive(GTK_WIDGET(spinButtonMapSize), FALSE);
+  gtk_widget_set_sensitive(GTK_WIDGET(buttonFindIslands), FALSE);
+  gtk_statusbar_push(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_PROGRESS, "Generate new map...");
+  islandsFlag = FALSE;
+  #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+    // range of the spin button is limited to the max. texture size already
+    mapSize = getValidMapSize(static_cast<uint>(gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(spinButtonMapSize))), MAX_MAP_SIZE);
+  #endif
 
   auto doneHandler = [](GObject      *sourceObject,
                         GAsyncResult *result,
@@ -591,9 +456,13 @@ LOCAL void onNewMap(GtkWidget *widget, GdkEventButton *eventButton, gpointer use
     (void)userData;
 
     newMapFlag = TRUE;
+    frameScheduler.requestFrame();
+    scheduleFrames();
 
-    gtk_statusbar_pop(GTK_STATUSBAR(statusBar), 0);
+    gtk_statusbar_pop(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_PROGRESS);
     gtk_widget_set_sensitive(buttonNewMap, TRUE);
+    gtk_widget_set_sensitive(spinButtonMapSize, TRUE);
+    gtk_widget_set_sensitive(buttonFindIslands, TRUE);
   };
   GTask *task = g_task_new(widget,nullptr,doneHandler,nullptr);
   assert(task != nullptr);
@@ -624,8 +493,12 @@ LOCAL void onFindIslands(GtkWidget *widget, GdkEventButton *eventButton, gpointe
   (void)eventButton;
   (void)userData;
 
+  // map must not be replaced while the islands are searched
+  gtk_widget_set_sensitive(GTK_WIDGET(buttonNewMap), FALSE);
+  gtk_widget_set_sensitive(GTK_WIDGET(spinButtonMapSize), FALSE);
   gtk_widget_set_sensitive(GTK_WIDGET(buttonFindIslands), FALSE);
-  gtk_statusbar_push(GTK_STATUSBAR(statusBar), 0, "Calculate islands...");
+  gtk_statusbar_push(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_PROGRESS, "Calculate islands...");
+  islandsFlag = FALSE;
 
   auto doneHandler = [](GObject      *sourceObject,
                         GAsyncResult *result,
@@ -641,7 +514,15 @@ LOCAL void onFindIslands(GtkWidget *widget, GdkEventButton *eventButton, gpointe
     buffer << islandCount;
     gtk_label_set_text(GTK_LABEL(islandsText),buffer.str().c_str());
 
-    gtk_statusbar_pop(GTK_STATUSBAR(statusBar), 0);
+    // show islands: one label texture upload
+    islandsFlag   = TRUE;
+    newLabelsFlag = TRUE;
+    frameScheduler.requestFrame();
+    scheduleFrames();
+
+    gtk_statusbar_pop(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_PROGRESS);
+    gtk_widget_set_sensitive(buttonNewMap, TRUE);
+    gtk_widget_set_sensitive(spinButtonMapSize, TRUE);
     gtk_widget_set_sensitive(buttonFindIslands, TRUE);
   };
   GTask *task = g_task_new(widget,nullptr,doneHandler,nullptr);
@@ -665,13 +546,97 @@ LOCAL void onFindIslands(GtkWidget *widget, GdkEventButton *eventButton, gpointe
   g_object_unref(task);
 }
 
+/** callback on rotate toggled
+ * @param toggleButton toggle button
+ * @param userData user data
+ */
+LOCAL void onRotate(GtkToggleButton *toggleButton, gpointer userData)
+{
+  (void)userData;
+
+  frameScheduler.setAnimating(gtk_toggle_button_get_active(toggleButton));
+  frameScheduler.requestFrame();
+  scheduleFrames();
+}
+
+/** callback on pointer motion in view: hover island
+ * @param widget widget
+ * @param eventMotion event motion
+ * @param userData user data
+ * @return FALSE
+ */
+LOCAL gboolean onPointerMotion(GtkWidget *widget, GdkEventMotion *eventMotion, gpointer userData)
+{
+  (void)widget;
+  (void)userData;
+
+  pointerFlag = TRUE;
+  pointerX    = eventMotion->x;
+  pointerY    = eventMotion->y;
+  if (islandsFlag)
+  {
+    frameScheduler.requestFrame();
+    scheduleFrames();
+  }
+
+  return FALSE;
+}
+
+/** callback on pointer leaving view
+ * @param widget widget
+ * @param eventCrossing event crossing
+ * @param userData user data
+ * @return FALSE
+ */
+LOCAL gboolean onPointerLeave(GtkWidget *widget, GdkEventCrossing *eventCrossing, gpointer userData)
+{
+  (void)widget;
+  (void)eventCrossing;
+  (void)userData;
+
+  pointerFlag = FALSE;
+  renderer.setHoverLabel(0);
+  frameScheduler.requestFrame();
+  scheduleFrames();
+
+  return FALSE;
+}
+
+/** callback on button press in view: select island
+ * @param widget widget
+ * @param eventButton event button
+ * @param userData user data
+ * @return TRUE iff handled
+ */
+LOCAL gboolean onPointerPress(GtkWidget *widget, GdkEventButton *eventButton, gpointer userData)
+{
+  (void)widget;
+  (void)userData;
+
+  if (!islandsFlag || (eventButton->button != 1))
+  {
+    return FALSE;
+  }
+
+  pointerFlag = TRUE;
+  pointerX    = eventButton->x;
+  pointerY    = eventButton->y;
+  selectFlag  = TRUE;
+  frameScheduler.requestFrame();
+  scheduleFrames();
+
+  return TRUE;
+}
+
 /** create intial map
  * @param window top level window
  */
 LOCAL void initialMap(GtkWidget *window)
 {
   gtk_widget_set_sensitive(GTK_WIDGET(buttonNewMap), FALSE);
-  gtk_statusbar_push(GTK_STATUSBAR(statusBar), 0, "Generate initial map...");
+  gtk_widget_set_sensitive(GTK_WIDGET(spinButtonMapSize), FALSE);
+  gtk_widget_set_sensitive(GTK_WIDGET(buttonFindIslands), FALSE);
+  gtk_statusbar_push(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_PROGRESS, "Generate initial map...");
 
   GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(window),
                                              GTK_DIALOG_DESTROY_WITH_PARENT,
@@ -692,10 +657,14 @@ LOCAL void initialMap(GtkWidget *window)
     (void)userData;
 
     newMapFlag = TRUE;
+    frameScheduler.requestFrame();
+    scheduleFrames();
 
     gtk_widget_destroy(dialog);
-    gtk_statusbar_pop(GTK_STATUSBAR(statusBar), 0);
+    gtk_statusbar_pop(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_PROGRESS);
     gtk_widget_set_sensitive(buttonNewMap, TRUE);
+    gtk_widget_set_sensitive(spinButtonMapSize, TRUE);
+    gtk_widget_set_sensitive(buttonFindIslands, TRUE);
   };
   GTask *task = g_task_new(dialog,nullptr,doneHandler,nullptr);
   assert(task != nullptr);
@@ -713,15 +682,73 @@ LOCAL void initialMap(GtkWidget *window)
   g_object_unref(task);
 }
 
+/** print usage
+ * @param programName program name
+ */
+LOCAL void printUsage(const char *programName)
+{
+  printf("Usage: %s [<options>]\n", programName);
+  printf("\n");
+  printf("Options:\n");
+  printf("  -f, --fps <n>       target frames per second (default: every display refresh)\n");
+  #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+    printf("  -m, --map-size <n>  map width+height (default: %u, %u..%u, multiple of %u)\n", DEFAULT_MAP_SIZE, MIN_MAP_SIZE, MAX_MAP_SIZE, MAP_SIZE_STEP);
+  #endif
+  printf("  -p, --paused        start with rotation paused\n");
+  printf("  -r, --relief <h>    terrain relief height (default: %.2f, 0: smooth)\n", (double)Renderer::DEFAULT_RELIEF_HEIGHT);
+  printf("  -h, --help          print this help\n");
+}
+
 // ---------------------------------------------------------------------
 
 int main(int argc, char **argv)
 {
   GtkWidget *window;
+  bool      rotateFlag = true;
 
   // initialize GTK
   gtk_init(&argc, &argv);
 
+  // parse options
+  const struct option OPTIONS[] =
+  {
+    {"fps",      required_argument, nullptr, 'f'},
+    {"map-size", required_argument, nullptr, 'm'},
+    {"paused",   no_argument,       nullptr, 'p'},
+    {"relief",   required_argument, nullptr, 'r'},
+    {"help",     no_argument,       nullptr, 'h'},
+    {nullptr,    0,                 nullptr, 0  }
+  };
+  int ch;
+  while ((ch = getopt_long(argc, argv, "f:m:pr:h", OPTIONS, nullptr)) != -1)
+  {
+    switch (ch)
+    {
+      case 'f':
+        frameScheduler.setTargetFPS(strtod(optarg, nullptr));
+        break;
+      case 'm':
+        #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+          mapSize = getValidMapSize(static_cast<uint>(std::min(strtoul(optarg, nullptr, 10), static_cast<ulong>(MAX_MAP_SIZE))), MAX_MAP_SIZE);
+        #else
+          fprintf(stderr, "Warning: fixed map, map size ignored\n");
+        #endif
+        break;
+      case 'p':
+        rotateFlag = false;
+        break;
+      case 'r':
+        renderer.setReliefHeight(std::max(0.0, strtod(optarg, nullptr)));
+        break;
+      case 'h':
+        printUsage(argv[0]);
+        return EXIT_SUCCESS;
+      default:
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
   // create top level window
   window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
   assert(window != nullptr);
@@ -752,6 +779,10 @@ int main(int argc, char **argv)
             g_signal_connect(area, "realize", G_CALLBACK(onRealize), nullptr);
             g_signal_connect(area, "unrealize", G_CALLBACK(onUnrealize), nullptr);
             g_signal_connect(area, "render", G_CALLBACK(onRender), nullptr);
+            gtk_widget_add_events(area, GDK_POINTER_MOTION_MASK | GDK_BUTTON_PRESS_MASK | GDK_LEAVE_NOTIFY_MASK);
+            g_signal_connect(area, "motion-notify-event", G_CALLBACK(onPointerMotion), nullptr);
+            g_signal_connect(area, "leave-notify-event", G_CALLBACK(onPointerLeave), nullptr);
+            g_signal_connect(area, "button-press-event", G_CALLBACK(onPointerPress), nullptr);
           }
           gtk_box_pack_start(GTK_BOX(hbox), vbox, TRUE, TRUE, 0);
         }
@@ -766,11 +797,30 @@ int main(int argc, char **argv)
             gtk_box_pack_start(GTK_BOX(vbox), buttonNewMap, FALSE, FALSE, 0);
             g_signal_connect(buttonNewMap, "button-press-event", G_CALLBACK(onNewMap), nullptr);
 
+            GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, FALSE);
+            assert(hbox != nullptr);
+            gtk_box_set_spacing(GTK_BOX(hbox), 6);
+            {
+              GtkWidget *label = gtk_label_new("Size:");
+              gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
+
+              // range is limited to the max. texture size on realize
+              #if (TEXTURE_TYPE != TEXTURE_TYPE_FIXED)
+                spinButtonMapSize = gtk_spin_button_new_with_range(MIN_MAP_SIZE, MAX_MAP_SIZE, MAP_SIZE_STEP);
+                gtk_spin_button_set_value(GTK_SPIN_BUTTON(spinButtonMapSize), mapSize);
+              #else
+                spinButtonMapSize = gtk_spin_button_new_with_range(TEXTURE_WIDTH, TEXTURE_WIDTH, 1);
+              #endif
+              gtk_widget_set_tooltip_text(spinButtonMapSize, "map width+height of the next new map");
+              gtk_box_pack_start(GTK_BOX(hbox), spinButtonMapSize, FALSE, FALSE, 0);
+            }
+            gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+
             buttonFindIslands = gtk_button_new_with_label("Calculate islands");
             gtk_box_pack_start(GTK_BOX(vbox), buttonFindIslands, FALSE, FALSE, 0);
             g_signal_connect(buttonFindIslands, "button-press-event", G_CALLBACK(onFindIslands), nullptr);
 
-            GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, FALSE);
+            hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, FALSE);
             assert(hbox != nullptr);
             gtk_box_set_spacing(GTK_BOX(hbox), 6);
             {
@@ -781,6 +831,15 @@ int main(int argc, char **argv)
               gtk_box_pack_start(GTK_BOX(hbox), islandsText, FALSE, FALSE, 0);
             }
             gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+
+            checkButtonRotate = gtk_check_button_new_with_label("Rotate");
+            gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(checkButtonRotate), rotateFlag);
+            gtk_box_pack_start(GTK_BOX(vbox), checkButtonRotate, FALSE, FALSE, 0);
+            g_signal_connect(checkButtonRotate, "toggled", G_CALLBACK(onRotate), nullptr);
+
+            frameStatisticsText = gtk_label_new("");
+            gtk_widget_set_tooltip_text(frameStatisticsText, "frames per second, average/95%/max. frame time");
+            gtk_box_pack_start(GTK_BOX(vbox), frameStatisticsText, FALSE, FALSE, 0);
           }
           gtk_box_pack_start(GTK_BOX(hbox), vbox, FALSE, FALSE, 0);
         }
@@ -792,7 +851,7 @@ int main(int argc, char **argv)
     {
       statusBar = gtk_statusbar_new();
       assert(statusBar != nullptr);
-      gtk_statusbar_push(GTK_STATUSBAR(statusBar), 0, "OK");
+      gtk_statusbar_push(GTK_STATUSBAR(statusBar), STATUS_CONTEXT_PROGRESS, "OK");
 
       gtk_box_pack_start(GTK_BOX(vbox), statusBar, TRUE, TRUE, 0);
     }
@@ -809,6 +868,11 @@ int main(int argc, char **argv)
 
   gtk_widget_show_all(GTK_WIDGET(window));
 
+  // start rendering
+  frameScheduler.setAnimating(rotateFlag);
+  frameScheduler.requestFrame();
+  scheduleFrames();
+
   // create initial map
   initialMap(window);
 
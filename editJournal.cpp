@@ -0,0 +1,523 @@
+/***********************************************************************\
+*
+* Contents: edit journal: undo/redo of map edits
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <algorithm>
+#include <cassert>
+
+#include "binaryIO.h"
+
+#include "editJournal.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+const size_t EditJournal::DEFAULT_MEMORY_BUDGET;
+const uint   EditJournal::DEFAULT_CHECKPOINT_INTERVAL;
+const uint   EditJournal::MAX_CHECKPOINTS;
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** tile value: type and color
+ */
+struct TileValue
+{
+  uint8_t type;
+  Color   color;
+
+  bool operator==(const TileValue &value) const
+  {
+    return (type == value.type) && !(color != value.color);
+  }
+};
+
+/** append run-length encoded values: pairs of count and value
+ * @param data data
+ * @param values values
+ * @param n number of values
+ */
+LOCAL void putValues(std::vector<uint8_t> &data, const TileValue values[], size_t n)
+{
+  size_t i = 0;
+  while (i < n)
+  {
+    size_t j = i + 1;
+    while ((j < n) && (values[j] == values[i]))
+    {
+      j++;
+    }
+
+    putVarUInt(data, j - i);
+    data.push_back(values[i].type);
+    data.push_back(values[i].color.r);
+    data.push_back(values[i].color.g);
+    data.push_back(values[i].color.b);
+
+    i = j;
+  }
+}
+
+/** get run-length encoded values
+ * @param data data
+ * @param i index in data, advanced
+ * @param n number of values
+ * @param values values or nullptr to skip
+ */
+LOCAL void getValues(const std::vector<uint8_t> &data, size_t &i, size_t n, TileValue values[])
+{
+  size_t j = 0;
+  while (j < n)
+  {
+    size_t count = getVarUInt(data, i);
+    assert(j + count <= n);
+    assert(i + 4 <= data.size());
+
+    if (values != nullptr)
+    {
+      TileValue value;
+      value.type    = data[i + 0];
+      value.color.r = data[i + 1];
+      value.color.g = data[i + 2];
+      value.color.b = data[i + 3];
+      std::fill(values + j, values + j + count, value);
+    }
+    i += 4;
+    j += count;
+  }
+}
+
+EditJournal::EditJournal(Map &map, size_t memoryBudget, uint checkpointInterval)
+  : map(map)
+  , memoryBudget(memoryBudget)
+  , checkpointInterval(checkpointInterval)
+  , overflow(false)
+  , transactionDepth(0)
+  , replaying(false)
+  , memoryUsage(0)
+  , checkpointMemoryUsage(0)
+  , transactionNumber(0)
+  , transactionCount(0)
+{
+  map.addListener(this);
+}
+
+EditJournal::~EditJournal()
+{
+  map.removeListener(this);
+}
+
+void EditJournal::beginTransaction()
+{
+  bool checkpoint = false;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (transactionDepth == 0)
+    {
+      checkpoint = commitChanges();
+    }
+    transactionDepth++;
+  }
+  if (checkpoint)
+  {
+    takeCheckpoint();
+  }
+}
+
+void EditJournal::commitTransaction()
+{
+  bool checkpoint = false;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    assert(transactionDepth > 0);
+    transactionDepth--;
+    if (transactionDepth == 0)
+    {
+      checkpoint = commitChanges();
+    }
+  }
+  if (checkpoint)
+  {
+    takeCheckpoint();
+  }
+}
+
+bool EditJournal::canUndo() const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  return !undoTransactions.empty() || !changes.empty();
+}
+
+bool EditJournal::canRedo() const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  return !redoTransactions.empty() && changes.empty();
+}
+
+bool EditJournal::undo()
+{
+  Transaction transaction;
+  bool        checkpoint;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    assert(transactionDepth == 0);
+    checkpoint = commitChanges();
+    if (undoTransactions.empty())
+    {
+      return false;
+    }
+
+    transaction = std::move(undoTransactions.back());
+    undoTransactions.pop_back();
+    replaying = true;
+  }
+  if (checkpoint)
+  {
+    takeCheckpoint();
+  }
+
+  apply(transaction, true);
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    replaying = false;
+    redoTransactions.push_back(std::move(transaction));
+  }
+
+  return true;
+}
+
+bool EditJournal::redo()
+{
+  Transaction transaction;
+  bool        checkpoint;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    assert(transactionDepth == 0);
+    checkpoint = commitChanges();
+    if (redoTransactions.empty())
+    {
+      return false;
+    }
+
+    transaction = std::move(redoTransactions.back());
+    redoTransactions.pop_back();
+    replaying = true;
+  }
+  if (checkpoint)
+  {
+    takeCheckpoint();
+  }
+
+  apply(transaction, false);
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    replaying = false;
+    undoTransactions.push_back(std::move(transaction));
+  }
+
+  return true;
+}
+
+size_t EditJournal::getCheckpointCount() const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  return checkpoints.size();
+}
+
+void EditJournal::restoreCheckpoint(size_t i)
+{
+  Map::Snapshot snapshot;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    assert(i < checkpoints.size());
+    snapshot = checkpoints[i].snapshot;
+  }
+
+  beginTransaction();
+  map.restore(snapshot);
+  commitTransaction();
+}
+
+size_t EditJournal::getMemoryUsage() const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  return memoryUsage + checkpointMemoryUsage;
+}
+
+void EditJournal::clear()
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  changes.clear();
+  overflow = false;
+  undoTransactions.clear();
+  redoTransactions.clear();
+  memoryUsage           = 0;
+  checkpointMemoryUsage = 0;
+  transactionCount      = 0;
+  checkpoints.clear();
+}
+
+void EditJournal::onTileChanged(const Map &map, uint x, uint y, const Tile &oldTile, const Tile &newTile)
+{
+  if (   (oldTile.getType() == newTile.getType())
+      && !(oldTile.getColor() != newTile.getColor())
+     )
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(lock);
+
+  if (replaying || overflow)
+  {
+    return;
+  }
+
+  Change change;
+  change.index    = static_cast<uint64_t>(y) * map.getWidth() + x;
+  change.oldType  = static_cast<uint8_t>(oldTile.getType());
+  change.newType  = static_cast<uint8_t>(newTile.getType());
+  change.oldColor = oldTile.getColor();
+  change.newColor = newTile.getColor();
+  changes.push_back(change);
+
+  // raw changes exceeding the budget cannot be kept anyway
+  if ((changes.size() * sizeof(Change)) > memoryBudget)
+  {
+    changes.clear();
+    changes.shrink_to_fit();
+    overflow = true;
+  }
+}
+
+void EditJournal::onMapChanged(const Map &map)
+{
+  (void)map;
+
+  clear();
+}
+
+bool EditJournal::commitChanges()
+{
+  if (overflow)
+  {
+    // transaction too large: history before is lost
+    overflow = false;
+    undoTransactions.clear();
+    redoTransactions.clear();
+    memoryUsage = 0;
+    return false;
+  }
+  if (changes.empty())
+  {
+    return false;
+  }
+
+  // sort by tile index; a tile changed multiple times keeps the first old
+  // and the last new value
+  std::stable_sort(changes.begin(), changes.end(), [](const Change &change1, const Change &change2) { return change1.index < change2.index; });
+  size_t n = 0;
+  for (size_t i = 0; i < changes.size(); i++)
+  {
+    if ((n > 0) && (changes[n - 1].index == changes[i].index))
+    {
+      changes[n - 1].newType  = changes[i].newType;
+      changes[n - 1].newColor = changes[i].newColor;
+    }
+    else
+    {
+      changes[n++] = changes[i];
+    }
+  }
+  changes.resize(n);
+
+  // encode runs of consecutive tiles: gap to previous run, length,
+  // run-length encoded new values, run-length encoded old values
+  Transaction            transaction;
+  std::vector<TileValue> oldValues, newValues;
+  uint64_t               end = 0;
+  size_t                 i   = 0;
+  while (i < changes.size())
+  {
+    size_t j = i + 1;
+    while ((j < changes.size()) && (changes[j].index == changes[j - 1].index + 1))
+    {
+      j++;
+    }
+
+    oldValues.resize(j - i);
+    newValues.resize(j - i);
+    for (size_t k = i; k < j; k++)
+    {
+      oldValues[k - i].type  = changes[k].oldType;
+      oldValues[k - i].color = changes[k].oldColor;
+      newValues[k - i].type  = changes[k].newType;
+      newValues[k - i].color = changes[k].newColor;
+    }
+
+    putVarUInt(transaction.data, changes[i].index - end);
+    putVarUInt(transaction.data, j - i);
+    putValues(transaction.data, newValues.data(), j - i);
+    putValues(transaction.data, oldValues.data(), j - i);
+
+    end = changes[j - 1].index + 1;
+    i   = j;
+  }
+  transaction.data.shrink_to_fit();
+  transaction.number = ++transactionNumber;
+  changes.clear();
+
+  // new transaction: undone transactions cannot be redone anymore
+  for (const Transaction &redoTransaction : redoTransactions)
+  {
+    memoryUsage -= redoTransaction.data.size();
+  }
+  redoTransactions.clear();
+  memoryUsage += transaction.data.size();
+  undoTransactions.push_back(std::move(transaction));
+  trim();
+
+  transactionCount++;
+  if ((checkpointInterval > 0) && (transactionCount >= checkpointInterval))
+  {
+    transactionCount = 0;
+    return true;
+  }
+
+  return false;
+}
+
+void EditJournal::takeCheckpoint()
+{
+  Map::Snapshot snapshot = map.getSnapshot();
+
+  std::lock_guard<std::mutex> guard(lock);
+
+  // chunks changed since the last checkpoint are kept by it only
+  if (!checkpoints.empty())
+  {
+    Checkpoint &lastCheckpoint = checkpoints.back();
+    size_t     n               = snapshot.getChunkCount();
+    if (lastCheckpoint.snapshot.getChunkCount() == n)
+    {
+      n = 0;
+      for (size_t i = 0; i < snapshot.getChunkCount(); i++)
+      {
+        if (!lastCheckpoint.snapshot.isSharedChunk(snapshot, i))
+        {
+          n++;
+        }
+      }
+    }
+    lastCheckpoint.memoryUsage = n * sizeof(Map::TileChunk);
+    checkpointMemoryUsage += lastCheckpoint.memoryUsage;
+  }
+
+  Checkpoint checkpoint;
+  checkpoint.snapshot          = snapshot;
+  checkpoint.transactionNumber = transactionNumber;
+  checkpoint.memoryUsage       = 0;
+  checkpoints.push_back(checkpoint);
+  while (checkpoints.size() > MAX_CHECKPOINTS)
+  {
+    checkpointMemoryUsage -= checkpoints.front().memoryUsage;
+    checkpoints.pop_front();
+  }
+  trim();
+}
+
+void EditJournal::trim()
+{
+  // drop the older of the oldest transaction and the oldest checkpoint
+  while (   ((memoryUsage + checkpointMemoryUsage) > memoryBudget)
+         && (!undoTransactions.empty() || !checkpoints.empty())
+        )
+  {
+    if (   !checkpoints.empty()
+        && (undoTransactions.empty() || (checkpoints.front().transactionNumber < undoTransactions.front().number))
+       )
+    {
+      checkpointMemoryUsage -= checkpoints.front().memoryUsage;
+      checkpoints.pop_front();
+    }
+    else
+    {
+      memoryUsage -= undoTransactions.front().data.size();
+      undoTransactions.pop_front();
+    }
+  }
+}
+
+void EditJournal::apply(const Transaction &transaction, bool undo)
+{
+  const uint width = map.getWidth();
+
+  std::vector<TileValue>   values;
+  std::vector<Tile::Types> types;
+  std::vector<Color>       colors;
+  uint64_t                 index = 0;
+  size_t                   i     = 0;
+  while (i < transaction.data.size())
+  {
+    index += getVarUInt(transaction.data, i);
+    size_t n = getVarUInt(transaction.data, i);
+
+    values.resize(n);
+    getValues(transaction.data, i, n, undo ? nullptr : values.data());
+    getValues(transaction.data, i, n, undo ? values.data() : nullptr);
+
+    types.resize(n);
+    colors.resize(n);
+    for (size_t k = 0; k < n; k++)
+    {
+      types[k]  = static_cast<Tile::Types>(values[k].type);
+      colors[k] = values[k].color;
+    }
+
+    // runs may continue in the next row
+    size_t k = 0;
+    while (k < n)
+    {
+      uint x = static_cast<uint>((index + k) % width);
+      uint y = static_cast<uint>((index + k) / width);
+      uint m = static_cast<uint>(std::min(n - k, static_cast<size_t>(width - x)));
+
+      map.setTiles(x, y, m, &types[k], &colors[k]);
+      k += m;
+    }
+
+    index += n;
+  }
+}
+
+/* end of file */
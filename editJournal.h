@@ -0,0 +1,190 @@
+/***********************************************************************\
+*
+* Contents: edit journal: undo/redo of map edits
+* Systems: all
+*
+\***********************************************************************/
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+#include "islands.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** edit journal: records tile changes of a map as transactions of
+ *  compact deltas (runs of changed tiles with run-length encoded old and
+ *  new values) and undoes/redoes them in time proportional to the delta
+ *  size. Every n transactions a checkpoint (snapshot of the map) is
+ *  taken, which can be restored even if the transactions are dropped
+ *  already. A checkpoint keeps the chunks changed since it was taken;
+ *  their memory is counted from the next checkpoint on. The oldest
+ *  transactions and checkpoints are dropped if the memory budget is
+ *  exceeded. Replacing all tiles (Map::reset(), Map::load()) clears the
+ *  journal.
+ */
+class EditJournal : public MapListener
+{
+  public:
+    // default memory budget of transactions and checkpoints [bytes]
+    static const size_t DEFAULT_MEMORY_BUDGET       = 16 * 1024 * 1024;
+    // default number of transactions between checkpoints
+    static const uint   DEFAULT_CHECKPOINT_INTERVAL = 64;
+    // max. number of checkpoints
+    static const uint   MAX_CHECKPOINTS             = 8;
+
+    /** create edit journal; registers as listener of map
+     * @param map map
+     * @param memoryBudget memory budget of transactions and
+     *                     checkpoints [bytes]
+     * @param checkpointInterval number of transactions between
+     *                           checkpoints or 0 for no checkpoints
+     */
+    EditJournal(Map    &map,
+                size_t memoryBudget       = DEFAULT_MEMORY_BUDGET,
+                uint   checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL
+               );
+
+    /** destroy edit journal
+     */
+    virtual ~EditJournal();
+
+    /** begin transaction; transactions can be nested, changes are
+     *  committed with the outermost commitTransaction(). Changes outside
+     *  of transactions are collected until the next call of begin-/
+     *  commitTransaction(), undo() or redo().
+     */
+    void beginTransaction();
+
+    /** commit transaction
+     */
+    void commitTransaction();
+
+    /** check if undo is possible
+     * @return true iff transaction to undo available
+     */
+    bool canUndo() const;
+
+    /** check if redo is possible
+     * @return true iff transaction to redo available
+     */
+    bool canRedo() const;
+
+    /** undo last transaction; tiles must not be changed concurrently
+     * @return true iff undone
+     */
+    bool undo();
+
+    /** redo last undone transaction; tiles must not be changed
+     *  concurrently
+     * @return true iff redone
+     */
+    bool redo();
+
+    /** get number of checkpoints
+     * @return number of checkpoints
+     */
+    size_t getCheckpointCount() const;
+
+    /** restore checkpoint; recorded as a transaction, so it can be
+     *  undone
+     * @param i checkpoint index, 0 is the oldest checkpoint
+     */
+    void restoreCheckpoint(size_t i);
+
+    /** get memory usage of transactions and checkpoints
+     * @return memory usage [bytes]
+     */
+    size_t getMemoryUsage() const;
+
+    /** clear journal: drop all transactions and checkpoints
+     */
+    void clear();
+
+    void onTileChanged(const Map &map, uint x, uint y, const Tile &oldTile, const Tile &newTile) override;
+    void onMapChanged(const Map &map) override;
+
+  private:
+    /** change of a tile
+     */
+    struct Change
+    {
+      uint64_t index;  // tile index
+      uint8_t  oldType, newType;
+      Color    oldColor, newColor;
+    };
+
+    /** transaction: encoded runs of changed tiles
+     */
+    struct Transaction
+    {
+      uint64_t             number;  // sequence number
+      std::vector<uint8_t> data;
+    };
+
+    /** checkpoint
+     */
+    struct Checkpoint
+    {
+      Map::Snapshot snapshot;
+      uint64_t      transactionNumber;  // number of last transaction before checkpoint
+      size_t        memoryUsage;        // memory of chunks not shared with next checkpoint [bytes]
+    };
+
+    Map                       &map;
+    const size_t              memoryBudget;
+    const uint                checkpointInterval;
+    std::vector<Change>       changes;           // changes of open transaction
+    bool                      overflow;          // true iff open transaction exceeds memory budget
+    uint                      transactionDepth;
+    bool                      replaying;         // true while undo/redo changes tiles
+    std::deque<Transaction>   undoTransactions;
+    std::deque<Transaction>   redoTransactions;
+    size_t                    memoryUsage;       // memory usage of undo+redo transactions
+    size_t                    checkpointMemoryUsage;
+    uint64_t                  transactionNumber; // number of last transaction
+    uint                      transactionCount;  // transactions since last checkpoint
+    std::deque<Checkpoint>    checkpoints;
+    mutable std::mutex        lock;
+
+    /** commit collected changes as transaction; lock must be locked
+     * @return true iff checkpoint should be taken
+     */
+    bool commitChanges();
+
+    /** take checkpoint; lock must not be locked
+     */
+    void takeCheckpoint();
+
+    /** drop oldest transactions and checkpoints until memory budget is
+     *  kept; lock must be locked
+     */
+    void trim();
+
+    /** apply transaction to map
+     * @param transaction transaction
+     * @param undo true to set old values, false to set new values
+     */
+    void apply(const Transaction &transaction, bool undo);
+};
+
+#endif // EDIT_JOURNAL_H
+
+/* end of file */
@@ -0,0 +1,169 @@
+/***********************************************************************\
+*
+* Contents: frame capture: offscreen framebuffer with asynchronous
+*           read back
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+
+#include <epoxy/gl.h>
+
+#include "frameCapture.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+FrameCapture::FrameCapture(uint bufferCount)
+  : width(0)
+  , height(0)
+  , framebuffer(0)
+  , renderbuffers{0, 0}
+  , buffers(std::max(1U, bufferCount), Buffer{0, nullptr, 0})
+  , frameNumber(0)
+  , savedFramebuffer(0)
+  , savedViewport{0, 0, 0, 0}
+{
+}
+
+void FrameCapture::init(uint width, uint height)
+{
+  this->width  = width;
+  this->height = height;
+
+  // framebuffer
+  glGenRenderbuffers(2, renderbuffers);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &savedFramebuffer);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+  assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+  glBindFramebuffer(GL_FRAMEBUFFER, savedFramebuffer);
+
+  // pixel pack buffers
+  for (Buffer &buffer : buffers)
+  {
+    glGenBuffers(1, &buffer.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, nullptr, GL_STREAM_READ);
+    buffer.fence = nullptr;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  frameNumber = 0;
+}
+
+void FrameCapture::done()
+{
+  for (Buffer &buffer : buffers)
+  {
+    if (buffer.fence != nullptr)
+    {
+      glDeleteSync(buffer.fence);
+      buffer.fence = nullptr;
+    }
+    glDeleteBuffers(1, &buffer.buffer);
+    buffer.buffer = 0;
+  }
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteRenderbuffers(2, renderbuffers);
+  framebuffer      = 0;
+  renderbuffers[0] = 0;
+  renderbuffers[1] = 0;
+}
+
+void FrameCapture::begin()
+{
+  assert(framebuffer != 0);
+
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &savedFramebuffer);
+  glGetIntegerv(GL_VIEWPORT, savedViewport);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(0, 0, width, height);
+}
+
+void FrameCapture::end(const FrameHandler &handler)
+{
+  Buffer &buffer = buffers[frameNumber % buffers.size()];
+
+  // deliver oldest frame before its buffer is reused
+  if (buffer.fence != nullptr)
+  {
+    deliver(buffer, handler);
+  }
+
+  // start read back
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.buffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  buffer.fence       = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  buffer.frameNumber = frameNumber;
+  frameNumber++;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, savedFramebuffer);
+  glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+void FrameCapture::flush(const FrameHandler &handler)
+{
+  // oldest first
+  for (size_t i = 0; i < buffers.size(); i++)
+  {
+    Buffer &buffer = buffers[(frameNumber + i) % buffers.size()];
+    if (buffer.fence != nullptr)
+    {
+      deliver(buffer, handler);
+    }
+  }
+}
+
+void FrameCapture::deliver(Buffer &buffer, const FrameHandler &handler)
+{
+  assert(buffer.fence != nullptr);
+
+  glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  glDeleteSync(buffer.fence);
+  buffer.fence = nullptr;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.buffer);
+  const uint8_t *pixels = static_cast<const uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+                                                                       0,
+                                                                       static_cast<GLsizeiptr>(width) * height * 4,
+                                                                       GL_MAP_READ_BIT
+                                                                      )
+                                                     );
+  if (pixels != nullptr)
+  {
+    handler(buffer.frameNumber, pixels);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/* end of file */
@@ -0,0 +1,140 @@
+/***********************************************************************\
+*
+* Contents: frame capture: offscreen framebuffer with asynchronous
+*           read back
+* Systems: all
+*
+\***********************************************************************/
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <functional>
+
+#include <sys/types.h>
+
+#include <epoxy/gl.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** frame capture: renders frames into a framebuffer object and reads
+ *  them back through a ring of pixel pack buffers. A frame is delivered
+ *  when its buffer is reused, i. e. bufferCount-1 frames later, so the
+ *  GPU renders the next frames while previous frames are transferred.
+ *
+ *  All methods must be called in the GL context.
+ *
+ *  Usage:
+ *
+ *    frameCapture.init(width, height);
+ *    for each frame
+ *    {
+ *      frameCapture.begin();
+ *      ... draw ...
+ *      frameCapture.end(handler);
+ *    }
+ *    frameCapture.flush(handler);
+ *    frameCapture.done();
+ */
+class FrameCapture
+{
+  public:
+    // default number of pixel pack buffers
+    static const uint DEFAULT_BUFFER_COUNT = 3;
+
+    /** frame handler
+     * @param frameNumber frame number, 0..n-1
+     * @param pixels RGBA pixels, bottom row first
+     */
+    typedef std::function<void(uint64_t frameNumber, const uint8_t *pixels)> FrameHandler;
+
+    /** create frame capture
+     * @param bufferCount number of pixel pack buffers (frames in flight)
+     */
+    FrameCapture(uint bufferCount = DEFAULT_BUFFER_COUNT);
+
+    /** create framebuffer and pixel pack buffers
+     * @param width,height frame size
+     */
+    void init(uint width, uint height);
+
+    /** release GL objects
+     */
+    void done();
+
+    /** begin frame: bind framebuffer and set viewport
+     */
+    void begin();
+
+    /** end frame: start read back of frame, deliver the oldest frame if
+     *  its buffer is reused and restore the framebuffer
+     * @param handler frame handler
+     */
+    void end(const FrameHandler &handler);
+
+    /** deliver all frames in flight
+     * @param handler frame handler
+     */
+    void flush(const FrameHandler &handler);
+
+    /** get frame width
+     * @return width
+     */
+    uint getWidth() const
+    {
+      return width;
+    }
+
+    /** get frame height
+     * @return height
+     */
+    uint getHeight() const
+    {
+      return height;
+    }
+
+  private:
+    /** pixel pack buffer
+     */
+    struct Buffer
+    {
+      GLuint   buffer;
+      GLsync   fence;        // read back done or nullptr if unused
+      uint64_t frameNumber;
+    };
+
+    uint                width, height;
+    GLuint              framebuffer;
+    GLuint              renderbuffers[2];  // color, depth
+    std::vector<Buffer> buffers;
+    uint64_t            frameNumber;      // next frame number
+    GLint               savedFramebuffer;
+    GLint               savedViewport[4];
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture &operator=(const FrameCapture&) = delete;
+
+    /** wait for read back of buffer and deliver frame
+     * @param buffer buffer
+     * @param handler frame handler
+     */
+    void deliver(Buffer &buffer, const FrameHandler &handler);
+};
+
+#endif // FRAME_CAPTURE_H
+
+/* end of file */
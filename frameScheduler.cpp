@@ -0,0 +1,150 @@
+/***********************************************************************\
+*
+* Contents: frame scheduler: frame pacing and render on demand
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include "frameScheduler.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** add value to ring buffer
+ * @param values ring buffer
+ * @param index running index
+ * @param value value
+ */
+LOCAL void addValue(std::vector<int64_t> &values, uint64_t index, int64_t value)
+{
+  if (values.size() < FrameScheduler::STATISTICS_FRAME_COUNT)
+  {
+    values.push_back(value);
+  }
+  else
+  {
+    values[index % FrameScheduler::STATISTICS_FRAME_COUNT] = value;
+  }
+}
+
+FrameScheduler::FrameScheduler(double targetFPS)
+  : targetInterval(0)
+  , animatingFlag(false)
+  , requestFlag(false)
+  , nextFrameTime(0)
+  , frameCount(0)
+  , skippedTickCount(0)
+  , lastFrameTime(0)
+{
+  setTargetFPS(targetFPS);
+}
+
+void FrameScheduler::setTargetFPS(double targetFPS)
+{
+  targetInterval = (targetFPS > 0.0) ? static_cast<int64_t>(1000000.0 / targetFPS) : 0;
+  nextFrameTime  = 0;
+}
+
+bool FrameScheduler::tick(int64_t time)
+{
+  if (isIdle())
+  {
+    return false;
+  }
+
+  if (targetInterval > 0)
+  {
+    // ticks are aligned to the display refresh: accept a tick up to a
+    // quarter interval early, so e. g. 30 FPS on a 60 Hz display does
+    // not drop to 20 FPS by jitter
+    if (time < nextFrameTime - targetInterval / 4)
+    {
+      skippedTickCount++;
+      return false;
+    }
+
+    // keep the average rate; restart after idle or if behind
+    nextFrameTime += targetInterval;
+    if (nextFrameTime <= time)
+    {
+      nextFrameTime = time + targetInterval;
+    }
+  }
+
+  requestFlag = false;
+
+  return true;
+}
+
+void FrameScheduler::frameDone(int64_t time, int64_t renderTime)
+{
+  addValue(renderTimes, frameCount, renderTime);
+  if (animatingFlag && (frameCount > 0))
+  {
+    addValue(intervals, frameCount, time - lastFrameTime);
+  }
+  lastFrameTime = time;
+  frameCount++;
+}
+
+FrameScheduler::Statistics FrameScheduler::getStatistics() const
+{
+  Statistics statistics;
+
+  statistics.frameCount       = frameCount;
+  statistics.skippedTickCount = skippedTickCount;
+
+  if (!renderTimes.empty())
+  {
+    std::vector<int64_t> sortedRenderTimes(renderTimes);
+    std::sort(sortedRenderTimes.begin(), sortedRenderTimes.end());
+    statistics.averageFrameTime = static_cast<double>(std::accumulate(sortedRenderTimes.begin(), sortedRenderTimes.end(), int64_t(0)))
+                                  / static_cast<double>(sortedRenderTimes.size())
+                                  / 1000.0;
+    statistics.p95FrameTime     = static_cast<double>(sortedRenderTimes[(sortedRenderTimes.size() * 95) / 100]) / 1000.0;
+    statistics.maxFrameTime     = static_cast<double>(sortedRenderTimes.back()) / 1000.0;
+  }
+  else
+  {
+    statistics.averageFrameTime = 0.0;
+    statistics.p95FrameTime     = 0.0;
+    statistics.maxFrameTime     = 0.0;
+  }
+
+  if (!intervals.empty())
+  {
+    statistics.averageInterval = static_cast<double>(std::accumulate(intervals.begin(), intervals.end(), int64_t(0)))
+                                 / static_cast<double>(intervals.size())
+                                 / 1000.0;
+    statistics.maxInterval     = static_cast<double>(*std::max_element(intervals.begin(), intervals.end())) / 1000.0;
+    statistics.framesPerSecond = (statistics.averageInterval > 0.0) ? 1000.0 / statistics.averageInterval : 0.0;
+  }
+  else
+  {
+    statistics.averageInterval = 0.0;
+    statistics.maxInterval     = 0.0;
+    statistics.framesPerSecond = 0.0;
+  }
+
+  return statistics;
+}
+
+/* end of file */
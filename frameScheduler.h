@@ -0,0 +1,140 @@
+/***********************************************************************\
+*
+* Contents: frame scheduler: frame pacing and render on demand
+* Systems: all
+*
+\***********************************************************************/
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+
+#include <sys/types.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** frame scheduler: decides on each display refresh tick whether a frame
+ *  is rendered. Frames are rendered continuously while animating, paced
+ *  to the target frame rate, otherwise only once per request. When idle,
+ *  the caller stops the ticks until the next request. Keeps statistics
+ *  of the recent frames.
+ *
+ *  Times are in microseconds of a monotonic clock, e. g. the frame time
+ *  of a GdkFrameClock.
+ */
+class FrameScheduler
+{
+  public:
+    // number of frames for statistics
+    static const uint STATISTICS_FRAME_COUNT = 120;
+
+    /** frame statistics of the recent frames
+     */
+    struct Statistics
+    {
+      uint64_t frameCount;          // total number of rendered frames
+      uint64_t skippedTickCount;    // total number of ticks without frame
+      double   framesPerSecond;
+      double   averageFrameTime;    // average render time [ms]
+      double   p95FrameTime;        // 95th percentile render time [ms]
+      double   maxFrameTime;        // max. render time [ms]
+      double   averageInterval;     // average time between frames [ms]
+      double   maxInterval;         // max. time between frames [ms]
+    };
+
+    /** create frame scheduler
+     * @param targetFPS target frames per second; 0 for every tick
+     */
+    FrameScheduler(double targetFPS = 0.0);
+
+    /** set target frame rate
+     * @param targetFPS target frames per second; 0 for every tick
+     */
+    void setTargetFPS(double targetFPS);
+
+    /** get target frame rate
+     * @return target frames per second; 0 for every tick
+     */
+    double getTargetFPS() const
+    {
+      return (targetInterval > 0) ? 1000000.0 / static_cast<double>(targetInterval) : 0.0;
+    }
+
+    /** set animating: render frames continuously
+     * @param animatingFlag true iff animating
+     */
+    void setAnimating(bool animatingFlag)
+    {
+      this->animatingFlag = animatingFlag;
+    }
+
+    /** check if animating
+     * @return true iff animating
+     */
+    bool isAnimating() const
+    {
+      return animatingFlag;
+    }
+
+    /** request a frame, e. g. after a change of the scene
+     */
+    void requestFrame()
+    {
+      requestFlag = true;
+    }
+
+    /** check if idle: no frame is needed until the next request
+     * @return true iff idle
+     */
+    bool isIdle() const
+    {
+      return !animatingFlag && !requestFlag;
+    }
+
+    /** tick of the display refresh
+     * @param time tick time [us]
+     * @return true iff a frame should be rendered
+     */
+    bool tick(int64_t time);
+
+    /** report rendered frame
+     * @param time start time of frame [us]
+     * @param renderTime render time [us]
+     */
+    void frameDone(int64_t time, int64_t renderTime);
+
+    /** get statistics
+     * @return statistics of the recent frames
+     */
+    Statistics getStatistics() const;
+
+  private:
+    int64_t              targetInterval;     // [us]; 0 for every tick
+    bool                 animatingFlag;
+    bool                 requestFlag;
+    int64_t              nextFrameTime;      // [us]
+
+    uint64_t             frameCount;
+    uint64_t             skippedTickCount;
+    int64_t              lastFrameTime;      // [us]
+    std::vector<int64_t> renderTimes;        // ring buffers [us]
+    std::vector<int64_t> intervals;
+};
+
+#endif // FRAME_SCHEDULER_H
+
+/* end of file */
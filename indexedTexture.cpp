@@ -0,0 +1,299 @@
+/***********************************************************************\
+*
+* Contents: indexed texture: palette indexed map texture
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <cassert>
+
+#include <epoxy/gl.h>
+
+#include "color.h"
+
+#include "indexedTexture.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// palette entry alpha of not animated colors; animated colors store the
+// interpolation factor 0..1 as 0..ANIMATED_ALPHA_MAX
+LOCAL const uint8_t STATIC_ALPHA       = 255;
+LOCAL const float   ANIMATED_ALPHA_MAX = 254.0f;
+
+const char *IndexedTexture::FRAGMENT_SHADER_FUNCTIONS =
+  "uniform highp usampler2D  indexedTextureIndices;\n"
+  "uniform mediump sampler2D indexedTexturePalette;\n"
+  "uniform vec3              indexedTextureAnimationColor0;\n"
+  "uniform vec3              indexedTextureAnimationColor1;\n"
+  "uniform float             indexedTexturePhase;\n"
+  "\n"
+  "vec4 indexedTexturePaletteColor(highp ivec2 p)\n"
+  "{\n"
+  "  highp uint index = texelFetch(indexedTextureIndices, p, 0).r;\n"
+  "  vec4       entry = texelFetch(indexedTexturePalette, ivec2(int(index & 255u), int(index >> 8)), 0);\n"
+  "  if (entry.a < 1.0)\n"
+  "  {\n"
+  "    // animated: triangle wave over the interpolation factor\n"
+  "    float t = entry.a * (255.0 / 254.0) + indexedTexturePhase;\n"
+  "    entry = vec4(mix(indexedTextureAnimationColor0,\n"
+  "                     indexedTextureAnimationColor1,\n"
+  "                     1.0 - abs(1.0 - mod(t, 2.0))\n"
+  "                    ),\n"
+  "                 1.0\n"
+  "                );\n"
+  "  }\n"
+  "  return entry;\n"
+  "}\n"
+  "\n"
+  "vec4 indexedTextureColor(highp vec2 uv)\n"
+  "{\n"
+  "  highp ivec2 size = textureSize(indexedTextureIndices, 0);\n"
+  "  highp vec2  p    = uv * vec2(size) - 0.5;\n"
+  "  highp vec2  f    = fract(p);\n"
+  "  highp ivec2 p0   = ivec2(mod(floor(p), vec2(size)));\n"
+  "  highp ivec2 p1   = (p0 + 1) % size;\n"
+  "  return mix(mix(indexedTexturePaletteColor(p0),\n"
+  "                 indexedTexturePaletteColor(ivec2(p1.x, p0.y)),\n"
+  "                 f.x\n"
+  "                ),\n"
+  "             mix(indexedTexturePaletteColor(ivec2(p0.x, p1.y)),\n"
+  "                 indexedTexturePaletteColor(p1),\n"
+  "                 f.x\n"
+  "                ),\n"
+  "             f.y\n"
+  "            );\n"
+  "}\n";
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** pack color
+ * @param color color
+ * @return packed RGB
+ */
+LOCAL inline uint32_t packColor(const Color &color)
+{
+  return (static_cast<uint32_t>(color.r) << 16) | (static_cast<uint32_t>(color.g) << 8) | color.b;
+}
+
+IndexedTexture::IndexedTexture()
+  : indexTexture(0)
+  , paletteTexture(0)
+  , animationColors{Color{0, 0, 0}, Color{0, 0, 0}}
+  , animationFlag(false)
+{
+}
+
+void IndexedTexture::init()
+{
+  glGenTextures(1, &indexTexture);
+  glActiveTexture(GL_TEXTURE0 + INDEX_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, indexTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glGenTextures(1, &paletteTexture);
+  glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, paletteTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void IndexedTexture::done()
+{
+  glDeleteTextures(1, &indexTexture);
+  glDeleteTextures(1, &paletteTexture);
+  indexTexture   = 0;
+  paletteTexture = 0;
+}
+
+void IndexedTexture::setAnimationColors(const Color &color0, const Color &color1)
+{
+  animationColors[0] = color0;
+  animationColors[1] = color1;
+  animationFlag      = (color0 != color1);
+}
+
+bool IndexedTexture::set(const Color colors[], uint width, uint height)
+{
+  assert(indexTexture != 0);
+
+  const size_t n = static_cast<size_t>(width) * height;
+
+  // build palette; neighbouring texels mostly have the same color
+  palette.clear();
+  paletteIndex.clear();
+  std::vector<uint16_t> indices(n);
+  uint32_t              lastColor = UINT32_MAX;
+  uint                  lastIndex = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    const uint32_t color = packColor(colors[i]);
+    if (color != lastColor)
+    {
+      auto iterator = paletteIndex.find(color);
+      if (iterator != paletteIndex.end())
+      {
+        lastIndex = iterator->second;
+      }
+      else
+      {
+        if (palette.size() >= MAX_PALETTE_SIZE)
+        {
+          palette.clear();
+          paletteIndex.clear();
+          return false;
+        }
+        lastIndex = palette.size();
+        paletteIndex[color] = lastIndex;
+        palette.push_back(colors[i]);
+      }
+      lastColor = color;
+    }
+    indices[i] = static_cast<uint16_t>(lastIndex);
+  }
+
+  // upload index texture: 8 bit if possible
+  glActiveTexture(GL_TEXTURE0 + INDEX_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, indexTexture);
+  if (getIndexSize() == 1)
+  {
+    const std::vector<uint8_t> indices8(indices.begin(), indices.end());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, indices8.data());
+  }
+  else
+  {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, indices.data());
+  }
+
+  // upload palette texture
+  const uint           paletteHeight = (palette.size() + PALETTE_WIDTH - 1) / PALETTE_WIDTH;
+  std::vector<uint8_t> entries(static_cast<size_t>(PALETTE_WIDTH) * paletteHeight * 4, 0);
+  for (size_t i = 0; i < palette.size(); i++)
+  {
+    getPaletteEntry(palette[i], &entries[i * 4]);
+  }
+  glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, paletteTexture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, PALETTE_WIDTH, paletteHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, entries.data());
+  glActiveTexture(GL_TEXTURE0);
+
+  return true;
+}
+
+bool IndexedTexture::replaceColor(const Color &color, const Color &newColor)
+{
+  auto iterator = paletteIndex.find(packColor(color));
+  if (iterator == paletteIndex.end())
+  {
+    return false;
+  }
+
+  const uint index = iterator->second;
+  paletteIndex.erase(iterator);
+  paletteIndex[packColor(newColor)] = index;
+  palette[index] = newColor;
+
+  uint8_t entry[4];
+  getPaletteEntry(newColor, entry);
+  glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, paletteTexture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, index % PALETTE_WIDTH, index / PALETTE_WIDTH, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, entry);
+  glActiveTexture(GL_TEXTURE0);
+
+  return true;
+}
+
+void IndexedTexture::bind(GLuint program, float phase) const
+{
+  glActiveTexture(GL_TEXTURE0 + INDEX_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, indexTexture);
+  glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, paletteTexture);
+  glActiveTexture(GL_TEXTURE0);
+
+  glUniform1i(glGetUniformLocation(program, "indexedTextureIndices"), INDEX_TEXTURE_UNIT);
+  glUniform1i(glGetUniformLocation(program, "indexedTexturePalette"), PALETTE_TEXTURE_UNIT);
+  glUniform3f(glGetUniformLocation(program, "indexedTextureAnimationColor0"),
+              animationColors[0].r / 255.0f,
+              animationColors[0].g / 255.0f,
+              animationColors[0].b / 255.0f
+             );
+  glUniform3f(glGetUniformLocation(program, "indexedTextureAnimationColor1"),
+              animationColors[1].r / 255.0f,
+              animationColors[1].g / 255.0f,
+              animationColors[1].b / 255.0f
+             );
+  glUniform1f(glGetUniformLocation(program, "indexedTexturePhase"), phase);
+}
+
+void IndexedTexture::getPaletteEntry(const Color &color, uint8_t entry[4]) const
+{
+  entry[0] = color.r;
+  entry[1] = color.g;
+  entry[2] = color.b;
+  entry[3] = STATIC_ALPHA;
+
+  if (animationFlag)
+  {
+    // get interpolation factor from the channel with the largest range
+    const int d[3] =
+    {
+      animationColors[1].r - animationColors[0].r,
+      animationColors[1].g - animationColors[0].g,
+      animationColors[1].b - animationColors[0].b
+    };
+    const int c[3] =
+    {
+      color.r - animationColors[0].r,
+      color.g - animationColors[0].g,
+      color.b - animationColors[0].b
+    };
+    uint channel = 0;
+    for (uint i = 1; i < 3; i++)
+    {
+      if (abs(d[i]) > abs(d[channel]))
+      {
+        channel = i;
+      }
+    }
+    const double factor = static_cast<double>(c[channel]) / static_cast<double>(d[channel]);
+
+    // animated iff the color is an interpolation of the animation colors
+    bool interpolatedFlag = (factor >= 0.0) && (factor <= 1.0);
+    for (uint i = 0; i < 3; i++)
+    {
+      if (abs(c[i] - static_cast<int>(d[i] * factor)) > 1)
+      {
+        interpolatedFlag = false;
+      }
+    }
+    if (interpolatedFlag)
+    {
+      entry[3] = static_cast<uint8_t>(lround(factor * ANIMATED_ALPHA_MAX));
+    }
+  }
+}
+
+/* end of file */
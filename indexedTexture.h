@@ -0,0 +1,139 @@
+/***********************************************************************\
+*
+* Contents: indexed texture: palette indexed map texture
+* Systems: all
+*
+\***********************************************************************/
+#ifndef INDEXED_TEXTURE_H
+#define INDEXED_TEXTURE_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+#include <epoxy/gl.h>
+
+#include "color.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** indexed texture: stores a color image as an 8 bit (up to 256 colors)
+ *  or 16 bit index texture and a palette texture; the color lookup is
+ *  done in the fragment shader. Palette entries on the line between the
+ *  two animation colors (e. g. water) are animated by a phase uniform
+ *  without changing texels.
+ *
+ *  All methods must be called in the GL context.
+ */
+class IndexedTexture
+{
+  public:
+    // max. number of palette entries
+    static const uint MAX_PALETTE_SIZE        = 65536;
+    // palette texture width [entries]
+    static const uint PALETTE_WIDTH           = 256;
+    // texture units used by bind()
+    static const uint INDEX_TEXTURE_UNIT      = 3;
+    static const uint PALETTE_TEXTURE_UNIT    = 4;
+
+    /** GLSL ES 3.00 fragment shader functions; insert after the
+     *  #version/precision lines:
+     *
+     *    vec4 indexedTextureColor(vec2 uv)  bilinear filtered color at UV
+     *                                       position, wrapped
+     */
+    static const char *FRAGMENT_SHADER_FUNCTIONS;
+
+    /** create indexed texture
+     */
+    IndexedTexture();
+
+    /** create GL objects
+     */
+    void init();
+
+    /** release GL objects
+     */
+    void done();
+
+    /** set animation colors: palette entries interpolated between the
+     *  colors (see Color::interpolate()) are animated by bind(); must be
+     *  called before set()
+     * @param color0,color1 animation colors
+     */
+    void setAnimationColors(const Color &color0, const Color &color1);
+
+    /** set texture: build palette and upload index and palette texture
+     * @param colors colors, row by row
+     * @param width,height size
+     * @return true iff set, false if there are more than
+     *         MAX_PALETTE_SIZE colors
+     */
+    bool set(const Color colors[], uint width, uint height);
+
+    /** change palette color: recolor all texels of a color
+     * @param color color
+     * @param newColor new color
+     * @return true iff color is in palette
+     */
+    bool replaceColor(const Color &color, const Color &newColor);
+
+    /** bind textures and set uniforms of FRAGMENT_SHADER_FUNCTIONS
+     * @param program current program
+     * @param phase animation phase; 0 shows the original colors, period 2
+     */
+    void bind(GLuint program, float phase) const;
+
+    /** get size of an index
+     * @return size of index [bytes]: 1 or 2
+     */
+    uint getIndexSize() const
+    {
+      return (palette.size() <= 256) ? 1 : 2;
+    }
+
+    /** get number of palette entries
+     * @return number of palette entries
+     */
+    uint getPaletteSize() const
+    {
+      return static_cast<uint>(palette.size());
+    }
+
+  private:
+    GLuint                                  indexTexture;
+    GLuint                                  paletteTexture;
+    Color                                   animationColors[2];
+    bool                                    animationFlag;
+
+    std::vector<Color>                      palette;
+    std::unordered_map<uint32_t, uint>      paletteIndex;  // packed RGB -> index
+
+    IndexedTexture(const IndexedTexture&) = delete;
+    IndexedTexture &operator=(const IndexedTexture&) = delete;
+
+    /** get palette texture entry
+     * @param color color
+     * @param entry entry to fill (RGBA)
+     */
+    void getPaletteEntry(const Color &color, uint8_t entry[4]) const;
+};
+
+#endif // INDEXED_TEXTURE_H
+
+/* end of file */
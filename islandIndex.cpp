@@ -0,0 +1,285 @@
+/***********************************************************************\
+*
+* Contents: island index: R-tree of island bounding boxes
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <queue>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+#include "islandIndex.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+const uint     IslandIndex::NODE_CAPACITY;
+const uint32_t IslandIndex::NONE;
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** get distance from position to range on an axis
+ * @param p position
+ * @param p0,p1 range [p0,p1)
+ * @param size axis size the distance wraps around in or 0 for no wrap
+ * @return distance (0 if inside)
+ */
+LOCAL inline uint64_t getAxisDistance(uint p, uint p0, uint p1, uint size)
+{
+  if      (p < p0)
+  {
+    uint64_t d = p0 - p;
+    return (size > 0) ? std::min(d, static_cast<uint64_t>(p) + size - (p1 - 1)) : d;
+  }
+  else if (p >= p1)
+  {
+    uint64_t d = p - p1 + 1;
+    return (size > 0) ? std::min(d, static_cast<uint64_t>(p0) + size - p) : d;
+  }
+  else
+  {
+    return 0;
+  }
+}
+
+/** sort-tile-recursive packing: order items, so that each group of
+ *  capacity consecutive items is a tile of a vertical slice
+ * @param items items
+ * @param getBox function to get box of item
+ * @param capacity group size
+ */
+template<typename T, typename GetBox>
+LOCAL void packSTR(std::vector<T> &items, GetBox getBox, uint capacity)
+{
+  // centers multiplied by 2 to stay integer
+  auto centerX = [&getBox](const T &item) { const IslandIndex::Box &box = getBox(item); return static_cast<uint64_t>(box.x0) + box.x1; };
+  auto centerY = [&getBox](const T &item) { const IslandIndex::Box &box = getBox(item); return static_cast<uint64_t>(box.y0) + box.y1; };
+
+  size_t groupCount = (items.size() + capacity - 1) / capacity;
+  size_t sliceCount = static_cast<size_t>(ceil(sqrt(static_cast<double>(groupCount))));
+  size_t sliceSize  = sliceCount * capacity;
+
+  std::sort(items.begin(), items.end(), [&centerX](const T &item1, const T &item2) { return centerX(item1) < centerX(item2); });
+  for (size_t i = 0; i < items.size(); i += sliceSize)
+  {
+    std::sort(items.begin() + i,
+              items.begin() + std::min(i + sliceSize, items.size()),
+              [&centerY](const T &item1, const T &item2) { return centerY(item1) < centerY(item2); }
+             );
+  }
+}
+
+void IslandIndex::Box::extend(const Box &box)
+{
+  if (box.isEmpty())
+  {
+    return;
+  }
+
+  if (isEmpty())
+  {
+    *this = box;
+  }
+  else
+  {
+    x0 = std::min(x0, box.x0);
+    y0 = std::min(y0, box.y0);
+    x1 = std::max(x1, box.x1);
+    y1 = std::max(y1, box.y1);
+  }
+}
+
+uint64_t IslandIndex::Box::getDistance2(uint x, uint y, uint wrapWidth, uint wrapHeight) const
+{
+  uint64_t dx = getAxisDistance(x, x0, x1, wrapWidth);
+  uint64_t dy = getAxisDistance(y, y0, y1, wrapHeight);
+
+  return dx * dx + dy * dy;
+}
+
+void IslandIndex::clear()
+{
+  boxes.clear();
+  entries.clear();
+  nodes.clear();
+  root = NONE;
+}
+
+void IslandIndex::build(const std::vector<Box> &boxes, uint wrapWidth, uint wrapHeight)
+{
+  clear();
+
+  this->wrapWidth  = wrapWidth;
+  this->wrapHeight = wrapHeight;
+  this->boxes      = boxes;
+  for (uint32_t i = 0; i < boxes.size(); i++)
+  {
+    if (!boxes[i].isEmpty())
+    {
+      entries.push_back(i);
+    }
+  }
+  if (entries.empty())
+  {
+    return;
+  }
+
+  // leaves
+  packSTR(entries, [this](uint32_t i) -> const Box& { return this->boxes[i]; }, NODE_CAPACITY);
+  std::vector<Node> level;
+  for (size_t i = 0; i < entries.size(); i += NODE_CAPACITY)
+  {
+    Node node;
+    node.first = static_cast<uint32_t>(i);
+    node.count = static_cast<uint32_t>(std::min(static_cast<size_t>(NODE_CAPACITY), entries.size() - i));
+    node.leaf  = true;
+    for (uint32_t j = node.first; j < node.first + node.count; j++)
+    {
+      node.box.extend(this->boxes[entries[j]]);
+    }
+    level.push_back(node);
+  }
+
+  // inner nodes up to the root; children of a node are stored consecutive
+  while (level.size() > 1)
+  {
+    packSTR(level, [](const Node &node) -> const Box& { return node.box; }, NODE_CAPACITY);
+
+    uint32_t base = static_cast<uint32_t>(nodes.size());
+    nodes.insert(nodes.end(), level.begin(), level.end());
+
+    std::vector<Node> parents;
+    for (size_t i = 0; i < level.size(); i += NODE_CAPACITY)
+    {
+      Node node;
+      node.first = base + static_cast<uint32_t>(i);
+      node.count = static_cast<uint32_t>(std::min(static_cast<size_t>(NODE_CAPACITY), level.size() - i));
+      node.leaf  = false;
+      for (uint32_t j = 0; j < node.count; j++)
+      {
+        node.box.extend(level[i + j].box);
+      }
+      parents.push_back(node);
+    }
+    level.swap(parents);
+  }
+
+  root = static_cast<uint32_t>(nodes.size());
+  nodes.push_back(level[0]);
+}
+
+void IslandIndex::find(const Box &box, std::vector<uint32_t> &indices) const
+{
+  indices.clear();
+  if (isEmpty())
+  {
+    return;
+  }
+
+  std::vector<uint32_t> stack;
+  stack.push_back(root);
+  while (!stack.empty())
+  {
+    const Node &node = nodes[stack.back()];
+    stack.pop_back();
+
+    if (node.box.intersects(box))
+    {
+      for (uint32_t i = node.first; i < node.first + node.count; i++)
+      {
+        if      (!node.leaf)
+        {
+          stack.push_back(i);
+        }
+        else if (boxes[entries[i]].intersects(box))
+        {
+          indices.push_back(entries[i]);
+        }
+      }
+    }
+  }
+}
+
+void IslandIndex::findNearest(uint                    x,
+                              uint                    y,
+                              uint                    k,
+                              std::vector<uint32_t>   &indices,
+                              std::vector<uint64_t>   *distance2s,
+                              const GetDistance2      &getDistance2
+                             ) const
+{
+  indices.clear();
+  if (distance2s != nullptr) distance2s->clear();
+  if (isEmpty() || (k == 0))
+  {
+    return;
+  }
+
+  // best-first search: squared distance, kind, entry/node index; exact
+  // distances are never less than box distances, so an exact entry taken
+  // from the queue is nearer than all remaining candidates
+  enum Kinds : uint8_t { EXACT, ENTRY, NODE };
+  typedef std::tuple<uint64_t, uint8_t, uint32_t> Candidate;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+
+  candidates.push(Candidate(nodes[root].box.getDistance2(x, y, wrapWidth, wrapHeight), NODE, root));
+  while (!candidates.empty() && (indices.size() < k))
+  {
+    Candidate candidate = candidates.top();
+    candidates.pop();
+
+    uint32_t index = std::get<2>(candidate);
+    switch (std::get<1>(candidate))
+    {
+      case ENTRY:
+        if (getDistance2 != nullptr)
+        {
+          // refine: re-queue with exact distance
+          candidates.push(Candidate(std::max(std::get<0>(candidate), getDistance2(index)), EXACT, index));
+        }
+        else
+        {
+          indices.push_back(index);
+          if (distance2s != nullptr) distance2s->push_back(std::get<0>(candidate));
+        }
+        break;
+      case EXACT:
+        indices.push_back(index);
+        if (distance2s != nullptr) distance2s->push_back(std::get<0>(candidate));
+        break;
+      case NODE:
+        {
+          const Node &node = nodes[index];
+          for (uint32_t i = node.first; i < node.first + node.count; i++)
+          {
+            if (node.leaf)
+            {
+              candidates.push(Candidate(boxes[entries[i]].getDistance2(x, y, wrapWidth, wrapHeight), ENTRY, entries[i]));
+            }
+            else
+            {
+              candidates.push(Candidate(nodes[i].box.getDistance2(x, y, wrapWidth, wrapHeight), NODE, i));
+            }
+          }
+        }
+        break;
+    }
+  }
+}
+
+/* end of file */
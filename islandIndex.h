@@ -0,0 +1,199 @@
+/***********************************************************************\
+*
+* Contents: island index: R-tree of island bounding boxes
+* Systems: all
+*
+\***********************************************************************/
+#ifndef ISLAND_INDEX_H
+#define ISLAND_INDEX_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <functional>
+
+#include <sys/types.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** island index: static R-tree of bounding boxes, bulk loaded with
+ *  sort-tile-recursive (STR) packing. Entries are identified by their
+ *  index in the list of boxes passed to build().
+ */
+class IslandIndex
+{
+  public:
+    /** bounding box [x0,x1) x [y0,y1)
+     */
+    class Box
+    {
+      public:
+        uint x0, y0, x1, y1;
+
+        Box()
+          : x0(0)
+          , y0(0)
+          , x1(0)
+          , y1(0)
+        {
+        }
+
+        Box(uint x0, uint y0, uint x1, uint y1)
+          : x0(x0)
+          , y0(y0)
+          , x1(x1)
+          , y1(y1)
+        {
+        }
+
+        /** check if box is empty
+         * @return true iff empty
+         */
+        bool isEmpty() const
+        {
+          return (x0 >= x1) || (y0 >= y1);
+        }
+
+        /** check if position is inside box
+         * @param x,y position
+         * @return true iff inside
+         */
+        bool contains(uint x, uint y) const
+        {
+          return (x >= x0) && (x < x1) && (y >= y0) && (y < y1);
+        }
+
+        /** check if boxes intersect
+         * @param box other box
+         * @return true iff intersecting
+         */
+        bool intersects(const Box &box) const
+        {
+          return (x0 < box.x1) && (box.x0 < x1) && (y0 < box.y1) && (box.y0 < y1);
+        }
+
+        /** extend box to include other box
+         * @param box other box
+         */
+        void extend(const Box &box);
+
+        /** extend box to include position
+         * @param x,y position
+         */
+        void extend(uint x, uint y)
+        {
+          extend(Box(x, y, x + 1, y + 1));
+        }
+
+        /** get squared distance from position to nearest tile in box
+         * @param x,y position
+         * @param wrapWidth,wrapHeight size of the area the distance
+         *                             wraps around in or 0 for no wrap
+         * @return squared distance (0 if inside)
+         */
+        uint64_t getDistance2(uint x, uint y, uint wrapWidth = 0, uint wrapHeight = 0) const;
+    };
+
+    /** get exact squared distance from the search position to an entry;
+     *  must not be less than the bounding box distance
+     * @param index entry index
+     * @return squared distance
+     */
+    typedef std::function<uint64_t(uint32_t index)> GetDistance2;
+
+    IslandIndex()
+      : wrapWidth(0)
+      , wrapHeight(0)
+      , root(NONE)
+    {
+    }
+
+    /** clear index
+     */
+    void clear();
+
+    /** build index
+     * @param boxes bounding boxes
+     * @param wrapWidth,wrapHeight size of the area distances wrap around
+     *                             in (torus) or 0 for no wrap
+     */
+    void build(const std::vector<Box> &boxes, uint wrapWidth = 0, uint wrapHeight = 0);
+
+    /** check if index is empty
+     * @return true iff empty
+     */
+    bool isEmpty() const
+    {
+      return root == NONE;
+    }
+
+    /** find entries with bounding boxes intersecting rectangle
+     * @param box rectangle
+     * @param indices indices of found entries (unsorted)
+     */
+    void find(const Box &box, std::vector<uint32_t> &indices) const;
+
+    /** find entries with bounding boxes containing position
+     * @param x,y position
+     * @param indices indices of found entries (unsorted)
+     */
+    void find(uint x, uint y, std::vector<uint32_t> &indices) const
+    {
+      find(Box(x, y, x + 1, y + 1), indices);
+    }
+
+    /** find k nearest entries; bounding box distances are refined with
+     *  the exact distances of the entries, if available
+     * @param x,y position
+     * @param k max. number of entries
+     * @param indices indices of found entries, nearest first
+     * @param distance2s squared distances of found entries or nullptr
+     * @param getDistance2 exact distance of entry or nullptr for
+     *                     bounding box distances
+     */
+    void findNearest(uint                    x,
+                     uint                    y,
+                     uint                    k,
+                     std::vector<uint32_t>   &indices,
+                     std::vector<uint64_t>   *distance2s   = nullptr,
+                     const GetDistance2      &getDistance2 = nullptr
+                    ) const;
+
+  private:
+    // max. number of children of a node
+    static const uint NODE_CAPACITY = 16;
+    // no node
+    static const uint32_t NONE = UINT32_MAX;
+
+    /** node: children are entries (leaf) or nodes
+     */
+    struct Node
+    {
+      Box      box;
+      uint32_t first;  // index of first child in entries resp. nodes
+      uint32_t count;  // number of children
+      bool     leaf;
+    };
+
+    uint                  wrapWidth, wrapHeight;
+    std::vector<Box>      boxes;
+    std::vector<uint32_t> entries;  // entry indices sorted by leaves
+    std::vector<Node>     nodes;
+    uint32_t              root;
+};
+
+#endif // ISLAND_INDEX_H
+
+/* end of file */
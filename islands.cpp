@@ -16,17 +16,24 @@
 #include <unordered_map>
 #include <algorithm>
 #include <exception>
+#include <stdexcept>
 #include <cassert>
 
+#include "parallel.h"
+#include "distanceField.h"
+
 #include "islands.h"
 
 /****************** Conditional compilation switches *******************/
 
 /***************************** Constants *******************************/
+#define LOCAL static
 
 /***************************** Datatypes *******************************/
 
 /***************************** Variables *******************************/
+// last generation of island labels of all maps
+LOCAL std::atomic<uint64_t> islandGenerationCounter(0);
 
 /****************************** Macros *********************************/
 
@@ -34,41 +41,232 @@
 
 /***************************** Functions *******************************/
 
-void Map::reset()
+/** get distance of two positions on a wrapping axis
+ * @param p0,p1 positions
+ * @param size axis size
+ * @return distance
+ */
+LOCAL inline uint64_t getWrapDistance(uint p0, uint p1, uint size)
 {
-  tiles.clear();
-  for (uint y = 0; y < height; y++)
+  uint d = (p0 > p1) ? p0 - p1 : p1 - p0;
+
+  return std::min(d, size - d);
+}
+
+void Map::Snapshot::getLandMask(LandMask &landMask) const
+{
+  landMask.resize(width, height);
+  parallelFor(0, height, CHUNK_SIZE, [&](uint y0, uint y1)
   {
-    std::vector<Tile> row;
-    for (uint x = 0; x < height; x++)
+    for (uint y = y0; y < y1; y++)
     {
-      row.push_back(Tile());
+      for (uint x = 0; x < width; x++)
+      {
+        landMask.set(x, y, isLand(x, y));
+      }
     }
-    tiles.push_back(row);
-  }
+  });
 }
 
-Tile &Map::getTile(int x, int y)
+void Map::restore(const Snapshot &snapshot)
 {
-  static Tile OFF_MAP_TILE = Tile(Tile::Types::WATER);
+  assert(snapshot.getWidth() == width);
+  assert(snapshot.getHeight() == height);
 
-  if ((y >= 0) && (static_cast<size_t>(y) < tiles.size()))
+  // chunks not copied since the snapshot are unchanged
+  std::vector<const TileChunk*> currentChunks(chunks.size());
+  lockChunks();
+  for (size_t i = 0; i < chunks.size(); i++)
   {
-    std::vector<Tile> &row = tiles[y];
+    currentChunks[i] = chunks[i].get();
+  }
+  unlockChunks();
 
-    if ((x >= 0) && (static_cast<size_t>(x) < row.size()))
+  const Map   &map = *this;
+  Tile::Types types[CHUNK_SIZE];
+  Color       colors[CHUNK_SIZE];
+  for (size_t i = 0; i < currentChunks.size(); i++)
+  {
+    if (snapshot.chunks[i].get() == currentChunks[i])
     {
-      return row[x];
+      continue;
     }
-    else
+
+    uint x0 = static_cast<uint>(i % chunksX) * CHUNK_SIZE;
+    uint y0 = static_cast<uint>(i / chunksX) * CHUNK_SIZE;
+    uint x1 = std::min(x0 + CHUNK_SIZE, width);
+    uint y1 = std::min(y0 + CHUNK_SIZE, height);
+    for (uint y = y0; y < y1; y++)
     {
-      return OFF_MAP_TILE;
+      // set run from first to last changed tile of the row
+      uint first = x1, last = x0;
+      for (uint x = x0; x < x1; x++)
+      {
+        const Tile &tile    = snapshot.getTile(x, y);
+        const Tile &current = map.getTile(x, y);
+
+        types [x - x0] = tile.getType();
+        colors[x - x0] = tile.getColor();
+        if ((tile.getType() != current.getType()) || (tile.getColor() != current.getColor()))
+        {
+          first = std::min(first, x);
+          last  = x + 1;
+        }
+      }
+      if (first < last)
+      {
+        setTiles(first, y, last - first, &types[first - x0], &colors[first - x0]);
+      }
     }
   }
+}
+
+void Map::reset()
+{
+  clearIslands();
+  elevations.clear();
+  coastDistances.clear();
+  landMask.clear();
+  regionIndex.invalidate(0);
+  initChunks();
+
+  mapChanged();
+}
+
+void Map::reset(uint width, uint height)
+{
+  this->width  = width;
+  this->height = height;
+  landMask.resize(width, height);
+  reset();
+}
+
+const Tile &Map::getTile(int x, int y) const
+{
+  if (   (x >= 0) && (static_cast<uint>(x) < width)
+      && (y >= 0) && (static_cast<uint>(y) < height)
+     )
+  {
+    return (*chunks[getChunkIndex(chunksX, x, y)])[getChunkTileIndex(x, y)];
+  }
   else
   {
-    return OFF_MAP_TILE;
+    return getOffMapTile();
+  }
+}
+
+void Map::setTiles(uint x, uint y, uint n, const Tile::Types types[], const Color colors[])
+{
+  assert(static_cast<size_t>(x) + n <= width);
+  assert(y < height);
+
+  // lock once per part of the run inside a chunk
+  while (n > 0)
+  {
+    uint m = std::min(n, CHUNK_SIZE - (x & (CHUNK_SIZE - 1)));
+
+    ChunkStripe &stripe = lockChunkWrite(y);
+    Tile        *tiles  = &getWritableTile(stripe, x, y);
+    Tile         oldTiles[CHUNK_SIZE];
+    for (uint i = 0; i < m; i++)
+    {
+      oldTiles[i] = tiles[i];
+      tiles[i].set(Coordinates(x + i, y), types[i], colors[i]);
+    }
+    tilesChanged(x, y, m, oldTiles, tiles);
+    unlockChunkWrite(stripe);
+
+    x      += m;
+    n      -= m;
+    types  += m;
+    colors += m;
+  }
+}
+
+Map::Snapshot Map::getSnapshot() const
+{
+  lockChunks();
+
+  Snapshot snapshot;
+  snapshot.width   = width;
+  snapshot.height  = height;
+  snapshot.chunksX = chunksX;
+  snapshot.chunks.assign(chunks.begin(), chunks.end());
+  snapshot.islandLabels     = islandLabels;
+  snapshot.islandCount      = islandLabelCount;
+  snapshot.islandGeneration = islandGeneration;
+
+  // chunks are shared now: copy on next write
+  for (size_t i = 0; i < chunks.size(); i++)
+  {
+    writableChunks[i].store(nullptr, std::memory_order_relaxed);
   }
+
+  unlockChunks();
+
+  return snapshot;
+}
+
+void Map::updateCoastDistances()
+{
+  DistanceField::compute(landMask, coastDistances);
+}
+
+void Map::enableRegionQueries(bool enabled)
+{
+  std::lock_guard<std::mutex> lock(regionIndexLock);
+
+  regionQueries = enabled;
+  if (regionQueries)
+  {
+    regionIndex.invalidate(0);
+    regionIndex.update(*this);
+  }
+  else
+  {
+    regionIndex.clear();
+  }
+}
+
+void Map::updateRegionQueries() const
+{
+  std::lock_guard<std::mutex> lock(regionIndexLock);
+
+  if (regionQueries && !regionIndex.isValid())
+  {
+    regionIndex.update(*this);
+  }
+}
+
+RegionStatistics Map::queryRect(uint x, uint y, uint width, uint height) const
+{
+  std::lock_guard<std::mutex> lock(regionIndexLock);
+
+  if (!regionQueries)
+  {
+    throw std::logic_error("region queries not enabled");
+  }
+
+  if (!regionIndex.isValid())
+  {
+    regionIndex.update(*this);
+  }
+
+  RegionStatistics regionStatistics;
+  uint64_t         colorSums[3];
+  regionStatistics.tileCount = regionIndex.getSums(x, y, width, height, regionStatistics.typeCounts, colorSums);
+  if (regionStatistics.tileCount > 0)
+  {
+    regionStatistics.averageColor.r = static_cast<uint8_t>(colorSums[0] / regionStatistics.tileCount);
+    regionStatistics.averageColor.g = static_cast<uint8_t>(colorSums[1] / regionStatistics.tileCount);
+    regionStatistics.averageColor.b = static_cast<uint8_t>(colorSums[2] / regionStatistics.tileCount);
+  }
+  else
+  {
+    regionStatistics.averageColor = {0, 0, 0};
+  }
+
+  return regionStatistics;
 }
 
 void Map::load(const std::string &filePath)
@@ -76,7 +274,10 @@ void Map::load(const std::string &filePath)
   std::ifstream inputStream(filePath);
   if (inputStream.is_open())
   {
-    uint        y = 0;
+    clearIslands();
+
+    std::vector<std::vector<Tile>> tiles;
+    uint                           y = 0;
     std::string line;
     while (getline(inputStream,line) )
     {
@@ -119,103 +320,387 @@ void Map::load(const std::string &filePath)
       y++;
     }
     inputStream.close();
+
+    width  = !tiles.empty() ? tiles[0].size() : 0;
+    height = tiles.size();
+    elevations.clear();
+    coastDistances.clear();
+    landMask.resize(width, height);
+    initChunks();
+    for (uint y = 0; y < height; y++)
+    {
+      ChunkStripe &stripe = lockChunkWrite(y);
+      for (uint x = 0; (x < width) && (x < tiles[y].size()); x++)
+      {
+        const Tile &tile = tiles[y][x];
+
+        getWritableTile(stripe, x, y) = tile;
+        landMask.set(x, y, tile.getType() != Tile::Types::WATER);
+      }
+      unlockChunkWrite(stripe);
+    }
+    regionIndex.invalidate(0);
+    updateRegionQueries();
+
+    mapChanged();
   }
 }
 
-uint Map::findIslands()
+void Map::save(const std::string &filePath) const
 {
-  // neighbour offset
-  std::array<Coordinates, 8> NEIGHBORS =
-  {{
-    Coordinates{-1,-1},
-    Coordinates{ 0,-1},
-    Coordinates{+1,-1},
-    Coordinates{-1, 0},
-    Coordinates{+1, 0},
-    Coordinates{-1,+1},
-    Coordinates{ 0,+1},
-    Coordinates{+1,+1}
-  }};
-
-  // init islands: everything which is not water
-  std::for_each(islands.begin(), islands.end(), [](const Island *island)
+  std::ofstream outputStream(filePath);
+  if (!outputStream.is_open())
   {
-    delete(island);
-  });
-  islands.clear();
-  for (std::vector<Tile> &row : tiles)
+    std::stringstream buffer;
+    buffer << "cannot create map file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  const Snapshot snapshot = getSnapshot();
+  std::string    line(width + 1, '\n');
+  for (uint y = 0; y < height; y++)
   {
-    for (Tile &tile : row)
+    for (uint x = 0; x < width; x++)
     {
-      if (tile.getType() != Tile::Types::WATER)
+      switch (snapshot.getTile(x, y).getType())
       {
-        Island *island = new Island(tile.getCoordinates());
-        tile.setIsland(island);
-
-        islands.insert(island);
+        case Tile::Types::WATER:
+          line[x] = '.';
+          break;
+        case Tile::Types::LAND:
+          line[x] = '+';
+          break;
+        case Tile::Types::TREE:
+          line[x] = '*';
+          break;
+        case Tile::Types::MOUNTAIN:
+          line[x] = '^';
+          break;
+        case Tile::Types::BUILDING:
+          line[x] = '@';
+          break;
       }
     }
+    outputStream.write(line.data(), line.size());
+  }
+
+  outputStream.close();
+  if (outputStream.fail())
+  {
+    std::stringstream buffer;
+    buffer << "cannot write map file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
   }
+}
+
+uint Map::findIslands(const Snapshot &snapshot)
+{
+  assert(snapshot.getWidth() == width);
+  assert(snapshot.getHeight() == height);
 
-  // merge islands
-  std::unordered_set<Island*>::iterator iterator;
-  do
-  {
-    // find an island which has frontier tiles
-    iterator = std::find_if(islands.begin(),
-                            islands.end(),
-                            [](const Island *island) -> bool
-                            {
-                              assert(island != nullptr);
-
-                              return island->hasFrontiers();
-                            }
-                           );
-    if (iterator != islands.end())
+  // init islands
+  clearIslands();
+
+  // get runs of land tiles of all rows
+  std::vector<LandMask::Run> runs;
+  std::vector<size_t>        rowRunIndices;
+  {
+    LandMask snapshotLandMask;
+    snapshot.getLandMask(snapshotLandMask);
+
+    std::vector<LandMask::Run> rowRuns;
+    for (uint y = 0; y < height; y++)
     {
-      Island *island = *iterator;
-      assert(island != nullptr);
+      rowRunIndices.push_back(runs.size());
+      snapshotLandMask.getRuns(y, rowRuns);
+      runs.insert(runs.end(), rowRuns.begin(), rowRuns.end());
+    }
+    rowRunIndices.push_back(runs.size());
+  }
 
-      // get next frontier coordinates
-      Coordinates coordinates = island->fetchFrontier();
+  // merge runs which touch runs in the previous row (including diagonal
+  // neighbors) with union-find
+  std::vector<size_t> parents(runs.size());
+  for (size_t i = 0; i < runs.size(); i++)
+  {
+    parents[i] = i;
+  }
+  auto find = [&parents](size_t i) -> size_t
+  {
+    while (parents[i] != i)
+    {
+      parents[i] = parents[parents[i]];
+      i = parents[i];
+    }
 
-      // merge connected neighbor tiles into island
-      for (const Coordinates &neightbor : NEIGHBORS)
+    return i;
+  };
+
+  for (uint y = 1; y < height; y++)
+  {
+    size_t j = rowRunIndices[y - 1];
+    for (size_t i = rowRunIndices[y]; i < rowRunIndices[y + 1]; i++)
+    {
+      // skip runs in previous row left of run
+      while ((j < rowRunIndices[y]) && (runs[j].x1 < runs[i].x0))
       {
-        Tile &neighborTile = getTile(coordinates.x + neightbor.x, coordinates.y + neightbor.y);
+        j++;
+      }
 
-        if (!neighborTile.isIsland(island) && (neighborTile.getType() != Tile::Types::WATER))
+      // merge all runs in previous row which overlap [x0-1,x1+1)
+      for (size_t k = j; (k < rowRunIndices[y]) && (runs[k].x0 <= runs[i].x1); k++)
+      {
+        size_t root1 = find(i);
+        size_t root2 = find(k);
+        if (root1 != root2)
         {
-          Island *neighborIsland = neighborTile.getIsland();
-          islands.erase(neighborIsland);
-          island->merge(neighborTile);
-          delete(neighborIsland);
+          parents[std::max(root1, root2)] = std::min(root1, root2);
         }
       }
     }
   }
-  while (iterator != islands.end());
 
-  // update island ids: enumerate A..z
-  char id = 'A';
-  for (Island *island : islands)
+  // create islands and assign tiles; enumerate ids A..z and labels 1..n
+  // from top left
+  std::vector<Island*> runIslands(runs.size(), nullptr);
+  char                 id = 'A';
+
+  // new label plane: snapshots keep the old one
+  std::shared_ptr<std::vector<uint32_t>> labelPlane = std::make_shared<std::vector<uint32_t>>(static_cast<size_t>(width) * height, 0);
+  for (uint y = 0; y < height; y++)
   {
-    island->setId(id);
-    id++;
+    for (size_t i = rowRunIndices[y]; i < rowRunIndices[y + 1]; i++)
+    {
+      size_t root = find(i);
+      if (runIslands[root] == nullptr)
+      {
+        runIslands[root] = new Island();
+        runIslands[root]->setId(id);
+        id++;
+        runIslands[root]->setLabel(static_cast<uint32_t>(islandsByLabel.size() + 1));
+
+        islands.insert(runIslands[root]);
+        islandsByLabel.push_back(runIslands[root]);
+      }
+
+      Island   *island = runIslands[root];
+      uint32_t *labels = &(*labelPlane)[static_cast<size_t>(y) * width];
+      island->addRun(runs[i].x0, runs[i].x1, y);
+      std::fill(labels + runs[i].x0, labels + runs[i].x1, island->getLabel());
+    }
   }
 
+  // index of island bounding boxes; entry i is island with label i+1
+  std::vector<IslandIndex::Box> boxes;
+  boxes.reserve(islandsByLabel.size());
+  for (const Island *island : islandsByLabel)
+  {
+    boxes.push_back(island->getBoundingBox());
+  }
+  islandIndex.build(boxes, width, height);
+
+  setIslandLabels(labelPlane, static_cast<uint>(islandsByLabel.size()));
+
   return islands.size();
 }
 
+void Map::getIslandsInRect(uint x, uint y, uint width, uint height, std::vector<const Island*> &islands) const
+{
+  islands.clear();
+
+  IslandIndex::Box rect(x,
+                        y,
+                        static_cast<uint>(std::min(static_cast<size_t>(x) + width,  static_cast<size_t>(this->width ))),
+                        static_cast<uint>(std::min(static_cast<size_t>(y) + height, static_cast<size_t>(this->height)))
+                       );
+  if (rect.isEmpty())
+  {
+    return;
+  }
+
+  // candidates by bounding box; check tiles in the intersection with the
+  // rectangle until a tile of the island is found
+  std::vector<uint32_t> indices;
+  islandIndex.find(rect, indices);
+  std::sort(indices.begin(), indices.end());
+  for (uint32_t i : indices)
+  {
+    const Island           *island      = islandsByLabel[i];
+    const IslandIndex::Box &boundingBox = island->getBoundingBox();
+
+    uint x0 = std::max(rect.x0, boundingBox.x0);
+    uint y0 = std::max(rect.y0, boundingBox.y0);
+    uint x1 = std::min(rect.x1, boundingBox.x1);
+    uint y1 = std::min(rect.y1, boundingBox.y1);
+
+    bool found = false;
+    for (uint y = y0; (y < y1) && !found; y++)
+    {
+      const uint32_t *labels = &(*islandLabels)[static_cast<size_t>(y) * this->width];
+      for (uint x = x0; (x < x1) && !found; x++)
+      {
+        found = (labels[x] == island->getLabel());
+      }
+    }
+    if (found)
+    {
+      islands.push_back(island);
+    }
+  }
+}
+
+void Map::getNearestIslands(uint x, uint y, uint k, std::vector<const Island*> &islands) const
+{
+  islands.clear();
+
+  // exact distance: nearest tile of the island, wraps around
+  auto getDistance2 = [this, x, y](uint32_t i) -> uint64_t
+  {
+    const Island           *island      = islandsByLabel[i];
+    const IslandIndex::Box &boundingBox = island->getBoundingBox();
+
+    uint64_t distance2 = UINT64_MAX;
+    for (uint ty = boundingBox.y0; (ty < boundingBox.y1) && (distance2 > 0); ty++)
+    {
+      uint64_t dy = getWrapDistance(y, ty, height);
+      if ((dy * dy) >= distance2)
+      {
+        continue;
+      }
+
+      const uint32_t *labels = &(*islandLabels)[static_cast<size_t>(ty) * width];
+      for (uint tx = boundingBox.x0; tx < boundingBox.x1; tx++)
+      {
+        if (labels[tx] == island->getLabel())
+        {
+          uint64_t dx = getWrapDistance(x, tx, width);
+          distance2 = std::min(distance2, dx * dx + dy * dy);
+        }
+      }
+    }
+
+    return distance2;
+  };
+
+  std::vector<uint32_t> indices;
+  islandIndex.findNearest(x, y, k, indices, nullptr, getDistance2);
+  for (uint32_t i : indices)
+  {
+    islands.push_back(islandsByLabel[i]);
+  }
+}
+
+void Map::clearIslands()
+{
+  for (const Island *island : islands)
+  {
+    delete(island);
+  }
+  islands.clear();
+  islandsByLabel.clear();
+  islandIndex.clear();
+
+  setIslandLabels(getNoIslandLabels(), 0);
+}
+
+const std::shared_ptr<const std::vector<uint32_t>> &Map::getNoIslandLabels()
+{
+  static const std::shared_ptr<const std::vector<uint32_t>> NO_ISLAND_LABELS = std::make_shared<const std::vector<uint32_t>>();
+
+  return NO_ISLAND_LABELS;
+}
+
+void Map::setIslandLabels(const std::shared_ptr<const std::vector<uint32_t>> &labels, uint count)
+{
+  lockChunks();
+
+  islandLabels     = labels;
+  islandLabelCount = count;
+  islandGeneration = ++islandGenerationCounter;
+
+  unlockChunks();
+}
+
+const Tile &Map::getOffMapTile()
+{
+  static const Tile OFF_MAP_TILE = Tile(Tile::Types::WATER);
+
+  return OFF_MAP_TILE;
+}
+
+void Map::lockChunks() const
+{
+  chunksLock.lock();
+  chunksLocked.store(true);
+  for (ChunkStripe &stripe : chunkStripes)
+  {
+    while (stripe.writerCount.load() != 0)
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void Map::unlockChunks() const
+{
+  chunksLocked.store(false);
+  chunksLock.unlock();
+}
+
+void Map::initChunks()
+{
+  lockChunks();
+
+  chunksX = (width  + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  chunksY = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+  // all chunks share one empty chunk, copied on the first write: an
+  // empty map needs memory of one chunk only
+  size_t                     n          = static_cast<size_t>(chunksX) * chunksY;
+  std::shared_ptr<TileChunk> emptyChunk = std::make_shared<TileChunk>();
+  chunks.assign(n, emptyChunk);
+  writableChunks.reset(new std::atomic<TileChunk*>[n]);
+  for (size_t i = 0; i < n; i++)
+  {
+    writableChunks[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+  unlockChunks();
+}
+
+Map::TileChunk *Map::copyChunk(ChunkStripe &stripe, size_t i)
+{
+  std::lock_guard<std::mutex> lock(stripe.copyLock);
+
+  TileChunk *chunk = writableChunks[i].load(std::memory_order_acquire);
+  if (chunk == nullptr)
+  {
+    // snapshots may be gone already: copy only if still shared
+    if (chunks[i].use_count() > 1)
+    {
+      chunks[i] = std::make_shared<TileChunk>(*chunks[i]);
+    }
+    else
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    chunk = chunks[i].get();
+    writableChunks[i].store(chunk, std::memory_order_release);
+  }
+
+  return chunk;
+}
+
 void Map::printIslands() const
 {
-  for (const std::vector<Tile> &row : tiles)
+  for (uint y = 0; y < height; y++)
   {
-    for (const Tile &tile : row)
+    for (uint x = 0; x < width; x++)
     {
-      if (tile.getIsland() != nullptr)
+      const Island *island = getIslandAt(x, y);
+      if (island != nullptr)
       {
-        std::cout << tile.getIsland()->getId();
+        std::cout << island->getId();
       }
       else
       {
@@ -228,11 +713,11 @@ void Map::printIslands() const
 
 void Map::print() const
 {
-  for (const std::vector<Tile> &row : tiles)
+  for (uint y = 0; y < height; y++)
   {
-    for (const Tile &tile : row)
+    for (uint x = 0; x < width; x++)
     {
-      switch (tile.getType())
+      switch (getTile(x, y).getType())
       {
         case Tile::Types::WATER:
           std::cout << " ";
@@ -19,8 +19,15 @@
 #include <algorithm>
 #include <exception>
 #include <cassert>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include "color.h"
+#include "landMask.h"
+#include "regionIndex.h"
+#include "islandIndex.h"
 
 /****************** Conditional compilation switches *******************/
 
@@ -57,7 +64,7 @@ class Coordinates
     }
 };
 
-class Island;
+class Map;
 
 /** tile in map
  */
@@ -72,32 +79,29 @@ class Tile
       MOUNTAIN,
       BUILDING
     };
+    static const uint TYPE_COUNT = 5;  // number of types
 
     Tile()
       : coordinates(Coordinates(0,0))
       , type(Types::WATER)
-      , island(nullptr)
     {
     }
 
     Tile(Types type)
       : coordinates(Coordinates(0,0))
       , type(type)
-      , island(nullptr)
     {
     }
 
     Tile(const Coordinates &coordinates, Types type)
       : coordinates(coordinates)
       , type(type)
-      , island(nullptr)
     {
     }
 
     Tile(uint x, uint y, Types type)
       : coordinates(Coordinates(x,y))
       , type(type)
-      , island(nullptr)
     {
     }
 
@@ -129,23 +133,6 @@ class Tile
       this->type        = type;
     }
 
-    Island *getIsland() const
-    {
-      return island;
-    }
-
-    void setIsland(Island *island)
-    {
-      assert(island != nullptr);
-
-      this->island = island;
-    }
-
-    bool isIsland(const Island *island) const
-    {
-      return this->island == island;
-    }
-
     friend std::ostream& operator<<(std::ostream &outputStream, const Tile &tile)
     {
       outputStream << "Tile { " << tile.coordinates << ", type=";
@@ -176,20 +163,44 @@ class Tile
     Coordinates coordinates;
     Types       type;
     Color       color;
-    Island      *island;
 };
 
-/** island
+/** statistics of a map region
  */
-class Island
+class RegionStatistics
 {
   public:
-    Island()
+    size_t tileCount;
+    size_t typeCounts[RegionIndex::TYPE_COUNT];
+    Color  averageColor;
+
+    /** get number of tiles of type
+     * @param type tile type
+     * @return number of tiles
+     */
+    size_t getCount(Tile::Types type) const
+    {
+      return typeCounts[static_cast<uint>(type)];
+    }
+
+    /** get ratio of tiles of type
+     * @param type tile type
+     * @return ratio [0..1]
+     */
+    double getRatio(Tile::Types type) const
     {
+      return (tileCount > 0) ? static_cast<double>(getCount(type)) / static_cast<double>(tileCount) : 0.0;
     }
+};
 
-    Island(const Coordinates &coordinates)
-      : frontiers({coordinates})
+/** island
+ */
+class Island
+{
+  public:
+    Island()
+      : label(0)
+      , tileCount(0)
     {
     }
 
@@ -203,67 +214,267 @@ class Island
       this->id = id;
     }
 
-    /** check if there are any unexplorted frontier tiles available
-     * @return true iff frontier tiles available
+    /** get label in island label plane
+     * @return label (1..n)
      */
-    bool hasFrontiers() const
+    uint32_t getLabel() const
     {
-      return frontiers.size() > 0;
+      return label;
     }
 
-    /** fetch and remove next frontier coordinate
-     * @return coordinates
+    /** set label
+     * @param label label (1..n)
      */
-    Coordinates fetchFrontier()
+    void setLabel(uint32_t label)
     {
-      Coordinates coordinates = frontiers.back();
-      frontiers.pop_back();
+      this->label = label;
+    }
 
-      return coordinates;
+    /** get bounding box
+     * @return bounding box
+     */
+    const IslandIndex::Box &getBoundingBox() const
+    {
+      return boundingBox;
     }
 
-    /** merge tile into island
-     * @param tile tile
+    /** get number of tiles
+     * @return number of tiles
      */
-    void merge(Tile &tile)
+    size_t getTileCount() const
     {
-      tile.setIsland(this);
-      frontiers.push_back(tile.getCoordinates());
+      return tileCount;
+    }
+
+    /** add run of tiles to bounding box and tile count
+     * @param x0,x1 run [x0,x1)
+     * @param y row
+     */
+    void addRun(uint x0, uint x1, uint y)
+    {
+      boundingBox.extend(IslandIndex::Box(x0, y, x1, y + 1));
+      tileCount += x1 - x0;
     }
 
     friend std::ostream& operator<<(std::ostream &outputStream, const Island *island)
     {
-      outputStream << "Island { frontiers=" << island->frontiers.size() << " }";
+      outputStream << "Island { label=" << island->label << ", tiles=" << island->tileCount << " }";
 
       return outputStream;
     }
 
   private:
-    char                     id;
-    std::vector<Coordinates> frontiers;
+    char             id;
+    uint32_t         label;
+    IslandIndex::Box boundingBox;
+    size_t           tileCount;
+};
+
+/** map listener: get notified about map changes
+ */
+class MapListener
+{
+  public:
+    virtual ~MapListener()
+    {
+    }
+
+    /** called after a tile was changed by Map::setTile(); called from
+     *  the thread calling setTile(), possibly concurrently, while the
+     *  tile is locked: must not take snapshots of the map
+     * @param map map
+     * @param x,y position
+     * @param oldTile tile before change
+     * @param newTile tile after change
+     */
+    virtual void onTileChanged(const Map &map, uint x, uint y, const Tile &oldTile, const Tile &newTile) = 0;
+
+    /** called after a run of tiles in a row was changed by
+     *  Map::setTiles(), like onTileChanged(); override to handle the
+     *  run at once, e. g. to lock only once
+     * @param map map
+     * @param x,y position of first tile
+     * @param n number of tiles
+     * @param oldTiles tiles before change
+     * @param newTiles tiles after change
+     */
+    virtual void onTilesChanged(const Map &map, uint x, uint y, uint n, const Tile oldTiles[], const Tile newTiles[])
+    {
+      for (uint i = 0; i < n; i++)
+      {
+        onTileChanged(map, x + i, y, oldTiles[i], newTiles[i]);
+      }
+    }
+
+    /** called after all tiles were replaced by Map::reset() or
+     *  Map::load(); map size may have changed
+     * @param map map
+     */
+    virtual void onMapChanged(const Map &map) = 0;
 };
 
-/** map
+/** map; tiles are stored in reference counted chunks, which are shared
+ *  with snapshots and copied on the first write after a snapshot was
+ *  taken. Use snapshots to read tiles while tiles are changed.
  */
 class Map
 {
   public:
+    // chunk width+height of the tile storage: 2^CHUNK_SHIFT
+    static const uint CHUNK_SHIFT = 6;
+    static const uint CHUNK_SIZE  = 1 << CHUNK_SHIFT;
+
+    /** chunk of tiles, row by row
+     */
+    typedef std::array<Tile, CHUNK_SIZE * CHUNK_SIZE> TileChunk;
+
+    /** immutable snapshot of the tiles and island labels of a map; cheap
+     *  to copy and safe to read from any thread while the map is changed
+     */
+    class Snapshot
+    {
+      public:
+        Snapshot()
+          : width(0)
+          , height(0)
+          , chunksX(0)
+          , islandLabels(getNoIslandLabels())
+          , islandCount(0)
+          , islandGeneration(0)
+        {
+        }
+
+        /** get width
+         * @return width
+         */
+        uint getWidth() const
+        {
+          return width;
+        }
+
+        /** get height
+         * @return height
+         */
+        uint getHeight() const
+        {
+          return height;
+        }
+
+        /** get tile at x/y position
+         * @param x,y position
+         * @return tile (water outside of the map)
+         */
+        const Tile &getTile(int x, int y) const
+        {
+          if (   (x >= 0) && (static_cast<uint>(x) < width)
+              && (y >= 0) && (static_cast<uint>(y) < height)
+             )
+          {
+            return (*chunks[getChunkIndex(chunksX, x, y)])[getChunkTileIndex(x, y)];
+          }
+          else
+          {
+            return getOffMapTile();
+          }
+        }
+
+        /** check if tile is land (any type except water)
+         * @param x,y position
+         * @return true iff land
+         */
+        bool isLand(uint x, uint y) const
+        {
+          return getTile(x, y).getType() != Tile::Types::WATER;
+        }
+
+        /** get land mask of snapshot
+         * @param landMask land mask
+         */
+        void getLandMask(LandMask &landMask) const;
+
+        /** get number of chunks
+         * @return number of chunks
+         */
+        size_t getChunkCount() const
+        {
+          return chunks.size();
+        }
+
+        /** get number of chunks per row; chunk i covers the tiles
+         *  [(i%chunksX)*CHUNK_SIZE,..+CHUNK_SIZE) x
+         *  [(i/chunksX)*CHUNK_SIZE,..+CHUNK_SIZE), clipped to the map
+         * @return number of chunks per row
+         */
+        uint getChunksX() const
+        {
+          return chunksX;
+        }
+
+        /** check if chunk is shared with other snapshot of the same map,
+         *  i. e. it was not changed between the snapshots
+         * @param snapshot other snapshot
+         * @param i chunk index
+         * @return true iff shared
+         */
+        bool isSharedChunk(const Snapshot &snapshot, size_t i) const
+        {
+          assert(i < chunks.size());
+          assert(i < snapshot.chunks.size());
+
+          return chunks[i] == snapshot.chunks[i];
+        }
+
+        /** get island label plane
+         * @return island labels (width*height values, row by row) or
+         *         empty if islands not found
+         */
+        const std::vector<uint32_t> &getIslandLabels() const
+        {
+          return *islandLabels;
+        }
+
+        /** get number of islands
+         * @return number of islands; labels are 1..n
+         */
+        uint getIslandCount() const
+        {
+          return islandCount;
+        }
+
+        /** get generation of island labels; changed when islands are
+         *  found or cleared, unique over all maps
+         * @return generation
+         */
+        uint64_t getIslandGeneration() const
+        {
+          return islandGeneration;
+        }
+
+      private:
+        friend class Map;
+
+        uint                                          width, height;
+        uint                                          chunksX;
+        std::vector<std::shared_ptr<const TileChunk>> chunks;
+        std::shared_ptr<const std::vector<uint32_t>>  islandLabels;
+        uint                                          islandCount;
+        uint64_t                                      islandGeneration;
+    };
+
     /** create new map
      * @oaram width, height map width+height
      */
     Map(uint width, uint height)
       : width(width)
       , height(height)
+      , chunksLocked(false)
+      , landMask(width, height)
+      , regionQueries(false)
+      , islandLabels(getNoIslandLabels())
+      , islandLabelCount(0)
+      , islandGeneration(0)
     {
-      for (uint y = 0; y < height; y++)
-      {
-        std::vector<Tile> row;
-        for (uint x = 0; x < height; x++)
-        {
-          row.push_back(Tile());
-        }
-        tiles.push_back(row);
-      }
+      initChunks();
     }
 
     /** create new map
@@ -271,6 +482,13 @@ class Map
     Map()
       : width(0)
       , height(0)
+      , chunksX(0)
+      , chunksY(0)
+      , chunksLocked(false)
+      , regionQueries(false)
+      , islandLabels(getNoIslandLabels())
+      , islandLabelCount(0)
+      , islandGeneration(0)
     {
     }
 
@@ -288,6 +506,11 @@ class Map
      */
     void reset();
 
+    /** reset map content and change map size
+     * @param width, height new map width+height
+     */
+    void reset(uint width, uint height);
+
     /** get map width
      * @return width
      */
@@ -304,13 +527,14 @@ class Map
       return height;
     }
 
-    /** get tile at x/y position
+    /** get tile at x/y position; read-only, change tiles with setTile()
+     *  or setTiles()
      * @param x,y position
-     * @return tile
+     * @return tile or water tile if outside of the map
      */
-    Tile &getTile(int x, int y);
+    const Tile &getTile(int x, int y) const;
 
-    /** set tile at x/y posiiton
+    /** set tile at x/y posiiton; thread-safe for different tiles
      * @param x,y position
      * @param type tile type
      * @param color color
@@ -320,10 +544,15 @@ class Map
       assert(x < width);
       assert(y < height);
 
-      tiles[y][x].set(Coordinates(x, y), type, color);
+      ChunkStripe &stripe = lockChunkWrite(y);
+      Tile        &tile   = getWritableTile(stripe, x, y);
+      const Tile  oldTile = tile;
+      tile.set(Coordinates(x, y), type, color);
+      tileChanged(x, y, oldTile, tile);
+      unlockChunkWrite(stripe);
     }
 
-    /** set tile at x/y posiiton
+    /** set tile at x/y posiiton; thread-safe for different tiles
      * @param x,y position
      * @param type tile type
      */
@@ -332,22 +561,273 @@ class Map
       assert(x < width);
       assert(y < height);
 
-      tiles[y][x].set(Coordinates(x, y), type);
+      ChunkStripe &stripe = lockChunkWrite(y);
+      Tile        &tile   = getWritableTile(stripe, x, y);
+      const Tile  oldTile = tile;
+      tile.set(Coordinates(x, y), type);
+      tileChanged(x, y, oldTile, tile);
+      unlockChunkWrite(stripe);
     }
 
+    /** set run of tiles in a row; faster than setTile() for each tile;
+     *  thread-safe for different tiles
+     * @param x,y position of first tile
+     * @param n number of tiles, run must be inside row
+     * @param types tile types
+     * @param colors colors
+     */
+    void setTiles(uint x, uint y, uint n, const Tile::Types types[], const Color colors[]);
+
+    /** get snapshot of tiles in O(number of chunks); thread-safe
+     * @return snapshot
+     */
+    Snapshot getSnapshot() const;
+
+    /** restore tiles of a snapshot of this map; only chunks changed since
+     *  the snapshot are compared, changed tiles are set with setTiles()
+     * @param snapshot snapshot
+     */
+    void restore(const Snapshot &snapshot);
+
+    /** add map listener; not thread-safe
+     * @param listener listener to add
+     */
+    void addListener(MapListener *listener)
+    {
+      assert(listener != nullptr);
+
+      listeners.push_back(listener);
+    }
+
+    /** remove map listener; not thread-safe
+     * @param listener listener to remove
+     */
+    void removeListener(MapListener *listener)
+    {
+      listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+    }
+
+    /** check if tile is land (any type except water)
+     * @param x,y position
+     * @return true iff land
+     */
+    bool isLand(uint x, uint y) const
+    {
+      return landMask.get(x, y);
+    }
+
+    /** get land mask; kept in sync by setTile()
+     * @return land mask
+     */
+    const LandMask &getLandMask() const
+    {
+      return landMask;
+    }
+
+    /** count land tiles in rectangle
+     * @param x,y top left position
+     * @param width,height rectangle size
+     * @return number of land tiles
+     */
+    size_t countLand(uint x, uint y, uint width, uint height) const
+    {
+      return landMask.count(x, y, width, height);
+    }
+
+    /** check if map has an elevation field
+     * @return true iff elevation field available
+     */
+    bool hasElevations() const
+    {
+      return !elevations.empty();
+    }
+
+    /** get elevation at x/y position
+     * @param x,y position
+     * @return elevation relative to sea level
+     */
+    float getElevation(uint x, uint y) const
+    {
+      assert(x < width);
+      assert(y < height);
+      assert(hasElevations());
+
+      return elevations[static_cast<size_t>(y) * width + x];
+    }
+
+    /** get elevation field
+     * @return elevation field (width*height values, row by row) or
+     *         empty if no elevations available
+     */
+    const std::vector<float> &getElevations() const
+    {
+      return elevations;
+    }
+
+    /** set elevation field
+     * @param elevations elevation field (width*height values, row by row)
+     */
+    void setElevations(std::vector<float> &&elevations)
+    {
+      assert(elevations.size() == static_cast<size_t>(width) * height);
+
+      this->elevations = std::move(elevations);
+    }
+
+    /** set elevation at x/y position; thread-safe for different tiles
+     * @param x,y position
+     * @param elevation elevation relative to sea level
+     */
+    void setElevation(uint x, uint y, float elevation)
+    {
+      assert(x < width);
+      assert(y < height);
+      assert(hasElevations());
+
+      elevations[static_cast<size_t>(y) * width + x] = elevation;
+    }
+
+    /** check if map has a coast distance field
+     * @return true iff coast distance field available
+     */
+    bool hasCoastDistances() const
+    {
+      return !coastDistances.empty();
+    }
+
+    /** get signed distance to the coast at x/y position
+     * @param x,y position
+     * @return distance to nearest water tile (land, >=1) or negative
+     *         distance to nearest land tile (water, <=-1)
+     */
+    float getCoastDistance(uint x, uint y) const
+    {
+      assert(x < width);
+      assert(y < height);
+      assert(hasCoastDistances());
+
+      return coastDistances[static_cast<size_t>(y) * width + x];
+    }
+
+    /** get coast distance field
+     * @return coast distance field (width*height values, row by row) or
+     *         empty if not available
+     */
+    const std::vector<float> &getCoastDistances() const
+    {
+      return coastDistances;
+    }
+
+    /** update coast distance field from the land mask; the field is not
+     *  updated by setTile()
+     */
+    void updateCoastDistances();
+
+    /** enable/disable region queries; region queries need summed-area
+     *  tables of about 23 bytes per tile
+     * @param enabled true to enable region queries
+     */
+    void enableRegionQueries(bool enabled);
+
+    /** update region query tables; only needed to avoid the update on
+     *  the next query, tables are updated lazily
+     */
+    void updateRegionQueries() const;
+
+    /** get statistics of rectangle in O(1); region queries must be
+     *  enabled
+     * @param x,y top left position
+     * @param width,height rectangle size (clipped to map)
+     * @return region statistics
+     */
+    RegionStatistics queryRect(uint x, uint y, uint width, uint height) const;
+
     /** load map
      * @oaram filePath file path
      */
     void load(const std::string &filePath);
 
-    /** save map
+    /** save map in the format of load(); tile colors are not saved
      * @oaram filePath file path
      */
-    void save(const std::string &filePath);
+    void save(const std::string &filePath) const;
+
+    /** find islands of the current tiles: 8-connected land tiles;
+     *  builds the island label plane and the island index
+     * @return number of islands
+     */
+    uint findIslands()
+    {
+      return findIslands(getSnapshot());
+    }
 
-    /** find islands
+    /** find islands of a snapshot of the map
+     * @param snapshot snapshot
+     * @return number of islands
      */
-    uint findIslands();
+    uint findIslands(const Snapshot &snapshot);
+
+    /** get island label at x/y position
+     * @param x,y position
+     * @return island label (1..n) or 0 if no island or islands not found
+     */
+    uint32_t getIslandLabel(uint x, uint y) const
+    {
+      assert(x < width);
+      assert(y < height);
+
+      return !islandLabels->empty() ? (*islandLabels)[static_cast<size_t>(y) * width + x] : 0;
+    }
+
+    /** get island label plane
+     * @return island labels (width*height values, row by row) or empty
+     *         if islands not found
+     */
+    const std::vector<uint32_t> &getIslandLabels() const
+    {
+      return *islandLabels;
+    }
+
+    /** get number of islands
+     * @return number of islands; labels are 1..n
+     */
+    uint getIslandCount() const
+    {
+      return static_cast<uint>(islandsByLabel.size());
+    }
+
+    /** get island by label
+     * @param label island label (1..n)
+     * @return island or nullptr
+     */
+    const Island *getIsland(uint32_t label) const
+    {
+      return ((label > 0) && (label <= islandsByLabel.size())) ? islandsByLabel[label - 1] : nullptr;
+    }
+
+    /** get island at x/y position in O(1)
+     * @param x,y position
+     * @return island or nullptr
+     */
+    const Island *getIslandAt(uint x, uint y) const
+    {
+      return getIsland(getIslandLabel(x, y));
+    }
+
+    /** get islands with at least one tile in rectangle
+     * @param x,y top left position
+     * @param width,height rectangle size
+     * @param islands islands (sorted by label)
+     */
+    void getIslandsInRect(uint x, uint y, uint width, uint height, std::vector<const Island*> &islands) const;
+
+    /** get k nearest islands by distance to their nearest tile; the
+     *  distance wraps around in x and y direction
+     * @param x,y position
+     * @param k max. number of islands
+     * @param islands islands, nearest first
+     */
+    void getNearestIslands(uint x, uint y, uint k, std::vector<const Island*> &islands) const;
 
     /** print map with detected islands
      */
@@ -366,9 +846,203 @@ class Map
     }
 
   private:
-    uint                           width, height;
-    std::vector<std::vector<Tile>> tiles;
-    std::unordered_set<Island*>    islands;
+    // number of chunk stripes
+    static const uint CHUNK_STRIPE_COUNT = 64;
+
+    /** stripe of chunk rows: writers in progress and lock for copying
+     *  chunks; one cache line each
+     */
+    struct alignas(64) ChunkStripe
+    {
+      std::atomic<uint32_t> writerCount;
+      std::mutex            copyLock;
+
+      ChunkStripe()
+        : writerCount(0)
+      {
+      }
+    };
+
+    uint                                         width, height;
+    uint                                         chunksX, chunksY;
+    std::vector<std::shared_ptr<TileChunk>>      chunks;
+    std::unique_ptr<std::atomic<TileChunk*>[]>   writableChunks;  // chunk if not shared with a snapshot or another chunk, else nullptr
+    mutable ChunkStripe                          chunkStripes[CHUNK_STRIPE_COUNT];
+    mutable std::atomic<bool>                    chunksLocked;    // true while all chunks are locked
+    mutable std::mutex                           chunksLock;      // lock for locking all chunks
+    std::vector<float>                           elevations;
+    std::vector<float>                           coastDistances;
+    LandMask                                     landMask;
+    bool                                         regionQueries;
+    mutable RegionIndex                          regionIndex;
+    mutable std::mutex                           regionIndexLock;
+    std::unordered_set<Island*>                  islands;
+    std::vector<Island*>                         islandsByLabel;
+    std::shared_ptr<const std::vector<uint32_t>> islandLabels;      // shared with snapshots
+    uint                                         islandLabelCount;  // number of islands in islandLabels
+    uint64_t                                     islandGeneration;  // generation of islandLabels
+    IslandIndex                                  islandIndex;
+    std::vector<MapListener*>                    listeners;
+
+    /** get tile returned for positions outside of the map
+     * @return water tile
+     */
+    static const Tile &getOffMapTile();
+
+    /** get island labels of a map without islands
+     * @return empty island labels
+     */
+    static const std::shared_ptr<const std::vector<uint32_t>> &getNoIslandLabels();
+
+    /** set island labels; visible to new snapshots
+     * @param labels island labels or empty
+     * @param count number of islands
+     */
+    void setIslandLabels(const std::shared_ptr<const std::vector<uint32_t>> &labels, uint count);
+
+    /** get chunk index of tile
+     * @param chunksX number of chunks per row
+     * @param x,y position
+     * @return chunk index
+     */
+    static size_t getChunkIndex(uint chunksX, uint x, uint y)
+    {
+      return static_cast<size_t>(y >> CHUNK_SHIFT) * chunksX + (x >> CHUNK_SHIFT);
+    }
+
+    /** get index of tile inside chunk
+     * @param x,y position
+     * @return index inside chunk
+     */
+    static uint getChunkTileIndex(uint x, uint y)
+    {
+      return ((y & (CHUNK_SIZE - 1)) << CHUNK_SHIFT) | (x & (CHUNK_SIZE - 1));
+    }
+
+    /** allocate chunks with water tiles for current size
+     */
+    void initChunks();
+
+    /** lock chunk row for writing; waits while all chunks are locked
+     * @param y row
+     * @return stripe of chunk row
+     */
+    ChunkStripe &lockChunkWrite(uint y)
+    {
+      ChunkStripe &stripe = chunkStripes[(y >> CHUNK_SHIFT) % CHUNK_STRIPE_COUNT];
+      for (;;)
+      {
+        stripe.writerCount.fetch_add(1);
+        if (!chunksLocked.load())
+        {
+          return stripe;
+        }
+        stripe.writerCount.fetch_sub(1);
+        while (chunksLocked.load(std::memory_order_relaxed))
+        {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    /** unlock chunk row for writing
+     * @param stripe stripe of chunk row
+     */
+    void unlockChunkWrite(ChunkStripe &stripe)
+    {
+      stripe.writerCount.fetch_sub(1, std::memory_order_release);
+    }
+
+    /** lock all chunks: wait until running writes are done, block new
+     *  writes
+     */
+    void lockChunks() const;
+
+    /** unlock all chunks
+     */
+    void unlockChunks() const;
+
+    /** get tile for writing; copies the chunk if shared with a snapshot;
+     *  chunk row must be locked for writing
+     * @param stripe stripe of chunk row
+     * @param x,y position
+     * @return tile
+     */
+    Tile &getWritableTile(ChunkStripe &stripe, uint x, uint y)
+    {
+      size_t    i     = getChunkIndex(chunksX, x, y);
+      TileChunk *chunk = writableChunks[i].load(std::memory_order_acquire);
+      if (chunk == nullptr)
+      {
+        chunk = copyChunk(stripe, i);
+      }
+
+      return (*chunk)[getChunkTileIndex(x, y)];
+    }
+
+    /** make chunk writable: copy chunk if still shared with a snapshot
+     * @param stripe stripe of chunk row
+     * @param i chunk index
+     * @return writable chunk
+     */
+    TileChunk *copyChunk(ChunkStripe &stripe, size_t i);
+
+    /** delete islands, label plane and island index
+     */
+    void clearIslands();
+
+    /** update land mask and region index after a tile change and notify
+     *  listeners
+     * @param x,y position
+     * @param oldTile tile before change
+     * @param tile tile after change
+     */
+    void tileChanged(uint x, uint y, const Tile &oldTile, const Tile &tile)
+    {
+      // other threads may set tiles of the same land mask word
+      landMask.setShared(x, y, tile.getType() != Tile::Types::WATER);
+      if (regionQueries)
+      {
+        regionIndex.invalidate(y);
+      }
+      for (MapListener *listener : listeners)
+      {
+        listener->onTileChanged(*this, x, y, oldTile, tile);
+      }
+    }
+
+    /** update land mask and region index after a change of a run of
+     *  tiles in a row and notify listeners once
+     * @param x,y position of first tile
+     * @param n number of tiles
+     * @param oldTiles tiles before change
+     * @param tiles tiles after change
+     */
+    void tilesChanged(uint x, uint y, uint n, const Tile oldTiles[], const Tile tiles[])
+    {
+      for (uint i = 0; i < n; i++)
+      {
+        landMask.setShared(x + i, y, tiles[i].getType() != Tile::Types::WATER);
+      }
+      if (regionQueries)
+      {
+        regionIndex.invalidate(y);
+      }
+      for (MapListener *listener : listeners)
+      {
+        listener->onTilesChanged(*this, x, y, n, oldTiles, tiles);
+      }
+    }
+
+    /** notify listeners about replaced tiles
+     */
+    void mapChanged()
+    {
+      for (MapListener *listener : listeners)
+      {
+        listener->onMapChanged(*this);
+      }
+    }
 };
 
 #endif // ISLANDS_H
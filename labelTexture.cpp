@@ -0,0 +1,185 @@
+/***********************************************************************\
+*
+* Contents: label texture: island label overlay
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include <epoxy/gl.h>
+
+#include "labelTexture.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// opacity increase of hovered and selected islands
+LOCAL const float HIGHLIGHT_OPACITY = 0.3f;
+
+const char *LabelTexture::FRAGMENT_SHADER_FUNCTIONS =
+  "uniform highp usampler2D labelTextureLabels;\n"
+  "uniform highp uint       labelTextureHover;\n"
+  "uniform highp uint       labelTextureSelected;\n"
+  "uniform float            labelTextureOpacity;\n"
+  "uniform float            labelTextureHighlightOpacity;\n"
+  "\n"
+  "vec3 labelTextureColor(highp uint label)\n"
+  "{\n"
+  "  // hashed palette: distinct colors for neighbouring labels\n"
+  "  highp uint h = label * 0x9E3779B1u;\n"
+  "  h = (h ^ (h >> 15)) * 0x85EBCA77u;\n"
+  "  h ^= h >> 13;\n"
+  "  return 0.25 + 0.75 * vec3(float(h & 255u), float((h >> 8) & 255u), float((h >> 16) & 255u)) / 255.0;\n"
+  "}\n"
+  "\n"
+  "highp uint labelTextureLabel(highp ivec2 p, highp ivec2 size)\n"
+  "{\n"
+  "  return texelFetch(labelTextureLabels, (p + size) % size, 0).r;\n"
+  "}\n"
+  "\n"
+  "vec4 labelTextureOverlay(vec4 color, highp vec2 uv)\n"
+  "{\n"
+  "  if (labelTextureOpacity <= 0.0)\n"
+  "  {\n"
+  "    return color;\n"
+  "  }\n"
+  "\n"
+  "  highp ivec2 size  = textureSize(labelTextureLabels, 0);\n"
+  "  highp ivec2 p     = ivec2(mod(floor(uv * vec2(size)), vec2(size)));\n"
+  "  highp uint  label = texelFetch(labelTextureLabels, p, 0).r;\n"
+  "  if (label == 0u)\n"
+  "  {\n"
+  "    return color;\n"
+  "  }\n"
+  "\n"
+  "  // outline: island texel next to water or another island\n"
+  "  bool  outline =    (labelTextureLabel(p + ivec2( 1,  0), size) != label)\n"
+  "                  || (labelTextureLabel(p + ivec2(-1,  0), size) != label)\n"
+  "                  || (labelTextureLabel(p + ivec2( 0,  1), size) != label)\n"
+  "                  || (labelTextureLabel(p + ivec2( 0, -1), size) != label);\n"
+  "  bool  highlight = (label == labelTextureHover) || (label == labelTextureSelected);\n"
+  "  vec3  c = mix(color.rgb,\n"
+  "                labelTextureColor(label),\n"
+  "                highlight ? labelTextureHighlightOpacity : labelTextureOpacity\n"
+  "               );\n"
+  "  if (outline)\n"
+  "  {\n"
+  "    c = (label == labelTextureSelected) ? vec3(1.0, 1.0, 0.0) : c * 0.5;\n"
+  "  }\n"
+  "  return vec4(c, color.a);\n"
+  "}\n";
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+LabelTexture::LabelTexture()
+  : texture(0)
+  , setFlag(false)
+  , hoverLabel(0)
+  , selectedLabel(0)
+  , opacity(DEFAULT_OPACITY)
+{
+}
+
+void LabelTexture::init()
+{
+  glGenTextures(1, &texture);
+  glActiveTexture(GL_TEXTURE0 + LABEL_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glActiveTexture(GL_TEXTURE0);
+
+  clear();
+}
+
+void LabelTexture::done()
+{
+  glDeleteTextures(1, &texture);
+  texture = 0;
+  setFlag = false;
+}
+
+void LabelTexture::set(const uint32_t labels[], uint width, uint height)
+{
+  assert(texture != 0);
+  assert(width > 0);
+  assert(height > 0);
+
+  glActiveTexture(GL_TEXTURE0 + LABEL_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if ((width <= MAX_SIZE) && (height <= MAX_SIZE))
+  {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, labels);
+  }
+  else
+  {
+    // subsample huge label planes; small islands may vanish
+    uint step = 2;
+    while (((width + step - 1) / step > MAX_SIZE) || ((height + step - 1) / step > MAX_SIZE))
+    {
+      step *= 2;
+    }
+    const uint            subWidth  = (width  + step - 1) / step;
+    const uint            subHeight = (height + step - 1) / step;
+    std::vector<uint32_t> subLabels(static_cast<size_t>(subWidth) * subHeight);
+    for (uint y = 0; y < subHeight; y++)
+    {
+      for (uint x = 0; x < subWidth; x++)
+      {
+        subLabels[static_cast<size_t>(y) * subWidth + x] = labels[static_cast<size_t>(y * step) * width + x * step];
+      }
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, subWidth, subHeight, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, subLabels.data());
+  }
+  glActiveTexture(GL_TEXTURE0);
+
+  setFlag = true;
+}
+
+void LabelTexture::clear()
+{
+  assert(texture != 0);
+
+  const uint32_t noLabel = 0;
+
+  glActiveTexture(GL_TEXTURE0 + LABEL_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, 1, 1, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &noLabel);
+  glActiveTexture(GL_TEXTURE0);
+
+  setFlag       = false;
+  hoverLabel    = 0;
+  selectedLabel = 0;
+}
+
+void LabelTexture::bind(GLuint program) const
+{
+  glActiveTexture(GL_TEXTURE0 + LABEL_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glActiveTexture(GL_TEXTURE0);
+
+  glUniform1i(glGetUniformLocation(program, "labelTextureLabels"), LABEL_TEXTURE_UNIT);
+  glUniform1ui(glGetUniformLocation(program, "labelTextureHover"), hoverLabel);
+  glUniform1ui(glGetUniformLocation(program, "labelTextureSelected"), selectedLabel);
+  glUniform1f(glGetUniformLocation(program, "labelTextureOpacity"), setFlag ? opacity : 0.0f);
+  glUniform1f(glGetUniformLocation(program, "labelTextureHighlightOpacity"), std::min(opacity + HIGHLIGHT_OPACITY, 1.0f));
+}
+
+/* end of file */
@@ -0,0 +1,145 @@
+/***********************************************************************\
+*
+* Contents: label texture: island label overlay
+* Systems: all
+*
+\***********************************************************************/
+#ifndef LABEL_TEXTURE_H
+#define LABEL_TEXTURE_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <epoxy/gl.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** label texture: stores an island label plane (see Map::findIslands())
+ *  as a 32 bit integer texture. The fragment shader colors every island
+ *  by a hash of its label and outlines it; hover and selection are
+ *  uniforms, so no per island work is done on the CPU.
+ *
+ *  All methods must be called in the GL context.
+ */
+class LabelTexture
+{
+  public:
+    // max. texture width+height; larger label planes are subsampled
+    static const uint MAX_SIZE           = 4096;
+    // texture unit used by bind()
+    static const uint LABEL_TEXTURE_UNIT = 6;
+    // default opacity of the island colors
+    static constexpr float DEFAULT_OPACITY = 0.5f;
+
+    /** GLSL ES 3.00 fragment shader functions; insert after the
+     *  #version/precision lines:
+     *
+     *    vec4 labelTextureOverlay(vec4 color, vec2 uv)  color with island
+     *                                                   overlay at UV
+     *                                                   position, wrapped
+     */
+    static const char *FRAGMENT_SHADER_FUNCTIONS;
+
+    /** create label texture
+     */
+    LabelTexture();
+
+    /** create GL objects; no labels are shown until set()
+     */
+    void init();
+
+    /** release GL objects
+     */
+    void done();
+
+    /** set labels and show overlay
+     * @param labels labels, row by row; 0 is no island
+     * @param width,height size
+     */
+    void set(const uint32_t labels[], uint width, uint height);
+
+    /** clear labels and hide overlay
+     */
+    void clear();
+
+    /** check if labels are shown
+     * @return true iff labels are set
+     */
+    bool isSet() const
+    {
+      return setFlag;
+    }
+
+    /** set hover label
+     * @param label highlighted label or 0
+     */
+    void setHover(uint32_t label)
+    {
+      hoverLabel = label;
+    }
+
+    /** get hover label
+     * @return highlighted label or 0
+     */
+    uint32_t getHover() const
+    {
+      return hoverLabel;
+    }
+
+    /** set selected label
+     * @param label selected label or 0
+     */
+    void setSelected(uint32_t label)
+    {
+      selectedLabel = label;
+    }
+
+    /** get selected label
+     * @return selected label or 0
+     */
+    uint32_t getSelected() const
+    {
+      return selectedLabel;
+    }
+
+    /** set opacity of the island colors
+     * @param opacity opacity 0..1
+     */
+    void setOpacity(float opacity)
+    {
+      this->opacity = opacity;
+    }
+
+    /** bind texture and set uniforms of FRAGMENT_SHADER_FUNCTIONS
+     * @param program current program
+     */
+    void bind(GLuint program) const;
+
+  private:
+    GLuint   texture;
+    bool     setFlag;
+    uint32_t hoverLabel;
+    uint32_t selectedLabel;
+    float    opacity;
+
+    LabelTexture(const LabelTexture&) = delete;
+    LabelTexture &operator=(const LabelTexture&) = delete;
+};
+
+#endif // LABEL_TEXTURE_H
+
+/* end of file */
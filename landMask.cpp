@@ -0,0 +1,204 @@
+/***********************************************************************\
+*
+* Contents: bit-packed land/water mask
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "landMask.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+const uint LandMask::BITS_PER_WORD;
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** get mask of bits [b0,b1) in a word
+ * @param b0,b1 bit range, 0 <= b0 <= b1 <= 64
+ * @return mask
+ */
+LOCAL inline uint64_t getBitMask(uint b0, uint b1)
+{
+  uint64_t upper = (b1 < 64) ? (UINT64_C(1) << b1) - 1 : ~UINT64_C(0);
+  uint64_t lower = (UINT64_C(1) << b0) - 1;
+
+  return upper & ~lower;
+}
+
+void LandMask::resize(uint width, uint height)
+{
+  this->width       = width;
+  this->height      = height;
+  this->wordsPerRow = (width + BITS_PER_WORD - 1) / BITS_PER_WORD;
+  words.assign(static_cast<size_t>(wordsPerRow) * height, 0);
+}
+
+void LandMask::clear()
+{
+  std::fill(words.begin(), words.end(), 0);
+}
+
+uint64_t LandMask::getBits(uint x, uint y) const
+{
+  assert(x < width);
+
+  const uint64_t *row = getRow(y);
+
+  // extract n bits at x without wrap
+  auto extract = [row](uint x, uint n) -> uint64_t
+  {
+    uint     i = x / BITS_PER_WORD;
+    uint     b = x % BITS_PER_WORD;
+    uint64_t v = row[i] >> b;
+    if ((b != 0) && ((b + n) > BITS_PER_WORD))
+    {
+      v |= row[i + 1] << (BITS_PER_WORD - b);
+    }
+
+    return (n < BITS_PER_WORD) ? v & ((UINT64_C(1) << n) - 1) : v;
+  };
+
+  if ((x + BITS_PER_WORD) <= width)
+  {
+    return extract(x, BITS_PER_WORD);
+  }
+  else
+  {
+    // wrap around at the end of the row (possibly multiple times for small widths)
+    uint64_t bits  = 0;
+    uint     shift = 0;
+    while (shift < BITS_PER_WORD)
+    {
+      uint n = std::min(BITS_PER_WORD - shift, width - x);
+      bits |= extract(x, n) << shift;
+      shift += n;
+      x = (x + n) % width;
+    }
+
+    return bits;
+  }
+}
+
+uint64_t LandMask::getNeighborWord(uint wordIndex, uint y, int dx, int dy) const
+{
+  assert(wordIndex < wordsPerRow);
+
+  uint ny = static_cast<uint>(((static_cast<int>(y) + dy) % static_cast<int>(height) + static_cast<int>(height)) % static_cast<int>(height));
+  uint nx = static_cast<uint>(((static_cast<int>(wordIndex * BITS_PER_WORD) + dx) % static_cast<int>(width) + static_cast<int>(width)) % static_cast<int>(width));
+
+  uint64_t bits = (dx == 0) ? getRow(ny)[wordIndex] : getBits(nx, ny);
+  if (wordIndex == (wordsPerRow - 1))
+  {
+    bits &= getLastWordMask();
+  }
+
+  return bits;
+}
+
+size_t LandMask::count() const
+{
+  size_t n = 0;
+  for (uint64_t word : words)
+  {
+    n += static_cast<size_t>(__builtin_popcountll(word));
+  }
+
+  return n;
+}
+
+size_t LandMask::count(uint x, uint y, uint width, uint height) const
+{
+  uint x0 = std::min(x, this->width);
+  uint x1 = static_cast<uint>(std::min(static_cast<size_t>(x) + width,  static_cast<size_t>(this->width )));
+  uint y0 = std::min(y, this->height);
+  uint y1 = static_cast<uint>(std::min(static_cast<size_t>(y) + height, static_cast<size_t>(this->height)));
+  if ((x0 >= x1) || (y0 >= y1))
+  {
+    return 0;
+  }
+
+  uint i0 = x0 / BITS_PER_WORD;
+  uint i1 = (x1 - 1) / BITS_PER_WORD;
+  uint64_t firstMask = getBitMask(x0 % BITS_PER_WORD, BITS_PER_WORD);
+  uint64_t lastMask  = getBitMask(0, ((x1 - 1) % BITS_PER_WORD) + 1);
+
+  size_t n = 0;
+  for (uint y = y0; y < y1; y++)
+  {
+    const uint64_t *row = getRow(y);
+    if (i0 == i1)
+    {
+      n += static_cast<size_t>(__builtin_popcountll(row[i0] & firstMask & lastMask));
+    }
+    else
+    {
+      n += static_cast<size_t>(__builtin_popcountll(row[i0] & firstMask));
+      for (uint i = i0 + 1; i < i1; i++)
+      {
+        n += static_cast<size_t>(__builtin_popcountll(row[i]));
+      }
+      n += static_cast<size_t>(__builtin_popcountll(row[i1] & lastMask));
+    }
+  }
+
+  return n;
+}
+
+void LandMask::getRuns(uint y, std::vector<Run> &runs) const
+{
+  runs.clear();
+
+  uint x = findNext(0, y, true);
+  while (x < width)
+  {
+    Run run;
+    run.x0 = x;
+    run.x1 = findNext(x, y, false);
+    runs.push_back(run);
+
+    x = (run.x1 < width) ? findNext(run.x1, y, true) : width;
+  }
+}
+
+uint LandMask::findNext(uint x, uint y, bool land) const
+{
+  const uint64_t *row = getRow(y);
+
+  uint i = x / BITS_PER_WORD;
+  if (i >= wordsPerRow)
+  {
+    return width;
+  }
+
+  // search land bits or inverted bits for water
+  uint64_t word = (land ? row[i] : ~row[i]) & getBitMask(x % BITS_PER_WORD, BITS_PER_WORD);
+  while (word == 0)
+  {
+    i++;
+    if (i >= wordsPerRow)
+    {
+      return width;
+    }
+    word = land ? row[i] : ~row[i];
+  }
+
+  return std::min(i * BITS_PER_WORD + static_cast<uint>(__builtin_ctzll(word)), width);
+}
+
+/* end of file */
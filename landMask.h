@@ -0,0 +1,227 @@
+/***********************************************************************\
+*
+* Contents: bit-packed land/water mask
+* Systems: all
+*
+\***********************************************************************/
+#ifndef LAND_MASK_H
+#define LAND_MASK_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <cassert>
+
+#include <sys/types.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** land mask: 1 bit per tile (1 = land), 64 tiles per word. Every row
+ *  starts with a new word, unused bits at the end of a row are 0.
+ */
+class LandMask
+{
+  public:
+    static const uint BITS_PER_WORD = 64;
+
+    /** run of land tiles in a row
+     */
+    typedef struct
+    {
+      uint x0, x1;  // tiles [x0,x1)
+    } Run;
+
+    /** create empty land mask
+     */
+    LandMask()
+      : width(0)
+      , height(0)
+      , wordsPerRow(0)
+    {
+    }
+
+    /** create land mask (all water)
+     * @param width,height mask width+height
+     */
+    LandMask(uint width, uint height)
+    {
+      resize(width, height);
+    }
+
+    /** resize and clear mask
+     * @param width,height mask width+height
+     */
+    void resize(uint width, uint height);
+
+    /** clear mask (all water)
+     */
+    void clear();
+
+    /** get width
+     * @return width
+     */
+    uint getWidth() const
+    {
+      return width;
+    }
+
+    /** get height
+     * @return height
+     */
+    uint getHeight() const
+    {
+      return height;
+    }
+
+    /** get number of words per row
+     * @return words per row
+     */
+    uint getWordsPerRow() const
+    {
+      return wordsPerRow;
+    }
+
+    /** get row words
+     * @param y row
+     * @return row words
+     */
+    const uint64_t *getRow(uint y) const
+    {
+      assert(y < height);
+
+      return &words[static_cast<size_t>(y) * wordsPerRow];
+    }
+
+    /** get row words
+     * @param y row
+     * @return row words
+     */
+    uint64_t *getRow(uint y)
+    {
+      assert(y < height);
+
+      return &words[static_cast<size_t>(y) * wordsPerRow];
+    }
+
+    /** get mask of unused bits in last word of a row
+     * @return mask of used bits in last word
+     */
+    uint64_t getLastWordMask() const
+    {
+      return ((width % BITS_PER_WORD) != 0) ? (UINT64_C(1) << (width % BITS_PER_WORD)) - 1 : ~UINT64_C(0);
+    }
+
+    /** check if tile is land
+     * @param x,y position
+     * @return true iff land
+     */
+    bool get(uint x, uint y) const
+    {
+      assert(x < width);
+
+      return ((getRow(y)[x / BITS_PER_WORD] >> (x % BITS_PER_WORD)) & 1) != 0;
+    }
+
+    /** set tile land/water; not thread-safe for tiles of the same word,
+     *  see setShared()
+     * @param x,y position
+     * @param land true for land, false for water
+     */
+    void set(uint x, uint y, bool land)
+    {
+      assert(x < width);
+
+      uint64_t bit = UINT64_C(1) << (x % BITS_PER_WORD);
+      if (land)
+      {
+        getRow(y)[x / BITS_PER_WORD] |= bit;
+      }
+      else
+      {
+        getRow(y)[x / BITS_PER_WORD] &= ~bit;
+      }
+    }
+
+    /** set tile land/water with an atomic read-modify-write of its
+     *  word; thread-safe for different tiles, also in the same word
+     * @param x,y position
+     * @param land true for land, false for water
+     */
+    void setShared(uint x, uint y, bool land)
+    {
+      assert(x < width);
+
+      uint64_t bit = UINT64_C(1) << (x % BITS_PER_WORD);
+      if (land)
+      {
+        __atomic_fetch_or(&getRow(y)[x / BITS_PER_WORD], bit, __ATOMIC_RELAXED);
+      }
+      else
+      {
+        __atomic_fetch_and(&getRow(y)[x / BITS_PER_WORD], ~bit, __ATOMIC_RELAXED);
+      }
+    }
+
+    /** get 64 tiles of a row starting at x; wraps around at the end of
+     *  the row
+     * @param x,y start position
+     * @return bits: bit i is tile (x+i) % width
+     */
+    uint64_t getBits(uint x, uint y) const;
+
+    /** get neighbor word: word of a row shifted by dx/dy tiles; wraps
+     *  around at the map borders like the donut
+     * @param wordIndex word index in row
+     * @param y row
+     * @param dx,dy neighbor offset
+     * @return bits: bit i is land state of tile
+     *         (wordIndex*64+i+dx, y+dy); unused bits are 0
+     */
+    uint64_t getNeighborWord(uint wordIndex, uint y, int dx, int dy) const;
+
+    /** count land tiles in whole mask
+     * @return number of land tiles
+     */
+    size_t count() const;
+
+    /** count land tiles in rectangle
+     * @param x,y top left position
+     * @param width,height rectangle size (clipped to mask)
+     * @return number of land tiles
+     */
+    size_t count(uint x, uint y, uint width, uint height) const;
+
+    /** get runs of land tiles in row
+     * @param y row
+     * @param runs runs (cleared before)
+     */
+    void getRuns(uint y, std::vector<Run> &runs) const;
+
+  private:
+    uint                  width, height;
+    uint                  wordsPerRow;
+    std::vector<uint64_t> words;
+
+    /** find next tile with state in row
+     * @param x,y start position
+     * @param land state to find
+     * @return x position or width if not found
+     */
+    uint findNext(uint x, uint y, bool land) const;
+};
+
+#endif // LAND_MASK_H
+
+/* end of file */
@@ -10,17 +10,49 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <string.h>
+#include <math.h>
 #include <assert.h>
+#include <limits.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+
+#include "noise.h"
+#include "rivers.h"
+#include "rasterizer.h"
+#include "landMask.h"
+#include "morphology.h"
+#include "distanceField.h"
+#include "parallel.h"
 
 #include "mapGenerator.h"
 
 /****************** Conditional compilation switches *******************/
+#if defined(__SSE2__)
+  #define HAVE_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define HAVE_SSE2 0
+#endif
 
 /***************************** Constants *******************************/
 //Constants and globals - future plans to minimize these as much as possible
 const uint BORDER_Y = 1;
 const uint BORDER_X = 1;
 
+// min. map size for shapes: at least one tile between the borders;
+// smaller maps stay water
+const uint MIN_SHAPES_WIDTH  = 2 * BORDER_X + 2;
+const uint MIN_SHAPES_HEIGHT = 2 * BORDER_Y + 2;
+
 // anything that isn't modifiable land is stored as a negative int
 
 //J is largest land val, P is smallest value
@@ -36,6 +68,33 @@ const uint BORDER_X = 1;
 #define L1 -3 // Land Layer 1
 #define L2 -4 // Land Layer 2
 
+// lengths of the shape generator are given for this map size and scale
+// with the actual map size
+const uint  REFERENCE_MAP_SIZE = 512;
+
+// shape stamping
+const uint  HEXAGON_SIDE_STEP     = 4;    // rows per hexagon border point
+const float CIRCLE_POINT_DISTANCE = 4.0f; // pixels per distorted circle outline point
+
+// coast features: 1 in N coast tiles at REFERENCE_MAP_SIZE; erosion blobs
+// and rivers shrink with the map size, so both chances are scaled, too
+const uint  OCEAN_EROSION_CHANCE = 60;
+const uint  RIVER_SPAWN_CHANCE   = 16;
+
+// coast smoothing
+const uint  COAST_CLOSING_RADIUS       = 1;
+const uint  COAST_SMOOTHING_ITERATIONS = 2;
+
+// noise backend
+const uint  NOISE_OCTAVES        = 8;
+const uint  NOISE_BASE_FREQUENCY = 4;     // lattice cells of first octave across map width
+const float NOISE_PERSISTENCE    = 0.5f;
+const float NOISE_LAND_RATIO     = 0.4f;  // part of tiles above sea level
+const uint  NOISE_HISTOGRAM_SIZE = 4096;
+
+// elevation rivers: min. number of draining tiles per map tile for a river
+const float RIVER_ACCUMULATION_RATIO = 1.0f / 2000.0f;
+
 /***************************** Datatypes *******************************/
 typedef int GeneratorTileTypes;
 
@@ -45,7 +104,40 @@ typedef struct
   Color              color;
 } GeneratorTile;
 
+/** generator cost counters
+ */
+typedef struct
+{
+  uint64_t tileReads;
+  uint64_t tileWrites;
+  uint64_t randomDraws;
+} GeneratorCounters;
+
+/** pipeline stage parameter definition
+ */
+struct ParameterDefinition
+{
+  const char *name;
+  uint       defaultValue;
+  uint       min, max;
+};
+
+/** pipeline stage definition
+ */
+struct StageDefinition
+{
+  const char                       *name;
+  std::vector<ParameterDefinition> parameters;
+  void                             (*function)(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const MapGenerator::Parameters &parameters);
+};
+
 /***************************** Variables *******************************/
+const uint MapGenerator::DEFAULT_MIN_CONTINENTS;
+const uint MapGenerator::DEFAULT_MAX_CONTINENTS;
+
+// cost counters of the generator running in this thread; tiles accessed
+// in parallel loops are counted in bulk by the calling thread
+static thread_local GeneratorCounters counters = {0, 0, 0};
 
 /****************************** Macros *********************************/
 #define LOCAL static
@@ -54,16 +146,25 @@ typedef struct
 
 /***************************** Functions *******************************/
 
-LOCAL int neg_pos_gen() // generates a -1 or 1
+LOCAL inline int generatorRandom()
 {
-  int num = ((rand() % 2) - 1);
+  counters.randomDraws++;
+  return rand();
+}
 
-  if (num == 0)
-  {
-    num++;
-  }
+LOCAL inline uint mapScale(uint length, uint mapSize)
+{
+  // length at REFERENCE_MAP_SIZE scaled to map size, min. 1, max. UINT_MAX
+  return static_cast<uint>(std::max(static_cast<uint64_t>(1),
+                                    std::min((static_cast<uint64_t>(length) * mapSize) / REFERENCE_MAP_SIZE, static_cast<uint64_t>(UINT_MAX))
+                                   )
+                          );
+}
 
-  return num;
+LOCAL inline uint randomBelow(int n)
+{
+  // random number 0..n-1; 0 if the range is empty (e. g. shape larger than map)
+  return (n > 0) ? static_cast<uint>(generatorRandom() % n) : 0;
 }
 
 LOCAL int skewed_neg_pos_gen(int skew_val)
@@ -91,7 +192,7 @@ LOCAL int skewed_neg_pos_gen(int skew_val)
 
   */
 
-  int rand_val = (rand() % 12);// num inclusively between 0 and 11
+  int rand_val = (generatorRandom() % 12);// num inclusively between 0 and 11
 
   if ((rand_val) >= skew_val)
   {
@@ -108,6 +209,7 @@ LOCAL inline GeneratorTile mapGet(const GeneratorTile *generatorMap, uint mapWid
   assert(x < mapWidth);
   assert(y < mapHeight);
 
+  counters.tileReads++;
   return generatorMap[(y*mapWidth)+x];
 }
 
@@ -116,6 +218,7 @@ LOCAL inline void mapSetType(GeneratorTile *generatorMap, uint mapWidth, uint ma
   assert(x < mapWidth);
   assert(y < mapHeight);
 
+  counters.tileWrites++;
   generatorMap[(y*mapWidth)+x].type = type;
 }
 
@@ -124,409 +227,269 @@ LOCAL inline void mapSetColor(GeneratorTile *generatorMap, uint mapWidth, uint m
   assert(x < mapWidth);
   assert(y < mapHeight);
 
+  counters.tileWrites++;
   generatorMap[(y*mapWidth)+x].color.r = r;
   generatorMap[(y*mapWidth)+x].color.g = g;
   generatorMap[(y*mapWidth)+x].color.b = b;
 }
 
-LOCAL inline bool mapIs(const GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, uint x, uint y, GeneratorTileTypes type)
+LOCAL inline void mapFillTiles(GeneratorTile *tiles, size_t n, GeneratorTileTypes type)
 {
-  assert(x < mapWidth);
-  assert(y < mapHeight);
+  GeneratorTile tile;
+  memset(&tile, 0, sizeof(tile));
+  tile.type = type;
 
-  return mapGet(generatorMap,mapWidth,mapHeight,x,y).type == type;
+  counters.tileWrites += n;
+
+  #if HAVE_SSE2
+    // two tiles per store
+    static_assert(sizeof(GeneratorTile) == sizeof(int64_t), "generator tile size");
+
+    int64_t pattern;
+    memcpy(&pattern, &tile, sizeof(pattern));
+    const __m128i value = _mm_set1_epi64x(pattern);
+
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(&tiles[i]), value);
+    }
+    if (i < n)
+    {
+      tiles[i] = tile;
+    }
+  #else
+    std::fill(tiles, tiles + n, tile);
+  #endif
 }
 
-LOCAL void gen_stretched_hexagon(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, int water_or_land, int distortion) // generates a stretched out hexagon
+LOCAL inline void mapFillSpan(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, int y, int x0, int x1, GeneratorTileTypes type)
 {
-  // a value of 80 is a good distortion value
-  // variables for a stretched hexagon
+  // spans wrap around like the donut
+  uint n = static_cast<uint>(std::min(x1 - x0, static_cast<int>(mapWidth)));
+  uint x = static_cast<uint>(((x0 % static_cast<int>(mapWidth )) + static_cast<int>(mapWidth )) % static_cast<int>(mapWidth ));
+  y      =                  ((y  % static_cast<int>(mapHeight)) + static_cast<int>(mapHeight)) % static_cast<int>(mapHeight);
 
-  uint dstrt = 100 - distortion;
-  if (dstrt < 1)
+  GeneratorTile *row = &generatorMap[static_cast<size_t>(y) * mapWidth];
+  if ((x + n) <= mapWidth)
   {
-    dstrt = 0;
+    mapFillTiles(&row[x], n, type);
   }
-
-  // 1 = land     0 = water
-  GeneratorTileTypes pixel = W1;
-  GeneratorTileTypes not_pixel = L1;
-
-  if (water_or_land == 1)
+  else
   {
-    pixel = L1;
-    not_pixel = W1;
+    mapFillTiles(&row[x], mapWidth - x, type);
+    mapFillTiles(&row[0], (x + n) - mapWidth, type);
   }
+}
 
-  uint x_min;
-  uint x_max;
-  uint y_min;
-  uint y_max;
-
-  uint max_line_size;
-
-  uint rigidity = 2; // determines how squarish a map will be (0 = always slanted, huge values mean extreme squareness, e.g. 500 = square-like continents)
-
-  // skew will determine how far left or right a continent border will slant (between 0 - 12 | 0 is left/down, 12 = right/up, 6 is equal slant)
-//  int skew1;
-//  int skew2;
-  uint skew3;
-  uint skew4;
-
-  uint u_len_line; // upper edges
-  uint u_border_y;
-  uint u_border_x;
-
-  uint l_len_line; // lower edges
-  uint l_border_y;
-  uint l_border_x;
-
-  uint f_line_found;
-
-  uint left_u_tri_skew; // upper triangle skew
-  uint right_u_tri_skew;
-
-  uint left_l_tri_skew; // lower triangle skew
-  uint right_l_tri_skew;
-
-  uint y_len = 0; // an alternative if the lower triangle overflows
-
-//  skew1 = (rand() % 13);
-//  skew2 = (rand() % 13);
-  skew3 = (rand() % 13);
-  skew4 = (rand() % 13);
-
-  //These do whiles set up the bounds of the continents
-
-  y_max = (BORDER_Y) + (rand() % (mapHeight - (2 * BORDER_Y) - 30)) + 1 ;  //The 30 is a buffer
-  do
-  {
-    y_min = (BORDER_Y) + (rand() % (mapHeight - (2 * BORDER_Y))) ;
-  }
-  while (y_min > y_max);
+LOCAL std::vector<float> gen_radius_offsets(uint count, float step)
+{
+  // random walk of the radius, closed so the outline has no seam
+  std::vector<float> offsets(count);
 
-  if ((y_min - BORDER_Y) > ((mapHeight - y_max) - BORDER_Y))
+  float offset = 0.0f;
+  for (uint i = 0; i < count; i++)
   {
-    max_line_size = (mapHeight - y_max) - BORDER_Y;
+    offsets[i] = offset;
+    offset += static_cast<float>((generatorRandom() % 3) - 1) * step;
   }
-  else
+  for (uint i = 0; i < count; i++)
   {
-    max_line_size = (y_min - BORDER_Y);
+    offsets[i] -= (offset * i) / count;
   }
 
-  do
-  {
-    x_max = (BORDER_X) + (rand() % (mapWidth - (2 * BORDER_X))) + 1 ;    // random location between borders (plus 1, so smallest width is xmin=0 and xmax=1)
-  }
-  while ((x_max > mapWidth));
+  return offsets;
+}
 
-  do
-  {
-    x_min = ((BORDER_X)) + (rand() % (mapWidth - (2 * BORDER_X)));
-  }
-  while (x_min > x_max || ((x_max - x_min)/*length*/  > max_line_size));
+LOCAL void gen_distorted_circle(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, float c_center_x, float c_center_y, float radius, float bumpiness, GeneratorTileTypes type)
+{
+  // one outline point every CIRCLE_POINT_DISTANCE pixels of the circumference
+  uint count = std::max(8U, static_cast<uint>((2.0f * static_cast<float>(M_PI) * radius) / CIRCLE_POINT_DISTANCE));
+
+  Rasterizer::distortedCircle(c_center_x,
+                              c_center_y,
+                              radius,
+                              gen_radius_offsets(count, bumpiness),
+                              [&](int y, int x0, int x1)
+                              {
+                                mapFillSpan(generatorMap,mapWidth,mapHeight,y,x0,x1,type);
+                              }
+                             );
+}
 
-  // These blocks of code remove a rectangular shape with triangles on top and bottom, out of the map
-  u_border_y = y_min;
-  u_border_x = x_min;
-  u_len_line = x_max - x_min;
+LOCAL inline bool mapIs(const GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, uint x, uint y, GeneratorTileTypes type)
+{
+  assert(x < mapWidth);
+  assert(y < mapHeight);
 
-  f_line_found = 0;
+  return mapGet(generatorMap,mapWidth,mapHeight,x,y).type == type;
+}
 
-  for (uint y = 0; y < mapHeight; y++)
+LOCAL void mapGetLandMask(const GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, GeneratorTileTypes type, LandMask &landMask)
+{
+  landMask.resize(mapWidth, mapHeight);
+  parallelFor(0, mapHeight, 64, [&](uint y0, uint y1)
   {
-    for (uint x = 0; x < mapWidth; x++)
+    for (uint y = y0; y < y1; y++)
     {
-      if (x >= x_min && x <= x_max && y >= y_min && y <= y_max)
-      {
-        mapSetType(generatorMap,mapWidth,mapHeight,x,y,pixel); //W creates Water, L1 creates Land
-        f_line_found = 1;
-
-        if (rand() % dstrt == 1) //1 in (distortion_val) chance of a line length change
-        {
-          x_min = x_min + (rand() % 3 - 1);
-          x_max = x_max + (rand() % 3 - 1);
-        }
-      }
-      else
+      const GeneratorTile *row = &generatorMap[static_cast<size_t>(y) * mapWidth];
+      for (uint x = 0; x < mapWidth; x++)
       {
-        if (!mapIs(generatorMap,mapWidth,mapHeight,x,y,not_pixel))
+        if (row[x].type == type)
         {
-          mapSetType(generatorMap,mapWidth,mapHeight,x,y,pixel);
+          landMask.set(x,y,true);
         }
       }
     }
+  });
+  counters.tileReads += static_cast<uint64_t>(mapWidth) * mapHeight;
+}
 
-    if (f_line_found == 1 && (rand() % dstrt) == 1)
+LOCAL void mapSetLandMask(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const LandMask &landMask, GeneratorTileTypes landType, GeneratorTileTypes waterType)
+{
+  // only changed tiles are written, so other water types are kept
+  std::atomic<uint64_t> tileWrites(0);
+  parallelFor(0, mapHeight, 64, [&](uint y0, uint y1)
+  {
+    uint64_t n = 0;
+    for (uint y = y0; y < y1; y++)
     {
-      do
-      {
-        x_min = x_min + (rand() % 3 - 1);
-
-        if (x_min < BORDER_X)
-        {
-          x_min = BORDER_X + 2;
-        }
-        else if (x_min > (mapWidth - BORDER_X))
-        {
-          x_min = mapWidth - BORDER_X - 2;
-        }
-      }
-      while (x_min < BORDER_X || x_min > (mapWidth - BORDER_X));
-
-      do
+      GeneratorTile *row = &generatorMap[static_cast<size_t>(y) * mapWidth];
+      for (uint x = 0; x < mapWidth; x++)
       {
-        x_max = x_max + (rand() % 3 - 1);
-
-        if (x_max < BORDER_X)
-        {
-          x_max = BORDER_X + 2;
-        }
-        else if (x_max > (mapWidth - BORDER_X))
+        bool land = landMask.get(x,y);
+        if (land != (row[x].type == landType))
         {
-          x_max = mapWidth - BORDER_X - 2;
+          row[x].type = land ? landType : waterType;
+          n++;
         }
       }
-      while (x_max < BORDER_X || x_max > (mapWidth - BORDER_X));
-    }
-
-    if (y == y_max)
-    {
-      l_border_y = y_max;
-      l_border_x = x_min;
-      l_len_line = x_max - x_min;
     }
+    tileWrites += n;
+  });
+  counters.tileReads  += static_cast<uint64_t>(mapWidth) * mapHeight;
+  counters.tileWrites += tileWrites.load();
+}
 
-  }
-
-  // this block adds a triangular shape to the top border
+LOCAL void mapGetCoastDistances(const GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, std::vector<float> &coastDistances)
+{
+  LandMask land;
+  mapGetLandMask(generatorMap,mapWidth,mapHeight,L1,land);
+  DistanceField::compute(land, coastDistances);
+}
 
-  left_u_tri_skew = 1;
-  right_u_tri_skew = 1;
+LOCAL inline bool mapIsCoast(const GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const std::vector<float> &coastDistances, uint x, uint y)
+{
+  // land tile with water above, below, left or right; may be changed
+  // since the distances were computed
+  return    (coastDistances[(y*mapWidth)+x] == 1.0f)
+         && mapIs(generatorMap,mapWidth,mapHeight,x,y,L1);
+}
 
-  x_min = u_border_x ;
-  x_max = u_border_x + u_len_line;
-  y_min = u_border_y - u_len_line;
-  y_max = u_border_y;
+LOCAL void gen_stretched_hexagon(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, int water_or_land, int distortion) // generates a stretched out hexagon
+{
+  // a value of 80 is a good distortion value
+  // variables for a stretched hexagon
 
-  for (uint y = y_max; y > y_min; y--)
+  uint dstrt = 100 - distortion;
+  if (dstrt < 1)
   {
-    if (y > y_min)
-    {
-      x_min -= -1 * (left_u_tri_skew)  ;
-      x_max -= (right_u_tri_skew)  ;
-
-      if (((rand() % dstrt) == 1))
-      {
-        do
-        {
-          x_min = x_min + (rand() % 3 - 1);
-
-          if (x_min < BORDER_X)
-          {
-            x_min = BORDER_X + 2;
-          }
-          else if (x_min > (mapWidth - BORDER_X))
-          {
-            x_min = mapWidth - BORDER_X - 2;
-          }
-        }
-        while (x_min < BORDER_X || x_min > (mapWidth - BORDER_X));
-
-        do
-        {
-          x_max = x_max + (rand() % 3 - 1);
-
-          if (x_max < BORDER_X)
-          {
-            x_max = BORDER_X + 2;
-          }
-          else if (x_max > (mapWidth - BORDER_X))
-          {
-            x_max = mapWidth - BORDER_X - 2;
-          }
-        }
-        while (x_max < BORDER_X || x_max > (mapWidth - BORDER_X));
-      }
-    }
-
-    for (uint x = 0; x < mapWidth; x++)
-    {
-      if (x >= x_min && x <= x_max && y >= y_min && y <= y_max)
-      {
-        mapSetType(generatorMap,mapWidth,mapHeight,x,y,pixel); //W creates Water, L1 creates Land
-
-        if (rand() % dstrt == 1) //1 in (distortion_val) chance of a line length change
-        {
-          x_min = x_min + (rand() % 3 - 1);
-          x_max = x_max + (rand() % 3 - 1);
-        }
-      }
-      else
-      {
-        if (!mapIs(generatorMap,mapWidth,mapHeight,x,y,not_pixel))
-        {
-          mapSetType(generatorMap,mapWidth,mapHeight,x,y,pixel);
-        }
-      }
-    }
+    dstrt = 1;
   }
 
-  // this block adds a triangular shape to the lower border
-
-  left_l_tri_skew = 1;
-  right_l_tri_skew = 1;
-
-  x_min = l_border_x ;
-  x_max = l_border_x + l_len_line;
-  y_min = l_border_y;
-  y_max = l_border_y + l_len_line;
+  // 1 = land     0 = water
+  GeneratorTileTypes pixel = W1;
 
-  for (uint y = y_min; y < y_max; y++)
+  if (water_or_land == 1)
   {
-    if (y < y_max)
-    {
-      x_min -= - (left_l_tri_skew)   ;
-      x_max -= (right_l_tri_skew)  ;
-
-      if (((rand() % (rigidity + 1)) == 0))
-      {
-        do
-        {
-          x_min = x_min + (skewed_neg_pos_gen(skew3));
-
-          if (x_min < BORDER_X)
-          {
-            x_min = BORDER_X + 2;
-          }
-          else if (x_min > (mapWidth - BORDER_X))
-          {
-            x_min = mapWidth - BORDER_X - 2;
-          }
-        }
-        while (x_min < BORDER_X || x_min > (mapWidth - BORDER_X));
-
-        do
-        {
-          x_max = x_max + (skewed_neg_pos_gen(skew4));
-
-          if (x_max < BORDER_X)
-          {
-            x_max = BORDER_X + 2;
-          }
-          else if (x_max > (mapWidth - BORDER_X))
-          {
-            x_max = mapWidth - BORDER_X - 2;
-          }
-        }
-        while (x_max < BORDER_X || x_max > (mapWidth - BORDER_X));
-      }
-    }
+    pixel = L1;
+  }
 
-    for (uint x = 0; x < mapWidth; x++)
-    {
-      if (x >= x_min && x <= x_max && y >= y_min && y <= y_max)
-      {
-        mapSetType(generatorMap,mapWidth,mapHeight,x,y,W1); //W creates Water, L1 creates Land
+  uint x_min;
+  uint x_max;
+  uint y_min;
+  uint y_max;
 
-        if (rand() % dstrt == 1) //1 in (distortion_val) chance of a line length change
-        {
-          x_min = x_min + (rand() % 3 - 1);
-          x_max = x_max + (rand() % 3 - 1);
-        }
-      }
-      else
-      {
-        if (mapIs(generatorMap,mapWidth,mapHeight,x,y,not_pixel))
-        {
-          mapSetType(generatorMap,mapWidth,mapHeight,x,y,pixel);
-        }
-      }
-    }
+  uint max_line_size;
 
-    //THIS BLOCK HERE prevents stack smashing (an overflow)
-    if (x_max > (mapWidth - BORDER_X))
-    {
-      break;
-    }
+  uint len_line;
 
-    if (x_min > (mapWidth - BORDER_X))
-    {
-      break;
-    }
+  //These set up the bounds of the continents: a rectangle with triangles on top and bottom, the triangles have to fit into the map
 
-    if (x_max < (BORDER_X))
-    {
-      break;
-    }
+  y_max = (BORDER_Y) + randomBelow(static_cast<int>(mapHeight - (2 * BORDER_Y)) - static_cast<int>(mapScale(30, mapHeight))) + 1 ;  //The 30 is a buffer
+  y_min = (BORDER_Y) + (generatorRandom() % (y_max - BORDER_Y + 1));
 
-    if (x_min < (BORDER_X))
-    {
-      break;
-    }
+  if ((y_min - BORDER_Y) > ((mapHeight - y_max) - BORDER_Y))
+  {
+    max_line_size = (mapHeight - y_max) - BORDER_Y;
+  }
+  else
+  {
+    max_line_size = (y_min - BORDER_Y);
+  }
 
-    //The bottoms of the continents have a propensity to overflow
-    if (y_max > (mapHeight - BORDER_Y))
-    {
-      //This block adds bumpiness to the bottom of the rectangle in the case of an overflow
-      for (uint x = l_border_x; x <= l_border_x + l_len_line; x++)
-      {
-        y_len += (neg_pos_gen());
+  x_max = (BORDER_X) + (generatorRandom() % (mapWidth - (2 * BORDER_X))) + 1 ;    // random location between borders (plus 1, so smallest width is xmin=0 and xmax=1)
 
-        if (y_len < 1)
-        {
-          y_len = 2;
-        }
-        else if (y_len + l_border_y > (mapHeight - BORDER_Y - 30))
-        {
-          y_len = 1 + neg_pos_gen();
-        }
+  uint x_min_lower = ((x_max - BORDER_X) > max_line_size) ? x_max - max_line_size : BORDER_X;
+  uint x_min_upper = std::min(x_max, mapWidth - BORDER_X - 1);
+  x_min_lower = std::min(x_min_lower, x_min_upper);
+  x_min = x_min_lower + (generatorRandom() % (x_min_upper - x_min_lower + 1));
 
-        for (uint y = l_border_y; y < (l_border_y + y_len); y++)
-        {
-          mapSetType(generatorMap,mapWidth,mapHeight,x,y,pixel);
-        }
-      }
+  len_line = x_max - x_min;
 
-      break;
-    }
-
-    if (y_min > (mapHeight - BORDER_Y))
+  // the left and right border lines wander: 1 in (distortion_val) chance of a line length change per line
+  std::vector<int> left_offsets, right_offsets;
+  int              left_offset  = 0;
+  int              right_offset = 0;
+  for (uint y = y_min; y <= y_max; y++)
+  {
+    if ((generatorRandom() % dstrt) == 1)
     {
-      break;
+      left_offset  += (generatorRandom() % 3 - 1);
+      right_offset += (generatorRandom() % 3 - 1);
     }
+    left_offsets.push_back(left_offset);
+    right_offsets.push_back(right_offset);
+  }
 
-    if (y_max < (BORDER_Y))
-    {
-      break;
-    }
+  // hexagon outline: top apex, right border, bottom apex, left border
+  std::vector<Rasterizer::Point> points;
+  float center_x = x_min + (len_line + 1) / 2.0f;
 
-    if (y_min < (BORDER_Y))
-    {
-      break;
-    }
+  points.push_back(Rasterizer::Point(center_x, y_min - (len_line / 2.0f)));
+  for (uint y = y_min; y <= y_max; y += HEXAGON_SIDE_STEP)
+  {
+    points.push_back(Rasterizer::Point(x_max + 1 + right_offsets[y - y_min], y));
   }
+  points.push_back(Rasterizer::Point(x_max + 1 + right_offsets[y_max - y_min], y_max + 1));
+  points.push_back(Rasterizer::Point(center_x, y_max + 1 + (len_line / 2.0f)));
+  points.push_back(Rasterizer::Point(x_min + left_offsets[y_max - y_min], y_max + 1));
+  for (uint y = y_max - ((y_max - y_min) % HEXAGON_SIDE_STEP); y >= y_min + HEXAGON_SIDE_STEP; y -= HEXAGON_SIDE_STEP)
+  {
+    points.push_back(Rasterizer::Point(x_min + left_offsets[y - y_min], y));
+  }
+  points.push_back(Rasterizer::Point(x_min + left_offsets[0], y_min));
+
+  Rasterizer::polygon(points,
+                      [&](int y, int x0, int x1)
+                      {
+                        mapFillSpan(generatorMap,mapWidth,mapHeight,y,x0,x1,pixel);
+                      }
+                     );
 }
 
 LOCAL void gen_circle(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, int water_or_land, int max_size, int distortion, int hard_code_distortion, int render_direction)
 {
   // variables for circle
   uint x_min;
-  uint x_max;
   uint y_min;
-  uint y_max;
 
-  uint c_center_y;
-  uint c_center_x;
-  uint c_sqrd;
+  float c_center_y;
+  float c_center_x;
 
   uint c_size;
 
-  uint c_increase;
-  uint c_x_pos;
-  uint c_y_pos;
-
-  GeneratorTileTypes terrain_type;// sets the terrain
+  GeneratorTileTypes terrain_type = W1;// sets the terrain
 
   if (water_or_land == 1)
   {
@@ -538,477 +501,135 @@ LOCAL void gen_circle(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight
   }
 
   // this block ADDS a left to right circle to somewhere on the map
-  c_size = (rand() % max_size);//300ish is good for continents
+  c_size = randomBelow(max_size);//300ish is good for continents at REFERENCE_MAP_SIZE
   // c_size/2 = radius
 
 
-  x_min = ((rand() % (mapWidth - (2 * BORDER_X) - c_size - 100)) + BORDER_X) + 50 ;   // there is a buffer of 50 on both sides
-  x_max = x_min + c_size;
-  y_min = ((rand() % (mapHeight - (2 * BORDER_Y) - c_size - 100)) + BORDER_Y) + 50;
-  y_max = y_min + c_size;
+  x_min = (randomBelow(static_cast<int>(mapWidth  - (2 * BORDER_X)) - static_cast<int>(c_size + mapScale(100, mapWidth ))) + BORDER_X) + mapScale(50, mapWidth ) ;   // there is a buffer of 50 on both sides
+  y_min = (randomBelow(static_cast<int>(mapHeight - (2 * BORDER_Y)) - static_cast<int>(c_size + mapScale(100, mapHeight))) + BORDER_Y) + mapScale(50, mapHeight);
 
   if (hard_code_distortion == 0)
   {
-    distortion = (rand() % (((distortion / 5) * 4) + 1)) + (distortion / 5); // random value in distortion
+    distortion = (generatorRandom() % (((distortion / 5) * 4) + 1)) + (distortion / 5); // random value in distortion
   }
 
-  c_x_pos = x_min;
-  c_y_pos = y_min;
-
   // calculates the point in the middle of circle
-  c_center_y = y_min + (y_max - y_min) / 2 ;
-  c_center_x = x_min + (x_max - x_min) / 2 ;
+  c_center_x = x_min + c_size / 2.0f;
+  c_center_y = y_min + c_size / 2.0f;
 
-  c_sqrd = (c_size / 2) * (c_size / 2); // radius squared
+  // the border "bumpiness" grows with smaller distortion values
+  float bumpiness = sqrtf(100.0f / std::max(distortion, 1));
 
-  for (uint y = 0; y < mapHeight; y++)
-  {
-    for (uint x = 0; x < mapWidth; x++)
-    {
-      // a simple pythagorean formula is used to calculate bounds of circle
-      if (x > x_min && x < x_max && y > y_min && y < y_max)
-      {
-        if ((x - c_center_x) * (x - c_center_x) + (y - c_center_y) * (y - c_center_y) <= c_sqrd)
-        {
-          mapSetType(generatorMap,mapWidth,mapHeight,x,y,terrain_type);
-
-          if (rand() % distortion == 1) //1 in (bumpiness_value) chance of a line length change
-          {
-            // if(x_min < (mapWidth - BORDER_X - c_size) && x_min > BORDER_X && x_max < (mapWidth - BORDER_X) && x_max > (BORDER_X + 1) ){
-            c_increase = (rand() % 3 - 1);
-            c_center_x = c_center_x + c_increase;
-            x_min += (rand() % 3 - 1);
-            x_max +=  c_increase;
-
-            //}
-            // else{
-            if (x_min < BORDER_X || x_max < (BORDER_X + 1))
-            {
-              c_center_x++;
-              x_min++;
-              x_max++;
-            }
-            else if (x_min > (mapWidth - BORDER_X - c_size) || x_max > (mapWidth - BORDER_X))
-            {
-              c_center_x--;
-              x_min--;
-              x_max--;
-            }
-
-            //}
-          }
-        }
-        else
-        {
-          if (!mapIs(generatorMap,mapWidth,mapHeight,x,y,L1))
-          {
-            mapSetType(generatorMap,mapWidth,mapHeight,x,y,W1);
-          }
-        }
-      }
-    }
-  }
+  gen_distorted_circle(generatorMap, mapWidth, mapHeight, c_center_x, c_center_y, c_size / 2.0f, bumpiness, terrain_type);
 
   // this block ADDS an up to down circle ontop of the previous circle, which "bumpifies" the rounded edges
-  // c_size/2 is radius
-
   if (render_direction == 2)
   {
-    x_min = c_x_pos;
-    x_max = x_min + c_size;
-    y_min = c_y_pos;
-    y_max = y_min + c_size;
-
     if (hard_code_distortion == 0)
     {
-      distortion = (rand() % (((distortion / 5) * 4) + 1)) + (distortion / 5);
+      distortion = (generatorRandom() % (((distortion / 5) * 4) + 1)) + (distortion / 5);
+      bumpiness  = sqrtf(100.0f / std::max(distortion, 1));
     }
 
-    // calculates the point in the middle of circle
-    c_center_y = y_min + (y_max - y_min) / 2 ;
-    c_center_x = x_min + (x_max - x_min) / 2 ;
-
-    c_sqrd = (c_size / 2) * (c_size / 2); // radius squared
-
-    for (uint x = 0; x < mapWidth; x++)
-    {
-      for (uint y = 0; y < mapHeight; y++)
-      {
-        // a simple pythagorean formula is used to calculate bounds of circle
-        if (x > x_min && x < x_max && y > y_min && y < y_max)
-        {
-          if ((x - c_center_x) * (x - c_center_x) + (y - c_center_y) * (y - c_center_y) <= c_sqrd)
-          {
-            mapSetType(generatorMap,mapWidth,mapHeight,x,y,terrain_type);
-
-            if (rand() % distortion == 1) //1 in (bumpiness_value) chance of a line length change
-            {
-              // if(y_min < (mapHeight - BORDER_Y - c_size) && y_min > BORDER_Y && y_max < (mapHeight - BORDER_Y) && y_max > (BORDER_Y + 1)){
-              c_increase = (rand() % 3 - 1);
-              c_center_y = c_center_y + c_increase;
-              y_min += (rand() % 3 - 1);
-              y_max +=  c_increase;
-              //}
-
-              // else{
-              if (y_min < BORDER_Y || y_max < (BORDER_Y + 1))
-              {
-                c_center_y++;
-                y_min++;
-                y_max++;
-              }
-              else if (y_min > (mapHeight - BORDER_Y - c_size) || y_max > (mapHeight - BORDER_Y))
-              {
-                c_center_y--;
-                y_min--;
-                y_max--;
-              }
-
-              //}
-            }
-          }
-          else
-          {
-            if (!mapIs(generatorMap,mapWidth,mapHeight,x,y,L1))
-            {
-              mapSetType(generatorMap,mapWidth,mapHeight,x,y,W1);
-            }
-          }
-        }
-      }
-    }
+    gen_distorted_circle(generatorMap, mapWidth, mapHeight, c_center_x, c_center_y, c_size / 2.0f, bumpiness, terrain_type);
   }
 }
 
 LOCAL void gen_ocean_split(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight)
 {
-  //This function adds a max 150 pixel wide ocean that spits the pieces of land, it runs from BORDER_Y to mapHeight
-  //These do whiles set up the bounds of the ocean split
-
-  uint ocean_angle = (rand() % 7) - 3; // angle between -3 and 3
-
-  uint x_min;
-  uint x_max;
-  uint y_min;
-  uint y_max;
-
-  y_max = mapHeight - BORDER_Y;
-  y_min = BORDER_Y;
-
-  x_min = (rand() % (mapWidth - (2 * BORDER_X) - 300)) + (BORDER_X + 100) ; // random location with a buffer of 100 on left, and 200 on right
-
-  x_max = x_min + (rand() % 100) + 50;
-  // random location between borders with a min of 50 and max of 150
-
-  for (uint y = 0; y < mapHeight; y++)
-  {
-    for (uint x = 0; x < mapWidth; x++)
-    {
-      if (x >= x_min && x <= x_max && y >= y_min && y <= y_max)
-      {
-        mapSetType(generatorMap,mapWidth,mapHeight,x,y,W1); //W creates Water, L1 creates Land
-
-        if (rand() % 5 == 1) //1 in 5 chance of a line length change
-        {
-          x_min = x_min + (rand() % 3 - 1);
-          x_max = x_max + (rand() % 3 - 1);
-        }
-
-        if (x_max > (mapWidth - BORDER_X))
-        {
-          x_max--;
-          x_min--;
-          ocean_angle *= -1;
-        }
-
-        if (x_min < (BORDER_X))
-        {
-          x_max++;
-          x_min++;
-          ocean_angle *= -1;
-        }
-      }
-    }
-
-    x_min = x_min + ocean_angle;
-    x_max = x_max + ocean_angle;
-
-    if (rand() % 10 == 1)
-    {
-      ocean_angle = (rand() % 7) - 3;  //1 in 20 chance of a whole line angle change // angle between -3 and 3
-    }
-  }
-}
-
-LOCAL void gen_ocean_errosion(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight)
-{
-  //This function adds chunks of ocean flowing into the mainlands from left to right
-  // it uses a modified version of the gen_circle algo, slightly optimized for faster runtime
-  uint x_min;
-  uint x_max;
-  uint y_min;
-  uint y_max;
-
-  uint distortion;
-
-  uint c_center_y;
-  uint c_center_x;
-  uint c_sqrd;
-
-  uint c_size;
-
-  uint c_increase;
-  uint c_x_pos;
-  uint c_y_pos;
-
-  for (uint y = 1; y < (mapHeight - BORDER_Y - 10) ; y++)
-  {
-    for (uint x = 1; x < (mapWidth - BORDER_X - 10) ; x++)
-    {
-      if (mapIs(generatorMap,mapWidth,mapHeight,x,y,L1) && mapIs(generatorMap,mapWidth,mapHeight,x-1,y,W1))
-      {
-        if (rand() % 30 == 1) //1 in 20 chance of a circle of water spawned into the border
-        {
-          // this inner block REMOVES a left to right circle to the border on the map
-          c_size = (rand() % 15) + 5; // size between 5 and 10
+  //This function adds a max 150 pixel wide ocean (at REFERENCE_MAP_SIZE) that spits the pieces of land, it runs from BORDER_Y to mapHeight
+  //These set up the bounds of the ocean split
 
-          // c_size/2 = radius
-          c_x_pos = x - c_size / 2;
-          c_y_pos = y - c_size / 2;
+  int ocean_angle = (generatorRandom() % 7) - 3; // angle between -3 and 3
 
-          x_min = c_x_pos;
-          x_max = x_min + c_size;
-          y_min = c_y_pos;
-          y_max = y_min + c_size;
-
-          distortion = 3;
-
-          // calculates the point in the middle of circle
-          c_center_y = y_min + (y_max - y_min) / 2 ;
-          c_center_x = x_min + (x_max - x_min) / 2 ;
-
-          c_sqrd = (c_size / 2) * (c_size / 2); // radius squared
-
-          for (uint y = y_min; y < y_max; y++)
-          {
-            for (uint x = 0; x < (mapWidth - BORDER_X - 10); x++)
-            {
-              // a simple pythagorean formula is used to calculate bounds of circle
-              if (x > x_min && x < x_max && y > y_min && y < y_max)
-              {
-                if ((x - c_center_x) * (x - c_center_x) + (y - c_center_y) * (y - c_center_y) <= c_sqrd)
-                {
-                  mapSetType(generatorMap,mapWidth,mapHeight,x,y,W1);
-
-                  if (rand() % distortion == 1) //1 in (bumpiness_value) chance of a line length change
-                  {
-                    c_increase = (rand() % 3 - 1);
-                    c_center_x = c_center_x + c_increase;
-                    x_min += (rand() % 3 - 1);
-                    x_max +=  c_increase;
-
-                    if (x_min < BORDER_X || x_max < (BORDER_X + 1))
-                    {
-                      c_center_x++;
-                      x_min++;
-                      x_max++;
-                    }
-                    else if (x_min > (mapWidth - BORDER_X - c_size) || x_max > (mapWidth - BORDER_X))
-                    {
-                      c_center_x--;
-                      x_min--;
-                      x_max--;
-                    }
-                  }
-                }
-              }
-            }
-          }
-
-          // this block ADDS an up to down circle ontop of the previous circle, which "bumpifies" the rounded edges
-          // c_size/2 is radius
-          x_min = c_x_pos;
-          x_max = x_min + c_size;
-          y_min = c_y_pos;
-          y_max = y_min + c_size;
-
-          distortion = 3;
-
-          // calculates the point in the middle of circle
-          c_center_y = y_min + (y_max - y_min) / 2 ;
-          c_center_x = x_min + (x_max - x_min) / 2 ;
-
-          c_sqrd = (c_size / 2) * (c_size / 2); // radius squared
-
-          for (uint x = x_min; x < x_max; x++)
-          {
-            for (uint y = 0; y < (mapHeight - BORDER_Y - 10); y++)
-            {
-              // a simple pythagorean formula is used to calculate bounds of circle
-              if (x > x_min && x < x_max && y > y_min && y < y_max)
-              {
-                if ((x - c_center_x) * (x - c_center_x) + (y - c_center_y) * (y - c_center_y) <= c_sqrd)
-                {
-                  mapSetType(generatorMap,mapWidth,mapHeight,x,y,W1);
-
-                  if (rand() % distortion == 1) //1 in (bumpiness_value) chance of a line length change
-                  {
-                    c_increase = (rand() % 3 - 1);
-                    c_center_y = c_center_y + c_increase;
-                    y_min += (rand() % 3 - 1);
-                    y_max +=  c_increase;
-
-                    if (y_min < BORDER_Y || y_max < (BORDER_Y + 1))
-                    {
-                      c_center_y++;
-                      y_min++;
-                      y_max++;
-                    }
-                    else if (y_min > (mapHeight - BORDER_Y - c_size) || y_max > (mapHeight - BORDER_Y))
-                    {
-                      c_center_y--;
-                      y_min--;
-                      y_max--;
-                    }
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-  //This block adds chunks of ocean flowing into the mainlands from RIGHT to Left
-  for (uint y = 1; y < (mapHeight - BORDER_Y - 10) ; y++)
-  {
-    for (uint x = (mapWidth - BORDER_X - 11); x > 0 ; x--)
-    {
-      if (mapIs(generatorMap,mapWidth,mapHeight,x,y,L1) && mapIs(generatorMap,mapWidth,mapHeight,x-1,y,W1))
-      {
-        if (rand() % 30 == 1) //1 in 20 chance of a circle of water spawned into the border
-        {
+  int x_min;
+  int x_max;
+  uint y_min;
+  uint y_max;
 
-          // this inner block REMOVES a left to right circle to the border on the map
+  y_max = mapHeight - BORDER_Y;
+  y_min = BORDER_Y;
 
-          c_size = (rand() % 15) + 5; // size between 5 and 10
+  x_min = randomBelow(static_cast<int>(mapWidth - (2 * BORDER_X)) - static_cast<int>(mapScale(300, mapWidth))) + (BORDER_X + mapScale(100, mapWidth)) ; // random location with a buffer of 100 on left, and 200 on right
 
-          // c_size/2 = radius
-          c_x_pos = x - c_size / 2;
-          c_y_pos = y - c_size / 2;
+  x_max = x_min + randomBelow(mapScale(100, mapWidth)) + mapScale(50, mapWidth);
+  // random location between borders with a min of 50 and max of 150
 
-          x_min = c_x_pos;
-          x_max = x_min + c_size;
-          y_min = c_y_pos;
-          y_max = y_min + c_size;
+  for (uint y = y_min; y <= y_max; y++)
+  {
+    mapFillSpan(generatorMap,mapWidth,mapHeight,y,x_min,x_max + 1,W1); //W creates Water, L1 creates Land
 
-          distortion = 3;  // 50% chance of a line change
+    // line length change
+    x_min = x_min + (generatorRandom() % 3 - 1);
+    x_max = std::max(x_min, x_max + (generatorRandom() % 3 - 1));
 
-          // calculates the point in the middle of circle
-          c_center_y = y_min + (y_max - y_min) / 2 ;
-          c_center_x = x_min + (x_max - x_min) / 2 ;
+    if (x_max > static_cast<int>(mapWidth - BORDER_X))
+    {
+      x_max--;
+      x_min--;
+      ocean_angle *= -1;
+    }
 
-          c_sqrd = (c_size / 2) * (c_size / 2); // radius squared
+    if (x_min < static_cast<int>(BORDER_X))
+    {
+      x_max++;
+      x_min++;
+      ocean_angle *= -1;
+    }
 
-          for (uint y = y_min; y < y_max; y++)
-          {
-            for (uint x = 0; x < (mapWidth - BORDER_X - 10); x++)
-            {
-              // a simple pythagorean formula is used to calculate bounds of circle
-              if (x > x_min && x < x_max && y > y_min && y < y_max)
-              {
-                if ((x - c_center_x) * (x - c_center_x) + (y - c_center_y) * (y - c_center_y) <= c_sqrd)
-                {
-                  mapSetType(generatorMap,mapWidth,mapHeight,x,y,W1);
-
-                  if (rand() % distortion == 1) //1 in (bumpiness_value) chance of a line length change
-                  {
-                    c_increase = (rand() % 3 - 1);
-                    c_center_x = c_center_x + c_increase;
-                    x_min += (rand() % 3 - 1);
-                    x_max +=  c_increase;
-
-                    if (x_min < BORDER_X || x_max < (BORDER_X + 1))
-                    {
-                      c_center_x++;
-                      x_min++;
-                      x_max++;
-                    }
-                    else if (x_min > (mapWidth - BORDER_X - c_size) || x_max > (mapWidth - BORDER_X))
-                    {
-                      c_center_x--;
-                      x_min--;
-                      x_max--;
-                    }
-                  }
-                }
-              }
-            }
-          }
+    x_min = x_min + ocean_angle;
+    x_max = x_max + ocean_angle;
 
-          // this block ADDS an up to down circle ontop of the previous circle, which "bumpifies" the rounded edges
-          // c_size/2 is radius
-          x_min = c_x_pos;
-          x_max = x_min + c_size;
-          y_min = c_y_pos;
-          y_max = y_min + c_size;
+    if (generatorRandom() % 10 == 1)
+    {
+      ocean_angle = (generatorRandom() % 7) - 3;  //1 in 10 chance of a whole line angle change // angle between -3 and 3
+    }
+  }
+}
 
-          distortion = 3;
+LOCAL void gen_erosion_blob(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, uint x, uint y)
+{
+  // this block REMOVES a "bumpified" circle of water at the border on the map
+  uint mapSize = std::min(mapWidth, mapHeight);
+  uint c_size  = randomBelow(mapScale(15, mapSize)) + mapScale(5, mapSize); // size between 5 and 20
 
-          // calculates the point in the middle of circle
-          c_center_y = y_min + (y_max - y_min) / 2 ;
-          c_center_x = x_min + (x_max - x_min) / 2 ;
+  gen_distorted_circle(generatorMap, mapWidth, mapHeight, x, y, c_size / 2.0f, 1.0f, W1);
+}
 
-          c_sqrd = (c_size / 2) * (c_size / 2); // radius squared
+LOCAL void gen_ocean_errosion(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, uint erosion_chance)
+{
+  //This function adds chunks of ocean flowing into the mainlands at the coasts
+  std::vector<float> coastDistances;
+  mapGetCoastDistances(generatorMap,mapWidth,mapHeight,coastDistances);
 
-          for (uint x = x_min; x < x_max; x++)
-          {
-            for (uint y = 0; y < (mapHeight - BORDER_Y - 10); y++)
-            {
-              // a simple pythagorean formula is used to calculate bounds of circle
-              if (x > x_min && x < x_max && y > y_min && y < y_max)
-              {
-                if ((x - c_center_x) * (x - c_center_x) + (y - c_center_y) * (y - c_center_y) <= c_sqrd)
-                {
-                  mapSetType(generatorMap,mapWidth,mapHeight,x,y,W1);
-
-                  if (rand() % distortion == 1) //1 in (bumpiness_value) chance of a line length change
-                  {
-                    c_increase = (rand() % 3 - 1);
-                    c_center_y = c_center_y + c_increase;
-                    y_min += (rand() % 3 - 1);
-                    y_max +=  c_increase;
-
-                    if (y_min < BORDER_Y || y_max < (BORDER_Y + 1))
-                    {
-                      c_center_y++;
-                      y_min++;
-                      y_max++;
-                    }
-                    else if (y_min > (mapHeight - BORDER_Y - c_size) || y_max > (mapHeight - BORDER_Y))
-                    {
-                      c_center_y--;
-                      y_min--;
-                      y_max--;
-                    }
-                  }
-                }
-              }
-            }
-          }
+  uint chance = mapScale(erosion_chance, std::min(mapWidth, mapHeight));
+  for (uint y = 1; y + BORDER_Y + mapScale(10, mapHeight) < mapHeight ; y++)
+  {
+    for (uint x = 1; x + BORDER_X + mapScale(10, mapWidth) < mapWidth ; x++)
+    {
+      if (mapIsCoast(generatorMap,mapWidth,mapHeight,coastDistances,x,y))
+      {
+        if ((generatorRandom() % chance) == 0) //circle of water spawned into the border
+        {
+          gen_erosion_blob(generatorMap, mapWidth, mapHeight, x, y);
         }
       }
     }
   }
 }
 
-LOCAL void gen_rivers(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight)
+LOCAL void gen_coast_smoothing(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, uint closing_radius, uint smoothing_iterations)
 {
-  //Here we spawn in rivers
-
-  //GEOGRAPHICAL BACKGROUND: Rivers should always flow from higher elevation to lower elevation
+  // close narrow water gaps and smooth the coast lines with a cellular automaton
+  LandMask land, closed, smoothed;
+  mapGetLandMask(generatorMap,mapWidth,mapHeight,L1,land);
+  Morphology::close(land, closed, Morphology::StructuringElement::disc(closing_radius));
+  Morphology::smooth(closed, smoothed, smoothing_iterations);
+  mapSetLandMask(generatorMap,mapWidth,mapHeight,smoothed,L1,W1);
+}
 
+LOCAL void gen_river(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, uint x, uint y)
+{
   //"river units" are about 2 to 3 pixels in length, with the size of 2 to 3 varying for aesthetic realism
   // use of W2 below to plump up the river while avoiding mapHeightlision detection - i.e. river route is 1 pixel in length
   //I tried having the a "river unit" at 1 pixel length and it looked choppy and rigid
@@ -1020,101 +641,66 @@ LOCAL void gen_rivers(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight
   uint x_dir, y_dir; // x and y river direction -- i.e. skew values
   // skew between 3 and 9 inclusive, any greater or smaller will create a visually awkward intense skew (the word awkward is spelt so awkwardly)
 
-  //NOTE: our land search iterator still operates pixel by pixel as opposed to through river units
-  for (uint y = 1; y < (mapHeight - BORDER_Y - 10)/* -10 is a buffer */; y++)
+  // here is the river line algorithm
+  r_x0 = r_x = x;
+  r_y0 = r_y = y;
+  r_len = randomBelow(mapScale(64, std::min(mapWidth, mapHeight))) + mapScale(65, std::min(mapWidth, mapHeight)); // length between 64 and 128
+
+  x_dir = (generatorRandom() % 10) + 1; // should be a value between 1 and 11; it's a parameter in the skewed generator
+  y_dir = (generatorRandom() % 10) + 1;
+
+  for (uint p = 0; p < r_len; p++) // iterates and draws a line as series of points
   {
-    for (uint x = 1; x < (mapWidth - BORDER_X - 10); x++)
+    if (mapIs(generatorMap,mapWidth,mapHeight,r_x,r_y,W1))
     {
-      if (mapIs(generatorMap,mapWidth,mapHeight,x,y,L1) && mapIs(generatorMap,mapWidth,mapHeight,x-1,y,W1))
-      {
-        if ((rand() % 8) == 1) // 1 in 10 chance of spawning in river
-        {
-          // here is the river line algorithm
-          r_x0 = r_x = x;
-          r_y0 = r_y = y;
-          r_len = ((rand() % 64) + 65); // length between 1 and 128
+      break;
+    }
+    mapSetType(generatorMap,mapWidth,mapHeight,r_x,r_y,W1);// map[(r_y * mapHeight) + r_x] = W1;
+    // rivers wrap around like the donut
+    uint w2_y = (r_y + mapHeight + ((generatorRandom() % 3) - 1)) % mapHeight;
+    uint w2_x = (r_x + mapWidth  + ((generatorRandom() % 3) - 1)) % mapWidth;
+    mapSetType(generatorMap,mapWidth,mapHeight,w2_x,w2_y,W2);// map[((r_y + ((rand() % 3) - 1)) * mapHeight) + (r_x + ((rand() % 3) - 1)) ] = W2;
 
-          x_dir = (rand() % 10) + 1;
-          y_dir = (rand() % 10) + 1;
+    // map[r_x + ((rand() % 5) - 2 )][r_y + ((rand() % 5) - 2)] = W2;
 
-          for (uint p = 0; p < r_len; p++) // iterates and draws a line as series of points
-          {
-            if (mapIs(generatorMap,mapWidth,mapHeight,r_x,r_y,W1))
-            {
-              break;
-            }
-            mapSetType(generatorMap,mapWidth,mapHeight,r_x,r_y,W1);// map[(r_y * mapHeight) + r_x] = W1;
-            mapSetType(generatorMap,mapWidth,mapHeight,r_x + ((rand() % 3) - 1),r_y + ((rand() % 3) - 1),W2);// map[((r_y + ((rand() % 3) - 1)) * mapHeight) + (r_x + ((rand() % 3) - 1)) ] = W2;
-
-            // map[r_x + ((rand() % 5) - 2 )][r_y + ((rand() % 5) - 2)] = W2;
-
-            do
-            {
-              if ((rand() % 3) != 1)
-              {
-                r_x += skewed_neg_pos_gen(x_dir); // there is 33% of a 0 instead of a skewed -1 or 1
-              }
-
-              if ((rand() % 3) != 1)
-              {
-                r_y += skewed_neg_pos_gen(y_dir);
-              }
-            }
-            while (r_x == r_x0 && r_y == r_y0);
-
-            r_x0 = r_x;
-            r_y0 = r_y;
-          }
-        }
+    do
+    {
+      if ((generatorRandom() % 3) != 1)
+      {
+        r_x = (r_x + mapWidth + skewed_neg_pos_gen(x_dir)) % mapWidth; // there is 33% of a 0 instead of a skewed -1 or 1
+      }
+
+      if ((generatorRandom() % 3) != 1)
+      {
+        r_y = (r_y + mapHeight + skewed_neg_pos_gen(y_dir)) % mapHeight;
       }
     }
+    while (r_x == r_x0 && r_y == r_y0);
+
+    r_x0 = r_x;
+    r_y0 = r_y;
   }
+}
 
-  // same algo as before -- but the spawning of the river is from right to left
+LOCAL void gen_rivers(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, uint river_chance)
+{
+  //Here we spawn in rivers at the coasts
+
+  //GEOGRAPHICAL BACKGROUND: Rivers should always flow from higher elevation to lower elevation
+  std::vector<float> coastDistances;
+  mapGetCoastDistances(generatorMap,mapWidth,mapHeight,coastDistances);
 
-  for (uint y = 1; y < (mapHeight - BORDER_Y - 10)/* -10 is a buffer */; y++)
+  //NOTE: our land search iterator still operates pixel by pixel as opposed to through river units
+  uint chance = mapScale(river_chance, std::min(mapWidth, mapHeight));
+  for (uint y = 1; y + BORDER_Y + mapScale(10, mapHeight) < mapHeight/* 10 is a buffer */; y++)
   {
-    for (uint x = (mapWidth - BORDER_X - 10); x > 0; x--)
+    for (uint x = 1; x + BORDER_X + mapScale(10, mapWidth) < mapWidth; x++)
     {
-      if (mapIs(generatorMap,mapWidth,mapHeight,x,y,L1) && mapIs(generatorMap,mapWidth,mapHeight,x+1,y,W1))
+      if (mapIsCoast(generatorMap,mapWidth,mapHeight,coastDistances,x,y))
       {
-        if ((rand() % 8) == 1) // 1 in 10 chance of spawning in river
+        if ((generatorRandom() % chance) == 0)
         {
-          // here is the river line algorithm
-          r_x0 = r_x = x;
-          r_y0 = r_y = y;
-          r_len = ((rand() % 64) + 65); // length between 64 and 128
-
-          x_dir = (rand() % 10) + 1; // should be a value between 1 and 11; it's a parameter in the skewed generator
-          y_dir = (rand() % 10) + 1;
-
-          for (uint p = 0; p < r_len; p++) // iterates and draws a line as series of points
-          {
-            if (mapIs(generatorMap,mapWidth,mapHeight,r_x,r_y,W1))
-            {
-              break;
-            }
-            mapSetType(generatorMap,mapWidth,mapHeight,r_x,r_y,W1);//(r_y * mapHeight) + r_x] = W1;
-            mapSetType(generatorMap,mapWidth,mapHeight,r_x + ((rand() % 3) - 1),r_y + ((rand() % 3) - 1),W2);// map[((r_y + ((rand() % 3) - 1)) * mapHeight) + (r_x + ((rand() % 3) - 1)) ] = W2;     // see the river units note at top
-            // map[r_x + ((rand() % 5) - 2 )][r_y + ((rand() % 5) - 2)] = W2;
-
-            do
-            {
-              if ((rand() % 3) != 1)
-              {
-                r_x += skewed_neg_pos_gen(x_dir); // there is 33% of a 0 instead of a skewed -1 or 1
-              }
-
-              if ((rand() % 3) != 1)
-              {
-                r_y += skewed_neg_pos_gen(y_dir);
-              }
-            }
-            while (r_x == r_x0 && r_y == r_y0);
-
-            r_x0 = r_x;
-            r_y0 = r_y;
-          }
+          gen_river(generatorMap, mapWidth, mapHeight, x, y);
         }
       }
     }
@@ -1126,83 +712,74 @@ LOCAL int gen_biomes(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight)
   // this function adds in a rough estimate of climated base on latitude
 
   //Here we add base layer of land -- in this case P = Polar/Snow or Ice, ontop of the light blue render acting as an outline
+  //Land tiles with land above, right, below and left are interior tiles: erode land with a cross
+  LandMask land, interior;
+  mapGetLandMask(generatorMap,mapWidth,mapHeight,L1,land);
+  Morphology::erode(land, interior, Morphology::StructuringElement::cross(1));
   for (uint y = 0; y < mapHeight; y++)
   {
     for (uint x = 0; x < mapWidth; x++)
     {
-      if (mapIs(generatorMap,mapWidth,mapHeight,x,y,L1))
+      if (interior.get(x,y))
       {
-        mapSetType(generatorMap,mapWidth,mapHeight,x,y,L1);
-
-        if (mapIs(generatorMap,mapWidth,mapHeight,x,y-1,L1) || mapIs(generatorMap,mapWidth,mapHeight,x,y-1,P)) // check above
-        {
-          if (mapIs(generatorMap,mapWidth,mapHeight,x+1,y,L1) || mapIs(generatorMap,mapWidth,mapHeight,x+1,y,P)) // check right
-          {
-            if (mapIs(generatorMap,mapWidth,mapHeight,x,y-1,L1) || mapIs(generatorMap,mapWidth,mapHeight,x,y-1,P)) // check below
-            {
-              if (mapIs(generatorMap,mapWidth,mapHeight,x-1,y,L1) || mapIs(generatorMap,mapWidth,mapHeight,x-1,y,P)) // check left
-              {
-                mapSetType(generatorMap,mapWidth,mapHeight,x,y,P);
-              }
-            }
-          }
-        }
+        mapSetType(generatorMap,mapWidth,mapHeight,x,y,P);
       }
     }
   }
 
-  uint biome_val = 0;
+  float biome_val = 0;
 //  int add_val = (mapHeight / 2) / 500;
   uint equator = (mapHeight / 2);
 
-  uint south_ice_cap = 0; // default is 0
-  uint north_ice_cap = 0; // default is 0
+  // biome gradient: same biomes from pole to equator for any map height
+  float biome_step = (3.0f * REFERENCE_MAP_SIZE) / mapHeight;
+  int   ice_cap    = static_cast<int>(mapScale(75, mapHeight));
+
+  int south_ice_cap = 0; // default is 0
+  int north_ice_cap = 0; // default is 0
 
   for (uint x = 1; x < mapWidth; x++)
   {
-    if ((rand() % 7) == 0)
+    if ((generatorRandom() % 7) == 0)
     {
-      south_ice_cap += (rand() % 3) - 1;
+      south_ice_cap += (generatorRandom() % 3) - 1;
     }
 
-    if ((rand() % 7) == 0)
+    if ((generatorRandom() % 7) == 0)
     {
-      north_ice_cap += (rand() % 3) - 1;
+      north_ice_cap += (generatorRandom() % 3) - 1;
     }
 
-    if ((rand() % 7) == 0)
+    if ((generatorRandom() % 7) == 0)
     {
-      equator += (rand() % 3) - 1;
+      equator += (generatorRandom() % 3) - 1;
     }
 
     biome_val = 0;
 
-    for (uint y = (75 + north_ice_cap); y < mapHeight - (75 + south_ice_cap); y++)
+    // ice caps wander, but stay on the map
+    uint y_min = static_cast<uint>(std::max(ice_cap + north_ice_cap, 0));
+    uint y_max = static_cast<uint>(std::max(std::min(static_cast<int>(mapHeight) - (ice_cap + south_ice_cap), static_cast<int>(mapHeight)), 0));
+    for (uint y = y_min; y < y_max; y++)
     {
       if (y < equator)
       {
         if ((y % 3) == 0 || (y % 3) == 1)
         {
-          if (biome_val < 498)
-          {
-            biome_val += 3;
-          }
+          biome_val = std::min(biome_val + biome_step, 498.0f);
         }
       }
       else if (y > equator)
       {
         if ((y % 3) == 0 || (y % 3) == 1)
         {
-          if (biome_val > 0)
-          {
-            biome_val -= 3;
-          }
+          biome_val = std::max(biome_val - biome_step, 0.0f);
         }
       }
 
       if (mapIs(generatorMap,mapWidth,mapHeight,x,y,P))
       {
-        mapSetType(generatorMap,mapWidth,mapHeight,x,y,biome_val);
+        mapSetType(generatorMap,mapWidth,mapHeight,x,y,static_cast<GeneratorTileTypes>(biome_val));
       }
     }
   }
@@ -1382,74 +959,516 @@ LOCAL void blended_colors(GeneratorTile *generatorMap, uint mapWidth, uint mapHe
   }
 }
 
-void MapGenerator::generate(Map &map, uint minContinents, uint maxContinents)
+LOCAL void stageContinents(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const MapGenerator::Parameters &parameters)
 {
-  GeneratorTile *generatorMap;
+  // creates the main land masses
+  const uint minContinents = parameters.at("min");
+  const uint maxContinents = std::max(parameters.at("max"), minContinents);
+
+  uint continents = minContinents + randomBelow(static_cast<int>(std::min(maxContinents - minContinents, static_cast<uint>(INT_MAX))));
+
+  uint mapSize = std::min(mapWidth, mapHeight);
+  for (uint i = 0; i < continents; i++)
+  {
+    gen_stretched_hexagon(generatorMap, mapWidth, mapHeight, 0, 80);
+    gen_circle(generatorMap, mapWidth, mapHeight, 1, mapScale(300, mapSize), 100, 0, 2);
+    gen_circle(generatorMap, mapWidth, mapHeight, 0, mapScale(150, mapSize), 90, 1, 2);
+  }
+}
+
+LOCAL void stageOceanSplit(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const MapGenerator::Parameters &parameters)
+{
+  (void)parameters;
+
+  gen_ocean_split(generatorMap, mapWidth, mapHeight);
+}
+
+LOCAL void stageErosion(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const MapGenerator::Parameters &parameters)
+{
+  gen_ocean_errosion(generatorMap, mapWidth, mapHeight, parameters.at("chance"));
+}
+
+LOCAL void stageCoastSmoothing(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const MapGenerator::Parameters &parameters)
+{
+  gen_coast_smoothing(generatorMap, mapWidth, mapHeight, parameters.at("radius"), parameters.at("iterations"));
+}
+
+LOCAL void stageRivers(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const MapGenerator::Parameters &parameters)
+{
+  gen_rivers(generatorMap, mapWidth, mapHeight, parameters.at("chance"));
+}
+
+LOCAL void stageBiomes(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const MapGenerator::Parameters &parameters)
+{
+  (void)parameters;
+
+  gen_biomes(generatorMap, mapWidth, mapHeight);
+}
+
+LOCAL void stageColors(GeneratorTile *generatorMap, uint mapWidth, uint mapHeight, const MapGenerator::Parameters &parameters)
+{
+  (void)parameters;
 
-  generatorMap = (GeneratorTile*)malloc(map.getWidth()*map.getHeight()*sizeof(GeneratorTile));
-  assert(generatorMap != NULL);
+  blended_colors(generatorMap, mapWidth, mapHeight);
+}
 
-  // sets the background of map to default water
-  for (uint y = 0; y < map.getHeight(); y++)
+// pipeline stages, see MapGenerator::Pipeline
+LOCAL const StageDefinition STAGE_DEFINITIONS[] =
+{
+  {"continents",      {{"min",        MapGenerator::DEFAULT_MIN_CONTINENTS, 0, UINT_MAX},
+                       {"max",        MapGenerator::DEFAULT_MAX_CONTINENTS, 0, UINT_MAX}
+                      },                                                                   stageContinents    },
+  {"ocean-split",     {},                                                                  stageOceanSplit    },
+  {"erosion",         {{"chance",     OCEAN_EROSION_CHANCE,                 1, UINT_MAX}}, stageErosion       },
+  {"coast-smoothing", {{"radius",     COAST_CLOSING_RADIUS,                 0, 16      },
+                       {"iterations", COAST_SMOOTHING_ITERATIONS,           0, 64      }
+                      },                                                                   stageCoastSmoothing},
+  {"rivers",          {{"chance",     RIVER_SPAWN_CHANCE,                   1, UINT_MAX}}, stageRivers        },
+  {"biomes",          {},                                                                  stageBiomes        },
+  {"colors",          {},                                                                  stageColors        },
+};
+
+/** get pipeline stage definition
+ * @param name stage name
+ * @return stage definition or nullptr if not found
+ */
+LOCAL const StageDefinition *getStageDefinition(const std::string &name)
+{
+  for (const StageDefinition &stageDefinition : STAGE_DEFINITIONS)
   {
-    for (uint x = 0; x < map.getWidth(); x++)
+    if (name == stageDefinition.name)
     {
-      mapSetType(generatorMap,map.getWidth(),map.getHeight(),x,y,W1);
+      return &stageDefinition;
     }
   }
 
-  uint continents = minContinents + (rand() % (maxContinents - minContinents));
+  return nullptr;
+}
 
-  // 1. creates the main land masses
-  for (uint i = 0; i < continents; i++)
+/** parse unsigned number
+ * @param name parameter name
+ * @param value value
+ * @return number
+ */
+LOCAL uint parseNumber(const std::string &name, const std::string &value)
+{
+  size_t             n;
+  unsigned long long number;
+  try
+  {
+    number = std::stoull(value, &n);
+  }
+  catch (const std::exception &)
+  {
+    n = 0;
+  }
+  if ((n == 0) || (n != value.size()) || (value[0] == '-') || (number > UINT_MAX))
   {
-    gen_stretched_hexagon(generatorMap, map.getWidth(), map.getHeight(), 0, 80);
-    gen_circle(generatorMap, map.getWidth(), map.getHeight(), 1, 300, 100, 0, 2);
-    gen_circle(generatorMap, map.getWidth(), map.getHeight(), 0, 150, 90, 1, 2);
+    throw std::invalid_argument("invalid value '" + value + "' for '" + name + "'");
   }
 
-  // 2. add geographic realism to the land masses
-  gen_ocean_split(generatorMap, map.getWidth(), map.getHeight());
-  gen_ocean_errosion(generatorMap, map.getWidth(), map.getHeight());
-  gen_ocean_errosion(generatorMap, map.getWidth(), map.getHeight());
-  gen_rivers(generatorMap, map.getWidth(), map.getHeight());
-  gen_rivers(generatorMap, map.getWidth(), map.getHeight());
+  return static_cast<uint>(number);
+}
 
-  // 3. generate bio masses colors
-  gen_biomes(generatorMap, map.getWidth(), map.getHeight());
-  blended_colors(generatorMap, map.getWidth(), map.getHeight());
+/** run function and record its cost
+ * @param name stage name
+ * @param function function
+ * @param statistics statistics, appended
+ */
+LOCAL void runMeasured(const std::string &name, const std::function<void()> &function, std::vector<MapGenerator::StageStatistics> &statistics)
+{
+  const GeneratorCounters startCounters = counters;
+  auto                    startTime     = std::chrono::steady_clock::now();
+
+  function();
+
+  auto                          endTime = std::chrono::steady_clock::now();
+  MapGenerator::StageStatistics stageStatistics;
+  stageStatistics.name        = name;
+  stageStatistics.time        = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+  stageStatistics.tileReads   = counters.tileReads   - startCounters.tileReads;
+  stageStatistics.tileWrites  = counters.tileWrites  - startCounters.tileWrites;
+  stageStatistics.randomDraws = counters.randomDraws - startCounters.randomDraws;
+  statistics.push_back(stageStatistics);
+}
+
+LOCAL void gen_noise_terrain(Map &map, uint32_t seed)
+{
+  // elevation from periodic fractal noise; wraps in both directions like the donut
+  std::vector<float> elevations;
+  FractalNoise(seed, NOISE_OCTAVES, NOISE_BASE_FREQUENCY, NOISE_PERSISTENCE).generate(elevations, map.getWidth(), map.getHeight());
+
+  // get sea level from histogram, so the land ratio does not depend on the seed
+  std::vector<uint> histogram(NOISE_HISTOGRAM_SIZE, 0);
+  for (float elevation : elevations)
+  {
+    uint i = static_cast<uint>((elevation + 1.0f) * 0.5f * (NOISE_HISTOGRAM_SIZE - 1));
+    histogram[std::min(i, NOISE_HISTOGRAM_SIZE - 1)]++;
+  }
+  size_t waterCount = static_cast<size_t>((1.0f - NOISE_LAND_RATIO) * elevations.size());
+  size_t count      = 0;
+  uint   i          = 0;
+  while ((i < NOISE_HISTOGRAM_SIZE - 1) && (count + histogram[i] <= waterCount))
+  {
+    count += histogram[i];
+    i++;
+  }
+  float seaLevel = (static_cast<float>(i) / (NOISE_HISTOGRAM_SIZE - 1)) * 2.0f - 1.0f;
 
-  // fill-in map tiles
+  // elevations relative to sea level
+  float minElevation = 0.0f;
+  float maxElevation = 0.0f;
+  for (float &elevation : elevations)
+  {
+    elevation -= seaLevel;
+    minElevation = std::min(minElevation, elevation);
+    maxElevation = std::max(maxElevation, elevation);
+  }
+
+  // fill-in map tiles: water shaded by depth, land by height
   map.reset();
-  for (uint y = 0; y < map.getHeight(); y++)
+  parallelFor(0, map.getHeight(), 64, [&](uint y0, uint y1)
   {
-    for (uint x = 0; x < map.getWidth(); x++)
+    std::vector<Tile::Types> types(map.getWidth());
+    std::vector<Color>       colors(map.getWidth());
+    for (uint y = y0; y < y1; y++)
     {
-      GeneratorTile tile = mapGet(generatorMap,map.getWidth(),map.getHeight(),x,y);
+      for (uint x = 0; x < map.getWidth(); x++)
+      {
+        float elevation = elevations[static_cast<size_t>(y) * map.getWidth() + x];
+
+        if (elevation > 0.0f)
+        {
+          types[x]  = Tile::Types::LAND;
+          colors[x] = Color::interpolate(Color::LAND1, Color::LAND2, elevation / maxElevation);
+        }
+        else
+        {
+          double depth = (minElevation < 0.0f) ? elevation / minElevation : 0.0;
+          types[x]  = Tile::Types::WATER;
+          colors[x] = Color::interpolate(Color::WATER1, Color::WATER2, 1.0 - depth);
+        }
+      }
+      map.setTiles(0, y, map.getWidth(), types.data(), colors.data());
+    }
+  });
+  counters.tileWrites += static_cast<uint64_t>(map.getWidth()) * map.getHeight();
+  map.setElevations(std::move(elevations));
+}
 
-      switch (tile.type)
+LOCAL void gen_elevation_rivers(Map &map)
+{
+  // rivers where enough tiles drain through a land tile; river tiles are
+  // lowered to sea level, so the network can be re-computed from the map
+  // elevations for queries
+  RiverNetwork riverNetwork;
+  riverNetwork.compute(map.getElevations(), map.getWidth(), map.getHeight());
+
+  uint32_t              minAccumulation = std::max(16U, static_cast<uint>(RIVER_ACCUMULATION_RATIO * map.getWidth() * map.getHeight()));
+  std::atomic<uint64_t> riverTileCount(0);
+  parallelFor(0, map.getHeight(), 64, [&](uint y0, uint y1)
+  {
+    uint64_t n = 0;
+    for (uint y = y0; y < y1; y++)
+    {
+      for (uint x = 0; x < map.getWidth(); x++)
       {
-        case W1:
-          map.setTile(x, y, Tile::Types::WATER, Color::interpolate(Color::WATER1, Color::WATER2, (double)rand() / RAND_MAX));
-          break;
-        case W2:
+        if (riverNetwork.isLand(x, y) && (riverNetwork.getAccumulation(x, y) >= minAccumulation))
+        {
           map.setTile(x, y, Tile::Types::WATER, Color::WATER2);
-          break;
-        case L1:
-          map.setTile(x, y, Tile::Types::LAND, Color::LAND1);
-          break;
-        case L2:
-          map.setTile(x, y, Tile::Types::LAND, Color::LAND2);
-          break;
-          break;
-        default:
-          map.setTile(x, y, Tile::Types::LAND, tile.color);
-          break;
+          map.setElevation(x, y, 0.0f);
+          n++;
+        }
+      }
+    }
+    riverTileCount += n;
+  });
+  counters.tileReads  += static_cast<uint64_t>(map.getWidth()) * map.getHeight();
+  counters.tileWrites += riverTileCount;
+}
+
+MapGenerator::Pipeline MapGenerator::Pipeline::getDefault(uint minContinents, uint maxContinents)
+{
+  Pipeline pipeline;
+
+  // 1. creates the main land masses
+  pipeline.addStage("continents", {{"min", minContinents}, {"max", maxContinents}});
+
+  // 2. add geographic realism to the land masses
+  pipeline.addStage("ocean-split");
+  pipeline.addStage("erosion");
+  pipeline.addStage("erosion");
+  pipeline.addStage("coast-smoothing");
+  pipeline.addStage("rivers");
+  pipeline.addStage("rivers");
+
+  // 3. generate bio masses colors
+  pipeline.addStage("biomes");
+  pipeline.addStage("colors");
+
+  return pipeline;
+}
+
+void MapGenerator::Pipeline::addStage(const std::string &name, const Parameters &parameters)
+{
+  const StageDefinition *stageDefinition = getStageDefinition(name);
+  if (stageDefinition == nullptr)
+  {
+    throw std::invalid_argument("unknown stage '" + name + "'");
+  }
+
+  Stage stage;
+  stage.name = name;
+  for (const ParameterDefinition &parameterDefinition : stageDefinition->parameters)
+  {
+    stage.parameters[parameterDefinition.name] = parameterDefinition.defaultValue;
+  }
+  for (const auto &parameter : parameters)
+  {
+    auto iterator = stage.parameters.find(parameter.first);
+    if (iterator == stage.parameters.end())
+    {
+      throw std::invalid_argument("unknown parameter '" + parameter.first + "' of stage '" + name + "'");
+    }
+    for (const ParameterDefinition &parameterDefinition : stageDefinition->parameters)
+    {
+      if (   (parameter.first == parameterDefinition.name)
+          && ((parameter.second < parameterDefinition.min) || (parameter.second > parameterDefinition.max))
+         )
+      {
+        std::stringstream buffer;
+        buffer << "invalid value '" << parameter.second << "' for '" << parameter.first << "', expected " << parameterDefinition.min << ".." << parameterDefinition.max;
+        throw std::invalid_argument(buffer.str());
+      }
+    }
+    iterator->second = parameter.second;
+  }
+
+  stages.push_back(stage);
+}
+
+void MapGenerator::Pipeline::parse(std::istream &inputStream)
+{
+  // stages are replaced only if the whole pipeline is valid
+  Pipeline    pipeline;
+  std::string line;
+  uint        lineNumber = 0;
+  while (getline(inputStream, line))
+  {
+    lineNumber++;
+
+    size_t i = line.find('#');
+    if (i != std::string::npos)
+    {
+      line.erase(i);
+    }
+
+    std::stringstream lineStream(line);
+    std::string       name;
+    if (!(lineStream >> name))
+    {
+      continue;
+    }
+
+    try
+    {
+      Parameters  parameters;
+      std::string token;
+      while (lineStream >> token)
+      {
+        size_t j = token.find('=');
+        if ((j == std::string::npos) || (j == 0))
+        {
+          throw std::invalid_argument("invalid parameter '" + token + "'");
+        }
+        parameters[token.substr(0, j)] = parseNumber(token.substr(0, j), token.substr(j + 1));
+      }
+      pipeline.addStage(name, parameters);
+    }
+    catch (const std::invalid_argument &exception)
+    {
+      std::stringstream buffer;
+      buffer << "line " << lineNumber << ": " << exception.what();
+      throw std::invalid_argument(buffer.str());
+    }
+  }
+
+  stages.swap(pipeline.stages);
+}
+
+void MapGenerator::Pipeline::load(const std::string &filePath)
+{
+  std::ifstream inputStream(filePath);
+  if (!inputStream.is_open())
+  {
+    std::stringstream buffer;
+    buffer << "cannot open pipeline file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  try
+  {
+    parse(inputStream);
+  }
+  catch (const std::invalid_argument &exception)
+  {
+    throw std::invalid_argument("'" + filePath + "' " + exception.what());
+  }
+}
+
+void MapGenerator::Pipeline::print(std::ostream &outputStream) const
+{
+  for (const Stage &stage : stages)
+  {
+    outputStream << stage.name;
+    for (const auto &parameter : stage.parameters)
+    {
+      outputStream << " " << parameter.first << "=" << parameter.second;
+    }
+    outputStream << std::endl;
+  }
+}
+
+void MapGenerator::Pipeline::run(Map &map, std::vector<StageStatistics> &statistics) const
+{
+  const uint mapWidth  = map.getWidth();
+  const uint mapHeight = map.getHeight();
+
+  statistics.clear();
+  auto runStage = [&](const std::string &name, const std::function<void()> &function)
+  {
+    runMeasured(name, function, statistics);
+  };
+
+  GeneratorTile *generatorMap;
+
+  runStage("init", [&]()
+  {
+    generatorMap = (GeneratorTile*)malloc(static_cast<size_t>(mapWidth)*mapHeight*sizeof(GeneratorTile));
+    assert(generatorMap != NULL);
+
+    // sets the background of map to default water
+    mapFillTiles(generatorMap, static_cast<size_t>(mapWidth)*mapHeight, W1);
+  });
+
+  for (const Stage &stage : stages)
+  {
+    if ((mapWidth < MIN_SHAPES_WIDTH) || (mapHeight < MIN_SHAPES_HEIGHT))
+    {
+      break;
+    }
+
+    const StageDefinition *stageDefinition = getStageDefinition(stage.name);
+    assert(stageDefinition != nullptr);
+
+    runStage(stage.name, [&]()
+    {
+      stageDefinition->function(generatorMap, mapWidth, mapHeight, stage.parameters);
+    });
+  }
+
+  runStage("tiles", [&]()
+  {
+    // fill-in map tiles
+    map.reset();
+    std::vector<Tile::Types> types(mapWidth);
+    std::vector<Color>       colors(mapWidth);
+    for (uint y = 0; y < mapHeight; y++)
+    {
+      for (uint x = 0; x < mapWidth; x++)
+      {
+        GeneratorTile tile = mapGet(generatorMap,mapWidth,mapHeight,x,y);
+
+        switch (tile.type)
+        {
+          case W1:
+            types[x]  = Tile::Types::WATER;
+            colors[x] = Color::interpolate(Color::WATER1, Color::WATER2, (double)generatorRandom() / RAND_MAX);
+            break;
+          case W2:
+            types[x]  = Tile::Types::WATER;
+            colors[x] = Color::WATER2;
+            break;
+          case L1:
+            types[x]  = Tile::Types::LAND;
+            colors[x] = Color::LAND1;
+            break;
+          case L2:
+            types[x]  = Tile::Types::LAND;
+            colors[x] = Color::LAND2;
+            break;
+          default:
+            types[x]  = Tile::Types::LAND;
+            colors[x] = tile.color;
+            break;
+        }
       }
+      map.setTiles(0, y, mapWidth, types.data(), colors.data());
+      counters.tileWrites += mapWidth;
     }
+
+    map.updateCoastDistances();
+    map.updateRegionQueries();
+
+    free(generatorMap);
+  });
+}
+
+void MapGenerator::Pipeline::run(Map &map) const
+{
+  std::vector<StageStatistics> statistics;
+  run(map, statistics);
+}
+
+void MapGenerator::generate(Map &map, Backends backend, uint32_t seed, uint minContinents, uint maxContinents)
+{
+  generate(map, backend, seed, Pipeline::getDefault(minContinents, maxContinents));
+}
+
+void MapGenerator::generate(Map                          &map,
+                            Backends                     backend,
+                            uint32_t                     seed,
+                            const Pipeline               &pipeline,
+                            std::vector<StageStatistics> *statistics
+                           )
+{
+  switch (backend)
+  {
+    case Backends::SHAPES:
+      srand(seed);
+      if (statistics != nullptr)
+      {
+        pipeline.run(map, *statistics);
+      }
+      else
+      {
+        pipeline.run(map);
+      }
+      break;
+    case Backends::NOISE:
+      {
+        // no pipeline: one stage
+        std::vector<StageStatistics> noiseStatistics;
+        runMeasured("noise", [&]()
+        {
+          gen_noise_terrain(map, seed);
+          gen_elevation_rivers(map);
+          map.updateCoastDistances();
+          map.updateRegionQueries();
+        },
+        noiseStatistics);
+        if (statistics != nullptr)
+        {
+          *statistics = std::move(noiseStatistics);
+        }
+      }
+      break;
   }
+}
 
-  free(generatorMap);
+void MapGenerator::generate(Map &map, uint minContinents, uint maxContinents)
+{
+  Pipeline::getDefault(minContinents, maxContinents).run(map);
 }
 
 /* end of file */
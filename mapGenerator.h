@@ -11,6 +11,10 @@
 /****************************** Includes *******************************/
 #include <stdlib.h>
 #include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
 
 #include "islands.h"
 
@@ -31,6 +35,166 @@
 class MapGenerator
 {
   public:
+    // default min./max. number of continents (shapes backend)
+    static const uint DEFAULT_MIN_CONTINENTS = 600;
+    static const uint DEFAULT_MAX_CONTINENTS = 800;
+
+    /** generator backends
+     */
+    enum class Backends
+    {
+      SHAPES,   // randomly distorted hexagons and circles
+      NOISE     // periodic fractal noise elevation field
+    };
+
+    /** stage parameters: name -> value
+     */
+    typedef std::map<std::string, uint> Parameters;
+
+    /** pipeline stage
+     */
+    struct Stage
+    {
+      std::string name;
+      Parameters  parameters;  // all parameters of the stage
+    };
+
+    /** cost of a pipeline stage run
+     */
+    struct StageStatistics
+    {
+      std::string name;
+      double      time;         // wall time [ms]
+      uint64_t    tileReads;    // generator tiles read
+      uint64_t    tileWrites;   // generator tiles written
+      uint64_t    randomDraws;  // random numbers drawn
+    };
+
+    /** generator pipeline of the shapes backend: named stages with
+     *  parameters, which can be reordered, skipped or repeated. Stages
+     *  and their parameters (default value):
+     *
+     *    continents       min (600), max (800)  continents of hexagons and
+     *                                           circles
+     *    ocean-split      -                     ocean across the map
+     *    erosion          chance (60)           bays at 1 in chance coast
+     *                                           tiles
+     *    coast-smoothing  radius (1),           close narrow water gaps,
+     *                     iterations (2)        smooth coast lines
+     *    rivers           chance (16)           rivers at 1 in chance coast
+     *                                           tiles
+     *    biomes           -                     climate by latitude
+     *    colors           -                     biome colors
+     *
+     *  The erosion and rivers chances are for a 512x512 map and scaled
+     *  with the map size like the bays and rivers themselves (min. 1:
+     *  every coast tile).
+     *
+     *  A pipeline file has one stage per line, parameters as
+     *  name=value; # starts a comment:
+     *
+     *    continents min=600 max=800
+     *    erosion chance=60
+     *    erosion
+     *    ...
+     *
+     *  Every run records the cost of each stage, see StageStatistics.
+     */
+    class Pipeline
+    {
+      public:
+        /** create empty pipeline
+         */
+        Pipeline()
+        {
+        }
+
+        /** get default pipeline: stages of generate()
+         * @param minContinents min. number of continents
+         * @param maxContinents max. number of continents
+         * @return pipeline
+         */
+        static Pipeline getDefault(uint minContinents, uint maxContinents);
+
+        /** add stage
+         * @param name stage name
+         * @param parameters parameters; missing parameters get default
+         *                   values
+         * @throw std::invalid_argument on unknown stage or parameter
+         */
+        void addStage(const std::string &name, const Parameters &parameters = Parameters());
+
+        /** remove all stages
+         */
+        void clear()
+        {
+          stages.clear();
+        }
+
+        /** get stages
+         * @return stages in run order
+         */
+        const std::vector<Stage> &getStages() const
+        {
+          return stages;
+        }
+
+        /** parse pipeline and replace stages
+         * @param inputStream input stream, one stage per line
+         * @throw std::invalid_argument on syntax error
+         */
+        void parse(std::istream &inputStream);
+
+        /** load pipeline file and replace stages
+         * @param filePath file path
+         * @throw std::ios_base::failure, std::invalid_argument
+         */
+        void load(const std::string &filePath);
+
+        /** write pipeline in file format
+         * @param outputStream output stream
+         */
+        void print(std::ostream &outputStream) const;
+
+        /** run pipeline with the current random number sequence and
+         *  fill-in map tiles; maps smaller than 4x4 tiles are not
+         *  shaped and stay water
+         * @param map map
+         * @param statistics cost of the stages in run order; the water
+         *                   background is stage "init", the final
+         *                   fill-in of the map tiles is stage "tiles"
+         */
+        void run(Map &map, std::vector<StageStatistics> &statistics) const;
+        void run(Map &map) const;
+
+      private:
+        std::vector<Stage> stages;
+    };
+
+    /** generate map
+     * @param map map
+     * @param backend generator backend
+     * @param seed random seed
+     * @param minContinents min. number of continents (shapes backend only)
+     * @param maxContinents max. number of continents (shapes backend only)
+     */
+    static void generate(Map &map, Backends backend, uint32_t seed, uint minContinents, uint maxContinents);
+
+    /** generate map
+     * @param map map
+     * @param backend generator backend
+     * @param seed random seed
+     * @param pipeline pipeline (shapes backend only)
+     * @param statistics cost of the pipeline stages (noise backend:
+     *                   one stage "noise") or nullptr
+     */
+    static void generate(Map                          &map,
+                         Backends                     backend,
+                         uint32_t                     seed,
+                         const Pipeline               &pipeline,
+                         std::vector<StageStatistics> *statistics = nullptr
+                        );
+
     /** generate map
      * @param map map
      * @param minContinents min. number of continents
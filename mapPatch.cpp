@@ -0,0 +1,456 @@
+/***********************************************************************\
+*
+* Contents: map patch: diff of two map versions
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cassert>
+
+#include "parallel.h"
+#include "binaryIO.h"
+
+#include "mapPatch.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// chunks per parallel block
+LOCAL const uint CHUNK_BLOCK_SIZE = 16;
+
+// binary format
+LOCAL const char     BINARY_MAGIC[4] = {'D','W','M','P'};
+LOCAL const uint32_t BINARY_VERSION  = 1;
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** get rectangle of chunk
+ * @param snapshot snapshot
+ * @param i chunk index
+ * @param x0,y0,x1,y1 rectangle [x0,x1) x [y0,y1)
+ */
+LOCAL void getChunkRect(const Map::Snapshot &snapshot, size_t i, uint &x0, uint &y0, uint &x1, uint &y1)
+{
+  x0 = static_cast<uint>(i % snapshot.getChunksX()) * Map::CHUNK_SIZE;
+  y0 = static_cast<uint>(i / snapshot.getChunksX()) * Map::CHUNK_SIZE;
+  x1 = std::min(x0 + Map::CHUNK_SIZE, snapshot.getWidth());
+  y1 = std::min(y0 + Map::CHUNK_SIZE, snapshot.getHeight());
+}
+
+void MapPatch::clear()
+{
+  width  = 0;
+  height = 0;
+  chunkPatches.clear();
+}
+
+size_t MapPatch::getTileCount() const
+{
+  size_t n = 0;
+  for (const ChunkPatch &chunkPatch : chunkPatches)
+  {
+    for (const Run &run : chunkPatch.runs)
+    {
+      n += run.types.size();
+    }
+  }
+
+  return n;
+}
+
+uint64_t MapPatch::getChunkHash(const Map::Snapshot &snapshot, size_t i)
+{
+  assert(i < snapshot.getChunkCount());
+
+  uint x0, y0, x1, y1;
+  getChunkRect(snapshot, i, x0, y0, x1, y1);
+
+  // FNV-1a style hash with one step per tile: the type and color are
+  // packed into 32 bit and combined as a whole, not byte by byte
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (uint y = y0; y < y1; y++)
+  {
+    for (uint x = x0; x < x1; x++)
+    {
+      const Tile  &tile  = snapshot.getTile(x, y);
+      const Color color = tile.getColor();
+
+      hash ^=   static_cast<uint64_t>(tile.getType())
+              | (static_cast<uint64_t>(color.r) <<  8)
+              | (static_cast<uint64_t>(color.g) << 16)
+              | (static_cast<uint64_t>(color.b) << 24);
+      hash *= 0x100000001B3ULL;
+    }
+  }
+
+  return hash;
+}
+
+void MapPatch::getChunkHashes(const Map::Snapshot &snapshot, std::vector<uint64_t> &hashes)
+{
+  hashes.resize(snapshot.getChunkCount());
+  parallelFor(0, hashes.size(), CHUNK_BLOCK_SIZE, [&](uint i0, uint i1)
+  {
+    for (uint i = i0; i < i1; i++)
+    {
+      hashes[i] = getChunkHash(snapshot, i);
+    }
+  });
+}
+
+void MapPatch::diff(const Map::Snapshot &from, const Map::Snapshot &to)
+{
+  assert(from.getWidth() == to.getWidth());
+  assert(from.getHeight() == to.getHeight());
+
+  diffChunks(to, [&](uint32_t chunk, ChunkPatch &chunkPatch) -> bool
+  {
+    // shared chunks are unchanged
+    if (from.isSharedChunk(to, chunk))
+    {
+      return false;
+    }
+
+    auto isChanged = [&](uint x, uint y) -> bool
+    {
+      const Tile &fromTile = from.getTile(x, y);
+      const Tile &toTile   = to.getTile(x, y);
+
+      return (fromTile.getType() != toTile.getType()) || (fromTile.getColor() != toTile.getColor());
+    };
+
+    uint x0, y0, x1, y1;
+    getChunkRect(to, chunk, x0, y0, x1, y1);
+    for (uint y = y0; y < y1; y++)
+    {
+      uint x = x0;
+      while (x < x1)
+      {
+        if (isChanged(x, y))
+        {
+          Run run;
+          run.offset = (y - y0) * Map::CHUNK_SIZE + (x - x0);
+          do
+          {
+            const Tile &tile = to.getTile(x, y);
+            run.types.push_back(tile.getType());
+            run.colors.push_back(tile.getColor());
+            x++;
+          }
+          while ((x < x1) && isChanged(x, y));
+          chunkPatch.runs.push_back(std::move(run));
+        }
+        else
+        {
+          x++;
+        }
+      }
+    }
+    if (chunkPatch.runs.empty())
+    {
+      return false;
+    }
+
+    chunkPatch.oldHash = getChunkHash(from, chunk);
+    chunkPatch.newHash = getChunkHash(to, chunk);
+
+    return true;
+  });
+}
+
+void MapPatch::diff(const std::vector<uint64_t> &fromHashes, const Map::Snapshot &to)
+{
+  assert(fromHashes.size() == to.getChunkCount());
+
+  diffChunks(to, [&](uint32_t chunk, ChunkPatch &chunkPatch) -> bool
+  {
+    chunkPatch.oldHash = fromHashes[chunk];
+    chunkPatch.newHash = getChunkHash(to, chunk);
+    if (chunkPatch.newHash == chunkPatch.oldHash)
+    {
+      return false;
+    }
+
+    // old tiles unknown: patch all rows of chunk
+    uint x0, y0, x1, y1;
+    getChunkRect(to, chunk, x0, y0, x1, y1);
+    for (uint y = y0; y < y1; y++)
+    {
+      Run run;
+      run.offset = (y - y0) * Map::CHUNK_SIZE;
+      for (uint x = x0; x < x1; x++)
+      {
+        const Tile &tile = to.getTile(x, y);
+        run.types.push_back(tile.getType());
+        run.colors.push_back(tile.getColor());
+      }
+      chunkPatch.runs.push_back(std::move(run));
+    }
+
+    return true;
+  });
+}
+
+void MapPatch::apply(Map &map) const
+{
+  if ((map.getWidth() != width) || (map.getHeight() != height))
+  {
+    std::stringstream buffer;
+    buffer << "map patch size " << width << "x" << height << " does not match map size " << map.getWidth() << "x" << map.getHeight();
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  // check all chunks before changing any tile
+  const Map::Snapshot snapshot = map.getSnapshot();
+  for (const ChunkPatch &chunkPatch : chunkPatches)
+  {
+    if (getChunkHash(snapshot, chunkPatch.chunk) != chunkPatch.oldHash)
+    {
+      std::stringstream buffer;
+      buffer << "map patch does not match map at chunk " << chunkPatch.chunk;
+      throw std::ios_base::failure(buffer.str());
+    }
+  }
+
+  for (const ChunkPatch &chunkPatch : chunkPatches)
+  {
+    uint x0, y0, x1, y1;
+    getChunkRect(snapshot, chunkPatch.chunk, x0, y0, x1, y1);
+    for (const Run &run : chunkPatch.runs)
+    {
+      map.setTiles(x0 + run.offset % Map::CHUNK_SIZE,
+                   y0 + run.offset / Map::CHUNK_SIZE,
+                   static_cast<uint>(run.types.size()),
+                   run.types.data(),
+                   run.colors.data()
+                  );
+    }
+  }
+}
+
+void MapPatch::read(std::istream &inputStream)
+{
+  char magic[4];
+  if (   !inputStream.read(magic, sizeof(magic))
+      || !std::equal(magic, magic + sizeof(magic), BINARY_MAGIC)
+      || (readUInt(inputStream, 4) != BINARY_VERSION)
+     )
+  {
+    throw std::ios_base::failure("invalid map patch");
+  }
+
+  clear();
+  width  = static_cast<uint>(readUInt(inputStream, 4));
+  height = static_cast<uint>(readUInt(inputStream, 4));
+  if (readUInt(inputStream, 4) != Map::CHUNK_SIZE)
+  {
+    throw std::ios_base::failure("unsupported chunk size in map patch");
+  }
+
+  const uint64_t chunksX    = (static_cast<uint64_t>(width ) + Map::CHUNK_SIZE - 1) / Map::CHUNK_SIZE;
+  const uint64_t chunksY    = (static_cast<uint64_t>(height) + Map::CHUNK_SIZE - 1) / Map::CHUNK_SIZE;
+  const uint64_t chunkCount = chunksX * chunksY;
+  auto invalid = []()
+  {
+    throw std::ios_base::failure("invalid data in map patch");
+  };
+
+  // chunks; indices as gaps to the previous chunk
+  uint64_t chunk = 0;
+  uint64_t n     = readVarUInt(inputStream);
+  if (n > chunkCount)
+  {
+    invalid();
+  }
+  chunkPatches.resize(n);
+  for (ChunkPatch &chunkPatch : chunkPatches)
+  {
+    chunk += readVarUInt(inputStream);
+    if (chunk >= chunkCount)
+    {
+      invalid();
+    }
+    chunkPatch.chunk   = static_cast<uint32_t>(chunk);
+    chunkPatch.oldHash = readUInt(inputStream, 8);
+    chunkPatch.newHash = readUInt(inputStream, 8);
+    chunk++;
+
+    const uint chunkWidth  = std::min(static_cast<uint>(chunkPatch.chunk % chunksX + 1) * Map::CHUNK_SIZE, width ) - static_cast<uint>(chunkPatch.chunk % chunksX) * Map::CHUNK_SIZE;
+    const uint chunkHeight = std::min(static_cast<uint>(chunkPatch.chunk / chunksX + 1) * Map::CHUNK_SIZE, height) - static_cast<uint>(chunkPatch.chunk / chunksX) * Map::CHUNK_SIZE;
+
+    // runs; offsets as gaps to the end of the previous run
+    uint64_t offset   = 0;
+    uint64_t runCount = readVarUInt(inputStream);
+    if (runCount > static_cast<uint64_t>(chunkWidth) * chunkHeight)
+    {
+      invalid();
+    }
+    chunkPatch.runs.resize(runCount);
+    for (Run &run : chunkPatch.runs)
+    {
+      offset += readVarUInt(inputStream);
+      uint64_t length = readVarUInt(inputStream);
+      if (   (length == 0)
+          || (offset / Map::CHUNK_SIZE >= chunkHeight)
+          || (offset % Map::CHUNK_SIZE + length > chunkWidth)
+         )
+      {
+        invalid();
+      }
+      run.offset = static_cast<uint>(offset);
+
+      // run-length encoded tiles
+      while (run.types.size() < length)
+      {
+        uint64_t count = readVarUInt(inputStream);
+        uint8_t  type  = readByte(inputStream);
+        Color    color;
+        color.r = readByte(inputStream);
+        color.g = readByte(inputStream);
+        color.b = readByte(inputStream);
+        if ((count == 0) || (run.types.size() + count > length) || (type >= Tile::TYPE_COUNT))
+        {
+          invalid();
+        }
+        run.types.insert(run.types.end(), count, static_cast<Tile::Types>(type));
+        run.colors.insert(run.colors.end(), count, color);
+      }
+
+      offset += length;
+    }
+  }
+}
+
+void MapPatch::write(std::ostream &outputStream) const
+{
+  // header
+  outputStream.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  writeUInt(outputStream, BINARY_VERSION, 4);
+  writeUInt(outputStream, width, 4);
+  writeUInt(outputStream, height, 4);
+  writeUInt(outputStream, Map::CHUNK_SIZE, 4);
+
+  uint32_t chunk = 0;
+  writeVarUInt(outputStream, chunkPatches.size());
+  for (const ChunkPatch &chunkPatch : chunkPatches)
+  {
+    writeVarUInt(outputStream, chunkPatch.chunk - chunk);
+    writeUInt(outputStream, chunkPatch.oldHash, 8);
+    writeUInt(outputStream, chunkPatch.newHash, 8);
+    chunk = chunkPatch.chunk + 1;
+
+    uint offset = 0;
+    writeVarUInt(outputStream, chunkPatch.runs.size());
+    for (const Run &run : chunkPatch.runs)
+    {
+      writeVarUInt(outputStream, run.offset - offset);
+      writeVarUInt(outputStream, run.types.size());
+
+      size_t i = 0;
+      while (i < run.types.size())
+      {
+        size_t j = i + 1;
+        while (   (j < run.types.size())
+               && (run.types[j] == run.types[i])
+               && !(run.colors[j] != run.colors[i])
+              )
+        {
+          j++;
+        }
+
+        writeVarUInt(outputStream, j - i);
+        outputStream.put(static_cast<char>(run.types[i]));
+        outputStream.put(static_cast<char>(run.colors[i].r));
+        outputStream.put(static_cast<char>(run.colors[i].g));
+        outputStream.put(static_cast<char>(run.colors[i].b));
+
+        i = j;
+      }
+
+      offset = run.offset + static_cast<uint>(run.types.size());
+    }
+  }
+}
+
+void MapPatch::load(const std::string &filePath)
+{
+  std::ifstream inputStream(filePath, std::ios::binary);
+  if (!inputStream.is_open())
+  {
+    std::stringstream buffer;
+    buffer << "cannot open map patch file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  read(inputStream);
+}
+
+void MapPatch::save(const std::string &filePath) const
+{
+  std::ofstream outputStream(filePath, std::ios::binary);
+  if (!outputStream.is_open())
+  {
+    std::stringstream buffer;
+    buffer << "cannot create map patch file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+
+  write(outputStream);
+
+  outputStream.close();
+  if (outputStream.fail())
+  {
+    std::stringstream buffer;
+    buffer << "cannot write map patch file '" << filePath << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+}
+
+void MapPatch::diffChunks(const Map::Snapshot &to, const std::function<bool(uint32_t chunk, ChunkPatch &chunkPatch)> &compare)
+{
+  clear();
+  width  = to.getWidth();
+  height = to.getHeight();
+
+  // diff blocks of chunks in parallel, then concatenate in chunk order
+  const uint                           chunkCount = static_cast<uint>(to.getChunkCount());
+  std::vector<std::vector<ChunkPatch>> blockChunkPatches((chunkCount + CHUNK_BLOCK_SIZE - 1) / CHUNK_BLOCK_SIZE);
+  parallelFor(0, chunkCount, CHUNK_BLOCK_SIZE, [&](uint i0, uint i1)
+  {
+    std::vector<ChunkPatch> &chunkPatches = blockChunkPatches[i0 / CHUNK_BLOCK_SIZE];
+    for (uint i = i0; i < i1; i++)
+    {
+      ChunkPatch chunkPatch;
+      chunkPatch.chunk = i;
+      if (compare(i, chunkPatch))
+      {
+        chunkPatches.push_back(std::move(chunkPatch));
+      }
+    }
+  });
+  for (std::vector<ChunkPatch> &blockPatches : blockChunkPatches)
+  {
+    std::move(blockPatches.begin(), blockPatches.end(), std::back_inserter(chunkPatches));
+  }
+}
+
+/* end of file */
@@ -0,0 +1,162 @@
+/***********************************************************************\
+*
+* Contents: map patch: diff of two map versions
+* Systems: all
+*
+\***********************************************************************/
+#ifndef MAP_PATCH_H
+#define MAP_PATCH_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <functional>
+
+#include "islands.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** map patch: changed runs of tiles between two versions of a map,
+ *  grouped by chunk (Map::CHUNK_SIZE x Map::CHUNK_SIZE tiles). Chunks
+ *  shared by two snapshots are skipped without looking at the tiles.
+ *  Each changed chunk carries a hash of its old and new content, so a
+ *  patch is only applied to the map version it was made from.
+ */
+class MapPatch
+{
+  public:
+    MapPatch()
+      : width(0)
+      , height(0)
+    {
+    }
+
+    /** clear patch
+     */
+    void clear();
+
+    /** check if patch is empty
+     * @return true iff no tiles changed
+     */
+    bool isEmpty() const
+    {
+      return chunkPatches.empty();
+    }
+
+    /** get number of changed chunks
+     * @return number of changed chunks
+     */
+    size_t getChunkCount() const
+    {
+      return chunkPatches.size();
+    }
+
+    /** get number of changed tiles
+     * @return number of changed tiles
+     */
+    size_t getTileCount() const;
+
+    /** compute hash of the types and colors of the tiles of a chunk
+     * @param snapshot snapshot
+     * @param i chunk index
+     * @return hash
+     */
+    static uint64_t getChunkHash(const Map::Snapshot &snapshot, size_t i);
+
+    /** compute hashes of all chunks
+     * @param snapshot snapshot
+     * @param hashes chunk hashes
+     */
+    static void getChunkHashes(const Map::Snapshot &snapshot, std::vector<uint64_t> &hashes);
+
+    /** create patch from one map version to another; both snapshots
+     *  must be taken from the same map (or have the same size)
+     * @param from old map version
+     * @param to new map version
+     */
+    void diff(const Map::Snapshot &from, const Map::Snapshot &to);
+
+    /** create patch from chunk hashes of the old map version, e. g.
+     *  received from another process; chunks with different hashes are
+     *  patched completely
+     * @param fromHashes chunk hashes of old map version
+     * @param to new map version
+     */
+    void diff(const std::vector<uint64_t> &fromHashes, const Map::Snapshot &to);
+
+    /** apply patch to map; tiles must not be changed concurrently
+     * @param map map with the old map version, changed to the new map
+     *            version
+     */
+    void apply(Map &map) const;
+
+    /** read patch
+     * @param inputStream input stream
+     */
+    void read(std::istream &inputStream);
+
+    /** write patch in compact binary format: header, then variable
+     *  length encoded chunk indices, hashes and runs with run-length
+     *  encoded tiles
+     * @param outputStream output stream
+     */
+    void write(std::ostream &outputStream) const;
+
+    /** load patch from file
+     * @param filePath file path
+     */
+    void load(const std::string &filePath);
+
+    /** save patch to file
+     * @param filePath file path
+     */
+    void save(const std::string &filePath) const;
+
+  private:
+    /** run of changed tiles inside a chunk row
+     */
+    struct Run
+    {
+      uint                     offset;  // index of first tile inside chunk
+      std::vector<Tile::Types> types;
+      std::vector<Color>       colors;
+    };
+
+    /** changed tiles of a chunk
+     */
+    struct ChunkPatch
+    {
+      uint32_t         chunk;    // chunk index
+      uint64_t         oldHash;
+      uint64_t         newHash;
+      std::vector<Run> runs;
+    };
+
+    uint                    width, height;
+    std::vector<ChunkPatch> chunkPatches;  // sorted by chunk index
+
+    /** diff chunks in parallel
+     * @param to new map version
+     * @param compare function to get changed runs of a chunk, return
+     *                false if chunk is unchanged
+     */
+    void diffChunks(const Map::Snapshot &to, const std::function<bool(uint32_t chunk, ChunkPatch &chunkPatch)> &compare);
+};
+
+#endif // MAP_PATCH_H
+
+/* end of file */
@@ -0,0 +1,905 @@
+/***********************************************************************\
+*
+* Contents: map server: map generation service on a Unix domain socket
+* Systems: Unix
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <cassert>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "islands.h"
+#include "mapGenerator.h"
+#include "mapPatch.h"
+
+#include "mapServer.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// max. length of a request line [bytes]
+LOCAL const size_t MAX_REQUEST_LENGTH = 1024;
+// receive timeout for the request line [s]
+LOCAL const uint   RECEIVE_TIMEOUT    = 5;
+// max. size of a payload chunk [bytes]
+LOCAL const size_t PAYLOAD_CHUNK_SIZE = 64 * 1024;
+// approx. memory of the region index of a map per tile [bytes]
+LOCAL const size_t REGION_INDEX_TILE_SIZE = 23;
+
+/***************************** Datatypes *******************************/
+
+/** result payload
+ */
+struct MapServer::Payload
+{
+  std::vector<std::string>   chunks;
+  size_t                     size;  // total size [bytes] or memory usage of map
+  std::unique_ptr<const Map> map;   // generated map or nullptr
+
+  Payload()
+    : size(0)
+  {
+  }
+};
+
+/** output stream buffer: append to chunks of max. PAYLOAD_CHUNK_SIZE
+ *  bytes
+ */
+class PayloadBuffer : public std::streambuf
+{
+  public:
+    PayloadBuffer(std::vector<std::string> &chunks, size_t &size)
+      : chunks(chunks)
+      , size(size)
+    {
+    }
+
+  protected:
+    std::streamsize xsputn(const char *data, std::streamsize n) override
+    {
+      std::streamsize count = n;
+      while (n > 0)
+      {
+        if (chunks.empty() || (chunks.back().size() >= PAYLOAD_CHUNK_SIZE))
+        {
+          chunks.emplace_back();
+        }
+        std::string &chunk = chunks.back();
+        size_t      m      = std::min(static_cast<size_t>(n), PAYLOAD_CHUNK_SIZE - chunk.size());
+        chunk.append(data, m);
+        data += m;
+        n    -= m;
+        size += m;
+      }
+
+      return count;
+    }
+
+    int_type overflow(int_type ch) override
+    {
+      if (!traits_type::eq_int_type(ch, traits_type::eof()))
+      {
+        const char c = traits_type::to_char_type(ch);
+        xsputn(&c, 1);
+      }
+
+      return traits_type::not_eof(ch);
+    }
+
+  private:
+    std::vector<std::string> &chunks;
+    size_t                   &size;
+};
+
+/** request rejected because the server is busy
+ */
+class BusyError : public std::runtime_error
+{
+  public:
+    BusyError(const std::string &message)
+      : std::runtime_error(message)
+    {
+    }
+};
+
+/** reservation of tiles in progress; released on destruction
+ */
+class TileReservation
+{
+  public:
+    /** reserve tiles
+     * @param inflightTiles tiles in progress
+     * @param maxInflightTiles max. number of tiles in progress
+     * @param tileCount number of tiles to reserve
+     * @throw BusyError if the budget is exhausted
+     */
+    TileReservation(std::atomic<size_t> &inflightTiles, size_t maxInflightTiles, size_t tileCount)
+      : inflightTiles(inflightTiles)
+      , tileCount(tileCount)
+    {
+      size_t n = inflightTiles.load();
+      do
+      {
+        if (n + tileCount > maxInflightTiles)
+        {
+          throw BusyError("too many tiles in progress");
+        }
+      }
+      while (!inflightTiles.compare_exchange_weak(n, n + tileCount));
+    }
+
+    ~TileReservation()
+    {
+      inflightTiles -= tileCount;
+    }
+
+  private:
+    std::atomic<size_t> &inflightTiles;
+    const size_t        tileCount;
+
+    TileReservation(const TileReservation&) = delete;
+    TileReservation &operator=(const TileReservation&) = delete;
+};
+
+/** parsed request
+ */
+struct MapServer::Request
+{
+  std::string             command;
+  MapGenerator::Backends  backend;
+  uint32_t                seed;
+  uint                    width, height;
+  uint                    minContinents, maxContinents;
+  uint                    x, y, rectWidth, rectHeight;
+
+  /** get normalized map parameters
+   * @return parameters
+   */
+  std::string getMapKey() const
+  {
+    std::stringstream buffer;
+    buffer << "backend=" << ((backend == MapGenerator::Backends::SHAPES) ? "shapes" : "noise")
+           << " seed=" << seed
+           << " width=" << width
+           << " height=" << height;
+    if (backend == MapGenerator::Backends::SHAPES)
+    {
+      buffer << " minContinents=" << minContinents
+             << " maxContinents=" << maxContinents;
+    }
+
+    return buffer.str();
+  }
+
+  /** get number of map tiles
+   * @return width*height
+   */
+  size_t getTileCount() const
+  {
+    return static_cast<size_t>(width) * height;
+  }
+};
+
+/***************************** Variables *******************************/
+const uint   MapServer::DEFAULT_QUEUE_SIZE;
+const size_t MapServer::DEFAULT_CACHE_SIZE;
+const size_t MapServer::DEFAULT_MAX_REQUEST_TILES;
+const size_t MapServer::DEFAULT_MAX_INFLIGHT_TILES;
+const uint   MapServer::MIN_MAP_SIZE;
+const uint   MapServer::MAX_MAP_SIZE;
+const uint   MapServer::MAX_CONTINENTS;
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** throw error with system error message
+ * @param message message
+ */
+LOCAL void throwError(const std::string &message)
+{
+  std::stringstream buffer;
+  buffer << message << ": " << strerror(errno);
+  throw std::ios_base::failure(buffer.str());
+}
+
+/** get approx. memory usage of generated map with islands and region
+ *  index
+ * @param map map
+ * @return memory usage [bytes]
+ */
+LOCAL size_t getMemoryUsage(const Map &map)
+{
+  size_t tileCount = static_cast<size_t>(map.getWidth()) * map.getHeight();
+
+  return   tileCount * (sizeof(Tile) + sizeof(uint32_t) + REGION_INDEX_TILE_SIZE)
+         + map.getElevations().size() * sizeof(float)
+         + map.getCoastDistances().size() * sizeof(float);
+}
+
+/** send all data
+ * @param connection connection socket
+ * @param data data
+ * @param size data size [bytes]
+ * @return true iff sent
+ */
+LOCAL bool sendAll(int connection, const char *data, size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t n = send(connection, data, size, MSG_NOSIGNAL);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+
+  return true;
+}
+
+/** send reply
+ * @param connection connection socket
+ * @param reply reply line without line feed
+ * @param chunks payload chunks or nullptr
+ * @return true iff sent
+ */
+LOCAL bool sendReply(int connection, const std::string &reply, const std::vector<std::string> *chunks = nullptr)
+{
+  std::string line = reply + "\n";
+  if (!sendAll(connection, line.data(), line.size()))
+  {
+    return false;
+  }
+  if (chunks != nullptr)
+  {
+    for (const std::string &chunk : *chunks)
+    {
+      if (!sendAll(connection, chunk.data(), chunk.size()))
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/** receive request line
+ * @param connection connection socket
+ * @param line request line without line feed
+ * @return true iff received
+ */
+LOCAL bool receiveLine(int connection, std::string &line)
+{
+  line.clear();
+  while (line.size() < MAX_REQUEST_LENGTH)
+  {
+    char    ch;
+    ssize_t n = recv(connection, &ch, 1, 0);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    if ((n == 0) || (ch == '\n'))
+    {
+      return !line.empty();
+    }
+    if (ch != '\r')
+    {
+      line += ch;
+    }
+  }
+
+  return false;
+}
+
+/** parse unsigned number
+ * @param name parameter name
+ * @param value value
+ * @param min,max range
+ * @return number
+ */
+LOCAL uint parseNumber(const std::string &name, const std::string &value, uint64_t min, uint64_t max)
+{
+  size_t             n;
+  unsigned long long number;
+  try
+  {
+    number = std::stoull(value, &n);
+  }
+  catch (const std::exception &)
+  {
+    n = 0;
+  }
+  if ((n == 0) || (n != value.size()) || (value[0] == '-') || (number < min) || (number > max))
+  {
+    std::stringstream buffer;
+    buffer << "invalid value '" << value << "' for '" << name << "', expected " << min << ".." << max;
+    throw std::invalid_argument(buffer.str());
+  }
+
+  return static_cast<uint>(number);
+}
+
+MapServer::MapServer(const std::string &socketPath,
+                     const std::string &cacheDirectory,
+                     uint              workerCount,
+                     uint              queueSize,
+                     size_t            cacheSize,
+                     size_t            maxRequestTiles,
+                     size_t            maxInflightTiles
+                    )
+  : socketPath(socketPath)
+  , cacheDirectory(cacheDirectory)
+  , queueSize(queueSize)
+  , cacheSize(cacheSize)
+  , maxRequestTiles(maxRequestTiles)
+  , maxInflightTiles(std::max(maxInflightTiles, maxRequestTiles))
+  , listenSocket(-1)
+  , stopped(false)
+  , cacheUsage(0)
+  , inflightTiles(0)
+  , requestCount(0)
+  , rejectedCount(0)
+  , memoryHitCount(0)
+  , diskHitCount(0)
+  , computeCount(0)
+{
+  assert(workerCount > 0);
+  assert(queueSize > 0);
+  assert(maxRequestTiles > 0);
+
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path))
+  {
+    throw std::ios_base::failure("socket path too long '" + socketPath + "'");
+  }
+  strcpy(address.sun_path, socketPath.c_str());
+
+  listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenSocket == -1)
+  {
+    throwError("cannot create socket");
+  }
+  unlink(socketPath.c_str());
+  if (   (bind(listenSocket, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) != 0)
+      || (listen(listenSocket, static_cast<int>(queueSize)) != 0)
+     )
+  {
+    int error = errno;
+    close(listenSocket);
+    errno = error;
+    throwError("cannot listen on socket '" + socketPath + "'");
+  }
+
+  for (uint i = 0; i < workerCount; i++)
+  {
+    workers.push_back(std::thread(&MapServer::worker, this));
+  }
+}
+
+MapServer::~MapServer()
+{
+  stop();
+  {
+    std::lock_guard<std::mutex> guard(queueLock);
+    queueCondition.notify_all();
+  }
+  for (std::thread &thread : workers)
+  {
+    thread.join();
+  }
+  for (int connection : queue)
+  {
+    close(connection);
+  }
+
+  close(listenSocket);
+  unlink(socketPath.c_str());
+}
+
+void MapServer::run()
+{
+  while (!stopped)
+  {
+    int connection = accept(listenSocket, nullptr, nullptr);
+    if (connection == -1)
+    {
+      if (stopped || ((errno != EINTR) && (errno != ECONNABORTED)))
+      {
+        break;
+      }
+      continue;
+    }
+
+    struct timeval timeout = {RECEIVE_TIMEOUT, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // queue connection; reject if queue is full
+    bool queued = false;
+    {
+      std::lock_guard<std::mutex> guard(queueLock);
+      if (queue.size() < queueSize)
+      {
+        queue.push_back(connection);
+        queued = true;
+      }
+    }
+    if (queued)
+    {
+      queueCondition.notify_one();
+    }
+    else
+    {
+      rejectedCount++;
+      sendReply(connection, "BUSY");
+
+      // discard received request, otherwise closing resets the connection
+      // before the client read the reply
+      char buffer[MAX_REQUEST_LENGTH];
+      shutdown(connection, SHUT_WR);
+      while (recv(connection, buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+      {
+      }
+      close(connection);
+    }
+  }
+
+  stop();
+  {
+    std::lock_guard<std::mutex> guard(queueLock);
+    queueCondition.notify_all();
+  }
+}
+
+void MapServer::stop()
+{
+  stopped = true;
+  shutdown(listenSocket, SHUT_RDWR);
+}
+
+void MapServer::worker()
+{
+  while (true)
+  {
+    int connection;
+    {
+      std::unique_lock<std::mutex> guard(queueLock);
+      queueCondition.wait(guard, [this]() { return stopped || !queue.empty(); });
+      if (stopped)
+      {
+        return;
+      }
+      connection = queue.front();
+      queue.pop_front();
+    }
+
+    process(connection);
+    close(connection);
+  }
+}
+
+void MapServer::process(int connection)
+{
+  std::string line;
+  if (!receiveLine(connection, line))
+  {
+    sendReply(connection, "ERROR no request");
+    return;
+  }
+  requestCount++;
+
+  try
+  {
+    Request request;
+    parseRequest(line, request);
+    if ((request.command != "status") && (request.getTileCount() > maxRequestTiles))
+    {
+      std::stringstream buffer;
+      buffer << "map too large: " << request.getTileCount() << " tiles, max. " << maxRequestTiles;
+      throw std::invalid_argument(buffer.str());
+    }
+
+    Result result;
+    if      (request.command == "generate")
+    {
+      result = getMap(request);
+    }
+    else if (request.command == "islands")
+    {
+      result = getIslands(request);
+    }
+    else if (request.command == "query")
+    {
+      result = getQuery(request);
+    }
+    else
+    {
+      std::shared_ptr<Payload> payload = std::make_shared<Payload>();
+      PayloadBuffer            buffer(payload->chunks, payload->size);
+      std::ostream             outputStream(&buffer);
+      outputStream << getStatus();
+      result = payload;
+    }
+
+    sendReply(connection, "OK " + std::to_string(result->size), &result->chunks);
+  }
+  catch (const BusyError &)
+  {
+    rejectedCount++;
+    sendReply(connection, "BUSY");
+  }
+  catch (const std::exception &exception)
+  {
+    std::string message = exception.what();
+    std::replace(message.begin(), message.end(), '\n', ' ');
+    sendReply(connection, "ERROR " + message);
+  }
+}
+
+MapServer::Result MapServer::getCachedResult(const std::string &key, size_t tileCount, bool diskCache, const std::function<Result()> &compute)
+{
+  // wait for pending result of another request with the same key or
+  // compute it
+  std::promise<Result>       promise;
+  std::shared_future<Result> pendingResult;
+  {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    auto iterator = cacheIndex.find(key);
+    if (iterator != cacheIndex.end())
+    {
+      memoryHitCount++;
+      cacheList.splice(cacheList.begin(), cacheList, iterator->second);
+      return iterator->second->second;
+    }
+
+    auto pendingIterator = pendingResults.find(key);
+    if (pendingIterator != pendingResults.end())
+    {
+      pendingResult = pendingIterator->second;
+    }
+    else
+    {
+      pendingResults[key] = promise.get_future().share();
+    }
+  }
+  if (pendingResult.valid())
+  {
+    memoryHitCount++;
+    return pendingResult.get();
+  }
+
+  Result result;
+  try
+  {
+    // disk cache: key line, then result
+    std::string filePath = (diskCache && !cacheDirectory.empty()) ? getCacheFilePath(key) : std::string();
+    if (!filePath.empty())
+    {
+      std::ifstream inputStream(filePath, std::ios::binary);
+      std::string   fileKey;
+      if (inputStream.is_open() && getline(inputStream, fileKey) && (fileKey == key))
+      {
+        std::shared_ptr<Payload> payload = std::make_shared<Payload>();
+        PayloadBuffer            buffer(payload->chunks, payload->size);
+        std::ostream             outputStream(&buffer);
+        outputStream << inputStream.rdbuf();
+        if (!inputStream.bad() && (payload->size > 0))
+        {
+          result = payload;
+          diskHitCount++;
+        }
+      }
+    }
+
+    if (result == nullptr)
+    {
+      TileReservation reservation(inflightTiles, maxInflightTiles, tileCount);
+      result = compute();
+      computeCount++;
+
+      if (!filePath.empty())
+      {
+        // write to temporary file and rename, so readers never see
+        // partial files
+        std::string   tmpFilePath = filePath + ".tmp" + std::to_string(reinterpret_cast<uintptr_t>(&promise));
+        std::ofstream outputStream(tmpFilePath, std::ios::binary);
+        outputStream << key << '\n';
+        for (const std::string &chunk : result->chunks)
+        {
+          outputStream.write(chunk.data(), chunk.size());
+        }
+        outputStream.close();
+        if (outputStream.fail() || (rename(tmpFilePath.c_str(), filePath.c_str()) != 0))
+        {
+          unlink(tmpFilePath.c_str());
+        }
+      }
+    }
+  }
+  catch (...)
+  {
+    {
+      std::lock_guard<std::mutex> guard(cacheLock);
+      pendingResults.erase(key);
+    }
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    pendingResults.erase(key);
+    if (result->size <= cacheSize)
+    {
+      cacheList.emplace_front(key, result);
+      cacheIndex[key] = cacheList.begin();
+      cacheUsage += key.size() + result->size;
+
+      // evict least recently used results
+      while (cacheUsage > cacheSize)
+      {
+        const std::pair<std::string, Result> &entry = cacheList.back();
+        cacheUsage -= entry.first.size() + entry.second->size;
+        cacheIndex.erase(entry.first);
+        cacheList.pop_back();
+      }
+    }
+  }
+  promise.set_value(result);
+
+  return result;
+}
+
+MapServer::Result MapServer::getResult(const std::string &key, const std::function<void(std::ostream&)> &compute)
+{
+  // no tiles reserved: results are computed from the cached map, see
+  // getGeneratedMap()
+  return getCachedResult(key, 0, true, [&]() -> Result
+  {
+    std::shared_ptr<Payload> payload = std::make_shared<Payload>();
+    PayloadBuffer            buffer(payload->chunks, payload->size);
+    std::ostream             outputStream(&buffer);
+    compute(outputStream);
+
+    return payload;
+  });
+}
+
+void MapServer::generateMap(const Request &request, Map &map)
+{
+  if (request.backend == MapGenerator::Backends::SHAPES)
+  {
+    std::lock_guard<std::mutex> guard(generatorLock);
+    MapGenerator::generate(map, request.backend, request.seed, request.minContinents, request.maxContinents);
+  }
+  else
+  {
+    MapGenerator::generate(map, request.backend, request.seed, request.minContinents, request.maxContinents);
+  }
+}
+
+MapServer::Result MapServer::getGeneratedMap(const Request &request)
+{
+  return getCachedResult("map " + request.getMapKey(), request.getTileCount(), false, [&]() -> Result
+  {
+    std::unique_ptr<Map> map(new Map(request.width, request.height));
+    generateMap(request, *map);
+    map->findIslands();
+    map->enableRegionQueries(true);
+
+    std::shared_ptr<Payload> payload = std::make_shared<Payload>();
+    payload->size = getMemoryUsage(*map);
+    payload->map  = std::move(map);
+
+    return payload;
+  });
+}
+
+MapServer::Result MapServer::getMap(const Request &request)
+{
+  return getResult("generate " + request.getMapKey(), [&](std::ostream &outputStream)
+  {
+    const Result mapResult = getGeneratedMap(request);
+
+    // empty map shares one chunk, see Map::reset()
+    Map      emptyMap(request.width, request.height);
+    MapPatch patch;
+    patch.diff(emptyMap.getSnapshot(), mapResult->map->getSnapshot());
+    patch.write(outputStream);
+  });
+}
+
+MapServer::Result MapServer::getIslands(const Request &request)
+{
+  return getResult("islands " + request.getMapKey(), [&](std::ostream &outputStream)
+  {
+    const Result mapResult = getGeneratedMap(request);
+    const Map    &map      = *mapResult->map;
+
+    uint islandCount = map.getIslandCount();
+    outputStream << islandCount << '\n';
+    for (uint label = 1; label <= islandCount; label++)
+    {
+      const Island           *island     = map.getIsland(label);
+      const IslandIndex::Box &boundingBox = island->getBoundingBox();
+      outputStream << label << ' ' << island->getTileCount()
+                   << ' ' << boundingBox.x0 << ' ' << boundingBox.y0
+                   << ' ' << boundingBox.x1 << ' ' << boundingBox.y1
+                   << '\n';
+    }
+  });
+}
+
+MapServer::Result MapServer::getQuery(const Request &request)
+{
+  // not cached: answered from the cached map in O(1)
+  const Result           mapResult        = getGeneratedMap(request);
+  const RegionStatistics regionStatistics = mapResult->map->queryRect(request.x, request.y, request.rectWidth, request.rectHeight);
+
+  std::shared_ptr<Payload> payload = std::make_shared<Payload>();
+  PayloadBuffer            buffer(payload->chunks, payload->size);
+  std::ostream             outputStream(&buffer);
+  outputStream << "tiles "    << regionStatistics.tileCount << '\n'
+               << "water "    << regionStatistics.getCount(Tile::Types::WATER) << '\n'
+               << "land "     << regionStatistics.getCount(Tile::Types::LAND) << '\n'
+               << "tree "     << regionStatistics.getCount(Tile::Types::TREE) << '\n'
+               << "mountain " << regionStatistics.getCount(Tile::Types::MOUNTAIN) << '\n'
+               << "building " << regionStatistics.getCount(Tile::Types::BUILDING) << '\n'
+               << "color "    << static_cast<uint>(regionStatistics.averageColor.r)
+               << ' '         << static_cast<uint>(regionStatistics.averageColor.g)
+               << ' '         << static_cast<uint>(regionStatistics.averageColor.b) << '\n';
+
+  return payload;
+}
+
+std::string MapServer::getStatus() const
+{
+  std::stringstream buffer;
+  buffer << "requests "      << requestCount << '\n'
+         << "rejected "      << rejectedCount << '\n'
+         << "memoryHits "    << memoryHitCount << '\n'
+         << "diskHits "      << diskHitCount << '\n'
+         << "computed "      << computeCount << '\n'
+         << "inflightTiles " << inflightTiles << '\n';
+
+  return buffer.str();
+}
+
+std::string MapServer::getCacheFilePath(const std::string &key) const
+{
+  // FNV-1a of key
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (const char ch : key)
+  {
+    hash ^= static_cast<uint8_t>(ch);
+    hash *= 0x100000001B3ULL;
+  }
+
+  std::stringstream buffer;
+  buffer << cacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".cache";
+
+  return buffer.str();
+}
+
+void MapServer::parseRequest(const std::string &line, Request &request)
+{
+  std::stringstream                  inputStream(line);
+  std::map<std::string, std::string> parameters;
+  std::string                        token;
+
+  inputStream >> request.command;
+  while (inputStream >> token)
+  {
+    size_t i = token.find('=');
+    if ((i == std::string::npos) || (i == 0))
+    {
+      throw std::invalid_argument("invalid parameter '" + token + "'");
+    }
+    parameters[token.substr(0, i)] = token.substr(i + 1);
+  }
+
+  auto get = [&](const char *name, bool required, uint64_t min, uint64_t max, uint defaultValue) -> uint
+  {
+    auto iterator = parameters.find(name);
+    if (iterator == parameters.end())
+    {
+      if (required)
+      {
+        throw std::invalid_argument(std::string("missing parameter '") + name + "'");
+      }
+      return defaultValue;
+    }
+    uint value = parseNumber(name, iterator->second, min, max);
+    parameters.erase(iterator);
+
+    return value;
+  };
+
+  if (request.command == "status")
+  {
+    // no parameters
+  }
+  else if (   (request.command == "generate")
+           || (request.command == "islands")
+           || (request.command == "query")
+          )
+  {
+    auto iterator = parameters.find("backend");
+    if      ((iterator == parameters.end()) || (iterator->second == "shapes"))
+    {
+      request.backend = MapGenerator::Backends::SHAPES;
+    }
+    else if (iterator->second == "noise")
+    {
+      request.backend = MapGenerator::Backends::NOISE;
+    }
+    else
+    {
+      throw std::invalid_argument("unknown backend '" + iterator->second + "'");
+    }
+    if (iterator != parameters.end())
+    {
+      parameters.erase(iterator);
+    }
+
+    request.seed          = get("seed",          true,  0,                       UINT32_MAX,              0);
+    request.width         = get("width",         true,  MIN_MAP_SIZE, MAX_MAP_SIZE, 0);
+    request.height        = get("height",        true,  MIN_MAP_SIZE, MAX_MAP_SIZE, 0);
+    request.minContinents = get("minContinents", false, 0,                       MAX_CONTINENTS,          MapGenerator::DEFAULT_MIN_CONTINENTS);
+    request.maxContinents = get("maxContinents", false, request.minContinents,   MAX_CONTINENTS,          std::max(MapGenerator::DEFAULT_MAX_CONTINENTS, request.minContinents));
+    if (request.command == "query")
+    {
+      request.x          = get("x",          true, 0, request.width  - 1, 0);
+      request.y          = get("y",          true, 0, request.height - 1, 0);
+      request.rectWidth  = get("rectWidth",  true, 1, request.width  - request.x, 0);
+      request.rectHeight = get("rectHeight", true, 1, request.height - request.y, 0);
+    }
+  }
+  else
+  {
+    throw std::invalid_argument("unknown command '" + request.command + "'");
+  }
+
+  if (!parameters.empty())
+  {
+    throw std::invalid_argument("unknown parameter '" + parameters.begin()->first + "'");
+  }
+}
+
+/* end of file */
@@ -0,0 +1,240 @@
+/***********************************************************************\
+*
+* Contents: map server: map generation service on a Unix domain socket
+* Systems: Unix
+*
+\***********************************************************************/
+#ifndef MAP_SERVER_H
+#define MAP_SERVER_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <future>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <iostream>
+
+#include "islands.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** map server: accepts one request per connection on a Unix domain
+ *  socket. A request is a line with a command and key=value parameters:
+ *
+ *    generate backend=shapes|noise seed=<n> width=<n> height=<n>
+ *             [minContinents=<n>] [maxContinents=<n>]
+ *    islands  <parameters of generate>
+ *    query    <parameters of generate> x=<n> y=<n> rectWidth=<n>
+ *             rectHeight=<n>
+ *    status
+ *
+ *  The reply is "OK <size>\n" followed by <size> bytes of payload,
+ *  "BUSY\n" if the request queue is full or a map would exceed the
+ *  budget of tiles in progress, or "ERROR <message>\n" (e. g. map
+ *  larger than the tile budget of a request).
+ *  Payloads: generate - map patch (see MapPatch) from an all water map;
+ *  islands - number of islands, then per island a line "label tiles x0
+ *  y0 x1 y1"; query - region statistics as "name value" lines; status
+ *  - counters as "name value" lines.
+ *
+ *  Requests are processed by a fixed number of worker threads from a
+ *  bounded queue. Results are kept in an LRU cache in memory and
+ *  optionally on disk; concurrent requests with the same parameters
+ *  wait for the same result. Results are stored and sent in chunks, so
+ *  large payloads are never copied into one buffer. Generated maps are
+ *  kept in the memory cache, too, with their islands and region index:
+ *  all requests of a map generate it once, queries of rectangles are
+ *  answered from the cached map.
+ */
+class MapServer
+{
+  public:
+    // default max. number of queued connections
+    static const uint   DEFAULT_QUEUE_SIZE = 64;
+    // default memory cache size [bytes]
+    static const size_t DEFAULT_CACHE_SIZE = 256 * 1024 * 1024;
+    // default max. number of tiles of a map (width*height)
+    static const size_t DEFAULT_MAX_REQUEST_TILES  = 4096 * 4096;
+    // default max. number of tiles of all maps computed concurrently
+    static const size_t DEFAULT_MAX_INFLIGHT_TILES = 4 * DEFAULT_MAX_REQUEST_TILES;
+    // min./max. map width+height
+    static const uint   MIN_MAP_SIZE       = 64;
+    static const uint   MAX_MAP_SIZE       = 16384;
+    // max. number of continents (shapes backend)
+    static const uint   MAX_CONTINENTS     = 4096;
+
+    /** create map server
+     * @param socketPath socket path
+     * @param cacheDirectory directory for disk cache or empty
+     * @param workerCount number of worker threads
+     * @param queueSize max. number of queued connections
+     * @param cacheSize memory cache size [bytes]
+     * @param maxRequestTiles max. number of tiles of a map; larger
+     *                        requests are rejected with an error
+     * @param maxInflightTiles max. number of tiles of all maps computed
+     *                         concurrently; further requests are
+     *                         rejected as busy
+     */
+    MapServer(const std::string &socketPath,
+              const std::string &cacheDirectory,
+              uint              workerCount,
+              uint              queueSize        = DEFAULT_QUEUE_SIZE,
+              size_t            cacheSize        = DEFAULT_CACHE_SIZE,
+              size_t            maxRequestTiles  = DEFAULT_MAX_REQUEST_TILES,
+              size_t            maxInflightTiles = DEFAULT_MAX_INFLIGHT_TILES
+             );
+
+    /** destroy map server; removes socket
+     */
+    ~MapServer();
+
+    /** accept and process requests until stop() is called
+     */
+    void run();
+
+    /** stop server; async-signal-safe
+     */
+    void stop();
+
+  private:
+    /** result payload: chunks of max. PAYLOAD_CHUNK_SIZE bytes
+     */
+    struct Payload;
+    typedef std::shared_ptr<const Payload> Result;
+
+    /** parsed request
+     */
+    struct Request;
+
+    const std::string                    socketPath;
+    const std::string                    cacheDirectory;
+    const uint                           queueSize;
+    const size_t                         cacheSize;
+    const size_t                         maxRequestTiles;
+    const size_t                         maxInflightTiles;
+    int                                  listenSocket;
+    std::atomic<bool>                    stopped;
+
+    std::vector<std::thread>             workers;
+    std::deque<int>                      queue;            // accepted connections
+    std::mutex                           queueLock;
+    std::condition_variable              queueCondition;
+
+    std::list<std::pair<std::string, Result>>                                 cacheList;  // most recently used first
+    std::unordered_map<std::string, decltype(cacheList)::iterator>           cacheIndex;
+    size_t                                                                    cacheUsage;
+    std::unordered_map<std::string, std::shared_future<Result>>              pendingResults;
+    std::mutex                                                                cacheLock;
+
+    std::mutex                           generatorLock;    // shapes generator uses the global rand() state
+    std::atomic<size_t>                  inflightTiles;    // tiles of maps computed now
+
+    std::atomic<uint64_t>                requestCount;
+    std::atomic<uint64_t>                rejectedCount;
+    std::atomic<uint64_t>                memoryHitCount;
+    std::atomic<uint64_t>                diskHitCount;
+    std::atomic<uint64_t>                computeCount;
+
+    MapServer(const MapServer&) = delete;
+    MapServer &operator=(const MapServer&) = delete;
+
+    /** worker thread: process queued connections
+     */
+    void worker();
+
+    /** process request of a connection and send reply
+     * @param connection connection socket
+     */
+    void process(int connection);
+
+    /** get result from cache or compute it
+     * @param key cache key: normalized request
+     * @param tileCount number of map tiles needed to compute the result;
+     *                  reserved from the budget of tiles in progress
+     * @param diskCache true to read/write result from/to disk cache
+     * @param compute function to compute result
+     * @return result
+     */
+    Result getCachedResult(const std::string &key, size_t tileCount, bool diskCache, const std::function<Result()> &compute);
+
+    /** get result from cache or compute it
+     * @param key cache key: normalized request
+     * @param compute function to compute result: write payload to
+     *                output stream
+     * @return result
+     */
+    Result getResult(const std::string &key, const std::function<void(std::ostream&)> &compute);
+
+    /** generate map
+     * @param request request
+     * @param map generated map
+     */
+    void generateMap(const Request &request, Map &map);
+
+    /** get generated map from cache or generate it; the map is cached
+     *  with its islands and region index
+     * @param request request
+     * @return result with map
+     */
+    Result getGeneratedMap(const Request &request);
+
+    /** get generated map
+     * @param request request
+     * @return map patch from an all water map
+     */
+    Result getMap(const Request &request);
+
+    /** get islands of map
+     * @param request request
+     * @return islands
+     */
+    Result getIslands(const Request &request);
+
+    /** get region statistics of map
+     * @param request request
+     * @return region statistics
+     */
+    Result getQuery(const Request &request);
+
+    /** get status
+     * @return counters
+     */
+    std::string getStatus() const;
+
+    /** parse request line
+     * @param line request line
+     * @param request request
+     */
+    static void parseRequest(const std::string &line, Request &request);
+
+    /** get disk cache file path
+     * @param key cache key
+     * @return file path
+     */
+    std::string getCacheFilePath(const std::string &key) const;
+};
+
+#endif // MAP_SERVER_H
+
+/* end of file */
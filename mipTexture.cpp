@@ -0,0 +1,93 @@
+/***********************************************************************\
+*
+* Contents: mip texture: mipmapped map texture
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+
+#include <epoxy/gl.h>
+
+#include "color.h"
+
+#include "mipTexture.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+MipTexture::MipTexture()
+  : texture(0)
+  , width(0)
+  , height(0)
+  , levelCount(0)
+{
+}
+
+void MipTexture::init(uint width, uint height, bool immutableFlag)
+{
+  assert(width > 0);
+  assert(height > 0);
+
+  this->width  = width;
+  this->height = height;
+  levelCount   = 1;
+  while ((std::max(width, height) >> levelCount) > 0)
+  {
+    levelCount++;
+  }
+
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+  if (immutableFlag)
+  {
+    glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_RGB8, width, height);
+  }
+  else
+  {
+    for (uint level = 0; level < levelCount; level++)
+    {
+      uint levelWidth, levelHeight;
+      getLevelSize(level, levelWidth, levelHeight);
+      glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, levelWidth, levelHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    }
+  }
+}
+
+void MipTexture::done()
+{
+  glDeleteTextures(1, &texture);
+  texture = 0;
+}
+
+void MipTexture::upload(const Color colors[])
+{
+  assert(texture != 0);
+
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, colors);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+/* end of file */
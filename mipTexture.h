@@ -0,0 +1,98 @@
+/***********************************************************************\
+*
+* Contents: mip texture: mipmapped map texture
+* Systems: all
+*
+\***********************************************************************/
+#ifndef MIP_TEXTURE_H
+#define MIP_TEXTURE_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <algorithm>
+
+#include <sys/types.h>
+
+#include <epoxy/gl.h>
+
+#include "color.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** mip texture: RGB texture with a full mip chain, sampled trilinear and
+ *  repeated. An upload regenerates the mip chain on the GPU.
+ *
+ *  All methods must be called in the GL context.
+ */
+class MipTexture
+{
+  public:
+    /** create mip texture
+     */
+    MipTexture();
+
+    /** create texture
+     * @param width,height size
+     * @param immutableFlag true to allocate immutable storage
+     *                      (glTexStorage2D)
+     */
+    void init(uint width, uint height, bool immutableFlag);
+
+    /** release texture
+     */
+    void done();
+
+    /** upload image and generate mip chain
+     * @param colors colors, row by row
+     */
+    void upload(const Color colors[]);
+
+    /** bind texture to the active texture unit
+     */
+    void bind() const
+    {
+      glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    /** get number of mip levels
+     * @return number of levels including level 0
+     */
+    uint getLevelCount() const
+    {
+      return levelCount;
+    }
+
+  private:
+    GLuint texture;
+    uint   width, height;
+    uint   levelCount;
+
+    MipTexture(const MipTexture&) = delete;
+    MipTexture &operator=(const MipTexture&) = delete;
+
+    /** get size of mip level
+     * @param level level
+     * @param levelWidth,levelHeight size of level
+     */
+    void getLevelSize(uint level, uint &levelWidth, uint &levelHeight) const
+    {
+      levelWidth  = std::max(1U, width  >> level);
+      levelHeight = std::max(1U, height >> level);
+    }
+};
+
+#endif // MIP_TEXTURE_H
+
+/* end of file */
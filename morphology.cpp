@@ -0,0 +1,235 @@
+/***********************************************************************\
+*
+* Contents: bit-parallel morphological filters on land masks
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <cassert>
+#include <stdexcept>
+
+#include "parallel.h"
+
+#include "morphology.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// rows per parallel band
+LOCAL const uint BAND_HEIGHT = 32;
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** combine shifted words of structuring element
+ * @param input input mask
+ * @param output output mask
+ * @param structuringElement structuring element
+ * @param reflect true to reflect offsets (dilation)
+ * @param all true to require all tiles (erosion), false for any tile
+ *            (dilation)
+ */
+LOCAL void combine(const LandMask                         &input,
+                   LandMask                               &output,
+                   const Morphology::StructuringElement   &structuringElement,
+                   bool                                   reflect,
+                   bool                                   all
+                  )
+{
+  assert(&input != &output);
+
+  output.resize(input.getWidth(), input.getHeight());
+
+  parallelFor(0, input.getHeight(), BAND_HEIGHT, [&](uint y0, uint y1)
+  {
+    for (uint y = y0; y < y1; y++)
+    {
+      uint64_t *row = output.getRow(y);
+      for (uint i = 0; i < input.getWordsPerRow(); i++)
+      {
+        uint64_t word = all ? ~UINT64_C(0) : 0;
+        for (const std::pair<int, int> &offset : structuringElement.getOffsets())
+        {
+          uint64_t neighborWord = reflect
+                                    ? input.getNeighborWord(i, y, -offset.first, -offset.second)
+                                    : input.getNeighborWord(i, y,  offset.first,  offset.second);
+          word = all ? (word & neighborWord) : (word | neighborWord);
+        }
+        row[i] = word;
+      }
+      row[input.getWordsPerRow() - 1] &= input.getLastWordMask();
+    }
+  });
+}
+
+Morphology::StructuringElement::StructuringElement(const std::vector<std::pair<int, int>> &offsets)
+  : offsets(offsets)
+{
+  if (offsets.empty())
+  {
+    throw std::invalid_argument("empty structuring element");
+  }
+}
+
+Morphology::StructuringElement Morphology::StructuringElement::square(uint radius)
+{
+  StructuringElement structuringElement;
+
+  int r = static_cast<int>(radius);
+  for (int dy = -r; dy <= r; dy++)
+  {
+    for (int dx = -r; dx <= r; dx++)
+    {
+      structuringElement.offsets.push_back(std::make_pair(dx, dy));
+    }
+  }
+
+  return structuringElement;
+}
+
+Morphology::StructuringElement Morphology::StructuringElement::cross(uint radius)
+{
+  StructuringElement structuringElement;
+
+  int r = static_cast<int>(radius);
+  structuringElement.offsets.push_back(std::make_pair(0, 0));
+  for (int d = 1; d <= r; d++)
+  {
+    structuringElement.offsets.push_back(std::make_pair(-d,  0));
+    structuringElement.offsets.push_back(std::make_pair(+d,  0));
+    structuringElement.offsets.push_back(std::make_pair( 0, -d));
+    structuringElement.offsets.push_back(std::make_pair( 0, +d));
+  }
+
+  return structuringElement;
+}
+
+Morphology::StructuringElement Morphology::StructuringElement::disc(uint radius)
+{
+  StructuringElement structuringElement;
+
+  int r = static_cast<int>(radius);
+  for (int dy = -r; dy <= r; dy++)
+  {
+    for (int dx = -r; dx <= r; dx++)
+    {
+      if ((dx * dx + dy * dy) <= (r * r + r))
+      {
+        structuringElement.offsets.push_back(std::make_pair(dx, dy));
+      }
+    }
+  }
+
+  return structuringElement;
+}
+
+void Morphology::dilate(const LandMask &input, LandMask &output, const StructuringElement &structuringElement)
+{
+  combine(input, output, structuringElement, true, false);
+}
+
+void Morphology::erode(const LandMask &input, LandMask &output, const StructuringElement &structuringElement)
+{
+  combine(input, output, structuringElement, false, true);
+}
+
+void Morphology::open(const LandMask &input, LandMask &output, const StructuringElement &structuringElement)
+{
+  LandMask eroded;
+  erode(input, eroded, structuringElement);
+  dilate(eroded, output, structuringElement);
+}
+
+void Morphology::close(const LandMask &input, LandMask &output, const StructuringElement &structuringElement)
+{
+  LandMask dilated;
+  dilate(input, dilated, structuringElement);
+  erode(dilated, output, structuringElement);
+}
+
+void Morphology::smooth(const LandMask &input,
+                        LandMask       &output,
+                        uint           iterations,
+                        uint           birthLimit,
+                        uint           survivalLimit
+                       )
+{
+  assert(&input != &output);
+  assert(birthLimit <= 8);
+  assert(survivalLimit <= 8);
+
+  output = input;
+  if (iterations == 0)
+  {
+    return;
+  }
+
+  LandMask source;
+  for (uint iteration = 0; iteration < iterations; iteration++)
+  {
+    std::swap(source, output);
+    output.resize(source.getWidth(), source.getHeight());
+
+    parallelFor(0, source.getHeight(), BAND_HEIGHT, [&](uint y0, uint y1)
+    {
+      for (uint y = y0; y < y1; y++)
+      {
+        uint64_t *row = output.getRow(y);
+        for (uint i = 0; i < source.getWordsPerRow(); i++)
+        {
+          // count land neighbors of 64 tiles in parallel: 4 bit-planes of
+          // the count, added with ripple-carry adders
+          uint64_t counts[4] = {0, 0, 0, 0};
+          for (int dy = -1; dy <= 1; dy++)
+          {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+              if ((dx != 0) || (dy != 0))
+              {
+                uint64_t carry = source.getNeighborWord(i, y, dx, dy);
+                for (uint bit = 0; bit < 4; bit++)
+                {
+                  uint64_t t = counts[bit] & carry;
+                  counts[bit] ^= carry;
+                  carry = t;
+                }
+              }
+            }
+          }
+
+          // compare counts with limits
+          uint64_t birth    = 0;
+          uint64_t survival = 0;
+          for (uint n = 0; n <= 8; n++)
+          {
+            uint64_t equal = ~UINT64_C(0);
+            for (uint bit = 0; bit < 4; bit++)
+            {
+              equal &= ((n >> bit) & 1) ? counts[bit] : ~counts[bit];
+            }
+            if (n >= birthLimit   ) birth    |= equal;
+            if (n >= survivalLimit) survival |= equal;
+          }
+
+          uint64_t center = source.getRow(y)[i];
+          row[i] = (center & survival) | (~center & birth);
+        }
+        row[source.getWordsPerRow() - 1] &= source.getLastWordMask();
+      }
+    });
+  }
+}
+
+/* end of file */
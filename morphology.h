@@ -0,0 +1,128 @@
+/***********************************************************************\
+*
+* Contents: bit-parallel morphological filters on land masks
+* Systems: all
+*
+\***********************************************************************/
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+/****************************** Includes *******************************/
+#include <vector>
+#include <utility>
+
+#include "landMask.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** morphological filters. All filters process 64 tiles per operation,
+ *  run multi-threaded over bands of rows and wrap around at the map
+ *  borders like the donut. Input and output masks must be different.
+ */
+class Morphology
+{
+  public:
+    /** structuring element: set of offsets relative to the center
+     */
+    class StructuringElement
+    {
+      public:
+        /** create structuring element from offsets
+         * @param offsets offsets dx,dy relative to the center; must not
+         *                be empty
+         */
+        explicit StructuringElement(const std::vector<std::pair<int, int>> &offsets);
+
+        /** create square structuring element
+         * @param radius radius (1 = 3x3)
+         * @return structuring element
+         */
+        static StructuringElement square(uint radius);
+
+        /** create cross structuring element
+         * @param radius radius (1 = center+4 neighbors)
+         * @return structuring element
+         */
+        static StructuringElement cross(uint radius);
+
+        /** create disc structuring element
+         * @param radius radius
+         * @return structuring element
+         */
+        static StructuringElement disc(uint radius);
+
+        /** get offsets
+         * @return offsets dx,dy
+         */
+        const std::vector<std::pair<int, int>> &getOffsets() const
+        {
+          return offsets;
+        }
+
+      private:
+        std::vector<std::pair<int, int>> offsets;
+
+        StructuringElement() = default;
+    };
+
+    /** dilate: tile is land if any tile of the structuring element at
+     *  its position is land
+     * @param input input mask
+     * @param output output mask
+     * @param structuringElement structuring element
+     */
+    static void dilate(const LandMask &input, LandMask &output, const StructuringElement &structuringElement);
+
+    /** erode: tile is land if all tiles of the structuring element at
+     *  its position are land
+     * @param input input mask
+     * @param output output mask
+     * @param structuringElement structuring element
+     */
+    static void erode(const LandMask &input, LandMask &output, const StructuringElement &structuringElement);
+
+    /** open: erode+dilate; removes small land parts
+     * @param input input mask
+     * @param output output mask
+     * @param structuringElement structuring element
+     */
+    static void open(const LandMask &input, LandMask &output, const StructuringElement &structuringElement);
+
+    /** close: dilate+erode; fills small water parts
+     * @param input input mask
+     * @param output output mask
+     * @param structuringElement structuring element
+     */
+    static void close(const LandMask &input, LandMask &output, const StructuringElement &structuringElement);
+
+    /** cellular automaton smoothing with the 8 neighbors of a tile
+     * @param input input mask
+     * @param output output mask
+     * @param iterations number of iterations
+     * @param birthLimit min. number of land neighbors to turn water into
+     *                   land
+     * @param survivalLimit min. number of land neighbors to keep land
+     */
+    static void smooth(const LandMask &input,
+                       LandMask       &output,
+                       uint           iterations,
+                       uint           birthLimit = 5,
+                       uint           survivalLimit = 4
+                      );
+};
+
+#endif // MORPHOLOGY_H
+
+/* end of file */
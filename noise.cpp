@@ -0,0 +1,410 @@
+/***********************************************************************\
+*
+* Contents: periodic fractal value noise
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "parallel.h"
+
+#include "noise.h"
+
+/****************** Conditional compilation switches *******************/
+#if defined(__x86_64__) || defined(__i386__)
+  #define HAVE_X86_SIMD 1
+#else
+  #define HAVE_X86_SIMD 0
+#endif
+
+#if HAVE_X86_SIMD
+  #include <immintrin.h>
+#endif
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// tile size for parallel generation
+LOCAL const uint TILE_WIDTH  = 256;
+LOCAL const uint TILE_HEIGHT = 64;
+
+// lattice hash primes
+LOCAL const uint32_t HASH_PRIME_X      = 0x8DA6B343;
+LOCAL const uint32_t HASH_PRIME_Y      = 0xD8163841;
+LOCAL const uint32_t HASH_PRIME_OCTAVE = 0x27D4EB2D;
+LOCAL const uint32_t HASH_MIX1         = 0x7FEB352D;
+LOCAL const uint32_t HASH_MIX2         = 0x846CA68B;
+
+/***************************** Datatypes *******************************/
+
+/** lattice row parameters for one octave
+ */
+typedef struct
+{
+  uint     cellsX;      // number of lattice cells in x direction
+  float    scaleX;      // cellsX/width
+  uint32_t hashY0;      // hash of lattice row above
+  uint32_t hashY1;      // hash of lattice row below
+  float    sy;          // faded y-interpolation factor
+  float    amplitude;   // normalized octave amplitude
+} OctaveRow;
+
+typedef void(*RowKernel)(float *row, uint x0, uint x1, const OctaveRow &octaveRow);
+
+/** lattice of one octave; the same for all tiles of a field
+ */
+struct FractalNoise::Octave
+{
+  uint     cellsX, cellsY;  // number of lattice cells
+  float    scaleX;          // cellsX/width
+  uint32_t seed;            // octave hash seed
+  float    amplitude;       // normalized octave amplitude
+};
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** mix lattice hash into noise value
+ * @param h hash
+ * @return value [-1..1)
+ */
+LOCAL inline float latticeValue(uint32_t h)
+{
+  h ^= h >> 16;
+  h *= HASH_MIX1;
+  h ^= h >> 15;
+  h *= HASH_MIX2;
+  h ^= h >> 16;
+
+  return static_cast<float>(static_cast<int32_t>(h & 0xFFFFFF)) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+/** quintic fade curve
+ * @param t value [0..1]
+ * @return faded value [0..1]
+ */
+LOCAL inline float fade(float t)
+{
+  return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+/** scalar noise row kernel
+ * @param row row data
+ * @param x0,x1 range [x0,x1)
+ * @param octaveRow octave row parameters
+ */
+LOCAL void rowKernelScalar(float *row, uint x0, uint x1, const OctaveRow &octaveRow)
+{
+  for (uint x = x0; x < x1; x++)
+  {
+    float    u   = static_cast<float>(static_cast<int32_t>(x)) * octaveRow.scaleX;
+    uint32_t ix0 = static_cast<uint32_t>(static_cast<int32_t>(u));
+    float    tx  = u - static_cast<float>(static_cast<int32_t>(ix0));
+    if (ix0 >= octaveRow.cellsX) ix0 -= octaveRow.cellsX;
+    uint32_t ix1 = ix0 + 1;
+    if (ix1 == octaveRow.cellsX) ix1 = 0;
+
+    uint32_t hx0 = ix0 * HASH_PRIME_X;
+    uint32_t hx1 = ix1 * HASH_PRIME_X;
+    float    v00 = latticeValue(octaveRow.hashY0 ^ hx0);
+    float    v10 = latticeValue(octaveRow.hashY0 ^ hx1);
+    float    v01 = latticeValue(octaveRow.hashY1 ^ hx0);
+    float    v11 = latticeValue(octaveRow.hashY1 ^ hx1);
+
+    float sx = fade(tx);
+    float a  = v00 + (v10 - v00) * sx;
+    float b  = v01 + (v11 - v01) * sx;
+    float v  = a + (b - a) * octaveRow.sy;
+
+    row[x] += octaveRow.amplitude * v;
+  }
+}
+
+#if HAVE_X86_SIMD
+/** SSE4.1 lattice value
+ * @param h hashes
+ * @return values
+ */
+__attribute__((target("sse4.1")))
+LOCAL inline __m128 latticeValueSSE41(__m128i h)
+{
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+  h = _mm_mullo_epi32(h, _mm_set1_epi32(static_cast<int>(HASH_MIX1)));
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+  h = _mm_mullo_epi32(h, _mm_set1_epi32(static_cast<int>(HASH_MIX2)));
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+
+  __m128 v = _mm_cvtepi32_ps(_mm_and_si128(h, _mm_set1_epi32(0xFFFFFF)));
+  return _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(2.0f / 16777216.0f)), _mm_set1_ps(1.0f));
+}
+
+/** SSE4.1 noise row kernel (4 tiles per step)
+ * @param row row data
+ * @param x0,x1 range [x0,x1)
+ * @param octaveRow octave row parameters
+ */
+__attribute__((target("sse4.1")))
+LOCAL void rowKernelSSE41(float *row, uint x0, uint x1, const OctaveRow &octaveRow)
+{
+  const __m128i cellsX    = _mm_set1_epi32(static_cast<int>(octaveRow.cellsX));
+  const __m128i lastCell  = _mm_set1_epi32(static_cast<int>(octaveRow.cellsX) - 1);
+  const __m128  scaleX    = _mm_set1_ps(octaveRow.scaleX);
+  const __m128i hashY0    = _mm_set1_epi32(static_cast<int>(octaveRow.hashY0));
+  const __m128i hashY1    = _mm_set1_epi32(static_cast<int>(octaveRow.hashY1));
+  const __m128i primeX    = _mm_set1_epi32(static_cast<int>(HASH_PRIME_X));
+  const __m128  sy        = _mm_set1_ps(octaveRow.sy);
+  const __m128  amplitude = _mm_set1_ps(octaveRow.amplitude);
+
+  uint x = x0;
+  for (; x + 4 <= x1; x += 4)
+  {
+    __m128i xs  = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(x)), _mm_setr_epi32(0, 1, 2, 3));
+    __m128  u   = _mm_mul_ps(_mm_cvtepi32_ps(xs), scaleX);
+    __m128i ix0 = _mm_cvttps_epi32(u);
+    __m128  tx  = _mm_sub_ps(u, _mm_cvtepi32_ps(ix0));
+    ix0 = _mm_sub_epi32(ix0, _mm_and_si128(_mm_cmpgt_epi32(ix0, lastCell), cellsX));
+    __m128i ix1 = _mm_add_epi32(ix0, _mm_set1_epi32(1));
+    ix1 = _mm_andnot_si128(_mm_cmpeq_epi32(ix1, cellsX), ix1);
+
+    __m128i hx0 = _mm_mullo_epi32(ix0, primeX);
+    __m128i hx1 = _mm_mullo_epi32(ix1, primeX);
+    __m128  v00 = latticeValueSSE41(_mm_xor_si128(hashY0, hx0));
+    __m128  v10 = latticeValueSSE41(_mm_xor_si128(hashY0, hx1));
+    __m128  v01 = latticeValueSSE41(_mm_xor_si128(hashY1, hx0));
+    __m128  v11 = latticeValueSSE41(_mm_xor_si128(hashY1, hx1));
+
+    // fade: t*t*t*(t*(t*6-15)+10)
+    __m128 sx = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(tx, tx), tx),
+                           _mm_add_ps(_mm_mul_ps(tx,
+                                                 _mm_sub_ps(_mm_mul_ps(tx, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))
+                                                ),
+                                      _mm_set1_ps(10.0f)
+                                     )
+                          );
+    __m128 a  = _mm_add_ps(v00, _mm_mul_ps(_mm_sub_ps(v10, v00), sx));
+    __m128 b  = _mm_add_ps(v01, _mm_mul_ps(_mm_sub_ps(v11, v01), sx));
+    __m128 v  = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), sy));
+
+    _mm_storeu_ps(&row[x], _mm_add_ps(_mm_loadu_ps(&row[x]), _mm_mul_ps(amplitude, v)));
+  }
+
+  rowKernelScalar(row, x, x1, octaveRow);
+}
+
+/** AVX2 lattice value
+ * @param h hashes
+ * @return values
+ */
+__attribute__((target("avx2")))
+LOCAL inline __m256 latticeValueAVX2(__m256i h)
+{
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(HASH_MIX1)));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(HASH_MIX2)));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+
+  __m256 v = _mm256_cvtepi32_ps(_mm256_and_si256(h, _mm256_set1_epi32(0xFFFFFF)));
+  return _mm256_sub_ps(_mm256_mul_ps(v, _mm256_set1_ps(2.0f / 16777216.0f)), _mm256_set1_ps(1.0f));
+}
+
+/** AVX2 noise row kernel (8 tiles per step)
+ * @param row row data
+ * @param x0,x1 range [x0,x1)
+ * @param octaveRow octave row parameters
+ */
+__attribute__((target("avx2")))
+LOCAL void rowKernelAVX2(float *row, uint x0, uint x1, const OctaveRow &octaveRow)
+{
+  const __m256i cellsX    = _mm256_set1_epi32(static_cast<int>(octaveRow.cellsX));
+  const __m256i lastCell  = _mm256_set1_epi32(static_cast<int>(octaveRow.cellsX) - 1);
+  const __m256  scaleX    = _mm256_set1_ps(octaveRow.scaleX);
+  const __m256i hashY0    = _mm256_set1_epi32(static_cast<int>(octaveRow.hashY0));
+  const __m256i hashY1    = _mm256_set1_epi32(static_cast<int>(octaveRow.hashY1));
+  const __m256i primeX    = _mm256_set1_epi32(static_cast<int>(HASH_PRIME_X));
+  const __m256  sy        = _mm256_set1_ps(octaveRow.sy);
+  const __m256  amplitude = _mm256_set1_ps(octaveRow.amplitude);
+
+  uint x = x0;
+  for (; x + 8 <= x1; x += 8)
+  {
+    __m256i xs  = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(x)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256  u   = _mm256_mul_ps(_mm256_cvtepi32_ps(xs), scaleX);
+    __m256i ix0 = _mm256_cvttps_epi32(u);
+    __m256  tx  = _mm256_sub_ps(u, _mm256_cvtepi32_ps(ix0));
+    ix0 = _mm256_sub_epi32(ix0, _mm256_and_si256(_mm256_cmpgt_epi32(ix0, lastCell), cellsX));
+    __m256i ix1 = _mm256_add_epi32(ix0, _mm256_set1_epi32(1));
+    ix1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(ix1, cellsX), ix1);
+
+    __m256i hx0 = _mm256_mullo_epi32(ix0, primeX);
+    __m256i hx1 = _mm256_mullo_epi32(ix1, primeX);
+    __m256  v00 = latticeValueAVX2(_mm256_xor_si256(hashY0, hx0));
+    __m256  v10 = latticeValueAVX2(_mm256_xor_si256(hashY0, hx1));
+    __m256  v01 = latticeValueAVX2(_mm256_xor_si256(hashY1, hx0));
+    __m256  v11 = latticeValueAVX2(_mm256_xor_si256(hashY1, hx1));
+
+    // fade: t*t*t*(t*(t*6-15)+10)
+    __m256 sx = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(tx, tx), tx),
+                              _mm256_add_ps(_mm256_mul_ps(tx,
+                                                          _mm256_sub_ps(_mm256_mul_ps(tx, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))
+                                                         ),
+                                            _mm256_set1_ps(10.0f)
+                                           )
+                             );
+    __m256 a  = _mm256_add_ps(v00, _mm256_mul_ps(_mm256_sub_ps(v10, v00), sx));
+    __m256 b  = _mm256_add_ps(v01, _mm256_mul_ps(_mm256_sub_ps(v11, v01), sx));
+    __m256 v  = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), sy));
+
+    _mm256_storeu_ps(&row[x], _mm256_add_ps(_mm256_loadu_ps(&row[x]), _mm256_mul_ps(amplitude, v)));
+  }
+
+  rowKernelSSE41(row, x, x1, octaveRow);
+}
+#endif // HAVE_X86_SIMD
+
+/** get best row kernel for this CPU
+ * @return row kernel
+ */
+LOCAL RowKernel getRowKernel()
+{
+  #if HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+      return rowKernelAVX2;
+    }
+    else if (__builtin_cpu_supports("sse4.1"))
+    {
+      return rowKernelSSE41;
+    }
+  #endif
+
+  return rowKernelScalar;
+}
+
+// ---------------------------------------------------------------------
+
+FractalNoise::FractalNoise(uint32_t seed, uint octaves, uint baseFrequency, float persistence)
+  : seed(seed)
+  , octaves(octaves)
+  , baseFrequency(baseFrequency)
+  , persistence(persistence)
+{
+  assert(octaves > 0);
+  assert(baseFrequency > 0);
+}
+
+void FractalNoise::generate(std::vector<float> &field, uint width, uint height) const
+{
+  assert(width > 0);
+  assert(height > 0);
+
+  field.resize(static_cast<size_t>(width) * height);
+
+  // get octave lattice sizes and normalized amplitudes; octaves with more
+  // cells than tiles do not add any detail
+  std::vector<Octave> octaveLattices;
+  float               amplitude    = 1.0f;
+  float               amplitudeSum = 0.0f;
+  for (uint i = 0; (i < octaves) && ((baseFrequency << i) <= width); i++)
+  {
+    Octave octave;
+    octave.cellsX    = baseFrequency << i;
+    octave.cellsY    = std::max(1U, static_cast<uint>(lround(static_cast<double>(octave.cellsX) * height / width)));
+    octave.scaleX    = static_cast<float>(octave.cellsX) / static_cast<float>(width);
+    octave.seed      = seed ^ (static_cast<uint32_t>(i + 1) * HASH_PRIME_OCTAVE);
+    octave.amplitude = amplitude;
+    octaveLattices.push_back(octave);
+    amplitudeSum += amplitude;
+    amplitude *= persistence;
+  }
+  for (Octave &octave : octaveLattices)
+  {
+    octave.amplitude /= amplitudeSum;
+  }
+
+  uint tilesX = (width  + TILE_WIDTH  - 1) / TILE_WIDTH;
+  uint tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+  parallelFor(0, tilesX * tilesY, 1, [&](uint blockBegin, uint blockEnd)
+  {
+    for (uint i = blockBegin; i < blockEnd; i++)
+    {
+      uint x0 = (i % tilesX) * TILE_WIDTH;
+      uint y0 = (i / tilesX) * TILE_HEIGHT;
+
+      generateTile(field.data(),
+                   width,
+                   height,
+                   octaveLattices,
+                   x0,
+                   y0,
+                   std::min(x0 + TILE_WIDTH, width),
+                   std::min(y0 + TILE_HEIGHT, height)
+                  );
+    }
+  });
+}
+
+const char *FractalNoise::getKernelName()
+{
+  RowKernel rowKernel = getRowKernel();
+
+  #if HAVE_X86_SIMD
+    if      (rowKernel == rowKernelAVX2 ) return "avx2";
+    else if (rowKernel == rowKernelSSE41) return "sse4.1";
+  #endif
+  (void)rowKernel;
+
+  return "scalar";
+}
+
+void FractalNoise::generateTile(float                     *field,
+                                uint                      width,
+                                uint                      height,
+                                const std::vector<Octave> &octaveLattices,
+                                uint                      x0,
+                                uint                      y0,
+                                uint                      x1,
+                                uint                      y1
+                               ) const
+{
+  static const RowKernel rowKernel = getRowKernel();
+
+  for (uint y = y0; y < y1; y++)
+  {
+    float *row = &field[static_cast<size_t>(y) * width];
+    std::fill(row + x0, row + x1, 0.0f);
+
+    for (const Octave &octave : octaveLattices)
+    {
+      float    v   = static_cast<float>(y) * static_cast<float>(octave.cellsY) / static_cast<float>(height);
+      uint32_t iy0 = static_cast<uint32_t>(v);
+      float    ty  = v - static_cast<float>(iy0);
+      if (iy0 >= octave.cellsY) iy0 -= octave.cellsY;
+      uint32_t iy1 = (iy0 + 1 < octave.cellsY) ? iy0 + 1 : 0;
+
+      OctaveRow octaveRow;
+      octaveRow.cellsX    = octave.cellsX;
+      octaveRow.scaleX    = octave.scaleX;
+      octaveRow.hashY0    = octave.seed ^ (iy0 * HASH_PRIME_Y);
+      octaveRow.hashY1    = octave.seed ^ (iy1 * HASH_PRIME_Y);
+      octaveRow.sy        = fade(ty);
+      octaveRow.amplitude = octave.amplitude;
+
+      rowKernel(row, x0, x1, octaveRow);
+    }
+  }
+}
+
+/* end of file */
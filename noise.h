@@ -0,0 +1,84 @@
+/***********************************************************************\
+*
+* Contents: periodic fractal value noise
+* Systems: all
+*
+\***********************************************************************/
+#ifndef NOISE_H
+#define NOISE_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+
+#include <sys/types.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** fractal value noise (fBm) which wraps seamlessly in x and y
+ *  direction, i. e. it can be mapped onto a torus without seams
+ */
+class FractalNoise
+{
+  public:
+    /** create fractal noise
+     * @param seed random seed
+     * @param octaves number of octaves
+     * @param baseFrequency number of lattice cells of first octave
+     *                      across map width
+     * @param persistence amplitude factor from one octave to the next
+     */
+    FractalNoise(uint32_t seed, uint octaves, uint baseFrequency, float persistence);
+
+    /** generate noise field
+     * @param field field to fill (width*height values in range
+     *              [-1..1], row by row)
+     * @param width,height field width+height
+     */
+    void generate(std::vector<float> &field, uint width, uint height) const;
+
+    /** get name of used SIMD kernel
+     * @return "avx2", "sse4.1" or "scalar"
+     */
+    static const char *getKernelName();
+
+  private:
+    struct Octave;
+
+    uint32_t seed;
+    uint     octaves;
+    uint     baseFrequency;
+    float    persistence;
+
+    /** generate noise for a tile of the field
+     * @param field field
+     * @param width,height field width+height
+     * @param octaveLattices lattices of the octaves
+     * @param x0,y0,x1,y1 tile area [x0,x1) x [y0,y1)
+     */
+    void generateTile(float                     *field,
+                      uint                      width,
+                      uint                      height,
+                      const std::vector<Octave> &octaveLattices,
+                      uint                      x0,
+                      uint                      y0,
+                      uint                      x1,
+                      uint                      y1
+                     ) const;
+};
+
+#endif // NOISE_H
+
+/* end of file */
@@ -0,0 +1,191 @@
+/***********************************************************************\
+*
+* Contents: parallel execution helpers
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+
+#include "parallel.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/** job of parallelFor(): run by the calling thread and by up to
+ *  maxHelperCount pool threads
+ */
+struct Job
+{
+  const std::function<void()> *worker;
+  uint                        maxHelperCount;
+  uint                        helperCount;     // pool threads running worker
+};
+
+/** pool of worker threads helping parallelFor(); the threads are
+ *  created once and live until exit. The calling thread always works on
+ *  its own job, so jobs complete even if all pool threads are busy, e. g.
+ *  with nested parallelFor() calls.
+ */
+class ThreadPool
+{
+  public:
+    /** create pool
+     * @param threadCount number of threads
+     */
+    ThreadPool(uint threadCount)
+    {
+      for (uint i = 0; i < threadCount; i++)
+      {
+        std::thread(&ThreadPool::helper, this).detach();
+      }
+    }
+
+    /** run job with the help of pool threads
+     * @param job job
+     */
+    void run(Job &job)
+    {
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.push_back(&job);
+      }
+      if (job.maxHelperCount > 1)
+      {
+        jobAvailable.notify_all();
+      }
+      else
+      {
+        jobAvailable.notify_one();
+      }
+
+      try
+      {
+        (*job.worker)();
+      }
+      catch (...)
+      {
+        finish(job);
+        throw;
+      }
+      finish(job);
+    }
+
+  private:
+    std::mutex               lock;
+    std::condition_variable  jobAvailable;
+    std::condition_variable  jobDone;
+    std::deque<Job*>         jobs;
+
+    /** stop new helpers and wait for the running helpers of a job
+     * @param job job
+     */
+    void finish(Job &job)
+    {
+      std::unique_lock<std::mutex> guard(lock);
+
+      auto iterator = std::find(jobs.begin(), jobs.end(), &job);
+      if (iterator != jobs.end())
+      {
+        jobs.erase(iterator);
+      }
+      jobDone.wait(guard, [&job]() { return job.helperCount == 0; });
+    }
+
+    /** pool thread: help with queued jobs
+     */
+    void helper()
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      while (true)
+      {
+        jobAvailable.wait(guard, [this]() { return !jobs.empty(); });
+
+        Job *job = jobs.front();
+        job->helperCount++;
+        if (job->helperCount >= job->maxHelperCount)
+        {
+          jobs.pop_front();
+        }
+
+        guard.unlock();
+        (*job->worker)();
+        guard.lock();
+
+        job->helperCount--;
+        if (job->helperCount == 0)
+        {
+          jobDone.notify_all();
+        }
+      }
+    }
+};
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+uint getThreadCount()
+{
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+void parallelFor(uint begin, uint end, uint blockSize, const std::function<void(uint blockBegin, uint blockEnd)> &function)
+{
+  assert(blockSize > 0);
+
+  if (begin >= end)
+  {
+    return;
+  }
+
+  uint blockCount  = (end - begin + blockSize - 1) / blockSize;
+  uint threadCount = std::min(getThreadCount(), blockCount);
+
+  // blocks are fetched dynamically, so uneven blocks do not stall other threads
+  std::atomic<uint> nextBlock(0);
+  const std::function<void()> worker = [&]()
+  {
+    uint block;
+    while ((block = nextBlock.fetch_add(1)) < blockCount)
+    {
+      uint blockBegin = begin + block * blockSize;
+      uint blockEnd   = std::min(blockBegin + blockSize, end);
+
+      function(blockBegin, blockEnd);
+    }
+  };
+
+  if (threadCount <= 1)
+  {
+    worker();
+    return;
+  }
+
+  // threads are re-used: the pool is created on the first call and never
+  // destroyed, so parallelFor() may still be called while exiting
+  static ThreadPool *threadPool = new ThreadPool(getThreadCount() - 1);
+
+  Job job;
+  job.worker         = &worker;
+  job.maxHelperCount = threadCount - 1;
+  job.helperCount    = 0;
+  threadPool->run(job);
+}
+
+/* end of file */
@@ -0,0 +1,43 @@
+/***********************************************************************\
+*
+* Contents: parallel execution helpers
+* Systems: all
+*
+\***********************************************************************/
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/****************************** Includes *******************************/
+#include <functional>
+
+#include <sys/types.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** get number of worker threads
+ * @return number of worker threads (at least 1)
+ */
+uint getThreadCount();
+
+/** run function on blocks of range [begin, end) in parallel
+ * @param begin,end range
+ * @param blockSize block size
+ * @param function function to call with sub-range [blockBegin, blockEnd)
+ */
+void parallelFor(uint begin, uint end, uint blockSize, const std::function<void(uint blockBegin, uint blockEnd)> &function);
+
+#endif // PARALLEL_H
+
+/* end of file */
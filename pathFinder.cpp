@@ -0,0 +1,824 @@
+/***********************************************************************\
+*
+* Contents: hierarchical path finder (HPA*)
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <cassert>
+
+#include "parallel.h"
+#include "islands.h"
+
+#include "pathFinder.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// min. length of a border segment with entrances at both ends instead of
+// one entrance in the middle
+LOCAL const uint LONG_ENTRANCE_LENGTH = 6;
+
+// clusters/borders per parallel block
+LOCAL const uint BLOCK_SIZE = 16;
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+const uint     PathFinder::DEFAULT_CLUSTER_SIZE;
+const uint32_t PathFinder::CostModel::BLOCKED;
+const uint32_t PathFinder::NONE;
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+PathFinder::CostModel::CostModel()
+{
+  for (uint i = 0; i < Tile::TYPE_COUNT; i++)
+  {
+    costs[i] = BLOCKED;
+  }
+}
+
+PathFinder::CostModel PathFinder::CostModel::land()
+{
+  CostModel costModel;
+  costModel.setCost(Tile::Types::LAND,     10);
+  costModel.setCost(Tile::Types::TREE,     15);
+  costModel.setCost(Tile::Types::MOUNTAIN, 40);
+  costModel.setCost(Tile::Types::BUILDING, 10);
+
+  return costModel;
+}
+
+PathFinder::CostModel PathFinder::CostModel::water()
+{
+  CostModel costModel;
+  costModel.setCost(Tile::Types::WATER, 10);
+
+  return costModel;
+}
+
+uint32_t PathFinder::CostModel::getMinCost() const
+{
+  return *std::min_element(costs, costs + Tile::TYPE_COUNT);
+}
+
+PathFinder::PathFinder(Map &map, const CostModel &costModel, uint clusterSize)
+  : map(map)
+  , costModel(costModel)
+  , clusterSize(clusterSize)
+  , width(0)
+  , height(0)
+  , clustersX(0)
+  , clustersY(0)
+  , searchGeneration(0)
+  , dirty(true)
+{
+  assert(clusterSize > 0);
+
+  map.addListener(this);
+}
+
+PathFinder::~PathFinder()
+{
+  map.removeListener(this);
+}
+
+bool PathFinder::findPath(uint x0, uint y0, uint x1, uint y1, Path &path)
+{
+  std::lock_guard<std::mutex> lock(graphLock);
+
+  Map::Snapshot snapshot;
+  updateGraph(snapshot);
+
+  path.waypoints.clear();
+  path.segmentClusters.clear();
+  path.cost = 0;
+
+  if ((x0 >= width) || (y0 >= height) || (x1 >= width) || (y1 >= height))
+  {
+    return false;
+  }
+
+  const uint32_t start = y0 * width + x0;
+  const uint32_t goal  = y1 * width + x1;
+  if ((getCost(snapshot, start) == CostModel::BLOCKED) || (getCost(snapshot, goal) == CostModel::BLOCKED))
+  {
+    return false;
+  }
+  if (start == goal)
+  {
+    path.waypoints.push_back(Coordinates(x0, y0));
+    return true;
+  }
+
+  // costs from start inside start cluster and to goal inside goal cluster
+  const uint32_t startCluster = getCluster(x0, y0);
+  const uint32_t goalCluster  = getCluster(x1, y1);
+  std::vector<uint32_t> tileCosts, startCosts, goalCosts;
+  getTileCosts(snapshot, startCluster, tileCosts);
+  computeCosts(startCluster, tileCosts, start, false, startCosts, nullptr);
+  getTileCosts(snapshot, goalCluster, tileCosts);
+  computeCosts(goalCluster, tileCosts, goal, true, goalCosts, nullptr);
+
+  // check if goal is reachable: start and goal connect to the same
+  // component or are connected inside the cluster
+  {
+    std::vector<uint32_t> startComponents;
+    const Cluster &cluster = clusters[startCluster];
+    for (uint32_t i = 0; i < cluster.nodes.size(); i++)
+    {
+      if (startCosts[getLocal(startCluster, cluster.nodes[i])] != CostModel::BLOCKED)
+      {
+        startComponents.push_back(nodeComponents[nodeBases[startCluster] + i]);
+      }
+    }
+
+    bool reachable =    (startCluster == goalCluster)
+                     && (startCosts[getLocal(startCluster, goal)] != CostModel::BLOCKED);
+    const Cluster &goalClusterNodes = clusters[goalCluster];
+    for (uint32_t i = 0; (i < goalClusterNodes.nodes.size()) && !reachable; i++)
+    {
+      if (goalCosts[getLocal(goalCluster, goalClusterNodes.nodes[i])] != CostModel::BLOCKED)
+      {
+        uint32_t component = nodeComponents[nodeBases[goalCluster] + i];
+        reachable = std::find(startComponents.begin(), startComponents.end(), component) != startComponents.end();
+      }
+    }
+    if (!reachable)
+    {
+      return false;
+    }
+  }
+
+  // A* on abstract graph; start and goal are virtual nodes
+  const uint32_t START_NODE = nodeBases.back();
+  const uint32_t GOAL_NODE  = nodeBases.back() + 1;
+  const uint64_t minCost    = costModel.getMinCost();
+
+  searchGeneration++;
+  if (searchGeneration == 0)
+  {
+    for (SearchState &searchState : searchStates)
+    {
+      searchState.generation = 0;
+    }
+    searchGeneration = 1;
+  }
+
+  // estimated total cost, inverted cost, node: on ties prefer candidates
+  // closer to the goal
+  typedef std::tuple<uint64_t, uint64_t, uint32_t> Candidate;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+
+  auto getHeuristic = [&](uint32_t index) -> uint64_t
+  {
+    uint dx = (index % width > x1) ? (index % width - x1) : (x1 - index % width);
+    uint dy = (index / width > y1) ? (index / width - y1) : (y1 - index / width);
+
+    return (static_cast<uint64_t>(std::min(dx, width - dx)) + std::min(dy, height - dy)) * minCost;
+  };
+  auto relax = [&](uint32_t node, uint32_t index, uint64_t cost, uint32_t parent, uint32_t segmentCluster)
+  {
+    SearchState &searchState = searchStates[node];
+    if ((searchState.generation != searchGeneration) || (cost < searchState.cost))
+    {
+      searchState.cost           = cost;
+      searchState.index          = index;
+      searchState.parent         = parent;
+      searchState.segmentCluster = segmentCluster;
+      searchState.generation     = searchGeneration;
+      candidates.push(Candidate(cost + getHeuristic(index), UINT64_MAX - cost, node));
+    }
+  };
+
+  {
+    const Cluster &cluster = clusters[startCluster];
+    for (uint32_t i = 0; i < cluster.nodes.size(); i++)
+    {
+      uint32_t cost = startCosts[getLocal(startCluster, cluster.nodes[i])];
+      if (cost != CostModel::BLOCKED)
+      {
+        relax(nodeBases[startCluster] + i, cluster.nodes[i], cost, START_NODE, startCluster);
+      }
+    }
+  }
+  if (startCluster == goalCluster)
+  {
+    uint32_t cost = startCosts[getLocal(startCluster, goal)];
+    if (cost != CostModel::BLOCKED)
+    {
+      relax(GOAL_NODE, goal, cost, START_NODE, startCluster);
+    }
+  }
+
+  bool found = false;
+  while (!candidates.empty())
+  {
+    uint64_t cost = UINT64_MAX - std::get<1>(candidates.top());
+    uint32_t node = std::get<2>(candidates.top());
+    candidates.pop();
+
+    if (cost > searchStates[node].cost)
+    {
+      continue;
+    }
+    if (node == GOAL_NODE)
+    {
+      found = true;
+      break;
+    }
+
+    const uint32_t index        = searchStates[node].index;
+    const uint32_t clusterIndex = getCluster(index % width, index / width);
+    const Cluster  &cluster     = clusters[clusterIndex];
+    const uint32_t i            = node - nodeBases[clusterIndex];
+    const size_t   n            = cluster.nodes.size();
+
+    // other entrances of cluster
+    for (size_t j = 0; j < n; j++)
+    {
+      uint32_t nodeCost = cluster.costs[i * n + j];
+      if ((j != i) && (nodeCost != CostModel::BLOCKED))
+      {
+        relax(nodeBases[clusterIndex] + j, cluster.nodes[j], cost + nodeCost, node, clusterIndex);
+      }
+    }
+    // entrances of neighbor clusters
+    for (const std::pair<uint32_t, uint32_t> &link : cluster.links[i])
+    {
+      uint32_t neighborCluster = getCluster(link.first % width, link.first / width);
+      uint32_t j               = getNode(clusters[neighborCluster], link.first);
+      assert(j != NONE);
+      relax(nodeBases[neighborCluster] + j, link.first, cost + link.second, node, NONE);
+    }
+    // goal
+    if (clusterIndex == goalCluster)
+    {
+      uint32_t goalCost = goalCosts[getLocal(goalCluster, index)];
+      if (goalCost != CostModel::BLOCKED)
+      {
+        relax(GOAL_NODE, goal, cost + goalCost, node, goalCluster);
+      }
+    }
+  }
+  if (!found)
+  {
+    return false;
+  }
+
+  // get waypoints from goal back to start; skip empty segments
+  path.cost = searchStates[GOAL_NODE].cost;
+  uint32_t node = GOAL_NODE;
+  uint32_t last = goal;
+  path.waypoints.push_back(Coordinates(x1, y1));
+  while (node != START_NODE)
+  {
+    const SearchState &searchState = searchStates[node];
+    uint32_t          parentIndex  = (searchState.parent != START_NODE) ? searchStates[searchState.parent].index : start;
+    if (parentIndex != last)
+    {
+      path.waypoints.push_back(Coordinates(parentIndex % width, parentIndex / width));
+      path.segmentClusters.push_back(searchState.segmentCluster);
+      last = parentIndex;
+    }
+    node = searchState.parent;
+  }
+  std::reverse(path.waypoints.begin(), path.waypoints.end());
+  std::reverse(path.segmentClusters.begin(), path.segmentClusters.end());
+
+  return true;
+}
+
+bool PathFinder::refine(const Path &path, size_t segment, std::vector<Coordinates> &tiles) const
+{
+  return refine(map.getSnapshot(), path, segment, tiles);
+}
+
+bool PathFinder::refine(const Path &path, std::vector<Coordinates> &tiles) const
+{
+  tiles.clear();
+  if (path.isEmpty())
+  {
+    return false;
+  }
+
+  const Map::Snapshot snapshot = map.getSnapshot();
+  tiles.push_back(path.waypoints[0]);
+  for (size_t segment = 0; segment < path.getSegmentCount(); segment++)
+  {
+    if (!refine(snapshot, path, segment, tiles))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool PathFinder::refine(const Map::Snapshot &snapshot, const Path &path, size_t segment, std::vector<Coordinates> &tiles) const
+{
+  assert(segment < path.getSegmentCount());
+
+  std::lock_guard<std::mutex> lock(graphLock);
+
+  if ((width != snapshot.getWidth()) || (height != snapshot.getHeight()))
+  {
+    return false;
+  }
+
+  const Coordinates &from = path.waypoints[segment];
+  const Coordinates &to   = path.waypoints[segment + 1];
+  const uint32_t    start = from.y * width + from.x;
+  const uint32_t    goal  = to.y * width + to.x;
+
+  if (path.segmentClusters[segment] == NONE)
+  {
+    // step into neighbor cluster
+    if (getCost(snapshot, goal) == CostModel::BLOCKED)
+    {
+      return false;
+    }
+    tiles.push_back(to);
+  }
+  else
+  {
+    // path inside cluster
+    const uint32_t cluster = path.segmentClusters[segment];
+    if ((cluster >= clusters.size()) || (getLocal(cluster, start) == NONE) || (getLocal(cluster, goal) == NONE))
+    {
+      return false;
+    }
+
+    std::vector<uint32_t> tileCosts, costs, parents;
+    getTileCosts(snapshot, cluster, tileCosts);
+    computeCosts(cluster, tileCosts, start, false, costs, &parents);
+    if (costs[getLocal(cluster, goal)] == CostModel::BLOCKED)
+    {
+      return false;
+    }
+
+    size_t n = tiles.size();
+    for (uint32_t index = goal; index != start; index = parents[getLocal(cluster, index)])
+    {
+      tiles.push_back(Coordinates(index % width, index / width));
+    }
+    std::reverse(tiles.begin() + n, tiles.end());
+  }
+
+  return true;
+}
+
+void PathFinder::update()
+{
+  std::lock_guard<std::mutex> lock(graphLock);
+
+  Map::Snapshot snapshot;
+  updateGraph(snapshot);
+}
+
+void PathFinder::onTileChanged(const Map &, uint x, uint y, const Tile &oldTile, const Tile &newTile)
+{
+  if (costModel.getCost(oldTile.getType()) == costModel.getCost(newTile.getType()))
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(dirtyLock);
+
+  setDirty(x, y);
+}
+
+void PathFinder::onTilesChanged(const Map &, uint x, uint y, uint n, const Tile oldTiles[], const Tile newTiles[])
+{
+  // lock once for the run, only if the cost of a tile changed
+  std::unique_lock<std::mutex> lock(dirtyLock, std::defer_lock);
+  for (uint i = 0; i < n; i++)
+  {
+    if (costModel.getCost(oldTiles[i].getType()) != costModel.getCost(newTiles[i].getType()))
+    {
+      if (!lock.owns_lock())
+      {
+        lock.lock();
+      }
+      setDirty(x + i, y);
+    }
+  }
+}
+
+void PathFinder::onMapChanged(const Map &)
+{
+  std::lock_guard<std::mutex> lock(dirtyLock);
+
+  dirtyClusters.clear();
+  dirty = true;
+}
+
+void PathFinder::updateGraph(Map::Snapshot &snapshot)
+{
+  // get changed clusters
+  std::vector<bool> changedClusters;
+  bool              changed;
+  bool              reinit;
+  {
+    std::lock_guard<std::mutex> lock(dirtyLock);
+
+    changed = dirty;
+    reinit  = dirtyClusters.empty();
+    if (changed && !reinit)
+    {
+      changedClusters.swap(dirtyClusters);
+      dirtyClusters.assign(clusters.size(), false);
+    }
+    dirty = false;
+  }
+
+  // snapshot after the dirty state was taken: tiles changed meanwhile are
+  // in the snapshot and mark their clusters dirty again
+  snapshot = map.getSnapshot();
+
+  if (reinit || (width != snapshot.getWidth()) || (height != snapshot.getHeight()))
+  {
+    std::lock_guard<std::mutex> lock(dirtyLock);
+
+    width     = snapshot.getWidth();
+    height    = snapshot.getHeight();
+    clustersX = (width  + clusterSize - 1) / clusterSize;
+    clustersY = (height + clusterSize - 1) / clusterSize;
+    clusters.assign(static_cast<size_t>(clustersX) * clustersY, Cluster());
+    borders.assign(2 * clusters.size(), Border());
+    changedClusters.assign(clusters.size(), true);
+
+    // map replaced meanwhile: re-init all clusters again next time
+    if (dirty)
+    {
+      dirtyClusters.clear();
+    }
+    else
+    {
+      dirtyClusters.assign(clusters.size(), false);
+    }
+  }
+  else if (!changed)
+  {
+    return;
+  }
+
+  // borders and clusters to update: borders of changed clusters, nodes of
+  // changed clusters and their neighbors
+  std::vector<bool> updateBorders(borders.size(), false);
+  std::vector<bool> updateClusters(clusters.size(), false);
+  for (uint32_t cluster = 0; cluster < clusters.size(); cluster++)
+  {
+    if (changedClusters[cluster])
+    {
+      uint32_t cx    = cluster % clustersX;
+      uint32_t cy    = cluster / clustersX;
+      uint32_t left  = cy * clustersX + (cx + clustersX - 1) % clustersX;
+      uint32_t right = cy * clustersX + (cx + 1) % clustersX;
+      uint32_t up    = ((cy + clustersY - 1) % clustersY) * clustersX + cx;
+      uint32_t down  = ((cy + 1) % clustersY) * clustersX + cx;
+
+      updateBorders[2 * cluster + 0] = true;
+      updateBorders[2 * cluster + 1] = true;
+      updateBorders[2 * left    + 0] = true;
+      updateBorders[2 * up      + 1] = true;
+
+      updateClusters[cluster] = true;
+      updateClusters[left   ] = true;
+      updateClusters[right  ] = true;
+      updateClusters[up     ] = true;
+      updateClusters[down   ] = true;
+    }
+  }
+
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 0; i < borders.size(); i++)
+  {
+    if (updateBorders[i]) indices.push_back(i);
+  }
+  parallelFor(0, indices.size(), BLOCK_SIZE, [&](uint i0, uint i1)
+  {
+    for (uint i = i0; i < i1; i++)
+    {
+      updateBorder(snapshot, indices[i] / 2, (indices[i] % 2) != 0);
+    }
+  });
+
+  indices.clear();
+  for (uint32_t i = 0; i < clusters.size(); i++)
+  {
+    if (updateClusters[i]) indices.push_back(i);
+  }
+  parallelFor(0, indices.size(), BLOCK_SIZE, [&](uint i0, uint i1)
+  {
+    for (uint i = i0; i < i1; i++)
+    {
+      updateCluster(snapshot, indices[i]);
+    }
+  });
+
+  // dense node numbering for searches
+  nodeBases.resize(clusters.size() + 1);
+  nodeBases[0] = 0;
+  for (size_t i = 0; i < clusters.size(); i++)
+  {
+    nodeBases[i + 1] = nodeBases[i] + static_cast<uint32_t>(clusters[i].nodes.size());
+  }
+  searchStates.assign(nodeBases.back() + 2, SearchState());
+  searchGeneration = 0;
+
+  // connected components of the abstract graph with union-find, to reject
+  // unreachable goals without searching
+  nodeComponents.resize(nodeBases.back());
+  for (uint32_t node = 0; node < nodeComponents.size(); node++)
+  {
+    nodeComponents[node] = node;
+  }
+  auto find = [this](uint32_t node) -> uint32_t
+  {
+    while (nodeComponents[node] != node)
+    {
+      nodeComponents[node] = nodeComponents[nodeComponents[node]];
+      node = nodeComponents[node];
+    }
+
+    return node;
+  };
+  auto join = [&find, this](uint32_t node1, uint32_t node2)
+  {
+    uint32_t root1 = find(node1);
+    uint32_t root2 = find(node2);
+    if (root1 != root2)
+    {
+      nodeComponents[std::max(root1, root2)] = std::min(root1, root2);
+    }
+  };
+  for (uint32_t clusterIndex = 0; clusterIndex < clusters.size(); clusterIndex++)
+  {
+    const Cluster &cluster = clusters[clusterIndex];
+    const size_t  n        = cluster.nodes.size();
+    for (size_t i = 0; i < n; i++)
+    {
+      for (size_t j = i + 1; j < n; j++)
+      {
+        if (cluster.costs[i * n + j] != CostModel::BLOCKED)
+        {
+          join(nodeBases[clusterIndex] + i, nodeBases[clusterIndex] + j);
+        }
+      }
+      for (const std::pair<uint32_t, uint32_t> &link : cluster.links[i])
+      {
+        uint32_t neighborCluster = getCluster(link.first % width, link.first / width);
+        join(nodeBases[clusterIndex] + i, nodeBases[neighborCluster] + getNode(clusters[neighborCluster], link.first));
+      }
+    }
+  }
+  for (uint32_t node = 0; node < nodeComponents.size(); node++)
+  {
+    nodeComponents[node] = find(node);
+  }
+}
+
+void PathFinder::getTileCosts(const Map::Snapshot &snapshot, uint32_t cluster, std::vector<uint32_t> &tileCosts) const
+{
+  uint x0, y0, x1, y1;
+  getClusterRect(cluster, x0, y0, x1, y1);
+
+  tileCosts.resize(static_cast<size_t>(x1 - x0) * (y1 - y0));
+  size_t i = 0;
+  for (uint y = y0; y < y1; y++)
+  {
+    for (uint x = x0; x < x1; x++)
+    {
+      tileCosts[i] = costModel.getCost(snapshot.getTile(x, y).getType());
+      i++;
+    }
+  }
+}
+
+void PathFinder::updateBorder(const Map::Snapshot &snapshot, uint32_t cluster, bool bottom)
+{
+  uint x0, y0, x1, y1;
+  getClusterRect(cluster, x0, y0, x1, y1);
+
+  // tiles on both sides of the border, neighbor wraps around
+  const uint length = bottom ? (x1 - x0) : (y1 - y0);
+  auto getTransition = [&](uint i) -> std::pair<uint32_t, uint32_t>
+  {
+    if (bottom)
+    {
+      return std::make_pair((y1 - 1) * width + (x0 + i), (y1 % height) * width + (x0 + i));
+    }
+    else
+    {
+      return std::make_pair((y0 + i) * width + (x1 - 1), (y0 + i) * width + (x1 % width));
+    }
+  };
+  auto isPassable = [&](uint i) -> bool
+  {
+    std::pair<uint32_t, uint32_t> transition = getTransition(i);
+    return    (getCost(snapshot, transition.first ) != CostModel::BLOCKED)
+           && (getCost(snapshot, transition.second) != CostModel::BLOCKED);
+  };
+
+  // one entrance per segment of passable tile pairs; two for long segments
+  Border &border = borders[2 * cluster + (bottom ? 1 : 0)];
+  border.transitions.clear();
+  uint i = 0;
+  while (i < length)
+  {
+    if (isPassable(i))
+    {
+      uint j = i;
+      while ((j < length) && isPassable(j))
+      {
+        j++;
+      }
+
+      if ((j - i) >= LONG_ENTRANCE_LENGTH)
+      {
+        border.transitions.push_back(getTransition(i));
+        border.transitions.push_back(getTransition(j - 1));
+      }
+      else
+      {
+        border.transitions.push_back(getTransition(i + (j - i) / 2));
+      }
+
+      i = j;
+    }
+    else
+    {
+      i++;
+    }
+  }
+}
+
+void PathFinder::updateCluster(const Map::Snapshot &snapshot, uint32_t clusterIndex)
+{
+  Cluster &cluster = clusters[clusterIndex];
+
+  cluster.nodes.clear();
+  cluster.links.clear();
+  cluster.costs.clear();
+
+  auto addLink = [&](uint32_t index, uint32_t neighborIndex)
+  {
+    uint32_t i = getNode(cluster, index);
+    if (i == NONE)
+    {
+      i = static_cast<uint32_t>(cluster.nodes.size());
+      cluster.nodes.push_back(index);
+      cluster.links.push_back(std::vector<std::pair<uint32_t, uint32_t>>());
+    }
+    cluster.links[i].push_back(std::make_pair(neighborIndex, getCost(snapshot, neighborIndex)));
+  };
+
+  // entrances from own right/bottom borders and the borders of the
+  // left/top neighbors
+  uint32_t cx   = clusterIndex % clustersX;
+  uint32_t cy   = clusterIndex / clustersX;
+  uint32_t left = cy * clustersX + (cx + clustersX - 1) % clustersX;
+  uint32_t up   = ((cy + clustersY - 1) % clustersY) * clustersX + cx;
+  for (uint side = 0; side < 2; side++)
+  {
+    for (const std::pair<uint32_t, uint32_t> &transition : borders[2 * clusterIndex + side].transitions)
+    {
+      addLink(transition.first, transition.second);
+    }
+  }
+  for (const std::pair<uint32_t, uint32_t> &transition : borders[2 * left + 0].transitions)
+  {
+    addLink(transition.second, transition.first);
+  }
+  for (const std::pair<uint32_t, uint32_t> &transition : borders[2 * up + 1].transitions)
+  {
+    addLink(transition.second, transition.first);
+  }
+
+  // costs between entrances
+  const size_t n = cluster.nodes.size();
+  cluster.costs.resize(n * n);
+
+  std::vector<uint32_t> tileCosts, costs;
+  getTileCosts(snapshot, clusterIndex, tileCosts);
+  for (size_t i = 0; i < n; i++)
+  {
+    computeCosts(clusterIndex, tileCosts, cluster.nodes[i], false, costs, nullptr);
+    for (size_t j = 0; j < n; j++)
+    {
+      cluster.costs[i * n + j] = costs[getLocal(clusterIndex, cluster.nodes[j])];
+    }
+  }
+}
+
+void PathFinder::computeCosts(uint32_t                    cluster,
+                              const std::vector<uint32_t> &tileCosts,
+                              uint32_t                    index,
+                              bool                        reverse,
+                              std::vector<uint32_t>       &costs,
+                              std::vector<uint32_t>       *parents
+                             ) const
+{
+  uint x0, y0, x1, y1;
+  getClusterRect(cluster, x0, y0, x1, y1);
+  const uint w = x1 - x0;
+  const uint h = y1 - y0;
+
+  costs.assign(static_cast<size_t>(w) * h, CostModel::BLOCKED);
+  if (parents != nullptr)
+  {
+    parents->assign(static_cast<size_t>(w) * h, NONE);
+  }
+
+  // Dijkstra inside cluster; reverse: cost of a step is the cost to enter
+  // the tile closer to the start tile
+  typedef std::pair<uint64_t, uint32_t> Candidate;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+
+  uint32_t local = getLocal(cluster, index);
+  assert(local != NONE);
+  costs[local] = 0;
+  candidates.push(Candidate(0, local));
+  while (!candidates.empty())
+  {
+    uint64_t cost = candidates.top().first;
+    uint32_t u    = candidates.top().second;
+    candidates.pop();
+    if (cost > costs[u])
+    {
+      continue;
+    }
+
+    uint ux = u % w;
+    uint uy = u / w;
+    const uint32_t neighbors[4] =
+    {
+      (ux > 0    ) ? u - 1 : NONE,
+      (ux + 1 < w) ? u + 1 : NONE,
+      (uy > 0    ) ? u - w : NONE,
+      (uy + 1 < h) ? u + w : NONE
+    };
+    for (uint32_t v : neighbors)
+    {
+      if ((v != NONE) && (tileCosts[v] != CostModel::BLOCKED))
+      {
+        uint64_t newCost = cost + (reverse ? tileCosts[u] : tileCosts[v]);
+        if (newCost < costs[v])
+        {
+          costs[v] = static_cast<uint32_t>(newCost);
+          if (parents != nullptr)
+          {
+            (*parents)[v] = (y0 + uy) * width + (x0 + ux);
+          }
+          candidates.push(Candidate(newCost, v));
+        }
+      }
+    }
+  }
+}
+
+uint32_t PathFinder::getLocal(uint32_t cluster, uint32_t index) const
+{
+  uint x0, y0, x1, y1;
+  getClusterRect(cluster, x0, y0, x1, y1);
+
+  uint x = index % width;
+  uint y = index / width;
+  if ((x < x0) || (x >= x1) || (y < y0) || (y >= y1))
+  {
+    return NONE;
+  }
+
+  return (y - y0) * (x1 - x0) + (x - x0);
+}
+
+uint32_t PathFinder::getNode(const Cluster &cluster, uint32_t index)
+{
+  for (uint32_t i = 0; i < cluster.nodes.size(); i++)
+  {
+    if (cluster.nodes[i] == index)
+    {
+      return i;
+    }
+  }
+
+  return NONE;
+}
+
+/* end of file */
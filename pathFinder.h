@@ -0,0 +1,345 @@
+/***********************************************************************\
+*
+* Contents: hierarchical path finder (HPA*)
+* Systems: all
+*
+\***********************************************************************/
+#ifndef PATH_FINDER_H
+#define PATH_FINDER_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <utility>
+#include <mutex>
+
+#include "islands.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** hierarchical path finder (HPA*): the map is divided into clusters.
+ *  Entrances between neighbor clusters and the costs between the
+ *  entrances of a cluster are pre-computed into an abstract graph, which
+ *  is searched with A*. Paths are refined to tiles on demand, segment
+ *  by segment. Tile changes only invalidate the touched clusters, which
+ *  are re-computed on the next query. Moves are to the 4 neighbors and
+ *  wrap around at the map borders like the donut.
+ */
+class PathFinder : public MapListener
+{
+  public:
+    // default cluster width+height
+    static const uint DEFAULT_CLUSTER_SIZE = 32;
+
+    /** costs to enter a tile by tile type
+     */
+    class CostModel
+    {
+      public:
+        // tile cannot be entered
+        static const uint32_t BLOCKED = UINT32_MAX;
+
+        CostModel();
+
+        /** create cost model for land routes: land, trees, mountains,
+         *  buildings
+         * @return cost model
+         */
+        static CostModel land();
+
+        /** create cost model for sea routes: water only
+         * @return cost model
+         */
+        static CostModel water();
+
+        /** get cost to enter tile
+         * @param type tile type
+         * @return cost or BLOCKED
+         */
+        uint32_t getCost(Tile::Types type) const
+        {
+          return costs[static_cast<uint>(type)];
+        }
+
+        /** set cost to enter tile
+         * @param type tile type
+         * @param cost cost (>0) or BLOCKED
+         */
+        void setCost(Tile::Types type, uint32_t cost)
+        {
+          assert(cost > 0);
+
+          costs[static_cast<uint>(type)] = cost;
+        }
+
+        /** get min. cost of all tile types
+         * @return min. cost
+         */
+        uint32_t getMinCost() const;
+
+      private:
+        uint32_t costs[Tile::TYPE_COUNT];
+    };
+
+    /** path: waypoints of the abstract graph; refine with
+     *  PathFinder::refine()
+     */
+    class Path
+    {
+      public:
+        Path()
+          : cost(0)
+        {
+        }
+
+        /** check if path is empty
+         * @return true iff empty
+         */
+        bool isEmpty() const
+        {
+          return waypoints.empty();
+        }
+
+        /** get path cost
+         * @return sum of the costs of all entered tiles
+         */
+        uint64_t getCost() const
+        {
+          return cost;
+        }
+
+        /** get waypoints
+         * @return waypoints, start and goal included
+         */
+        const std::vector<Coordinates> &getWaypoints() const
+        {
+          return waypoints;
+        }
+
+        /** get number of segments
+         * @return number of segments between waypoints
+         */
+        size_t getSegmentCount() const
+        {
+          return !waypoints.empty() ? waypoints.size() - 1 : 0;
+        }
+
+      private:
+        friend class PathFinder;
+
+        std::vector<Coordinates> waypoints;
+        std::vector<uint32_t>    segmentClusters;  // cluster of segment or NONE for a step between clusters
+        uint64_t                 cost;
+    };
+
+    /** create path finder; registers as listener of map
+     * @param map map
+     * @param costModel cost model
+     * @param clusterSize cluster width+height
+     */
+    PathFinder(Map &map, const CostModel &costModel, uint clusterSize = DEFAULT_CLUSTER_SIZE);
+
+    /** destroy path finder
+     */
+    virtual ~PathFinder();
+
+    /** find path; thread-safe
+     * @param x0,y0 start position
+     * @param x1,y1 goal position
+     * @param path path
+     * @return true iff path found
+     */
+    bool findPath(uint x0, uint y0, uint x1, uint y1, Path &path);
+
+    /** refine path segment to tiles
+     * @param path path
+     * @param segment segment index [0..path.getSegmentCount()-1]
+     * @param tiles tiles of segment are appended, start waypoint of
+     *              segment excluded
+     * @return true iff refined, false if tiles changed meanwhile
+     */
+    bool refine(const Path &path, size_t segment, std::vector<Coordinates> &tiles) const;
+
+    /** refine whole path to tiles
+     * @param path path
+     * @param tiles tiles, start and goal included
+     * @return true iff refined, false if tiles changed meanwhile
+     */
+    bool refine(const Path &path, std::vector<Coordinates> &tiles) const;
+
+    /** update abstract graph of changed clusters; done automatically by
+     *  findPath()
+     */
+    void update();
+
+    void onTileChanged(const Map &map, uint x, uint y, const Tile &oldTile, const Tile &newTile) override;
+    void onTilesChanged(const Map &map, uint x, uint y, uint n, const Tile oldTiles[], const Tile newTiles[]) override;
+    void onMapChanged(const Map &map) override;
+
+  private:
+    // no cluster/node
+    static const uint32_t NONE = UINT32_MAX;
+
+    /** cluster: entrance nodes and costs between them
+     */
+    struct Cluster
+    {
+      std::vector<uint32_t>                                  nodes;  // node tile indices
+      std::vector<std::vector<std::pair<uint32_t, uint32_t>>> links;  // per node: tile index of node in neighbor cluster, cost
+      std::vector<uint32_t>                                  costs;  // costs[i*n+j]: cost from node i to node j
+    };
+
+    /** search state of an abstract node; valid if generation is the
+     *  current search generation
+     */
+    struct SearchState
+    {
+      uint64_t cost;
+      uint32_t index;           // tile index
+      uint32_t parent;          // parent node
+      uint32_t segmentCluster;  // cluster of segment from parent or NONE
+      uint32_t generation;
+    };
+
+    /** border between a cluster and its right resp. bottom neighbor:
+     *  pairs of tile indices (in cluster, in neighbor)
+     */
+    struct Border
+    {
+      std::vector<std::pair<uint32_t, uint32_t>> transitions;
+    };
+
+    Map                   &map;
+    const CostModel       costModel;
+    const uint            clusterSize;
+    uint                  width, height;
+    uint                  clustersX, clustersY;
+    std::vector<Cluster>  clusters;
+    std::vector<Border>   borders;         // 2 per cluster: right, bottom
+    std::vector<uint32_t> nodeBases;       // number of nodes in clusters before cluster
+    std::vector<uint32_t> nodeComponents;  // connected component of node
+    std::vector<SearchState> searchStates; // per node + start + goal
+    uint32_t              searchGeneration;
+    std::vector<bool>     dirtyClusters;   // empty: re-init all clusters
+    bool                  dirty;
+    std::mutex            dirtyLock;       // lock for dirtyClusters, dirty
+    mutable std::mutex    graphLock;       // lock for clusters, borders
+
+    /** mark cluster of tile as changed; dirtyLock must be held
+     * @param x,y position
+     */
+    void setDirty(uint x, uint y)
+    {
+      if (!dirtyClusters.empty() && (x < width) && (y < height))
+      {
+        dirtyClusters[getCluster(x, y)] = true;
+      }
+      dirty = true;
+    }
+
+    /** get cluster index of tile
+     * @param x,y position
+     * @return cluster index
+     */
+    uint32_t getCluster(uint x, uint y) const
+    {
+      return (y / clusterSize) * clustersX + (x / clusterSize);
+    }
+
+    /** get cost to enter tile
+     * @param snapshot map snapshot
+     * @param index tile index
+     * @return cost or CostModel::BLOCKED
+     */
+    uint32_t getCost(const Map::Snapshot &snapshot, uint32_t index) const
+    {
+      return costModel.getCost(snapshot.getTile(index % width, index / width).getType());
+    }
+
+    /** update abstract graph; graphLock must be locked
+     * @param snapshot map snapshot the graph was updated from; use it
+     *                 for all further tile reads
+     */
+    void updateGraph(Map::Snapshot &snapshot);
+
+    /** refine path segment to tiles; see refine()
+     * @param snapshot map snapshot
+     * @param path path
+     * @param segment segment index
+     * @param tiles tiles of segment are appended
+     * @return true iff refined
+     */
+    bool refine(const Map::Snapshot &snapshot, const Path &path, size_t segment, std::vector<Coordinates> &tiles) const;
+
+    /** get cluster rectangle
+     * @param cluster cluster index
+     * @param x0,y0,x1,y1 rectangle [x0,x1) x [y0,y1)
+     */
+    void getClusterRect(uint32_t cluster, uint &x0, uint &y0, uint &x1, uint &y1) const
+    {
+      x0 = (cluster % clustersX) * clusterSize;
+      y0 = (cluster / clustersX) * clusterSize;
+      x1 = std::min(x0 + clusterSize, width);
+      y1 = std::min(y0 + clusterSize, height);
+    }
+
+    /** get costs to enter the tiles of a cluster
+     * @param snapshot map snapshot
+     * @param cluster cluster index
+     * @param tileCosts costs, indexed by position inside cluster
+     */
+    void getTileCosts(const Map::Snapshot &snapshot, uint32_t cluster, std::vector<uint32_t> &tileCosts) const;
+
+    /** update border of cluster
+     * @param snapshot map snapshot
+     * @param cluster cluster index
+     * @param bottom true for bottom border, false for right border
+     */
+    void updateBorder(const Map::Snapshot &snapshot, uint32_t cluster, bool bottom);
+
+    /** update nodes and costs of cluster
+     * @param snapshot map snapshot
+     * @param cluster cluster index
+     */
+    void updateCluster(const Map::Snapshot &snapshot, uint32_t cluster);
+
+    /** compute costs from/to a tile to all tiles inside a cluster
+     * @param cluster cluster index
+     * @param tileCosts costs to enter the tiles of the cluster
+     * @param index tile index
+     * @param reverse false for costs from tile, true for costs to tile
+     * @param costs costs, indexed by position inside cluster
+     * @param parents parent tile indices or nullptr
+     */
+    void computeCosts(uint32_t cluster, const std::vector<uint32_t> &tileCosts, uint32_t index, bool reverse, std::vector<uint32_t> &costs, std::vector<uint32_t> *parents) const;
+
+    /** get position of tile inside cluster
+     * @param cluster cluster index
+     * @param index tile index
+     * @return position inside cluster or NONE if outside
+     */
+    uint32_t getLocal(uint32_t cluster, uint32_t index) const;
+
+    /** get local node index of tile in cluster
+     * @param cluster cluster
+     * @param index tile index
+     * @return node index or NONE
+     */
+    static uint32_t getNode(const Cluster &cluster, uint32_t index);
+};
+
+#endif // PATH_FINDER_H
+
+/* end of file */
@@ -0,0 +1,162 @@
+/***********************************************************************\
+*
+* Contents: scanline shape rasterizer
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "rasterizer.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+/***************************** Datatypes *******************************/
+
+/** polygon edge
+ */
+typedef struct
+{
+  int   yStart, yEnd;  // covered rows [yStart,yEnd)
+  float yTop;
+  float xTop;
+  float dxdy;
+} Edge;
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+void Rasterizer::polygon(const std::vector<Point> &points, const SpanHandler &spanHandler)
+{
+  // get edge table; horizontal edges and edges between two row centers
+  // do not cover any tile center
+  std::vector<Edge> edges;
+  for (size_t i = 0; i < points.size(); i++)
+  {
+    const Point &p0 = points[i];
+    const Point &p1 = points[(i + 1) % points.size()];
+
+    const Point &top    = (p0.y < p1.y) ? p0 : p1;
+    const Point &bottom = (p0.y < p1.y) ? p1 : p0;
+
+    Edge edge;
+    edge.yStart = static_cast<int>(ceilf(top.y - 0.5f));
+    edge.yEnd   = static_cast<int>(ceilf(bottom.y - 0.5f));
+    if (edge.yStart < edge.yEnd)
+    {
+      edge.yTop = top.y;
+      edge.xTop = top.x;
+      edge.dxdy = (bottom.x - top.x) / (bottom.y - top.y);
+      edges.push_back(edge);
+    }
+  }
+  if (edges.empty())
+  {
+    return;
+  }
+  std::sort(edges.begin(), edges.end(), [](const Edge &edge1, const Edge &edge2) { return edge1.yStart < edge2.yStart; });
+
+  int yEnd = 0;
+  for (const Edge &edge : edges)
+  {
+    yEnd = std::max(yEnd, edge.yEnd);
+  }
+
+  // scan rows with active edge list
+  std::vector<const Edge*> activeEdges;
+  std::vector<float>       xs;
+  size_t                   nextEdge = 0;
+  for (int y = edges[0].yStart; y < yEnd; y++)
+  {
+    while ((nextEdge < edges.size()) && (edges[nextEdge].yStart <= y))
+    {
+      activeEdges.push_back(&edges[nextEdge]);
+      nextEdge++;
+    }
+    activeEdges.erase(std::remove_if(activeEdges.begin(),
+                                     activeEdges.end(),
+                                     [y](const Edge *edge) { return edge->yEnd <= y; }
+                                    ),
+                      activeEdges.end()
+                     );
+
+    float yCenter = static_cast<float>(y) + 0.5f;
+    xs.clear();
+    for (const Edge *edge : activeEdges)
+    {
+      xs.push_back(edge->xTop + (yCenter - edge->yTop) * edge->dxdy);
+    }
+    std::sort(xs.begin(), xs.end());
+
+    for (size_t i = 0; i + 1 < xs.size(); i += 2)
+    {
+      int x0 = static_cast<int>(ceilf(xs[i    ] - 0.5f));
+      int x1 = static_cast<int>(ceilf(xs[i + 1] - 0.5f));
+      if (x0 < x1)
+      {
+        spanHandler(y, x0, x1);
+      }
+    }
+  }
+}
+
+void Rasterizer::circle(float centerX, float centerY, float radius, const SpanHandler &spanHandler)
+{
+  int y0 = static_cast<int>(ceilf(centerY - radius - 0.5f));
+  int y1 = static_cast<int>(floorf(centerY + radius - 0.5f));
+  for (int y = y0; y <= y1; y++)
+  {
+    float dy = (static_cast<float>(y) + 0.5f) - centerY;
+    float d  = radius * radius - dy * dy;
+    if (d >= 0.0f)
+    {
+      float halfWidth = sqrtf(d);
+      int   x0        = static_cast<int>(ceilf (centerX - halfWidth - 0.5f));
+      int   x1        = static_cast<int>(floorf(centerX + halfWidth - 0.5f)) + 1;
+      if (x0 < x1)
+      {
+        spanHandler(y, x0, x1);
+      }
+    }
+  }
+}
+
+void Rasterizer::distortedCircle(float                    centerX,
+                                 float                    centerY,
+                                 float                    radius,
+                                 const std::vector<float> &radiusOffsets,
+                                 const SpanHandler        &spanHandler
+                                )
+{
+  if (radiusOffsets.size() < 3)
+  {
+    circle(centerX, centerY, radius, spanHandler);
+    return;
+  }
+
+  std::vector<Point> points;
+  points.reserve(radiusOffsets.size());
+  for (size_t i = 0; i < radiusOffsets.size(); i++)
+  {
+    float angle = (2.0f * static_cast<float>(M_PI) * static_cast<float>(i)) / static_cast<float>(radiusOffsets.size());
+    float r     = std::max(0.0f, radius + radiusOffsets[i]);
+
+    points.push_back(Point(centerX + r * cosf(angle), centerY + r * sinf(angle)));
+  }
+
+  polygon(points, spanHandler);
+}
+
+/* end of file */
@@ -0,0 +1,87 @@
+/***********************************************************************\
+*
+* Contents: scanline shape rasterizer
+* Systems: all
+*
+\***********************************************************************/
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+/****************************** Includes *******************************/
+#include <vector>
+#include <functional>
+
+#include <sys/types.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** scanline rasterizer: converts shapes into horizontal spans of
+ *  covered tiles. A tile is covered if its center is inside the shape.
+ *  Spans are not clipped; the span handler has to clip or wrap them.
+ */
+class Rasterizer
+{
+  public:
+    /** polygon point
+     */
+    class Point
+    {
+      public:
+        float x, y;
+
+        Point(float x, float y)
+          : x(x)
+          , y(y)
+        {
+        }
+    };
+
+    /** span handler
+     * @param y row
+     * @param x0,x1 covered tiles [x0,x1)
+     */
+    typedef std::function<void(int y, int x0, int x1)> SpanHandler;
+
+    /** rasterize polygon (even-odd fill rule, may be concave)
+     * @param points polygon points
+     * @param spanHandler span handler
+     */
+    static void polygon(const std::vector<Point> &points, const SpanHandler &spanHandler);
+
+    /** rasterize circle
+     * @param centerX,centerY center
+     * @param radius radius
+     * @param spanHandler span handler
+     */
+    static void circle(float centerX, float centerY, float radius, const SpanHandler &spanHandler);
+
+    /** rasterize distorted circle: polygon with radial offsets
+     * @param centerX,centerY center
+     * @param radius radius
+     * @param radiusOffsets offsets to radius, one per polygon point
+     *                      (evenly distributed angles)
+     * @param spanHandler span handler
+     */
+    static void distortedCircle(float                    centerX,
+                                float                    centerY,
+                                float                    radius,
+                                const std::vector<float> &radiusOffsets,
+                                const SpanHandler        &spanHandler
+                               );
+};
+
+#endif // RASTERIZER_H
+
+/* end of file */
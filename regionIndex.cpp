@@ -0,0 +1,285 @@
+/***********************************************************************\
+*
+* Contents: region index: summed-area tables of map tiles
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "parallel.h"
+#include "islands.h"
+
+#include "regionIndex.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// columns per parallel block
+LOCAL const uint BLOCK_SIZE = 64;
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+const uint RegionIndex::TYPE_COUNT;
+const uint RegionIndex::CHUNK_SIZE;
+
+static_assert(RegionIndex::TYPE_COUNT == Tile::TYPE_COUNT, "number of tile types");
+static_assert(RegionIndex::CHUNK_SIZE * RegionIndex::CHUNK_SIZE <= UINT16_MAX, "chunk type counts fit into 16 bit");
+static_assert(RegionIndex::CHUNK_SIZE * RegionIndex::CHUNK_SIZE * 255ULL <= UINT32_MAX, "chunk color sums fit into 32 bit");
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+RegionIndex::Sums &RegionIndex::Sums::operator+=(const Sums &sums)
+{
+  for (uint i = 0; i < TYPE_COUNT; i++)
+  {
+    typeCounts[i] += sums.typeCounts[i];
+  }
+  for (uint i = 0; i < 3; i++)
+  {
+    colorSums[i] += sums.colorSums[i];
+  }
+
+  return *this;
+}
+
+RegionIndex::Sums &RegionIndex::Sums::operator-=(const Sums &sums)
+{
+  for (uint i = 0; i < TYPE_COUNT; i++)
+  {
+    typeCounts[i] -= sums.typeCounts[i];
+  }
+  for (uint i = 0; i < 3; i++)
+  {
+    colorSums[i] -= sums.colorSums[i];
+  }
+
+  return *this;
+}
+
+void RegionIndex::clear()
+{
+  width       = 0;
+  height      = 0;
+  chunkCountX = 0;
+  chunkCountY = 0;
+  dirtyY      = 0;
+  for (std::vector<uint16_t> &table : typeCountTables)
+  {
+    table.clear();
+    table.shrink_to_fit();
+  }
+  for (std::vector<uint32_t> &table : colorSumTables)
+  {
+    table.clear();
+    table.shrink_to_fit();
+  }
+  rowSums.clear();
+  rowSums.shrink_to_fit();
+  columnSums.clear();
+  columnSums.shrink_to_fit();
+  chunkSums.clear();
+  chunkSums.shrink_to_fit();
+}
+
+void RegionIndex::update(const Map &map)
+{
+  if ((map.getWidth() != width) || (map.getHeight() != height) || typeCountTables[0].empty())
+  {
+    width       = map.getWidth();
+    height      = map.getHeight();
+    chunkCountX = (width  + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunkCountY = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    dirtyY      = 0;
+
+    size_t n = static_cast<size_t>(width) * height;
+    for (std::vector<uint16_t> &table : typeCountTables)
+    {
+      table.assign(n, 0);
+    }
+    for (std::vector<uint32_t> &table : colorSumTables)
+    {
+      table.assign(n, 0);
+    }
+    rowSums.assign(static_cast<size_t>(chunkCountX + 1) * height, Sums());
+    columnSums.assign(static_cast<size_t>(width) * (chunkCountY + 1), Sums());
+    chunkSums.assign(static_cast<size_t>(chunkCountX + 1) * (chunkCountY + 1), Sums());
+  }
+
+  // tiles changed while updating invalidate the index again; read the
+  // tiles from a snapshot for a consistent view
+  uint y0 = dirtyY.exchange(height);
+  if (y0 >= height)
+  {
+    return;
+  }
+  const Map::Snapshot snapshot = map.getSnapshot();
+
+  // re-calculate all chunk rows from the chunk row of y0 on
+  uint chunkY0 = y0 / CHUNK_SIZE;
+
+  // chunk summed-area tables and row sums; one chunk row per block
+  parallelFor(chunkY0 * CHUNK_SIZE, height, CHUNK_SIZE, [&](uint blockBegin, uint blockEnd)
+  {
+    for (uint y = blockBegin; y < blockEnd; y++)
+    {
+      bool   firstRow     = (y == blockBegin);
+      size_t index        = static_cast<size_t>(y) * width;
+      size_t rowSumsIndex = static_cast<size_t>(y) * (chunkCountX + 1);
+
+      // sums of the row up to the current chunk; the row sums left of the
+      // first chunk are always 0
+      Sums sums;
+      for (uint chunkX = 0; chunkX < chunkCountX; chunkX++)
+      {
+
+        uint32_t typeCounts[TYPE_COUNT] = {0, 0, 0, 0, 0};
+        uint32_t colorSums[3]           = {0, 0, 0};
+        uint     x1                     = std::min((chunkX + 1) * CHUNK_SIZE, width);
+        for (uint x = chunkX * CHUNK_SIZE; x < x1; x++)
+        {
+          const Tile &tile = snapshot.getTile(x, y);
+
+          typeCounts[static_cast<uint>(tile.getType())]++;
+          colorSums[0] += tile.getColor().r;
+          colorSums[1] += tile.getColor().g;
+          colorSums[2] += tile.getColor().b;
+
+          for (uint i = 0; i < TYPE_COUNT; i++)
+          {
+            typeCountTables[i][index] = static_cast<uint16_t>(typeCounts[i] + (firstRow ? 0 : typeCountTables[i][index - width]));
+          }
+          for (uint i = 0; i < 3; i++)
+          {
+            colorSumTables[i][index] = colorSums[i] + (firstRow ? 0 : colorSumTables[i][index - width]);
+          }
+          index++;
+        }
+
+        for (uint i = 0; i < TYPE_COUNT; i++)
+        {
+          sums.typeCounts[i] += typeCounts[i];
+        }
+        for (uint i = 0; i < 3; i++)
+        {
+          sums.colorSums[i] += colorSums[i];
+        }
+
+        rowSumsIndex++;
+        rowSums[rowSumsIndex] = sums;
+        if (!firstRow)
+        {
+          rowSums[rowSumsIndex] += rowSums[rowSumsIndex - (chunkCountX + 1)];
+        }
+      }
+    }
+  });
+
+  // column sums of the chunk rows below chunkY0
+  parallelFor(0, width, BLOCK_SIZE, [&](uint blockBegin, uint blockEnd)
+  {
+    for (uint chunkY = chunkY0; chunkY < chunkCountY; chunkY++)
+    {
+      uint lastY = std::min((chunkY + 1) * CHUNK_SIZE, height) - 1;
+      for (uint x = blockBegin; x < blockEnd; x++)
+      {
+        Sums sums = columnSums[static_cast<size_t>(chunkY) * width + x];
+        sums += getChunkSums(x, lastY);
+        columnSums[static_cast<size_t>(chunkY + 1) * width + x] = sums;
+      }
+    }
+  });
+
+  // chunk sums of the chunk rows below chunkY0
+  for (uint chunkY = chunkY0; chunkY < chunkCountY; chunkY++)
+  {
+    uint lastY = std::min((chunkY + 1) * CHUNK_SIZE, height) - 1;
+    for (uint chunkX = 0; chunkX <= chunkCountX; chunkX++)
+    {
+      Sums sums = chunkSums[static_cast<size_t>(chunkY) * (chunkCountX + 1) + chunkX];
+      sums += rowSums[static_cast<size_t>(lastY) * (chunkCountX + 1) + chunkX];
+      chunkSums[static_cast<size_t>(chunkY + 1) * (chunkCountX + 1) + chunkX] = sums;
+    }
+  }
+}
+
+size_t RegionIndex::getSums(uint x, uint y, uint width, uint height, size_t typeCounts[TYPE_COUNT], uint64_t colorSums[3]) const
+{
+  assert(isValid());
+
+  uint x0 = std::min(x, this->width);
+  uint y0 = std::min(y, this->height);
+  uint x1 = static_cast<uint>(std::min(static_cast<size_t>(x) + width,  static_cast<size_t>(this->width )));
+  uint y1 = static_cast<uint>(std::min(static_cast<size_t>(y) + height, static_cast<size_t>(this->height)));
+
+  Sums sums = getPrefixSums(x1, y1);
+  sums += getPrefixSums(x0, y0);
+  sums -= getPrefixSums(x1, y0);
+  sums -= getPrefixSums(x0, y1);
+  for (uint i = 0; i < TYPE_COUNT; i++)
+  {
+    typeCounts[i] = static_cast<size_t>(sums.typeCounts[i]);
+  }
+  for (uint i = 0; i < 3; i++)
+  {
+    colorSums[i] = sums.colorSums[i];
+  }
+
+  return static_cast<size_t>(x1 - x0) * (y1 - y0);
+}
+
+RegionIndex::Sums RegionIndex::getChunkSums(uint x, uint y) const
+{
+  size_t index = static_cast<size_t>(y) * width + x;
+
+  Sums sums;
+  for (uint i = 0; i < TYPE_COUNT; i++)
+  {
+    sums.typeCounts[i] = typeCountTables[i][index];
+  }
+  for (uint i = 0; i < 3; i++)
+  {
+    sums.colorSums[i] = colorSumTables[i][index];
+  }
+
+  return sums;
+}
+
+RegionIndex::Sums RegionIndex::getPrefixSums(uint x, uint y) const
+{
+  uint chunkX = x / CHUNK_SIZE;
+  uint chunkY = y / CHUNK_SIZE;
+  uint dx     = x % CHUNK_SIZE;
+  uint dy     = y % CHUNK_SIZE;
+
+  // full chunks above/left, then the partial chunks above, left and the
+  // partial chunk of x,y itself
+  Sums sums = chunkSums[static_cast<size_t>(chunkY) * (chunkCountX + 1) + chunkX];
+  if (dx > 0)
+  {
+    sums += columnSums[static_cast<size_t>(chunkY) * width + (x - 1)];
+  }
+  if (dy > 0)
+  {
+    sums += rowSums[static_cast<size_t>(y - 1) * (chunkCountX + 1) + chunkX];
+  }
+  if ((dx > 0) && (dy > 0))
+  {
+    sums += getChunkSums(x - 1, y - 1);
+  }
+
+  return sums;
+}
+
+/* end of file */
@@ -0,0 +1,141 @@
+/***********************************************************************\
+*
+* Contents: region index: summed-area tables of map tiles
+* Systems: all
+*
+\***********************************************************************/
+#ifndef REGION_INDEX_H
+#define REGION_INDEX_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+
+#include <sys/types.h>
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+class Map;
+
+/***************************** Functions *******************************/
+
+/** region index: summed-area tables (integral images) of the tile type
+ *  counts and the tile color sums of a map. The map is split into chunks
+ *  with small summed-area tables of 16/32 bit per tile; sums over full
+ *  chunks and over chunk rows/columns are 64 bit. Sums over any rectangle
+ *  are computed from 4 prefix sums of up to 4 table entries each.
+ */
+class RegionIndex
+{
+  public:
+    // number of tile types, see Tile::Types
+    static const uint TYPE_COUNT = 5;
+    // chunk width+height; chunk sums fit into the 16/32 bit tables
+    static const uint CHUNK_SIZE = 128;
+
+    RegionIndex()
+      : width(0)
+      , height(0)
+      , chunkCountX(0)
+      , chunkCountY(0)
+      , dirtyY(0)
+    {
+    }
+
+    /** clear index
+     */
+    void clear();
+
+    /** invalidate index from row on; thread-safe
+     * @param y row
+     */
+    void invalidate(uint y)
+    {
+      uint current = dirtyY.load();
+      while ((y < current) && !dirtyY.compare_exchange_weak(current, y))
+      {
+      }
+    }
+
+    /** check if index is up-to-date
+     * @return true iff up-to-date
+     */
+    bool isValid() const
+    {
+      return !typeCountTables[0].empty() && (dirtyY.load() >= height);
+    }
+
+    /** update index: re-calculate all rows from first invalid row on in
+     *  parallel
+     * @param map map
+     */
+    void update(const Map &map);
+
+    /** get sums in rectangle
+     * @param x,y top left position
+     * @param width,height rectangle size (clipped to map)
+     * @param typeCounts number of tiles per type
+     * @param colorSums sums of red, green, blue
+     * @return number of tiles in clipped rectangle
+     */
+    size_t getSums(uint x, uint y, uint width, uint height, size_t typeCounts[TYPE_COUNT], uint64_t colorSums[3]) const;
+
+  private:
+    /** 64 bit sums
+     */
+    struct Sums
+    {
+      uint64_t typeCounts[TYPE_COUNT];
+      uint64_t colorSums[3];
+
+      Sums()
+        : typeCounts{0, 0, 0, 0, 0}
+        , colorSums{0, 0, 0}
+      {
+      }
+
+      Sums &operator+=(const Sums &sums);
+      Sums &operator-=(const Sums &sums);
+    };
+
+    uint                  width, height;
+    uint                  chunkCountX, chunkCountY;
+    std::atomic<uint>     dirtyY;
+    // summed-area tables within chunks: sums from chunk top left to tile
+    // (inclusive), width x height
+    std::vector<uint16_t> typeCountTables[TYPE_COUNT];
+    std::vector<uint32_t> colorSumTables[3];
+    // sums of full chunks left of a chunk from the chunk top row to a row
+    // (inclusive), (chunkCountX+1) x height
+    std::vector<Sums>     rowSums;
+    // sums of full chunks above a column of a chunk, width x (chunkCountY+1)
+    std::vector<Sums>     columnSums;
+    // sums of full chunks above/left of a chunk, (chunkCountX+1) x (chunkCountY+1)
+    std::vector<Sums>     chunkSums;
+
+    /** get sums of chunk summed-area table at tile
+     * @param x,y tile position
+     * @return sums from chunk top left to x,y (inclusive)
+     */
+    Sums getChunkSums(uint x, uint y) const;
+
+    /** get sums of rectangle [0,x) x [0,y)
+     * @param x,y position [0..width] x [0..height]
+     * @return sums
+     */
+    Sums getPrefixSums(uint x, uint y) const;
+};
+
+#endif // REGION_INDEX_H
+
+/* end of file */
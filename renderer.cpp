@@ -0,0 +1,1265 @@
+/***********************************************************************\
+*
+* Contents: renderer: donut world mesh, shaders and map texture
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+
+#include <epoxy/gl.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "color.h"
+#include "islands.h"
+#include "virtualTexture.h"
+#include "indexedTexture.h"
+#include "mipTexture.h"
+#include "labelTexture.h"
+#include "distanceField.h"
+
+#include "renderer.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// donut faces+size
+LOCAL const uint STEPS1 = 18 * 2;
+LOCAL const uint STEPS2 = 24 * 2;
+LOCAL const float R1 = 0.3;
+LOCAL const float R2 = 0.6;
+
+// relief mesh: grid of the finest level of detail; coarser levels use
+// every 2nd, 4th, ... grid point of the same vertex buffer
+LOCAL const uint GRID_RING_STEPS = 256;
+LOCAL const uint GRID_TUBE_STEPS = 128;
+// min. size of a grid quad around the ring [pixel]
+LOCAL const uint LOD_MIN_QUAD_SIZE = 2;
+
+// elevation texture unit (map textures use units 0..4)
+LOCAL const GLint ELEVATION_TEXTURE_UNIT = 5;
+// distance to the coast of max. elevation if the map has no elevation
+// field [fraction of map width]
+LOCAL const float COAST_RELIEF_DISTANCE = 1.0f / 16.0f;
+
+// vertex attribute locations
+LOCAL const GLuint POSITION_LOCATION = 0;
+LOCAL const GLuint COLOR_LOCATION    = 1;
+LOCAL const GLuint UV_LOCATION       = 2;
+// instance attribute locations: transform uses 4 locations (columns)
+LOCAL const GLuint TRANSFORM_LOCATION = 3;
+LOCAL const GLuint LAYER_LOCATION     = 7;
+
+// relief: vertices are displaced along the donut normal by the
+// elevation texture; hill shading from the elevation slope
+LOCAL const char *VERTEX_SHADER =
+  "#version 300 es\n"
+  "uniform mat4      projectionViewModel;\n"
+  "uniform mediump vec2 textureTranslate;  // shared with fragment shader\n"
+  "uniform sampler2D elevationSampler;\n"
+  "uniform float     reliefHeight;\n"
+  "uniform vec2      radii;\n"
+  "in vec3           vPosition;\n"
+  "in vec3           vColor;\n"
+  "in vec2           vUV;\n"
+  "out vec3          color;\n"
+  "out vec2          uv;\n"
+  "out float         shade;\n"
+  "\n"
+  "void main()\n"
+  "{\n"
+  "  vec2  w  = vUV + textureTranslate;\n"
+  "  vec2  d  = 1.0 / vec2(textureSize(elevationSampler, 0));\n"
+  "  float e  = textureLod(elevationSampler, w, 0.0).r;\n"
+  "  float ex = textureLod(elevationSampler, w + vec2(d.x, 0.0), 0.0).r;\n"
+  "  float ey = textureLod(elevationSampler, w + vec2(0.0, d.y), 0.0).r;\n"
+  "  vec3  n  = normalize(vPosition - vec3(normalize(vPosition.xy) * radii.x, 0.0));\n"
+  "  gl_Position = projectionViewModel * vec4(vPosition + n * (e * reliefHeight), 1.0);\n"
+  "  vec2  slope = vec2(ex - e, ey - e) * reliefHeight / (d * 6.2831853 * radii);\n"
+  "  shade = clamp(1.0 - 2.0 * (slope.x + slope.y), 0.5, 1.5);\n"
+  "  color = vColor;\n"
+  "  uv = vUV;\n"
+  "}\n";
+
+LOCAL const char *FRAGMENT_SHADER_HEADER =
+  "#version 300 es\n"
+  "precision mediump float;\n";
+
+LOCAL const char *MIP_FRAGMENT_SHADER =
+  "uniform sampler2D textureSampler;\n"
+  "uniform vec2      textureTranslate;\n"
+  "in vec3           color;\n"
+  "in vec2           uv;\n"
+  "in float          shade;\n"
+  "out vec4          fragment;\n"
+  "void main()\n"
+  "{\n"
+  "  vec2 w = vec2(uv.x+textureTranslate.x,uv.y+textureTranslate.y);\n"
+  "  vec4 c = texture(textureSampler, w);\n"
+  "  c = labelTextureOverlay(c, uv + textureTranslate);\n"
+  "  fragment = vec4(c.rgb * shade, c.a);\n"
+  "}\n";
+
+LOCAL const char *INDEXED_FRAGMENT_SHADER =
+  "uniform vec2      textureTranslate;\n"
+  "in vec3           color;\n"
+  "in vec2           uv;\n"
+  "in float          shade;\n"
+  "out vec4          fragment;\n"
+  "void main()\n"
+  "{\n"
+  "  vec4 c = indexedTextureColor(uv + textureTranslate);\n"
+  "  c = labelTextureOverlay(c, uv + textureTranslate);\n"
+  "  fragment = vec4(c.rgb * shade, c.a);\n"
+  "}\n";
+
+LOCAL const char *VIRTUAL_FRAGMENT_SHADER =
+  "uniform vec2      textureTranslate;\n"
+  "in vec3           color;\n"
+  "in vec2           uv;\n"
+  "in float          shade;\n"
+  "out vec4          fragment;\n"
+  "void main()\n"
+  "{\n"
+  "  vec4 c = virtualTextureColor(uv + textureTranslate);\n"
+  "  c = labelTextureOverlay(c, uv + textureTranslate);\n"
+  "  fragment = vec4(c.rgb * shade, c.a);\n"
+  "}\n";
+
+// feedback pass: visible virtual texture pages
+LOCAL const char *FEEDBACK_FRAGMENT_SHADER =
+  "uniform vec2      textureTranslate;\n"
+  "in vec3           color;\n"
+  "in vec2           uv;\n"
+  "out vec4          fragment;\n"
+  "void main()\n"
+  "{\n"
+  "  fragment = virtualTextureFeedback(uv + textureTranslate);\n"
+  "}\n";
+
+// pick pass: map texture position
+LOCAL const char *PICK_FRAGMENT_SHADER =
+  "uniform vec2        textureTranslate;\n"
+  "uniform highp uvec2 pickTextureSize;\n"
+  "in vec3             color;\n"
+  "in highp vec2       uv;\n"
+  "out highp uvec4     fragment;\n"
+  "void main()\n"
+  "{\n"
+  "  highp vec2 w = fract(uv + textureTranslate);\n"
+  "  fragment = uvec4(min(uvec2(w * vec2(pickTextureSize)), pickTextureSize - 1u), 1u, 0u);\n"
+  "}\n";
+
+// instanced: transform and map texture layer per instance
+LOCAL const char *INSTANCED_VERTEX_SHADER =
+  "#version 300 es\n"
+  "uniform mat4 projectionView;\n"
+  "uniform mat4 model;\n"
+  "in vec3      vPosition;\n"
+  "in vec3      vColor;\n"
+  "in vec2      vUV;\n"
+  "in mat4      iTransform;\n"
+  "in uint      iLayer;\n"
+  "out vec3     color;\n"
+  "out vec2     uv;\n"
+  "flat out uint layer;\n"
+  "\n"
+  "void main()\n"
+  "{\n"
+  "  gl_Position = projectionView * iTransform * model * vec4(vPosition, 1.0);\n"
+  "  color = vColor;\n"
+  "  uv = vUV;\n"
+  "  layer = iLayer;\n"
+  "}\n";
+
+LOCAL const char *INSTANCED_FRAGMENT_SHADER =
+  "#version 300 es\n"
+  "precision mediump float;\n"
+  "uniform mediump sampler2DArray textureSampler;\n"
+  "uniform vec2      textureTranslate;\n"
+  "in vec3           color;\n"
+  "in vec2           uv;\n"
+  "flat in uint      layer;\n"
+  "out vec4          fragment;\n"
+  "void main()\n"
+  "{\n"
+  "  fragment = texture(textureSampler, vec3(uv + textureTranslate, float(layer)));\n"
+  "}\n";
+
+/***************************** Datatypes *******************************/
+typedef struct
+{
+  glm::vec3 position;
+  glm::vec3 color;
+  glm::vec2 uv;
+} Vertex;
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** add triangle to vertices
+ * @param vertices vertices
+ * @param p0,p1,p2 triangle points
+ * @param uv0,uv1,uv2 triangle UV map points
+ */
+LOCAL void addTriangle(std::vector<Vertex> &vertices,
+                       const glm::vec3     &p0,
+                       const glm::vec3     &p1,
+                       const glm::vec3     &p2,
+                       const glm::vec2     &uv0,
+                       const glm::vec2     &uv1,
+                       const glm::vec2     &uv2
+                      )
+{
+  glm::vec3 c0 = { 1.0f, 0.0f, 0.0f };
+  glm::vec3 c1 = { 0.0f, 1.0f, 0.0f };
+  glm::vec3 c2 = { 0.0f, 0.0f, 1.0f };
+
+  // add triangle
+  vertices.push_back(Vertex{p0, c0, uv0});
+  vertices.push_back(Vertex{p1, c1, uv1});
+  vertices.push_back(Vertex{p2, c2, uv2});
+}
+
+/** add quad to vertices
+ * @param vertices vertices
+ * @param p0,p1,p2,p3 quad points
+ * @param uv0,uv1,uv2,uv3 quad UV map points
+ */
+LOCAL void addQuad(std::vector<Vertex> &vertices,
+                   const glm::vec3     &p0,
+                   const glm::vec3     &p1,
+                   const glm::vec3     &p2,
+                   const glm::vec3     &p3,
+                   const glm::vec2     &uv0,
+                   const glm::vec2     &uv1,
+                   const glm::vec2     &uv2,
+                   const glm::vec2     &uv3
+                  )
+{
+  addTriangle(vertices, p0, p1, p2, uv0, uv1, uv2);
+  addTriangle(vertices, p2, p3, p0, uv2, uv3, uv0);
+}
+
+/** create donut world segment
+ * @param segment segment
+ * @param maxSegmentCount max. segment count
+ * @param radius radius
+ * @param translateY translation along y-axis
+ */
+LOCAL void createDonutWorldSegment(glm::vec3 segment[], uint maxSegmentCount, float radius, float translateY)
+{
+  // get circle segment
+  segment[0] = glm::vec3(0.0f, radius, 0.0f);
+
+  for (uint i = 1; i < maxSegmentCount; i++)
+  {
+    float th = (2 * M_PI * (float)i) / (float)maxSegmentCount;
+
+    glm::vec3 eulers(th, 0.0, 0.0);
+    glm::quat q = glm::quat(eulers);
+
+    segment[i] = segment[0] * q;
+  }
+
+  segment[maxSegmentCount - 1] = segment[0];
+
+  // translate along y-axis
+  for (uint i = 0; i < maxSegmentCount; i++)
+  {
+    segment[i] += glm::vec3(0.0f, translateY, 0.0f);
+  }
+}
+
+/** create donut world
+ * @param vertices vertices
+ */
+LOCAL void createDonutWorld(std::vector<Vertex> &vertices)
+{
+  glm::vec3 segment [STEPS1];
+  glm::vec3 segment0[STEPS1];
+  glm::vec3 segment1[STEPS1];
+
+  createDonutWorldSegment(segment, STEPS1, R1, R2);
+
+  glm::vec2 uv[4] {glm::vec2(0.0f, 0.0f),
+                   glm::vec2(0.0f, 0.0f),
+                   glm::vec2(0.0f, 0.0f),
+                   glm::vec2(0.0f, 0.0f)
+                  };
+  memcpy(segment0, segment, sizeof(segment0));
+
+  for (uint i = 1; i < STEPS2; i++)
+  {
+    float th = (2 * M_PI * (float)i) / (float)STEPS2;
+
+    // get rotation quaternation
+    glm::vec3 eulers(0.0, 0.0, th);
+    glm::quat q = glm::quat(eulers);
+
+    // rotate donut world segment
+    for (uint j = 0; j < STEPS1; j++)
+    {
+      segment1[j] = segment[j] * q;
+    }
+
+    // create donut world stripe
+    uv[1][0] = (float)i / (float)STEPS2; // UV p1.x
+    uv[2][0] = (float)i / (float)STEPS2; // UV p2.x
+    uv[0][1] = 0.0f; // UV p0.y
+    uv[1][1] = 0.0f; // UV p0.y
+
+    for (uint j = 0; j < STEPS1 - 1; j++)
+    {
+      uv[3][1] = (float)(j + 1) / (float)(STEPS1 - 1); // UV p3.y
+      uv[2][1] = (float)(j + 1) / (float)(STEPS1 - 1); // UV p2.y
+
+      addQuad(vertices,
+              segment0[j + 0], segment1[j + 0],
+              segment1[j + 1], segment0[j + 1],
+              uv[0], uv[1], uv[2], uv[3]
+             );
+
+      // shift UV coodinates on y axis
+      uv[0][1] = uv[3][1]; // UV p3.y -> p0.y
+      uv[1][1] = uv[2][1]; // UV p2.y -> p1.y
+    }
+
+    memcpy(segment0, segment1, sizeof(segment0));
+
+    // shift UV coodinates on x axis
+    uv[0][0] = uv[1][0]; // UV p1.x -> p0.x
+    uv[3][0] = uv[2][0]; // UV p2.x -> p3.x
+  }
+
+  // create final donut world stripe (connect with first segment coordinates)
+  uv[1][0] = 1.0f; // UV p1.x
+  uv[2][0] = 1.0f; // UV p2.x
+  uv[0][1] = 0.0f; // UV p0.y
+  uv[1][1] = 0.0f; // UV p0.y
+
+  for (uint j = 0; j < STEPS1 - 1; j++)
+  {
+    uv[3][1] = (float)(j + 1) / (float)(STEPS1 - 1); // UV p3.y
+    uv[2][1] = (float)(j + 1) / (float)(STEPS1 - 1); // UV p2.y
+
+    addQuad(vertices,
+            segment0[j + 0], segment [j + 0],
+            segment [j + 1], segment0[j + 1],
+            uv[0], uv[1], uv[2], uv[3]
+           );
+
+    // shift UV coodinates on y axis
+    uv[0][1] = uv[3][1]; // UV p3.y -> p0.y
+    uv[1][1] = uv[2][1]; // UV p2.y -> p1.y
+  }
+}
+
+/** create donut world grid: same parametrisation and winding as
+ *  createDonutWorld(), but indexed, for levels of detail
+ * @param vertices vertices, (GRID_RING_STEPS+1) x (GRID_TUBE_STEPS+1);
+ *                 first and last row/column are duplicated for the UV
+ *                 map seam
+ * @param indices indices of all levels of detail: level l uses every
+ *                2^l-th grid point
+ * @param lodIndexOffsets,lodIndexCounts index offset [bytes] and number
+ *                                       of indices per level of detail
+ * @param lodCount number of levels of detail
+ */
+LOCAL void createDonutWorldGrid(std::vector<Vertex>   &vertices,
+                                std::vector<GLushort> &indices,
+                                GLintptr              lodIndexOffsets[],
+                                GLsizei               lodIndexCounts[],
+                                uint                  lodCount
+                               )
+{
+  static_assert((GRID_RING_STEPS + 1) * (GRID_TUBE_STEPS + 1) <= 65536, "grid too large for 16 bit indices");
+
+  // vertices: ring i, tube j
+  const glm::vec3 color(1.0f, 1.0f, 1.0f);
+  for (uint i = 0; i <= GRID_RING_STEPS; i++)
+  {
+    float th = (2 * M_PI * (float)i) / (float)GRID_RING_STEPS;
+    for (uint j = 0; j <= GRID_TUBE_STEPS; j++)
+    {
+      float ph = (2 * M_PI * (float)j) / (float)GRID_TUBE_STEPS;
+      float r  = R2 + R1 * cosf(ph);
+
+      vertices.push_back(Vertex{glm::vec3(r * sinf(th), r * cosf(th), -R1 * sinf(ph)),
+                                color,
+                                glm::vec2((float)i / (float)GRID_RING_STEPS, (float)j / (float)GRID_TUBE_STEPS)
+                               }
+                        );
+    }
+  }
+
+  // indices: two triangles per quad
+  for (uint lod = 0; lod < lodCount; lod++)
+  {
+    const uint step = 1U << lod;
+
+    lodIndexOffsets[lod] = static_cast<GLintptr>(indices.size() * sizeof(GLushort));
+    for (uint i = 0; i < GRID_RING_STEPS; i += step)
+    {
+      for (uint j = 0; j < GRID_TUBE_STEPS; j += step)
+      {
+        GLushort p0 = static_cast<GLushort>((i       ) * (GRID_TUBE_STEPS + 1) + (j       ));
+        GLushort p1 = static_cast<GLushort>((i + step) * (GRID_TUBE_STEPS + 1) + (j       ));
+        GLushort p2 = static_cast<GLushort>((i + step) * (GRID_TUBE_STEPS + 1) + (j + step));
+        GLushort p3 = static_cast<GLushort>((i       ) * (GRID_TUBE_STEPS + 1) + (j + step));
+
+        indices.insert(indices.end(), {p0, p1, p2, p2, p3, p0});
+      }
+    }
+    lodIndexCounts[lod] = static_cast<GLsizei>(indices.size() - lodIndexOffsets[lod] / sizeof(GLushort));
+  }
+}
+
+Renderer::Renderer(TextureTypes textureType)
+  : textureType(textureType)
+  , textureWidth(0)
+  , textureHeight(0)
+  , immutableTextureFlag(false)
+  , vertexBuffer(0)
+  , indexBuffer(0)
+  , vertexArray(0)
+  , lodIndexOffsets{}
+  , lodIndexCounts{}
+  , vertexShader(0)
+  , fragmentShader(0)
+  , program(0)
+  , projectionViewModelLocation(-1)
+  , textureTranslateLocation(-1)
+  , reliefHeightLocation(-1)
+  , feedbackFragmentShader(0)
+  , feedbackProgram(0)
+  , feedbackProjectionViewModelLocation(-1)
+  , feedbackTextureTranslateLocation(-1)
+  , feedbackReliefHeightLocation(-1)
+  , pickFragmentShader(0)
+  , pickProgram(0)
+  , pickProjectionViewModelLocation(-1)
+  , pickTextureTranslateLocation(-1)
+  , pickReliefHeightLocation(-1)
+  , pickFramebuffer(0)
+  , pickRenderbuffers{0, 0}
+  , elevationTexture(0)
+  , elevationWidth(0)
+  , elevationHeight(0)
+  , reliefHeight(DEFAULT_RELIEF_HEIGHT)
+  , model(1.0f)
+  , textureTranslate(0.0f, 0.0f)
+  , projectionViewModel(1.0f)
+  , viewportWidth(0)
+  , viewportHeight(0)
+  , lod(0)
+{
+  switch (textureType)
+  {
+    case TextureTypes::MIP:
+      mipTexture.reset(new MipTexture());
+      break;
+    case TextureTypes::INDEXED:
+      indexedTexture.reset(new IndexedTexture());
+      break;
+    case TextureTypes::VIRTUAL:
+      virtualTexture.reset(new VirtualTexture());
+      break;
+  }
+}
+
+void Renderer::init(uint textureWidth, uint textureHeight, bool immutableTextureFlag)
+{
+  GLint status;
+
+  this->textureWidth         = textureWidth;
+  this->textureHeight        = textureHeight;
+  this->immutableTextureFlag = immutableTextureFlag;
+
+  // init vertex+index buffer: grid is reused for all maps
+  std::vector<Vertex>   vertices;
+  std::vector<GLushort> indices;
+  createDonutWorldGrid(vertices, indices, lodIndexOffsets, lodIndexCounts, LOD_COUNT);
+
+  glGenBuffers(1, &vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+
+  // init elevation texture: flat until setElevations()
+  const uint8_t seaLevel = 0;
+  glGenTextures(1, &elevationTexture);
+  glActiveTexture(GL_TEXTURE0 + ELEVATION_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, elevationTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, 1, 1, 0, GL_RED, GL_UNSIGNED_BYTE, &seaLevel);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  elevationWidth  = 1;
+  elevationHeight = 1;
+
+  // init shaders
+  vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vertexShader, 1, &VERTEX_SHADER, NULL);
+  glCompileShader(vertexShader);
+  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
+  assert(status == GL_TRUE);
+
+  // init program and map texture
+  initMapTexture();
+
+  // init island overlay
+  labelTexture.init();
+
+  // init picking: map position of one pixel
+  pickProgram = createProgram(PICK_FRAGMENT_SHADER, pickFragmentShader);
+  pickProjectionViewModelLocation = glGetUniformLocation(pickProgram, "projectionViewModel");
+  pickTextureTranslateLocation    = glGetUniformLocation(pickProgram, "textureTranslate");
+  pickReliefHeightLocation        = glGetUniformLocation(pickProgram, "reliefHeight");
+  glUseProgram(pickProgram);
+  glUniform2ui(glGetUniformLocation(pickProgram, "pickTextureSize"), textureWidth, textureHeight);
+  glUseProgram(0);
+
+  GLint savedFramebuffer;
+  glGenRenderbuffers(2, pickRenderbuffers);
+  glBindRenderbuffer(GL_RENDERBUFFER, pickRenderbuffers[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32UI, 1, 1);
+  glBindRenderbuffer(GL_RENDERBUFFER, pickRenderbuffers[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 1, 1);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &savedFramebuffer);
+  glGenFramebuffers(1, &pickFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, pickFramebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, pickRenderbuffers[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, pickRenderbuffers[1]);
+  assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+  glBindFramebuffer(GL_FRAMEBUFFER, savedFramebuffer);
+
+  // bind vertex array
+  glGenVertexArrays(1, &vertexArray);
+  glBindVertexArray(vertexArray);
+  glGenBuffers(1, &indexBuffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glEnableVertexAttribArray(POSITION_LOCATION);
+  glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+  glEnableVertexAttribArray(COLOR_LOCATION);
+  glVertexAttribPointer(COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+  glEnableVertexAttribArray(UV_LOCATION);
+  glVertexAttribPointer(UV_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
+  glBindVertexArray(0);
+
+  // init model projection
+  model = glm::rotate(glm::mat4(1.0), (float)(2 * M_PI / 8), glm::vec3(-1, 0, 0));
+}
+
+void Renderer::done()
+{
+  switch (textureType)
+  {
+    case TextureTypes::MIP:
+      mipTexture->done();
+      break;
+    case TextureTypes::INDEXED:
+      indexedTexture->done();
+      break;
+    case TextureTypes::VIRTUAL:
+      virtualTexture->done();
+      glDeleteProgram(feedbackProgram);
+      glDeleteShader(feedbackFragmentShader);
+      break;
+  }
+  labelTexture.done();
+  glDeleteFramebuffers(1, &pickFramebuffer);
+  glDeleteRenderbuffers(2, pickRenderbuffers);
+  glDeleteProgram(pickProgram);
+  glDeleteShader(pickFragmentShader);
+  glDeleteProgram(program);
+  glDeleteShader(fragmentShader);
+  glDeleteShader(vertexShader);
+  glDeleteVertexArrays(1, &vertexArray);
+  glDeleteBuffers(1, &indexBuffer);
+  glDeleteBuffers(1, &vertexBuffer);
+  glDeleteTextures(1, &elevationTexture);
+
+  pickFramebuffer        = 0;
+  pickRenderbuffers[0]   = 0;
+  pickRenderbuffers[1]   = 0;
+  pickProgram            = 0;
+  pickFragmentShader     = 0;
+  feedbackProgram        = 0;
+  feedbackFragmentShader = 0;
+  program                = 0;
+  fragmentShader         = 0;
+  vertexShader           = 0;
+  vertexArray            = 0;
+  indexBuffer            = 0;
+  vertexBuffer           = 0;
+  elevationTexture       = 0;
+  elevationWidth         = 0;
+  elevationHeight        = 0;
+}
+
+uint Renderer::getMaxTextureSize(TextureTypes textureType)
+{
+  GLint maxTextureSize;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+
+  switch (textureType)
+  {
+    case TextureTypes::MIP:
+    case TextureTypes::INDEXED:
+      return static_cast<uint>(maxTextureSize);
+    case TextureTypes::VIRTUAL:
+      // page table has one texel per page
+      return static_cast<uint>(maxTextureSize) * VirtualTexture::PAGE_SIZE;
+  }
+
+  return 0;
+}
+
+void Renderer::setTextureSize(uint textureWidth, uint textureHeight)
+{
+  assert(textureWidth  <= getMaxTextureSize(textureType));
+  assert(textureHeight <= getMaxTextureSize(textureType));
+
+  if ((textureWidth == this->textureWidth) && (textureHeight == this->textureHeight))
+  {
+    return;
+  }
+
+  this->textureWidth  = textureWidth;
+  this->textureHeight = textureHeight;
+
+  switch (textureType)
+  {
+    case TextureTypes::MIP:
+      // immutable storage cannot be resized: re-create texture
+      mipTexture->done();
+      mipTexture->init(textureWidth, textureHeight, immutableTextureFlag);
+      break;
+    case TextureTypes::INDEXED:
+    case TextureTypes::VIRTUAL:
+      // allocated by setTexture()/setMap()
+      break;
+  }
+  glUseProgram(pickProgram);
+  glUniform2ui(glGetUniformLocation(pickProgram, "pickTextureSize"), textureWidth, textureHeight);
+  glUseProgram(0);
+
+  // labels of the old size are invalid
+  labelTexture.clear();
+}
+
+void Renderer::setTexture(const Color colors[])
+{
+  switch (textureType)
+  {
+    case TextureTypes::MIP:
+      mipTexture->upload(colors);
+      break;
+    case TextureTypes::INDEXED:
+      if (!indexedTexture->set(colors, textureWidth, textureHeight))
+      {
+        // too many colors for the palette: RGB texture without water shimmer
+        fprintf(stderr, "Warning: map has more than %u colors, using RGB texture\n", IndexedTexture::MAX_PALETTE_SIZE);
+        fallbackToMipTexture();
+        mipTexture->upload(colors);
+      }
+      break;
+    case TextureTypes::VIRTUAL:
+      assert(false);
+      break;
+  }
+}
+
+void Renderer::setMap(const Map::Snapshot &snapshot)
+{
+  assert(textureType == TextureTypes::VIRTUAL);
+
+  virtualTexture->setMap(snapshot);
+}
+
+void Renderer::computeElevations(const Map &map, uint width, uint height, std::vector<uint8_t> &elevations)
+{
+  assert(width > 0);
+  assert(height > 0);
+  assert((map.getWidth() % width) == 0);
+  assert((map.getHeight() % height) == 0);
+
+  const uint blockWidth  = map.getWidth()  / width;
+  const uint blockHeight = map.getHeight() / height;
+  const uint blockSize   = blockWidth * blockHeight;
+
+  elevations.assign(static_cast<size_t>(width) * height, 0);
+  if (map.hasElevations())
+  {
+    // elevation field relative to sea level: average of blocks
+    const std::vector<float> &field = map.getElevations();
+    const float maxElevation = *std::max_element(field.begin(), field.end());
+    if (maxElevation > 0.0f)
+    {
+      for (uint y = 0; y < height; y++)
+      {
+        for (uint x = 0; x < width; x++)
+        {
+          float sum = 0.0f;
+          for (uint dy = 0; dy < blockHeight; dy++)
+          {
+            const float *row = &field[static_cast<size_t>(y * blockHeight + dy) * map.getWidth() + x * blockWidth];
+            for (uint dx = 0; dx < blockWidth; dx++)
+            {
+              sum += std::max(row[dx], 0.0f);
+            }
+          }
+          elevations[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>(sum / (float)blockSize / maxElevation * 255.0f + 0.5f);
+        }
+      }
+    }
+  }
+  else
+  {
+    // distance to the coast: rises inland up to COAST_RELIEF_DISTANCE;
+    // blocks with at least half of the tiles land are land
+    const LandMask *landMask = &map.getLandMask();
+    LandMask       blockLandMask;
+    if (blockSize > 1)
+    {
+      blockLandMask.resize(width, height);
+      for (uint y = 0; y < height; y++)
+      {
+        for (uint x = 0; x < width; x++)
+        {
+          blockLandMask.set(x, y, 2 * landMask->count(x * blockWidth, y * blockHeight, blockWidth, blockHeight) >= blockSize);
+        }
+      }
+      landMask = &blockLandMask;
+    }
+
+    std::vector<float> distances;
+    DistanceField::compute(*landMask, distances);
+    const float maxDistance = (float)width * COAST_RELIEF_DISTANCE;
+    for (size_t i = 0; i < elevations.size(); i++)
+    {
+      if (distances[i] > 0.0f)
+      {
+        elevations[i] = static_cast<uint8_t>(std::min(distances[i] / maxDistance, 1.0f) * 255.0f + 0.5f);
+      }
+    }
+  }
+}
+
+void Renderer::setElevations(const uint8_t elevations[], uint width, uint height)
+{
+  assert(elevationTexture != 0);
+  assert(width > 0);
+  assert(height > 0);
+
+  glActiveTexture(GL_TEXTURE0 + ELEVATION_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, elevationTexture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if ((width != elevationWidth) || (height != elevationHeight))
+  {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, elevations);
+    elevationWidth  = width;
+    elevationHeight = height;
+  }
+  else
+  {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, elevations);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+bool Renderer::pick(uint viewX, uint viewY, uint &x, uint &y)
+{
+  assert(pickProgram != 0);
+
+  if ((viewX >= viewportWidth) || (viewY >= viewportHeight))
+  {
+    return false;
+  }
+
+  // pick matrix: pixel fills the pick framebuffer
+  const float     ndcX       = 2.0f * ((float)viewX + 0.5f) / (float)viewportWidth - 1.0f;
+  const float     ndcY       = 1.0f - 2.0f * ((float)viewY + 0.5f) / (float)viewportHeight;
+  const glm::mat4 pickMatrix = glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3((float)viewportWidth, (float)viewportHeight, 1.0f)),
+                                              glm::vec3(-ndcX, -ndcY, 0.0f)
+                                             );
+  const glm::mat4 pickProjectionViewModel = pickMatrix * projectionViewModel;
+
+  GLint savedFramebuffer;
+  GLint savedViewport[4];
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &savedFramebuffer);
+  glGetIntegerv(GL_VIEWPORT, savedViewport);
+  glBindFramebuffer(GL_FRAMEBUFFER, pickFramebuffer);
+  glViewport(0, 0, 1, 1);
+
+  const GLuint noHit[4] = {0, 0, 0, 0};
+  glClearBufferuiv(GL_COLOR, 0, noHit);
+  glClear(GL_DEPTH_BUFFER_BIT);
+
+  glUseProgram(pickProgram);
+  glEnable(GL_CULL_FACE);
+  glFrontFace(GL_CCW);
+  glCullFace(GL_BACK);
+  glEnable(GL_DEPTH_TEST);
+  glUniformMatrix4fv(pickProjectionViewModelLocation, 1, GL_FALSE, (const GLfloat *)&pickProjectionViewModel);
+  glUniform2fv(pickTextureTranslateLocation, 1, (const GLfloat *)&textureTranslate);
+  glUniform1f(pickReliefHeightLocation, reliefHeight);
+  glActiveTexture(GL_TEXTURE0 + ELEVATION_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, elevationTexture);
+  glActiveTexture(GL_TEXTURE0);
+  glBindVertexArray(vertexArray);
+  drawMesh(lod);
+  glBindVertexArray(0);
+  glUseProgram(0);
+
+  GLuint pixel[4];
+  glReadPixels(0, 0, 1, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, pixel);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, savedFramebuffer);
+  glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+
+  if (pixel[2] == 0)
+  {
+    return false;
+  }
+  x = pixel[0];
+  y = pixel[1];
+
+  return true;
+}
+
+bool Renderer::isStreaming()
+{
+  return (textureType == TextureTypes::VIRTUAL) && virtualTexture->isStreaming();
+}
+
+void Renderer::draw(uint viewWidth, uint viewHeight, ulong time, ulong deltaTime)
+{
+  // clear viewport
+  glClearColor(0.0, 0.0, 0.0, 1.0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  glUseProgram(program);
+  glEnable(GL_CULL_FACE);
+  glFrontFace(GL_CCW);
+  glCullFace(GL_BACK);
+  glEnable(GL_DEPTH_TEST);
+
+  model = glm::rotate(model, (float)deltaTime / 1000.0f, glm::vec3(0, 0, 1));
+  glm::vec3 position            = glm::vec3(0, 0, 2);
+  glm::vec3 front               = glm::vec3(0, 0, -1);
+  glm::vec3 up                  = glm::vec3(0, 1, 0);
+  glm::mat4 view                = glm::lookAt(position, position + front, up);
+  glm::mat4 projection          = glm::perspective(45.0, double(viewWidth) / double(viewHeight), 0.1, 100.0);
+  projectionViewModel           = projection * view * model;
+  glUniformMatrix4fv(projectionViewModelLocation, 1, GL_FALSE, (const GLfloat *)&projectionViewModel);
+  glUniform1f(reliefHeightLocation, reliefHeight);
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  viewportWidth  = viewport[2];
+  viewportHeight = viewport[3];
+
+  // level of detail: smooth surface needs no fine grid
+  lod = 0;
+  if (reliefHeight > 0.0f)
+  {
+    while (   (lod + 1 < LOD_COUNT)
+           && ((GRID_RING_STEPS >> lod) * LOD_MIN_QUAD_SIZE > viewHeight)
+          )
+    {
+      lod++;
+    }
+  }
+  else
+  {
+    lod = LOD_COUNT - 1;
+  }
+
+  glActiveTexture(GL_TEXTURE0 + ELEVATION_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, elevationTexture);
+
+  switch (textureType)
+  {
+    case TextureTypes::MIP:
+      glActiveTexture(GL_TEXTURE0);
+      mipTexture->bind();
+      break;
+    case TextureTypes::INDEXED:
+      // water shimmer: palette animation, period 4s
+      indexedTexture->bind(program, (float)(time % 4000) / 2000.0f);
+      break;
+    case TextureTypes::VIRTUAL:
+      virtualTexture->update();
+      break;
+  }
+
+  textureTranslate[1] = (float)((time / 30) % textureHeight) / (float)textureHeight;
+  glUniform2fv(textureTranslateLocation, 1, (const GLfloat *)&textureTranslate);
+
+  glBindVertexArray(vertexArray);
+
+  if (textureType == TextureTypes::VIRTUAL)
+  {
+    // feedback pass: request visible pages
+    virtualTexture->beginFeedback(viewportWidth, viewportHeight);
+    glUseProgram(feedbackProgram);
+    glUniformMatrix4fv(feedbackProjectionViewModelLocation, 1, GL_FALSE, (const GLfloat *)&projectionViewModel);
+    glUniform2fv(feedbackTextureTranslateLocation, 1, (const GLfloat *)&textureTranslate);
+    glUniform1f(feedbackReliefHeightLocation, reliefHeight);
+    virtualTexture->bind(feedbackProgram, true);
+    drawMesh(lod);
+    virtualTexture->endFeedback();
+
+    glUseProgram(program);
+    virtualTexture->bind(program, false);
+  }
+
+  // draw
+  labelTexture.bind(program);
+  drawMesh(lod);
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+}
+
+void Renderer::initMapTexture()
+{
+  switch (textureType)
+  {
+    case TextureTypes::MIP:
+      program = createProgram(MIP_FRAGMENT_SHADER, fragmentShader);
+
+      // trilinear filtered: minified donut samples the mip chain
+      mipTexture->init(textureWidth, textureHeight, immutableTextureFlag);
+      glUseProgram(program);
+      glUniform1i(glGetUniformLocation(program, "textureSampler"), 0);
+      glUseProgram(0);
+      break;
+    case TextureTypes::INDEXED:
+      program = createProgram(INDEXED_FRAGMENT_SHADER, fragmentShader);
+
+      // water colors are animated by the palette
+      indexedTexture->init();
+      indexedTexture->setAnimationColors(Color::WATER1, Color::WATER2);
+      break;
+    case TextureTypes::VIRTUAL:
+      program         = createProgram(VIRTUAL_FRAGMENT_SHADER, fragmentShader);
+      feedbackProgram = createProgram(FEEDBACK_FRAGMENT_SHADER, feedbackFragmentShader);
+      feedbackProjectionViewModelLocation = glGetUniformLocation(feedbackProgram, "projectionViewModel");
+      feedbackTextureTranslateLocation    = glGetUniformLocation(feedbackProgram, "textureTranslate");
+      feedbackReliefHeightLocation        = glGetUniformLocation(feedbackProgram, "reliefHeight");
+
+      virtualTexture->init();
+      break;
+  }
+  projectionViewModelLocation = glGetUniformLocation(program, "projectionViewModel");
+  textureTranslateLocation    = glGetUniformLocation(program, "textureTranslate");
+  reliefHeightLocation        = glGetUniformLocation(program, "reliefHeight");
+}
+
+void Renderer::fallbackToMipTexture()
+{
+  assert(textureType == TextureTypes::INDEXED);
+
+  indexedTexture->done();
+  indexedTexture.reset();
+  glDeleteProgram(program);
+  glDeleteShader(fragmentShader);
+
+  textureType = TextureTypes::MIP;
+  mipTexture.reset(new MipTexture());
+  initMapTexture();
+}
+
+GLuint Renderer::createProgram(const char *fragmentShaderMain, GLuint &shader) const
+{
+  GLint status;
+
+  // fragment shader: header, map texture functions, island overlay
+  // functions, main
+  const char *fragmentShaderSources[] =
+  {
+    FRAGMENT_SHADER_HEADER,
+    "",
+    LabelTexture::FRAGMENT_SHADER_FUNCTIONS,
+    fragmentShaderMain
+  };
+  switch (textureType)
+  {
+    case TextureTypes::MIP:
+      break;
+    case TextureTypes::INDEXED:
+      fragmentShaderSources[1] = IndexedTexture::FRAGMENT_SHADER_FUNCTIONS;
+      break;
+    case TextureTypes::VIRTUAL:
+      fragmentShaderSources[1] = VirtualTexture::FRAGMENT_SHADER_FUNCTIONS;
+      break;
+  }
+  shader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(shader, 4, fragmentShaderSources, NULL);
+  glCompileShader(shader);
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  assert(status == GL_TRUE);
+
+  // program: fixed attribute locations shared by all programs
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, shader);
+  glBindAttribLocation(program, POSITION_LOCATION, "vPosition");
+  glBindAttribLocation(program, COLOR_LOCATION, "vColor");
+  glBindAttribLocation(program, UV_LOCATION, "vUV");
+  glLinkProgram(program);
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  assert(status == GL_TRUE);
+  glDetachShader(program, shader);
+  glDetachShader(program, vertexShader);
+
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "elevationSampler"), ELEVATION_TEXTURE_UNIT);
+  glUniform2f(glGetUniformLocation(program, "radii"), R2, R1);
+  glUseProgram(0);
+
+  return program;
+}
+
+void Renderer::drawMesh(uint lod) const
+{
+  assert(lod < LOD_COUNT);
+
+  glDrawElements(GL_TRIANGLES, lodIndexCounts[lod], GL_UNSIGNED_SHORT, (const void *)lodIndexOffsets[lod]);
+}
+
+InstancedRenderer::InstancedRenderer()
+  : textureWidth(0)
+  , textureHeight(0)
+  , layerCount(0)
+  , texture(0)
+  , mipmapDirty(false)
+  , vertexBuffer(0)
+  , instanceBuffer(0)
+  , vertexArray(0)
+  , vertexCount(0)
+  , instanceCount(0)
+  , vertexShader(0)
+  , fragmentShader(0)
+  , program(0)
+  , projectionViewLocation(-1)
+  , modelLocation(-1)
+  , textureTranslateLocation(-1)
+  , model(1.0f)
+  , textureTranslate(0.0f, 0.0f)
+{
+}
+
+void InstancedRenderer::init(uint textureWidth, uint textureHeight, uint layerCount)
+{
+  GLint status;
+
+  this->textureWidth  = textureWidth;
+  this->textureHeight = textureHeight;
+  this->layerCount    = layerCount;
+
+  // init vertex buffer
+  std::vector<Vertex> vertices;
+  createDonutWorld(vertices);
+  vertexCount = static_cast<GLsizei>(vertices.size());
+
+  glGenBuffers(1, &vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+
+  glGenBuffers(1, &instanceBuffer);
+  instanceCount = 0;
+
+  // init map texture array: trilinear filtered, repeated
+  uint levelCount = 1;
+  while ((std::max(textureWidth, textureHeight) >> levelCount) > 0)
+  {
+    levelCount++;
+  }
+  glGenTextures(1, &texture);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, GL_RGB8, textureWidth, textureHeight, layerCount);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  mipmapDirty = true;
+
+  // init shaders
+  vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vertexShader, 1, &INSTANCED_VERTEX_SHADER, NULL);
+  glCompileShader(vertexShader);
+  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
+  assert(status == GL_TRUE);
+
+  fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(fragmentShader, 1, &INSTANCED_FRAGMENT_SHADER, NULL);
+  glCompileShader(fragmentShader);
+  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
+  assert(status == GL_TRUE);
+
+  program = glCreateProgram();
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  glBindAttribLocation(program, POSITION_LOCATION, "vPosition");
+  glBindAttribLocation(program, COLOR_LOCATION, "vColor");
+  glBindAttribLocation(program, UV_LOCATION, "vUV");
+  glBindAttribLocation(program, TRANSFORM_LOCATION, "iTransform");
+  glBindAttribLocation(program, LAYER_LOCATION, "iLayer");
+  glLinkProgram(program);
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  assert(status == GL_TRUE);
+  glDetachShader(program, fragmentShader);
+  glDetachShader(program, vertexShader);
+
+  projectionViewLocation   = glGetUniformLocation(program, "projectionView");
+  modelLocation            = glGetUniformLocation(program, "model");
+  textureTranslateLocation = glGetUniformLocation(program, "textureTranslate");
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "textureSampler"), 0);
+  glUseProgram(0);
+
+  // bind vertex array: per vertex and per instance attributes
+  glGenVertexArrays(1, &vertexArray);
+  glBindVertexArray(vertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glEnableVertexAttribArray(POSITION_LOCATION);
+  glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+  glEnableVertexAttribArray(COLOR_LOCATION);
+  glVertexAttribPointer(COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+  glEnableVertexAttribArray(UV_LOCATION);
+  glVertexAttribPointer(UV_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  for (uint i = 0; i < 4; i++)
+  {
+    glEnableVertexAttribArray(TRANSFORM_LOCATION + i);
+    glVertexAttribPointer(TRANSFORM_LOCATION + i,
+                          4,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          sizeof(Instance),
+                          (void *)(offsetof(Instance, transform) + i * sizeof(glm::vec4))
+                         );
+    glVertexAttribDivisor(TRANSFORM_LOCATION + i, 1);
+  }
+  glEnableVertexAttribArray(LAYER_LOCATION);
+  glVertexAttribIPointer(LAYER_LOCATION, 1, GL_UNSIGNED_INT, sizeof(Instance), (void *)offsetof(Instance, layer));
+  glVertexAttribDivisor(LAYER_LOCATION, 1);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // init model projection
+  model = glm::rotate(glm::mat4(1.0), (float)(2 * M_PI / 8), glm::vec3(-1, 0, 0));
+}
+
+void InstancedRenderer::done()
+{
+  glDeleteProgram(program);
+  glDeleteShader(fragmentShader);
+  glDeleteShader(vertexShader);
+  glDeleteVertexArrays(1, &vertexArray);
+  glDeleteBuffers(1, &instanceBuffer);
+  glDeleteBuffers(1, &vertexBuffer);
+  glDeleteTextures(1, &texture);
+
+  program        = 0;
+  fragmentShader = 0;
+  vertexShader   = 0;
+  vertexArray    = 0;
+  instanceBuffer = 0;
+  vertexBuffer   = 0;
+  texture        = 0;
+  instanceCount  = 0;
+}
+
+void InstancedRenderer::setTexture(uint layer, const Color colors[])
+{
+  assert(texture != 0);
+  assert(layer < layerCount);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, textureWidth, textureHeight, 1, GL_RGB, GL_UNSIGNED_BYTE, colors);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  mipmapDirty = true;
+}
+
+void InstancedRenderer::setInstances(const std::vector<Instance> &instances)
+{
+  assert(instanceBuffer != 0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), instances.data(), GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  instanceCount = static_cast<GLsizei>(instances.size());
+}
+
+void InstancedRenderer::draw(const glm::mat4 &projectionView, ulong time, ulong deltaTime)
+{
+  // clear viewport
+  glClearColor(0.0, 0.0, 0.0, 1.0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  if (mipmapDirty)
+  {
+    // one pass for all changed layers
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    mipmapDirty = false;
+  }
+
+  glUseProgram(program);
+  glEnable(GL_CULL_FACE);
+  glFrontFace(GL_CCW);
+  glCullFace(GL_BACK);
+  glEnable(GL_DEPTH_TEST);
+
+  model = glm::rotate(model, (float)deltaTime / 1000.0f, glm::vec3(0, 0, 1));
+  glUniformMatrix4fv(projectionViewLocation, 1, GL_FALSE, (const GLfloat *)&projectionView);
+  glUniformMatrix4fv(modelLocation, 1, GL_FALSE, (const GLfloat *)&model);
+
+  textureTranslate[1] = (float)((time / 30) % textureHeight) / (float)textureHeight;
+  glUniform2fv(textureTranslateLocation, 1, (const GLfloat *)&textureTranslate);
+
+  // draw all worlds
+  glBindVertexArray(vertexArray);
+  glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, instanceCount);
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+/* end of file */
@@ -0,0 +1,389 @@
+/***********************************************************************\
+*
+* Contents: renderer: donut world mesh, shaders and map texture
+* Systems: all
+*
+\***********************************************************************/
+#ifndef RENDERER_H
+#define RENDERER_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <memory>
+
+#include <sys/types.h>
+
+#include <epoxy/gl.h>
+#include <glm/glm.hpp>
+
+#include "color.h"
+#include "islands.h"
+#include "virtualTexture.h"
+#include "indexedTexture.h"
+#include "mipTexture.h"
+#include "labelTexture.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** renderer: draws the rotating donut world with the map texture into
+ *  the current framebuffer. Independent of the windowing system: runs in
+ *  a GtkGLArea as well as in a headless EGL context.
+ *
+ *  All methods must be called in the GL context.
+ */
+class Renderer
+{
+  public:
+    // default relief height of the terrain (donut tube radius: 0.3)
+    static constexpr float DEFAULT_RELIEF_HEIGHT = 0.02f;
+
+    /** map texture types
+     */
+    enum class TextureTypes
+    {
+      MIP,      // mipmapped RGB texture, see MipTexture
+      INDEXED,  // palette indexed texture with water shimmer, see IndexedTexture
+      VIRTUAL   // page streamed texture of any size, see VirtualTexture
+    };
+
+    /** create renderer
+     * @param textureType map texture type
+     */
+    Renderer(TextureTypes textureType = TextureTypes::MIP);
+
+    /** create mesh, shaders, map texture and (flat) elevation texture
+     * @param textureWidth,textureHeight map texture size
+     * @param immutableTextureFlag true to allocate immutable texture
+     *                             storage (MIP only)
+     */
+    void init(uint textureWidth, uint textureHeight, bool immutableTextureFlag);
+
+    /** release GL objects
+     */
+    void done();
+
+    /** get max. map texture size supported by the GL implementation
+     * @param textureType map texture type
+     * @return max. map texture width+height
+     */
+    static uint getMaxTextureSize(TextureTypes textureType);
+
+    /** change map texture size; the map texture is undefined until the
+     *  next setTexture() (MIP, INDEXED) or setMap() (VIRTUAL)
+     * @param textureWidth,textureHeight map texture size
+     */
+    void setTextureSize(uint textureWidth, uint textureHeight);
+
+    /** get map texture width
+     * @return map texture width
+     */
+    uint getTextureWidth() const
+    {
+      return textureWidth;
+    }
+
+    /** get map texture height
+     * @return map texture height
+     */
+    uint getTextureHeight() const
+    {
+      return textureHeight;
+    }
+
+    /** set map texture (MIP, INDEXED); INDEXED falls back to MIP if
+     *  the colors do not fit into the palette
+     * @param colors colors, row by row, textureWidth x textureHeight
+     */
+    void setTexture(const Color colors[]);
+
+    /** set map (VIRTUAL); may be called from any thread
+     * @param snapshot map snapshot
+     */
+    void setMap(const Map::Snapshot &snapshot);
+
+    /** compute elevation texture data of map: elevation field if
+     *  available, distance to the coast otherwise; water is flat.
+     *  Independent of the GL context, may be called from any thread.
+     * @param map map
+     * @param width,height elevation texture size; map size must be a
+     *                     multiple of it
+     * @param elevations elevations (width*height values, row by row):
+     *                   0 sea level, 255 max. height
+     */
+    static void computeElevations(const Map &map, uint width, uint height, std::vector<uint8_t> &elevations);
+
+    /** set elevation texture; only uploads the texture, the mesh is
+     *  displaced in the vertex shader
+     * @param elevations elevations, row by row, see computeElevations()
+     * @param width,height elevation texture size; independent of the
+     *                     map texture size
+     */
+    void setElevations(const uint8_t elevations[], uint width, uint height);
+
+    /** set relief height
+     * @param reliefHeight height of max. elevation above sea level; 0 for
+     *                     a smooth surface
+     */
+    void setReliefHeight(float reliefHeight)
+    {
+      this->reliefHeight = reliefHeight;
+    }
+
+    /** get relief height
+     * @return height of max. elevation above sea level
+     */
+    float getReliefHeight() const
+    {
+      return reliefHeight;
+    }
+
+    /** set island labels and show island overlay
+     * @param labels labels, row by row, see Map::getIslandLabels()
+     * @param width,height map size
+     */
+    void setLabels(const uint32_t labels[], uint width, uint height)
+    {
+      labelTexture.set(labels, width, height);
+    }
+
+    /** clear island labels and hide island overlay
+     */
+    void clearLabels()
+    {
+      labelTexture.clear();
+    }
+
+    /** set hovered island
+     * @param label island label or 0
+     */
+    void setHoverLabel(uint32_t label)
+    {
+      labelTexture.setHover(label);
+    }
+
+    /** set selected island
+     * @param label island label or 0
+     */
+    void setSelectedLabel(uint32_t label)
+    {
+      labelTexture.setSelected(label);
+    }
+
+    /** get selected island
+     * @return island label or 0
+     */
+    uint32_t getSelectedLabel() const
+    {
+      return labelTexture.getSelected();
+    }
+
+    /** pick map position at view pixel with the view of the last draw();
+     *  renders the pixel into a small framebuffer and reads it back
+     * @param viewX,viewY view pixel, (0,0) is top left
+     * @param x,y map texture position
+     * @return true iff donut world is hit
+     */
+    bool pick(uint viewX, uint viewY, uint &x, uint &y);
+
+    /** check if map texture pages are streamed (VIRTUAL)
+     * @return true iff streaming; render further frames to finish it
+     */
+    bool isStreaming();
+
+    /** clear and draw scene into the current framebuffer
+     * @param viewWidth,viewHeight view size for projection
+     * @param time animation time [ms]: texture scroll, water shimmer
+     * @param deltaTime time since last draw [ms]: rotation
+     */
+    void draw(uint viewWidth, uint viewHeight, ulong time, ulong deltaTime);
+
+    /** get map texture type
+     * @return map texture type; MIP after a fallback of INDEXED in
+     *         setTexture()
+     */
+    TextureTypes getTextureType() const
+    {
+      return textureType;
+    }
+
+  private:
+    // number of levels of detail of the mesh
+    static const uint LOD_COUNT = 3;
+
+    TextureTypes                    textureType;
+    uint                            textureWidth, textureHeight;
+    bool                            immutableTextureFlag;
+
+    GLuint                          vertexBuffer;
+    GLuint                          indexBuffer;
+    GLuint                          vertexArray;
+    GLintptr                        lodIndexOffsets[LOD_COUNT];
+    GLsizei                         lodIndexCounts[LOD_COUNT];
+    GLuint                          vertexShader;
+    GLuint                          fragmentShader;
+    GLuint                          program;
+    GLint                           projectionViewModelLocation;
+    GLint                           textureTranslateLocation;
+    GLint                           reliefHeightLocation;
+    GLuint                          feedbackFragmentShader;
+    GLuint                          feedbackProgram;
+    GLint                           feedbackProjectionViewModelLocation;
+    GLint                           feedbackTextureTranslateLocation;
+    GLint                           feedbackReliefHeightLocation;
+    GLuint                          pickFragmentShader;
+    GLuint                          pickProgram;
+    GLint                           pickProjectionViewModelLocation;
+    GLint                           pickTextureTranslateLocation;
+    GLint                           pickReliefHeightLocation;
+    GLuint                          pickFramebuffer;
+    GLuint                          pickRenderbuffers[2];  // map position, depth
+
+    GLuint                          elevationTexture;
+    uint                            elevationWidth, elevationHeight;
+    float                           reliefHeight;
+
+    std::unique_ptr<MipTexture>     mipTexture;
+    std::unique_ptr<IndexedTexture> indexedTexture;
+    std::unique_ptr<VirtualTexture> virtualTexture;
+    LabelTexture                    labelTexture;
+
+    glm::mat4                       model;
+    glm::vec2                       textureTranslate;
+    glm::mat4                       projectionViewModel;  // of last draw
+    uint                            viewportWidth, viewportHeight;
+    uint                            lod;
+
+    Renderer(const Renderer&) = delete;
+    Renderer &operator=(const Renderer&) = delete;
+
+    /** create program from vertex shader and fragment shader
+     * @param fragmentShaderMain fragment shader main function
+     * @param shader created fragment shader
+     * @return program
+     */
+    GLuint createProgram(const char *fragmentShaderMain, GLuint &shader) const;
+
+    /** create program and map texture of the texture type
+     */
+    void initMapTexture();
+
+    /** switch from INDEXED to MIP texture type: re-create program and
+     *  map texture
+     */
+    void fallbackToMipTexture();
+
+    /** draw mesh
+     * @param lod level of detail
+     */
+    void drawMesh(uint lod) const;
+};
+
+/** instanced renderer: draws many donut worlds with one draw call. Each
+ *  instance has a transform and a layer of a 2D array map texture; the
+ *  instances are stored in an instance buffer, so the cost per frame
+ *  does not depend on the number of worlds.
+ *
+ *  All methods must be called in the GL context.
+ */
+class InstancedRenderer
+{
+  public:
+    /** world instance
+     */
+    struct Instance
+    {
+      glm::mat4 transform;  // placement of the world
+      uint32_t  layer;      // map texture layer
+    };
+
+    /** create instanced renderer
+     */
+    InstancedRenderer();
+
+    /** create mesh, shaders and map texture array
+     * @param textureWidth,textureHeight map texture size
+     * @param layerCount number of map texture layers; max.
+     *                   GL_MAX_ARRAY_TEXTURE_LAYERS
+     */
+    void init(uint textureWidth, uint textureHeight, uint layerCount);
+
+    /** release GL objects
+     */
+    void done();
+
+    /** set map texture layer; the mip chains of all layers are
+     *  regenerated once on the next draw()
+     * @param layer layer
+     * @param colors colors, row by row, textureWidth x textureHeight
+     */
+    void setTexture(uint layer, const Color colors[]);
+
+    /** set instances
+     * @param instances instances
+     */
+    void setInstances(const std::vector<Instance> &instances);
+
+    /** clear and draw all instances into the current framebuffer
+     * @param projectionView projection and view matrix
+     * @param time animation time [ms]: texture scroll
+     * @param deltaTime time since last draw [ms]: rotation of all worlds
+     */
+    void draw(const glm::mat4 &projectionView, ulong time, ulong deltaTime);
+
+    /** get number of map texture layers
+     * @return number of layers
+     */
+    uint getLayerCount() const
+    {
+      return layerCount;
+    }
+
+    /** get number of instances
+     * @return number of instances
+     */
+    uint getInstanceCount() const
+    {
+      return instanceCount;
+    }
+
+  private:
+    uint      textureWidth, textureHeight;
+    uint      layerCount;
+    GLuint    texture;
+    bool      mipmapDirty;
+
+    GLuint    vertexBuffer;
+    GLuint    instanceBuffer;
+    GLuint    vertexArray;
+    GLsizei   vertexCount;
+    GLsizei   instanceCount;
+    GLuint    vertexShader;
+    GLuint    fragmentShader;
+    GLuint    program;
+    GLint     projectionViewLocation;
+    GLint     modelLocation;
+    GLint     textureTranslateLocation;
+
+    glm::mat4 model;
+    glm::vec2 textureTranslate;
+
+    InstancedRenderer(const InstancedRenderer&) = delete;
+    InstancedRenderer &operator=(const InstancedRenderer&) = delete;
+};
+
+#endif // RENDERER_H
+
+/* end of file */
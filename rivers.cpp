@@ -0,0 +1,215 @@
+/***********************************************************************\
+*
+* Contents: elevation driven river network
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <math.h>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <cassert>
+
+#include "rivers.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// neighbor offsets (D8)
+LOCAL const int NEIGHBOR_DX[8] = {-1, 0,+1,-1,+1,-1, 0,+1};
+LOCAL const int NEIGHBOR_DY[8] = {-1,-1,-1, 0, 0,+1,+1,+1};
+
+/***************************** Datatypes *******************************/
+
+// open tile in priority-flood: elevation+index
+typedef std::pair<float, uint32_t> OpenTile;
+
+/***************************** Variables *******************************/
+const uint32_t RiverNetwork::NONE;
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+void RiverNetwork::compute(const std::vector<float> &elevations, uint width, uint height)
+{
+  assert(elevations.size() == static_cast<size_t>(width) * height);
+
+  size_t n = elevations.size();
+
+  this->width  = width;
+  this->height = height;
+  filledElevations = elevations;
+  downstreams.assign(n, NONE);
+  accumulations.assign(n, 1);
+
+  auto getNeighbor = [width, height](uint32_t index, uint i) -> uint32_t
+  {
+    uint x = index % width;
+    uint y = index / width;
+
+    x = (x + width  + NEIGHBOR_DX[i]) % width;
+    y = (y + height + NEIGHBOR_DY[i]) % height;
+
+    return static_cast<uint32_t>(y) * width + x;
+  };
+
+  // priority-flood (Barnes et al.): tiles in depressions are raised by
+  // epsilon and processed from a plain queue; every land tile drains to
+  // the tile it was reached from
+  std::priority_queue<OpenTile, std::vector<OpenTile>, std::greater<OpenTile>> open;
+  std::queue<uint32_t>                                                         pits;
+  std::vector<bool>                                                            closed(n, false);
+  std::vector<uint32_t>                                                        order;
+  order.reserve(n);
+
+  // seeds: water tiles at the coast
+  for (uint32_t index = 0; index < n; index++)
+  {
+    if (filledElevations[index] <= 0.0f)
+    {
+      closed[index] = true;
+      for (uint i = 0; i < 8; i++)
+      {
+        if (filledElevations[getNeighbor(index, i)] > 0.0f)
+        {
+          open.push(OpenTile(filledElevations[index], index));
+          break;
+        }
+      }
+    }
+  }
+
+  // no coast (e. g. no water at all): drain into the lowest tile
+  if (open.empty() && (n > 0))
+  {
+    uint32_t lowest = 0;
+    for (uint32_t index = 1; index < n; index++)
+    {
+      if (filledElevations[index] < filledElevations[lowest])
+      {
+        lowest = index;
+      }
+    }
+    closed[lowest] = true;
+    open.push(OpenTile(filledElevations[lowest], lowest));
+  }
+
+  while (!open.empty() || !pits.empty())
+  {
+    uint32_t index;
+    if (!pits.empty())
+    {
+      index = pits.front();
+      pits.pop();
+    }
+    else
+    {
+      index = open.top().second;
+      open.pop();
+    }
+    order.push_back(index);
+
+    for (uint i = 0; i < 8; i++)
+    {
+      uint32_t neighbor = getNeighbor(index, i);
+      if (!closed[neighbor])
+      {
+        closed[neighbor]      = true;
+        downstreams[neighbor] = index;
+
+        float raised = nextafterf(filledElevations[index], INFINITY);
+        if (filledElevations[neighbor] <= raised)
+        {
+          filledElevations[neighbor] = raised;
+          pits.push(neighbor);
+        }
+        else
+        {
+          open.push(OpenTile(filledElevations[neighbor], neighbor));
+        }
+      }
+    }
+  }
+
+  // flow accumulation: upstream tiles are always processed after their
+  // downstream tile, so reverse processing order is a topological order
+  for (size_t i = order.size(); i > 0; i--)
+  {
+    uint32_t index = order[i - 1];
+    if (downstreams[index] != NONE)
+    {
+      accumulations[downstreams[index]] += accumulations[index];
+    }
+  }
+}
+
+bool RiverNetwork::getDownstream(uint x, uint y, Coordinates &downstream) const
+{
+  uint32_t index = downstreams[getIndex(x, y)];
+  if (index != NONE)
+  {
+    downstream = Coordinates(index % width, index / width);
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+std::vector<Coordinates> RiverNetwork::getUpstream(uint x, uint y, uint32_t minAccumulation) const
+{
+  std::vector<Coordinates> upstream;
+
+  size_t index = getIndex(x, y);
+  for (uint i = 0; i < 8; i++)
+  {
+    uint nx = (x + width  + NEIGHBOR_DX[i]) % width;
+    uint ny = (y + height + NEIGHBOR_DY[i]) % height;
+    size_t neighbor = getIndex(nx, ny);
+
+    if (   (downstreams[neighbor] == index)
+        && (accumulations[neighbor] >= minAccumulation)
+       )
+    {
+      upstream.push_back(Coordinates(nx, ny));
+    }
+  }
+
+  return upstream;
+}
+
+std::vector<Coordinates> RiverNetwork::getPath(uint x, uint y) const
+{
+  std::vector<Coordinates> path;
+
+  uint32_t index = static_cast<uint32_t>(getIndex(x, y));
+  path.push_back(Coordinates(x, y));
+  while (downstreams[index] != NONE)
+  {
+    index = downstreams[index];
+    path.push_back(Coordinates(index % width, index / width));
+  }
+
+  return path;
+}
+
+Coordinates RiverNetwork::getMouth(uint x, uint y) const
+{
+  uint32_t index = static_cast<uint32_t>(getIndex(x, y));
+  while (downstreams[index] != NONE)
+  {
+    index = downstreams[index];
+  }
+
+  return Coordinates(index % width, index / width);
+}
+
+/* end of file */
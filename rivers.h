@@ -0,0 +1,145 @@
+/***********************************************************************\
+*
+* Contents: elevation driven river network
+* Systems: all
+*
+\***********************************************************************/
+#ifndef RIVERS_H
+#define RIVERS_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+
+#include "islands.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** river network: flow directions and flow accumulation of an elevation
+ *  field. Depressions are filled by a priority-flood from the coast, so
+ *  every land tile drains into the sea. The field wraps in x and y
+ *  direction like the donut.
+ */
+class RiverNetwork
+{
+  public:
+    // no downstream tile (water tile)
+    static const uint32_t NONE = UINT32_MAX;
+
+    RiverNetwork()
+      : width(0)
+      , height(0)
+    {
+    }
+
+    /** compute flow directions and flow accumulation; without water
+     *  tiles at the coast all tiles drain into the lowest tile
+     * @param elevations elevation field (width*height values, row by
+     *                   row, <=0 is water)
+     * @param width,height field width+height
+     */
+    void compute(const std::vector<float> &elevations, uint width, uint height);
+
+    /** get width
+     * @return width
+     */
+    uint getWidth() const
+    {
+      return width;
+    }
+
+    /** get height
+     * @return height
+     */
+    uint getHeight() const
+    {
+      return height;
+    }
+
+    /** check if tile is land
+     * @param x,y position
+     * @return true iff land tile
+     */
+    bool isLand(uint x, uint y) const
+    {
+      return filledElevations[getIndex(x, y)] > 0.0f;
+    }
+
+    /** get flow accumulation: number of tiles draining through tile
+     * @param x,y position
+     * @return flow accumulation (including tile itself)
+     */
+    uint32_t getAccumulation(uint x, uint y) const
+    {
+      return accumulations[getIndex(x, y)];
+    }
+
+    /** get depression filled elevation
+     * @param x,y position
+     * @return elevation
+     */
+    float getFilledElevation(uint x, uint y) const
+    {
+      return filledElevations[getIndex(x, y)];
+    }
+
+    /** get downstream tile
+     * @param x,y position
+     * @param downstream downstream tile coordinates
+     * @return true iff downstream tile available, false for water
+     */
+    bool getDownstream(uint x, uint y, Coordinates &downstream) const;
+
+    /** get upstream tiles (tributaries) draining directly into tile
+     * @param x,y position
+     * @param minAccumulation min. flow accumulation of upstream tiles
+     * @return upstream tile coordinates
+     */
+    std::vector<Coordinates> getUpstream(uint x, uint y, uint32_t minAccumulation) const;
+
+    /** get river path from tile down to the sea
+     * @param x,y start position
+     * @return path including start tile and mouth water tile
+     */
+    std::vector<Coordinates> getPath(uint x, uint y) const;
+
+    /** get river mouth: water tile where the flow from a tile ends
+     * @param x,y start position
+     * @return mouth coordinates
+     */
+    Coordinates getMouth(uint x, uint y) const;
+
+  private:
+    uint                  width, height;
+    std::vector<float>    filledElevations;
+    std::vector<uint32_t> downstreams;
+    std::vector<uint32_t> accumulations;
+
+    /** get tile index
+     * @param x,y position
+     * @return index
+     */
+    size_t getIndex(uint x, uint y) const
+    {
+      assert(x < width);
+      assert(y < height);
+
+      return static_cast<size_t>(y) * width + x;
+    }
+};
+
+#endif // RIVERS_H
+
+/* end of file */
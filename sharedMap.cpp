@@ -0,0 +1,322 @@
+/***********************************************************************\
+*
+* Contents: shared map: publish map planes in POSIX shared memory
+* Systems: Unix
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <cassert>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+#include "sharedMap.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+LOCAL const char     MAGIC[4] = {'D','W','S','M'};
+LOCAL const uint32_t VERSION  = 1;
+
+// alignment of planes [bytes]
+LOCAL const uint64_t PLANE_ALIGNMENT = 64;
+
+// chunks per parallel block
+LOCAL const uint CHUNK_BLOCK_SIZE = 16;
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** align offset
+ * @param offset offset
+ * @return offset aligned to PLANE_ALIGNMENT
+ */
+LOCAL inline uint64_t align(uint64_t offset)
+{
+  return (offset + PLANE_ALIGNMENT - 1) & ~(PLANE_ALIGNMENT - 1);
+}
+
+/** throw error with system error message
+ * @param message message
+ * @param name segment name
+ */
+LOCAL void throwError(const char *message, const std::string &name)
+{
+  std::stringstream buffer;
+  buffer << message << " '" << name << "': " << strerror(errno);
+  throw std::ios_base::failure(buffer.str());
+}
+
+SharedMapWriter::SharedMapWriter(const std::string &name)
+  : name(name)
+  , header(nullptr)
+{
+}
+
+SharedMapWriter::~SharedMapWriter()
+{
+  remove();
+}
+
+void SharedMapWriter::publish(const Map &map)
+{
+  const Map::Snapshot snapshot = map.getSnapshot();
+  bool                created  = false;
+  if (   (header == nullptr)
+      || (header->width  != snapshot.getWidth())
+      || (header->height != snapshot.getHeight())
+     )
+  {
+    create(snapshot.getWidth(), snapshot.getHeight());
+    created = true;
+  }
+
+  const uint width  = header->width;
+  const uint height = header->height;
+  uint8_t    *base  = reinterpret_cast<uint8_t*>(header);
+  uint8_t    *types  = base + header->typesOffset;
+  uint8_t    *colors = base + header->colorsOffset;
+  uint32_t   *labels = reinterpret_cast<uint32_t*>(base + header->labelsOffset);
+
+  // begin write: odd sequence number
+  const uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+  header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // copy tiles of chunks changed since the last publish
+  const bool incremental = !created && (lastSnapshot.getChunkCount() == snapshot.getChunkCount());
+  parallelFor(0, snapshot.getChunkCount(), CHUNK_BLOCK_SIZE, [&](uint i0, uint i1)
+  {
+    for (uint i = i0; i < i1; i++)
+    {
+      if (incremental && lastSnapshot.isSharedChunk(snapshot, i))
+      {
+        continue;
+      }
+
+      const uint x0 = (i % snapshot.getChunksX()) * Map::CHUNK_SIZE;
+      const uint y0 = (i / snapshot.getChunksX()) * Map::CHUNK_SIZE;
+      const uint x1 = std::min(x0 + Map::CHUNK_SIZE, width);
+      const uint y1 = std::min(y0 + Map::CHUNK_SIZE, height);
+      for (uint y = y0; y < y1; y++)
+      {
+        for (uint x = x0; x < x1; x++)
+        {
+          const size_t index = static_cast<size_t>(y) * width + x;
+          const Tile   &tile = snapshot.getTile(x, y);
+          const Color  color = tile.getColor();
+
+          types[index]          = static_cast<uint8_t>(tile.getType());
+          colors[index * 3 + 0] = color.r;
+          colors[index * 3 + 1] = color.g;
+          colors[index * 3 + 2] = color.b;
+        }
+      }
+    }
+  });
+
+  // copy island labels of the snapshot if changed since the last publish
+  if (!incremental || (snapshot.getIslandGeneration() != lastSnapshot.getIslandGeneration()))
+  {
+    const std::vector<uint32_t> &islandLabels = snapshot.getIslandLabels();
+    if (!islandLabels.empty())
+    {
+      memcpy(labels, islandLabels.data(), islandLabels.size() * sizeof(uint32_t));
+    }
+    else
+    {
+      memset(labels, 0, static_cast<size_t>(width) * height * sizeof(uint32_t));
+    }
+    header->islandCount = snapshot.getIslandCount();
+  }
+
+  // end write: even sequence number
+  header->sequence.store(sequence + 2, std::memory_order_release);
+
+  lastSnapshot = snapshot;
+}
+
+uint64_t SharedMapWriter::getVersion() const
+{
+  return (header != nullptr) ? header->sequence.load(std::memory_order_relaxed) / 2 : 0;
+}
+
+void SharedMapWriter::create(uint width, uint height)
+{
+  // replace the name first, so readers of the old segment find the new
+  // segment when they see the stale flag
+  SharedMapHeader *oldHeader = header;
+  auto releaseOldHeader = [&oldHeader]()
+  {
+    if (oldHeader != nullptr)
+    {
+      oldHeader->stale.store(1, std::memory_order_release);
+      munmap(oldHeader, oldHeader->size);
+      oldHeader = nullptr;
+    }
+  };
+  header = nullptr;
+  shm_unlink(name.c_str());
+
+  const uint64_t tileCount    = static_cast<uint64_t>(width) * height;
+  const uint64_t typesOffset  = align(sizeof(SharedMapHeader));
+  const uint64_t colorsOffset = align(typesOffset + tileCount);
+  const uint64_t labelsOffset = align(colorsOffset + tileCount * 3);
+  const uint64_t size         = labelsOffset + tileCount * sizeof(uint32_t);
+
+  int handle = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (handle == -1)
+  {
+    releaseOldHeader();
+    throwError("cannot create shared memory", name);
+  }
+  if (ftruncate(handle, size) != 0)
+  {
+    ::close(handle);
+    shm_unlink(name.c_str());
+    releaseOldHeader();
+    throwError("cannot resize shared memory", name);
+  }
+  void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+  ::close(handle);
+  if (memory == MAP_FAILED)
+  {
+    shm_unlink(name.c_str());
+    releaseOldHeader();
+    throwError("cannot map shared memory", name);
+  }
+
+  header = new(memory) SharedMapHeader();
+  header->version      = VERSION;
+  header->width        = width;
+  header->height       = height;
+  header->size         = size;
+  header->typesOffset  = typesOffset;
+  header->colorsOffset = colorsOffset;
+  header->labelsOffset = labelsOffset;
+  header->sequence.store(0, std::memory_order_relaxed);
+  header->stale.store(0, std::memory_order_relaxed);
+  header->islandCount  = 0;
+
+  // magic last: readers reject the segment until the header is complete
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(header->magic, MAGIC, sizeof(MAGIC));
+
+  releaseOldHeader();
+
+  // new segment: copy all chunks
+  lastSnapshot = Map::Snapshot();
+}
+
+void SharedMapWriter::remove()
+{
+  if (header != nullptr)
+  {
+    header->stale.store(1, std::memory_order_release);
+    munmap(header, header->size);
+    shm_unlink(name.c_str());
+    header = nullptr;
+  }
+  lastSnapshot = Map::Snapshot();
+}
+
+void SharedMapReader::open(const std::string &name)
+{
+  close();
+
+  int handle = shm_open(name.c_str(), O_RDONLY, 0);
+  if (handle == -1)
+  {
+    throwError("cannot open shared memory", name);
+  }
+  struct stat fileStat;
+  if (fstat(handle, &fileStat) != 0)
+  {
+    ::close(handle);
+    throwError("cannot get size of shared memory", name);
+  }
+  if (static_cast<size_t>(fileStat.st_size) < sizeof(SharedMapHeader))
+  {
+    ::close(handle);
+    std::stringstream buffer;
+    buffer << "invalid shared map '" << name << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+  void *memory = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, handle, 0);
+  ::close(handle);
+  if (memory == MAP_FAILED)
+  {
+    throwError("cannot map shared memory", name);
+  }
+
+  const SharedMapHeader *mappedHeader = reinterpret_cast<const SharedMapHeader*>(memory);
+  if (   (memcmp(mappedHeader->magic, MAGIC, sizeof(MAGIC)) != 0)
+      || (mappedHeader->version != VERSION)
+      || (mappedHeader->size > static_cast<uint64_t>(fileStat.st_size))
+     )
+  {
+    munmap(memory, fileStat.st_size);
+    std::stringstream buffer;
+    buffer << "invalid shared map '" << name << "'";
+    throw std::ios_base::failure(buffer.str());
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  header = mappedHeader;
+  size   = fileStat.st_size;
+}
+
+void SharedMapReader::close()
+{
+  if (header != nullptr)
+  {
+    munmap(const_cast<SharedMapHeader*>(header), size);
+    header = nullptr;
+    size   = 0;
+  }
+}
+
+uint64_t SharedMapReader::beginRead() const
+{
+  assert(header != nullptr);
+
+  uint64_t sequence;
+  while (((sequence = header->sequence.load(std::memory_order_acquire)) & 1) != 0)
+  {
+    std::this_thread::yield();
+  }
+
+  return sequence;
+}
+
+bool SharedMapReader::endRead(uint64_t sequence) const
+{
+  assert(header != nullptr);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  return header->sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+/* end of file */
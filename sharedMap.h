@@ -0,0 +1,243 @@
+/***********************************************************************\
+*
+* Contents: shared map: publish map planes in POSIX shared memory
+* Systems: Unix
+*
+\***********************************************************************/
+#ifndef SHARED_MAP_H
+#define SHARED_MAP_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <cassert>
+
+#include "islands.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/** header of shared map segment; followed by the planes at the given
+ *  offsets: tile types (1 byte per tile), colors (3 bytes RGB per tile),
+ *  island labels (4 bytes per tile), each row by row
+ */
+struct SharedMapHeader
+{
+  char                  magic[4];      // "DWSM"
+  uint32_t              version;       // format version
+  uint32_t              width, height;
+  uint64_t              size;          // segment size [bytes]
+  uint64_t              typesOffset;
+  uint64_t              colorsOffset;
+  uint64_t              labelsOffset;
+  std::atomic<uint64_t> sequence;      // seqlock: odd while publishing
+  std::atomic<uint32_t> stale;         // 1 iff replaced by a new segment (size changed)
+  uint32_t              islandCount;   // number of islands; 0 if not found
+};
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** shared map writer: publishes the tiles and island labels of a map to
+ *  a named POSIX shared memory segment. Only chunks changed since the
+ *  last publish are copied, the island labels only if they changed.
+ *  Readers are never blocked; a sequence lock tells them if they read a
+ *  consistent version.
+ */
+class SharedMapWriter
+{
+  public:
+    /** create shared map writer
+     * @param name segment name, e. g. "/donut-world"
+     */
+    SharedMapWriter(const std::string &name);
+
+    /** destroy shared map writer; removes segment
+     */
+    ~SharedMapWriter();
+
+    /** publish map; creates the segment on first call or if the map
+     *  size changed (the old segment is marked stale)
+     * @param map map
+     */
+    void publish(const Map &map);
+
+    /** get number of publishes
+     * @return number of publishes of current segment
+     */
+    uint64_t getVersion() const;
+
+  private:
+    const std::string name;
+    SharedMapHeader   *header;
+    Map::Snapshot     lastSnapshot;  // tiles of last publish
+
+    SharedMapWriter(const SharedMapWriter&) = delete;
+    SharedMapWriter &operator=(const SharedMapWriter&) = delete;
+
+    /** create segment
+     * @param width,height map size
+     */
+    void create(uint width, uint height);
+
+    /** remove segment
+     */
+    void remove();
+};
+
+/** shared map reader: maps a shared map segment read-only without
+ *  copying. Reads must be enclosed in beginRead()/endRead() and retried
+ *  if endRead() fails:
+ *
+ *    do
+ *    {
+ *      sequence = reader.beginRead();
+ *      ... read planes ...
+ *    }
+ *    while (!reader.endRead(sequence));
+ */
+class SharedMapReader
+{
+  public:
+    SharedMapReader()
+      : header(nullptr)
+      , size(0)
+    {
+    }
+
+    /** destroy shared map reader
+     */
+    ~SharedMapReader()
+    {
+      close();
+    }
+
+    /** open segment
+     * @param name segment name
+     */
+    void open(const std::string &name);
+
+    /** close segment
+     */
+    void close();
+
+    /** check if segment is open
+     * @return true iff open
+     */
+    bool isOpen() const
+    {
+      return header != nullptr;
+    }
+
+    /** check if segment is stale, i. e. replaced by a segment with a new
+     *  map size; reopen to read it
+     * @return true iff stale
+     */
+    bool isStale() const
+    {
+      assert(header != nullptr);
+
+      return header->stale.load(std::memory_order_acquire) != 0;
+    }
+
+    /** get width
+     * @return width
+     */
+    uint getWidth() const
+    {
+      assert(header != nullptr);
+
+      return header->width;
+    }
+
+    /** get height
+     * @return height
+     */
+    uint getHeight() const
+    {
+      assert(header != nullptr);
+
+      return header->height;
+    }
+
+    /** get number of islands
+     * @return number of islands
+     */
+    uint getIslandCount() const
+    {
+      assert(header != nullptr);
+
+      return header->islandCount;
+    }
+
+    /** get tile types plane
+     * @return tile types (Tile::Types), row by row
+     */
+    const uint8_t *getTypes() const
+    {
+      assert(header != nullptr);
+
+      return reinterpret_cast<const uint8_t*>(header) + header->typesOffset;
+    }
+
+    /** get colors plane
+     * @return colors (RGB), row by row
+     */
+    const uint8_t *getColors() const
+    {
+      assert(header != nullptr);
+
+      return reinterpret_cast<const uint8_t*>(header) + header->colorsOffset;
+    }
+
+    /** get island labels plane
+     * @return island labels (1..n or 0), row by row
+     */
+    const uint32_t *getLabels() const
+    {
+      assert(header != nullptr);
+
+      return reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(header) + header->labelsOffset);
+    }
+
+    /** begin read; waits while a publish is in progress
+     * @return sequence number for endRead()
+     */
+    uint64_t beginRead() const;
+
+    /** end read
+     * @param sequence sequence number from beginRead()
+     * @return true iff data read since beginRead() is consistent
+     */
+    bool endRead(uint64_t sequence) const;
+
+    /** get number of publishes
+     * @return number of publishes
+     */
+    uint64_t getVersion() const
+    {
+      assert(header != nullptr);
+
+      return header->sequence.load(std::memory_order_acquire) / 2;
+    }
+
+  private:
+    const SharedMapHeader *header;
+    size_t                size;    // mapped size [bytes]
+
+    SharedMapReader(const SharedMapReader&) = delete;
+    SharedMapReader &operator=(const SharedMapReader&) = delete;
+};
+
+#endif // SHARED_MAP_H
+
+/* end of file */
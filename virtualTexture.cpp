@@ -0,0 +1,710 @@
+/***********************************************************************\
+*
+* Contents: virtual texture: page streamed map texture of any size
+* Systems: all
+*
+\***********************************************************************/
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+#include <epoxy/gl.h>
+
+#include "islands.h"
+
+#include "virtualTexture.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+#define LOCAL static
+
+// no page in slot/no request
+LOCAL const uint64_t NO_PAGE = UINT64_MAX;
+
+// max. page table width+height: page coordinates are fed back with 12 bit
+LOCAL const uint MAX_PAGE_TABLE_SIZE = 4096;
+// max. page cache width+height: cache coordinates are stored with 8 bit
+LOCAL const uint MAX_CACHE_SIZE      = 256;
+
+static_assert(VirtualTexture::PAGE_SHIFT == 7, "PAGE_SHIFT of FRAGMENT_SHADER_FUNCTIONS");
+
+const char *VirtualTexture::FRAGMENT_SHADER_FUNCTIONS =
+  "const int                PAGE_SHIFT = 7;\n"
+  "const int                PAGE_SIZE  = 1 << PAGE_SHIFT;\n"
+  "uniform highp usampler2D virtualTexturePageTable;\n"
+  "uniform mediump sampler2D virtualTextureCache;\n"
+  "uniform highp vec2       virtualTextureMapSize;\n"
+  "uniform highp vec2       virtualTextureCacheSize;\n"
+  "uniform int              virtualTextureMaxLevel;\n"
+  "uniform highp float      virtualTextureLevelBias;\n"
+  "\n"
+  "int virtualTextureLevel(highp vec2 texel)\n"
+  "{\n"
+  "  highp vec2  dx = dFdx(texel);\n"
+  "  highp vec2  dy = dFdy(texel);\n"
+  "  highp float d  = max(max(dot(dx, dx), dot(dy, dy)), 1.0);\n"
+  "  return clamp(int(floor(0.5 * log2(d) + virtualTextureLevelBias)), 0, virtualTextureMaxLevel);\n"
+  "}\n"
+  "\n"
+  "vec4 virtualTextureColor(highp vec2 uv)\n"
+  "{\n"
+  "  if (virtualTextureMaxLevel < 0) return vec4(0.0, 0.0, 0.0, 1.0);\n"
+  "  highp vec2 texel = uv * virtualTextureMapSize;\n"
+  "  int        level = virtualTextureLevel(texel);\n"
+  "  ivec2      t     = ivec2(mod(texel, virtualTextureMapSize));\n"
+  "  uvec4      entry = texelFetch(virtualTexturePageTable, t >> (PAGE_SHIFT + level), level);\n"
+  "  if (entry.w == 0u) return vec4(0.0, 0.0, 0.0, 1.0);\n"
+  "  ivec2      offset = (t >> int(entry.z)) & (PAGE_SIZE - 1);\n"
+  "  highp vec2 p      = (vec2(ivec2(entry.xy) * PAGE_SIZE + offset) + 0.5) / virtualTextureCacheSize;\n"
+  "  return textureLod(virtualTextureCache, p, 0.0);\n"
+  "}\n"
+  "\n"
+  "vec4 virtualTextureFeedback(highp vec2 uv)\n"
+  "{\n"
+  "  highp vec2 texel = uv * virtualTextureMapSize;\n"
+  "  int        level = virtualTextureLevel(texel);\n"
+  "  ivec2      page  = ivec2(mod(texel, virtualTextureMapSize)) >> (PAGE_SHIFT + level);\n"
+  "  return vec4(float(page.x & 255),\n"
+  "              float(page.y & 255),\n"
+  "              float(((page.x >> 8) & 15) | (((page.y >> 8) & 15) << 4)),\n"
+  "              float(level + 1)\n"
+  "             ) / 255.0;\n"
+  "}\n";
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** get page key
+ * @param level mip level
+ * @param x,y page position on level
+ * @return key
+ */
+LOCAL inline uint64_t getPageKey(uint level, uint x, uint y)
+{
+  return (static_cast<uint64_t>(level) << 48) | (static_cast<uint64_t>(y) << 24) | x;
+}
+
+/** get level of page key
+ * @param key key
+ * @return level
+ */
+LOCAL inline uint getPageLevel(uint64_t key)
+{
+  return static_cast<uint>(key >> 48);
+}
+
+/** get x position of page key
+ * @param key key
+ * @return x
+ */
+LOCAL inline uint getPageX(uint64_t key)
+{
+  return static_cast<uint>(key & 0xFFFFFF);
+}
+
+/** get y position of page key
+ * @param key key
+ * @return y
+ */
+LOCAL inline uint getPageY(uint64_t key)
+{
+  return static_cast<uint>((key >> 24) & 0xFFFFFF);
+}
+
+/** get next power of 2
+ * @param n value
+ * @return smallest power of 2 >= n
+ */
+LOCAL inline uint getPowerOf2(uint n)
+{
+  uint p = 1;
+  while (p < n)
+  {
+    p <<= 1;
+  }
+
+  return p;
+}
+
+VirtualTexture::VirtualTexture(uint cacheSize, uint feedbackScale)
+  : feedbackScale(std::max(1U, feedbackScale))
+  , cacheSize(std::min(std::max(1U, cacheSize), MAX_CACHE_SIZE))
+  , mapWidth(0)
+  , mapHeight(0)
+  , pageTableWidth(0)
+  , pageTableHeight(0)
+  , levelCount(0)
+  , mapGeneration(0)
+  , pageTableTexture(0)
+  , cacheTexture(0)
+  , feedbackFramebuffer(0)
+  , feedbackRenderbuffers{0, 0}
+  , feedbackBuffers{0, 0}
+  , feedbackBufferValid{false, false}
+  , feedbackWidth(0)
+  , feedbackHeight(0)
+  , savedFramebuffer(0)
+  , savedViewport{0, 0, 0, 0}
+  , pageTableDirty(false)
+  , frame(0)
+  , uploadCount(0)
+  , quit(false)
+  , generation(0)
+  , mapChanged(false)
+  , currentRequest(NO_PAGE)
+{
+  thread = std::thread(&VirtualTexture::streamer, this);
+}
+
+VirtualTexture::~VirtualTexture()
+{
+  {
+    std::lock_guard<std::mutex> guard(requestLock);
+    quit = true;
+  }
+  requestCondition.notify_all();
+  thread.join();
+}
+
+void VirtualTexture::init()
+{
+  // page cache texture
+  GLint maxTextureSize;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+  cacheSize = std::min(cacheSize, static_cast<uint>(maxTextureSize) / PAGE_SIZE);
+
+  glGenTextures(1, &cacheTexture);
+  glActiveTexture(GL_TEXTURE0 + CACHE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, cacheTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB8, cacheSize * PAGE_SIZE, cacheSize * PAGE_SIZE);
+  glActiveTexture(GL_TEXTURE0);
+
+  slots.assign(cacheSize * cacheSize, Slot{NO_PAGE, 0, 0});
+  residentPages.clear();
+}
+
+void VirtualTexture::done()
+{
+  glDeleteTextures(1, &pageTableTexture);
+  glDeleteTextures(1, &cacheTexture);
+  glDeleteFramebuffers(1, &feedbackFramebuffer);
+  glDeleteRenderbuffers(2, feedbackRenderbuffers);
+  glDeleteBuffers(2, feedbackBuffers);
+  pageTableTexture         = 0;
+  cacheTexture             = 0;
+  feedbackFramebuffer      = 0;
+  feedbackRenderbuffers[0] = 0;
+  feedbackRenderbuffers[1] = 0;
+  feedbackBuffers[0]       = 0;
+  feedbackBuffers[1]       = 0;
+  feedbackBufferValid[0]   = false;
+  feedbackBufferValid[1]   = false;
+  feedbackWidth            = 0;
+  feedbackHeight           = 0;
+
+  mapWidth   = 0;
+  mapHeight  = 0;
+  levelCount = 0;
+  slots.clear();
+  residentPages.clear();
+  pageTable.clear();
+}
+
+void VirtualTexture::setMap(const Map::Snapshot &snapshot)
+{
+  {
+    std::lock_guard<std::mutex> guard(requestLock);
+
+    this->snapshot = snapshot;
+    generation++;
+    mapChanged = true;
+    requests.clear();
+    pages.clear();
+  }
+  requestCondition.notify_all();
+}
+
+void VirtualTexture::update()
+{
+  assert(cacheTexture != 0);
+
+  // get map changes and read pages
+  bool              resizeFlag = false;
+  uint              width      = 0;
+  uint              height     = 0;
+  std::vector<Page> newPages;
+  {
+    std::lock_guard<std::mutex> guard(requestLock);
+
+    if (mapChanged || ((pageTableTexture == 0) && (snapshot.getWidth() > 0)))
+    {
+      width         = snapshot.getWidth();
+      height        = snapshot.getHeight();
+      mapGeneration = generation;
+      mapChanged    = false;
+      resizeFlag    = true;
+    }
+
+    while (!pages.empty() && (newPages.size() < MAX_UPLOADS_PER_FRAME))
+    {
+      newPages.push_back(std::move(pages.front()));
+      pages.pop_front();
+    }
+  }
+
+  if (resizeFlag && ((width != mapWidth) || (height != mapHeight) || (pageTableTexture == 0)))
+  {
+    resize(width, height);
+  }
+
+  // upload pages
+  for (const Page &page : newPages)
+  {
+    if (page.generation == mapGeneration)
+    {
+      upload(page);
+    }
+  }
+
+  if (pageTableDirty)
+  {
+    updatePageTable();
+  }
+}
+
+bool VirtualTexture::isStreaming()
+{
+  std::lock_guard<std::mutex> guard(requestLock);
+
+  return    mapChanged
+         || !requests.empty()
+         || (currentRequest != NO_PAGE)
+         || !pages.empty();
+}
+
+void VirtualTexture::beginFeedback(uint viewWidth, uint viewHeight)
+{
+  const uint width  = std::max(1U, viewWidth  / feedbackScale);
+  const uint height = std::max(1U, viewHeight / feedbackScale);
+
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedFramebuffer);
+  glGetIntegerv(GL_VIEWPORT, savedViewport);
+
+  // create/resize feedback framebuffer
+  if ((feedbackFramebuffer == 0) || (width != feedbackWidth) || (height != feedbackHeight))
+  {
+    if (feedbackFramebuffer == 0)
+    {
+      glGenFramebuffers(1, &feedbackFramebuffer);
+      glGenRenderbuffers(2, feedbackRenderbuffers);
+      glGenBuffers(2, feedbackBuffers);
+    }
+
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackRenderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackRenderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedbackRenderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackRenderbuffers[1]);
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+    for (uint i = 0; i < 2; i++)
+    {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[i]);
+      glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, nullptr, GL_STREAM_READ);
+      feedbackBufferValid[i] = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    feedbackWidth  = width;
+    feedbackHeight = height;
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+  glViewport(0, 0, feedbackWidth, feedbackHeight);
+  glClearColor(0.0, 0.0, 0.0, 0.0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::endFeedback()
+{
+  frame++;
+
+  // start read back of this feedback
+  const uint i = frame % 2;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[i]);
+  glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  feedbackBufferValid[i] = true;
+
+  // process feedback of previous frame: read back is done, no stall
+  const uint j = 1 - i;
+  if (feedbackBufferValid[j])
+  {
+    const size_t pixelCount = static_cast<size_t>(feedbackWidth) * feedbackHeight;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[j]);
+    const void *feedback = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixelCount * 4, GL_MAP_READ_BIT);
+    if (feedback != nullptr)
+    {
+      processFeedback(static_cast<const uint8_t*>(feedback), pixelCount);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    feedbackBufferValid[j] = false;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, savedFramebuffer);
+  glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+void VirtualTexture::bind(GLuint program, bool feedback) const
+{
+  glActiveTexture(GL_TEXTURE0 + PAGE_TABLE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, pageTableTexture);
+  glActiveTexture(GL_TEXTURE0 + CACHE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, cacheTexture);
+  glActiveTexture(GL_TEXTURE0);
+
+  glUniform1i(glGetUniformLocation(program, "virtualTexturePageTable"), PAGE_TABLE_TEXTURE_UNIT);
+  glUniform1i(glGetUniformLocation(program, "virtualTextureCache"), CACHE_TEXTURE_UNIT);
+  glUniform2f(glGetUniformLocation(program, "virtualTextureMapSize"),
+              static_cast<float>(mapWidth),
+              static_cast<float>(mapHeight)
+             );
+  glUniform2f(glGetUniformLocation(program, "virtualTextureCacheSize"),
+              static_cast<float>(cacheSize * PAGE_SIZE),
+              static_cast<float>(cacheSize * PAGE_SIZE)
+             );
+  glUniform1i(glGetUniformLocation(program, "virtualTextureMaxLevel"), static_cast<GLint>(levelCount) - 1);
+  glUniform1f(glGetUniformLocation(program, "virtualTextureLevelBias"),
+              feedback ? -log2f(static_cast<float>(feedbackScale)) : 0.0f
+             );
+}
+
+void VirtualTexture::streamer()
+{
+  while (true)
+  {
+    // get next request
+    uint64_t      key;
+    Map::Snapshot requestSnapshot;
+    uint          requestGeneration;
+    {
+      std::unique_lock<std::mutex> guard(requestLock);
+      requestCondition.wait(guard, [this]() { return quit || !requests.empty(); });
+      if (quit)
+      {
+        break;
+      }
+
+      key = requests.front();
+      requests.pop_front();
+      currentRequest    = key;
+      requestSnapshot   = snapshot;
+      requestGeneration = generation;
+    }
+
+    // read page: every 2^level-th tile, wrapped around the map
+    const uint width  = requestSnapshot.getWidth();
+    const uint height = requestSnapshot.getHeight();
+    const uint level  = getPageLevel(key);
+    const uint64_t x0 = static_cast<uint64_t>(getPageX(key)) * PAGE_SIZE;
+    const uint64_t y0 = static_cast<uint64_t>(getPageY(key)) * PAGE_SIZE;
+
+    Page page;
+    page.key        = key;
+    page.generation = requestGeneration;
+    page.data.resize(PAGE_SIZE * PAGE_SIZE * 3);
+    if ((width > 0) && (height > 0))
+    {
+      uint8_t *p = page.data.data();
+      for (uint j = 0; j < PAGE_SIZE; j++)
+      {
+        const uint y = static_cast<uint>(((y0 + j) << level) % height);
+        for (uint i = 0; i < PAGE_SIZE; i++)
+        {
+          const uint  x     = static_cast<uint>(((x0 + i) << level) % width);
+          const Color color = requestSnapshot.getTile(x, y).getColor();
+
+          (*p++) = color.r;
+          (*p++) = color.g;
+          (*p++) = color.b;
+        }
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(requestLock);
+
+      currentRequest = NO_PAGE;
+      if (requestGeneration == generation)
+      {
+        pages.push_back(std::move(page));
+      }
+    }
+  }
+}
+
+void VirtualTexture::resize(uint width, uint height)
+{
+  mapWidth  = width;
+  mapHeight = height;
+
+  glDeleteTextures(1, &pageTableTexture);
+  pageTableTexture = 0;
+  levelCount       = 0;
+  pageTable.clear();
+  slots.assign(cacheSize * cacheSize, Slot{NO_PAGE, 0, 0});
+  residentPages.clear();
+
+  if ((width == 0) || (height == 0))
+  {
+    return;
+  }
+
+  // page pyramid: level 0 page table padded to a power of 2, so page
+  // (x,y) of level l+1 is the parent of page (2x..2x+1,2y..2y+1) of level l
+  pageTableWidth  = getPowerOf2((width  + PAGE_SIZE - 1) / PAGE_SIZE);
+  pageTableHeight = getPowerOf2((height + PAGE_SIZE - 1) / PAGE_SIZE);
+  assert(pageTableWidth  <= MAX_PAGE_TABLE_SIZE);
+  assert(pageTableHeight <= MAX_PAGE_TABLE_SIZE);
+  while ((std::max(pageTableWidth, pageTableHeight) >> levelCount) > 0)
+  {
+    levelCount++;
+  }
+  pageTable.resize(levelCount);
+
+  glGenTextures(1, &pageTableTexture);
+  glActiveTexture(GL_TEXTURE0 + PAGE_TABLE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, pageTableTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+  glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_RGBA8UI, pageTableWidth, pageTableHeight);
+  glActiveTexture(GL_TEXTURE0);
+
+  pageTableDirty = true;
+}
+
+void VirtualTexture::processFeedback(const uint8_t *feedback, size_t pixelCount)
+{
+  if (levelCount == 0)
+  {
+    return;
+  }
+
+  // get visible pages
+  std::vector<uint64_t> keys;
+  for (size_t i = 0; i < pixelCount; i++)
+  {
+    const uint8_t *p = &feedback[i * 4];
+    if (p[3] != 0)
+    {
+      keys.push_back(getPageKey(p[3] - 1,
+                                p[0] | ((p[2] & 0x0F) << 8),
+                                p[1] | ((p[2] >> 4) << 8)
+                               )
+                    );
+    }
+  }
+  keys.push_back(getPageKey(levelCount - 1, 0, 0));
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // mark visible pages and their coarser fallback pages as used, get
+  // missing or stale pages
+  std::vector<uint64_t> missingKeys;
+  for (uint64_t key : keys)
+  {
+    const uint level = getPageLevel(key);
+    if (level >= levelCount)
+    {
+      continue;
+    }
+
+    auto iterator = residentPages.find(key);
+    if ((iterator == residentPages.end()) || (slots[iterator->second].generation != mapGeneration))
+    {
+      missingKeys.push_back(key);
+    }
+    for (uint l = level; l < levelCount; l++)
+    {
+      iterator = residentPages.find(getPageKey(l, getPageX(key) >> (l - level), getPageY(key) >> (l - level)));
+      if (iterator != residentPages.end())
+      {
+        slots[iterator->second].lastUsed = frame;
+      }
+    }
+  }
+
+  // request missing pages, coarse pages first: they cover most of the view
+  std::stable_sort(missingKeys.begin(),
+                   missingKeys.end(),
+                   [](uint64_t key0, uint64_t key1)
+                   {
+                     return getPageLevel(key0) > getPageLevel(key1);
+                   }
+                  );
+  {
+    std::lock_guard<std::mutex> guard(requestLock);
+
+    requests.clear();
+    for (uint64_t key : missingKeys)
+    {
+      if (   (key != currentRequest)
+          && std::none_of(pages.begin(), pages.end(), [key](const Page &page) { return page.key == key; })
+         )
+      {
+        requests.push_back(key);
+      }
+    }
+  }
+  requestCondition.notify_all();
+}
+
+void VirtualTexture::upload(const Page &page)
+{
+  // get slot: same page, free slot or least recently used slot not used
+  // in the current frame; the coarsest page is never evicted
+  const uint64_t rootKey = getPageKey(levelCount - 1, 0, 0);
+  uint           slot;
+  auto iterator = residentPages.find(page.key);
+  if (iterator != residentPages.end())
+  {
+    slot = iterator->second;
+  }
+  else
+  {
+    slot = slots.size();
+    for (uint i = 0; i < slots.size(); i++)
+    {
+      if (slots[i].key == NO_PAGE)
+      {
+        slot = i;
+        break;
+      }
+      if (   (slots[i].key != rootKey)
+          && (slots[i].lastUsed < frame)
+          && ((slot == slots.size()) || (slots[i].lastUsed < slots[slot].lastUsed))
+         )
+      {
+        slot = i;
+      }
+    }
+    if (slot == slots.size())
+    {
+      // cache full with visible pages
+      return;
+    }
+
+    if (slots[slot].key != NO_PAGE)
+    {
+      residentPages.erase(slots[slot].key);
+    }
+    residentPages[page.key] = slot;
+    slots[slot].key         = page.key;
+  }
+  slots[slot].lastUsed   = frame;
+  slots[slot].generation = page.generation;
+
+  glActiveTexture(GL_TEXTURE0 + CACHE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, cacheTexture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D,
+                  0,
+                  (slot % cacheSize) * PAGE_SIZE,
+                  (slot / cacheSize) * PAGE_SIZE,
+                  PAGE_SIZE,
+                  PAGE_SIZE,
+                  GL_RGB,
+                  GL_UNSIGNED_BYTE,
+                  page.data.data()
+                 );
+  glActiveTexture(GL_TEXTURE0);
+
+  uploadCount++;
+  pageTableDirty = true;
+}
+
+void VirtualTexture::updatePageTable()
+{
+  // entry: cache page x, y, level of mapped page, valid; a missing page
+  // maps to the entry of its parent page
+  glActiveTexture(GL_TEXTURE0 + PAGE_TABLE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, pageTableTexture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (uint level = levelCount; level-- > 0; )
+  {
+    const uint width        = std::max(1U, pageTableWidth  >> level);
+    const uint height       = std::max(1U, pageTableHeight >> level);
+    const uint parentWidth  = std::max(1U, pageTableWidth  >> (level + 1));
+
+    std::vector<uint8_t> &entries = pageTable[level];
+    entries.resize(static_cast<size_t>(width) * height * 4);
+    for (uint y = 0; y < height; y++)
+    {
+      for (uint x = 0; x < width; x++)
+      {
+        uint8_t *entry = &entries[(static_cast<size_t>(y) * width + x) * 4];
+
+        auto iterator = residentPages.find(getPageKey(level, x, y));
+        if (iterator != residentPages.end())
+        {
+          entry[0] = static_cast<uint8_t>(iterator->second % cacheSize);
+          entry[1] = static_cast<uint8_t>(iterator->second / cacheSize);
+          entry[2] = static_cast<uint8_t>(level);
+          entry[3] = 1;
+        }
+        else if (level + 1 < levelCount)
+        {
+          memcpy(entry, &pageTable[level + 1][((static_cast<size_t>(y) / 2) * parentWidth + x / 2) * 4], 4);
+        }
+        else
+        {
+          memset(entry, 0, 4);
+        }
+      }
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    level,
+                    0,
+                    0,
+                    width,
+                    height,
+                    GL_RGBA_INTEGER,
+                    GL_UNSIGNED_BYTE,
+                    entries.data()
+                   );
+  }
+  glActiveTexture(GL_TEXTURE0);
+
+  pageTableDirty = false;
+}
+
+/* end of file */
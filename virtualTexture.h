@@ -0,0 +1,241 @@
+/***********************************************************************\
+*
+* Contents: virtual texture: page streamed map texture of any size
+* Systems: all
+*
+\***********************************************************************/
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+/****************************** Includes *******************************/
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <epoxy/gl.h>
+
+#include "islands.h"
+
+/****************** Conditional compilation switches *******************/
+
+/***************************** Constants *******************************/
+
+/***************************** Datatypes *******************************/
+
+/***************************** Variables *******************************/
+
+/****************************** Macros *********************************/
+
+/***************************** Forwards ********************************/
+
+/***************************** Functions *******************************/
+
+/** virtual texture: displays the tile colors of a map of any size with
+ *  GPU memory bounded by the view size. The map is divided into pages of
+ *  PAGE_SIZE x PAGE_SIZE texels on a mip pyramid (level l samples every
+ *  2^l-th tile). Resident pages are kept in a physical page cache
+ *  texture; a page table texture maps each virtual page to a cache page
+ *  or to its nearest resident coarser page. The visible pages are found
+ *  by rendering the scene at low resolution with
+ *  FRAGMENT_SHADER_FUNCTIONS/virtualTextureFeedback() between
+ *  beginFeedback() and endFeedback(); missing pages are read from the map
+ *  by a background thread and uploaded by update().
+ *
+ *  All methods except setMap() must be called in the GL context.
+ *
+ *  Usage per frame:
+ *
+ *    virtualTexture.update();
+ *    virtualTexture.beginFeedback(viewWidth, viewHeight);
+ *    ... draw scene with feedback program, bind(feedbackProgram, true) ...
+ *    virtualTexture.endFeedback();
+ *    ... draw scene with program, bind(program, false) ...
+ */
+class VirtualTexture
+{
+  public:
+    // page width+height [texels]: 2^PAGE_SHIFT
+    static const uint PAGE_SHIFT                  = 7;
+    static const uint PAGE_SIZE                   = 1 << PAGE_SHIFT;
+    // default page cache width+height [pages]
+    static const uint DEFAULT_CACHE_SIZE          = 16;
+    // default feedback resolution divisor
+    static const uint DEFAULT_FEEDBACK_SCALE      = 8;
+    // max. number of page uploads per frame
+    static const uint MAX_UPLOADS_PER_FRAME       = 16;
+    // texture units used by bind()
+    static const uint PAGE_TABLE_TEXTURE_UNIT     = 1;
+    static const uint CACHE_TEXTURE_UNIT          = 2;
+
+    /** GLSL ES 3.00 fragment shader functions; insert after the
+     *  #version/precision lines:
+     *
+     *    vec4 virtualTextureColor(vec2 uv)     color at UV position
+     *    vec4 virtualTextureFeedback(vec2 uv)  page request at UV position
+     *
+     *  UV positions are not wrapped; [0..1] covers the map once.
+     */
+    static const char *FRAGMENT_SHADER_FUNCTIONS;
+
+    /** create virtual texture
+     * @param cacheSize page cache width+height [pages]
+     * @param feedbackScale feedback resolution divisor
+     */
+    VirtualTexture(uint cacheSize     = DEFAULT_CACHE_SIZE,
+                   uint feedbackScale = DEFAULT_FEEDBACK_SCALE
+                  );
+
+    /** destroy virtual texture; GL objects must be released with done()
+     */
+    ~VirtualTexture();
+
+    /** create GL objects
+     */
+    void init();
+
+    /** release GL objects
+     */
+    void done();
+
+    /** set map to display; pages of the previous map stay visible until
+     *  they are replaced. May be called from any thread.
+     * @param snapshot map snapshot
+     */
+    void setMap(const Map::Snapshot &snapshot);
+
+    /** upload streamed pages and update page table
+     */
+    void update();
+
+    /** begin feedback pass: bind and clear feedback framebuffer
+     * @param viewWidth,viewHeight view size [pixels]
+     */
+    void beginFeedback(uint viewWidth, uint viewHeight);
+
+    /** end feedback pass: start read back of feedback, request missing
+     *  pages of the previous feedback and restore framebuffer
+     */
+    void endFeedback();
+
+    /** bind textures and set uniforms of FRAGMENT_SHADER_FUNCTIONS
+     * @param program current program
+     * @param feedback true for the feedback pass
+     */
+    void bind(GLuint program, bool feedback) const;
+
+    /** check if pages are streamed: a map change, requested pages or read
+     *  pages are not yet uploaded
+     * @return true iff streaming; render further frames to finish it
+     */
+    bool isStreaming();
+
+    /** get number of resident pages
+     * @return number of pages in page cache
+     */
+    uint getResidentPageCount() const
+    {
+      return static_cast<uint>(residentPages.size());
+    }
+
+    /** get number of uploaded pages
+     * @return number of pages uploaded since init()
+     */
+    uint64_t getUploadCount() const
+    {
+      return uploadCount;
+    }
+
+  private:
+    /** page cache slot
+     */
+    struct Slot
+    {
+      uint64_t key;           // page key or NO_PAGE
+      uint64_t lastUsed;      // frame of last use
+      uint     generation;    // map generation of content
+    };
+
+    /** streamed page
+     */
+    struct Page
+    {
+      uint64_t             key;
+      uint                 generation;
+      std::vector<uint8_t> data;  // RGB, PAGE_SIZE x PAGE_SIZE
+    };
+
+    const uint   feedbackScale;
+    uint         cacheSize;                 // [pages]
+
+    // map, page pyramid
+    uint         mapWidth, mapHeight;
+    uint         pageTableWidth, pageTableHeight;  // level 0, power of 2
+    uint         levelCount;
+    uint         mapGeneration;             // generation of displayed map
+
+    // GL objects
+    GLuint       pageTableTexture;
+    GLuint       cacheTexture;
+    GLuint       feedbackFramebuffer;
+    GLuint       feedbackRenderbuffers[2];  // color, depth
+    GLuint       feedbackBuffers[2];        // pixel pack buffers
+    bool         feedbackBufferValid[2];
+    uint         feedbackWidth, feedbackHeight;
+    GLint        savedFramebuffer;
+    GLint        savedViewport[4];
+
+    // page cache
+    std::vector<Slot>                     slots;
+    std::unordered_map<uint64_t, uint>    residentPages;   // key -> slot
+    std::vector<std::vector<uint8_t>>     pageTable;       // per level RGBA
+    bool                                  pageTableDirty;
+    uint64_t                              frame;
+    uint64_t                              uploadCount;
+
+    // streaming
+    std::thread                           thread;
+    std::mutex                            requestLock;
+    std::condition_variable               requestCondition;
+    bool                                  quit;
+    Map::Snapshot                         snapshot;
+    uint                                  generation;       // incremented by setMap()
+    bool                                  mapChanged;
+    std::deque<uint64_t>                  requests;         // coarse pages first
+    uint64_t                              currentRequest;   // page read by streamer or NO_PAGE
+    std::deque<Page>                      pages;            // read pages to upload
+
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture &operator=(const VirtualTexture&) = delete;
+
+    /** streaming thread: read requested pages from map
+     */
+    void streamer();
+
+    /** setup page pyramid for map size
+     * @param width,height map size
+     */
+    void resize(uint width, uint height);
+
+    /** request missing and stale pages of a feedback buffer
+     * @param feedback feedback pixels (RGBA)
+     * @param pixelCount number of pixels
+     */
+    void processFeedback(const uint8_t *feedback, size_t pixelCount);
+
+    /** upload page to page cache
+     * @param page page
+     */
+    void upload(const Page &page);
+
+    /** rebuild and upload page table
+     */
+    void updatePageTable();
+};
+
+#endif // VIRTUAL_TEXTURE_H
+
+/* end of file */